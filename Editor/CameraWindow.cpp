@@ -102,6 +102,7 @@ CameraWindow::CameraWindow(wiGUI* gui) :GUI(gui)
 		if (proxy != nullptr)
 		{
 			proxy->name = args.sValue;
+			wiRenderer::GetScene().InvalidateLookups();
 		}
 	});
 	cameraWindow->AddWidget(proxyNameField);
@@ -27,7 +27,10 @@ MaterialWindow::MaterialWindow(wiGUI* gui) : GUI(gui)
 	materialNameField->SetSize(XMFLOAT2(300, 20));
 	materialNameField->OnInputAccepted([&](wiEventArgs args) {
 		if (material != nullptr)
+		{
 			material->name = args.sValue;
+			wiRenderer::GetScene().InvalidateLookups();
+		}
 	});
 	materialWindow->AddWidget(materialNameField);
 
@@ -304,7 +307,7 @@ MaterialWindow::MaterialWindow(wiGUI* gui) : GUI(gui)
 			ofn.Flags = 0;
 			if (GetSaveFileNameA(&ofn) == TRUE) {
 				string fileName = ofn.lpstrFile;
-				material->texture = (Texture2D*)wiResourceManager::GetGlobal()->add(fileName);
+				material->texture = (Texture2D*)wiResourceManager::GetGlobal()->add(fileName, wiResourceManager::IMAGE_BASECOLOR);
 				material->textureName = fileName;
 				texture_baseColor_Button->SetText(wiHelper::GetFileNameFromPath(material->textureName));
 			}
@@ -355,7 +358,7 @@ MaterialWindow::MaterialWindow(wiGUI* gui) : GUI(gui)
 			ofn.Flags = 0;
 			if (GetSaveFileNameA(&ofn) == TRUE) {
 				string fileName = ofn.lpstrFile;
-				material->normalMap = (Texture2D*)wiResourceManager::GetGlobal()->add(fileName);
+				material->normalMap = (Texture2D*)wiResourceManager::GetGlobal()->add(fileName, wiResourceManager::IMAGE_NORMALMAP);
 				material->normalMapName = fileName;
 				texture_normal_Button->SetText(wiHelper::GetFileNameFromPath(material->normalMapName));
 			}
@@ -406,7 +409,7 @@ MaterialWindow::MaterialWindow(wiGUI* gui) : GUI(gui)
 			ofn.Flags = 0;
 			if (GetSaveFileNameA(&ofn) == TRUE) {
 				string fileName = ofn.lpstrFile;
-				material->surfaceMap = (Texture2D*)wiResourceManager::GetGlobal()->add(fileName);
+				material->surfaceMap = (Texture2D*)wiResourceManager::GetGlobal()->add(fileName, wiResourceManager::IMAGE_LINEAR);
 				material->surfaceMapName = fileName;
 				texture_surface_Button->SetText(wiHelper::GetFileNameFromPath(material->surfaceMapName));
 			}
@@ -457,7 +460,7 @@ MaterialWindow::MaterialWindow(wiGUI* gui) : GUI(gui)
 			ofn.Flags = 0;
 			if (GetSaveFileNameA(&ofn) == TRUE) {
 				string fileName = ofn.lpstrFile;
-				material->displacementMap = (Texture2D*)wiResourceManager::GetGlobal()->add(fileName);
+				material->displacementMap = (Texture2D*)wiResourceManager::GetGlobal()->add(fileName, wiResourceManager::IMAGE_LINEAR);
 				material->displacementMapName = fileName;
 				texture_displacement_Button->SetText(wiHelper::GetFileNameFromPath(material->displacementMapName));
 			}
@@ -15,7 +15,7 @@ MeshWindow::MeshWindow(wiGUI* gui) : GUI(gui)
 
 
 	meshWindow = new wiWindow(GUI, "Mesh Window");
-	meshWindow->SetSize(XMFLOAT2(800, 600));
+	meshWindow->SetSize(XMFLOAT2(800, 640));
 	meshWindow->SetEnabled(false);
 	GUI->AddWidget(meshWindow);
 
@@ -41,6 +41,17 @@ MeshWindow::MeshWindow(wiGUI* gui) : GUI(gui)
 	});
 	meshWindow->AddWidget(doubleSidedCheckBox);
 
+	occluderCheckBox = new wiCheckBox("Occluder: ");
+	occluderCheckBox->SetTooltip("If enabled, the mesh hides the objects behind it with software occlusion culling. Use it for large, closed meshes with few triangles.");
+	occluderCheckBox->SetPos(XMFLOAT2(x, y += step));
+	occluderCheckBox->OnClick([&](wiEventArgs args) {
+		if (mesh != nullptr)
+		{
+			mesh->occluder = args.bValue;
+		}
+	});
+	meshWindow->AddWidget(occluderCheckBox);
+
 	massSlider = new wiSlider(0, 5000, 0, 100000, "Mass: ");
 	massSlider->SetTooltip("Set the mass amount for the physics engine.");
 	massSlider->SetSize(XMFLOAT2(100, 30));
@@ -183,6 +194,7 @@ void MeshWindow::SetMesh(Mesh* mesh)
 		meshInfoLabel->SetText(ss.str());
 
 		doubleSidedCheckBox->SetCheck(mesh->doubleSided);
+		occluderCheckBox->SetCheck(mesh->occluder);
 		massSlider->SetValue(mesh->mass);
 		frictionSlider->SetValue(mesh->friction);
 		impostorDistanceSlider->SetValue(mesh->impostorDistance);
@@ -27,6 +27,7 @@ public:
 	wiWindow*	meshWindow;
 	wiLabel*	meshInfoLabel;
 	wiCheckBox* doubleSidedCheckBox;
+	wiCheckBox* occluderCheckBox;
 	wiSlider*	massSlider;
 	wiSlider*	frictionSlider;
 	wiButton*	impostorCreateButton;
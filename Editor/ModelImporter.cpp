@@ -0,0 +1,45 @@
+#include "stdafx.h"
+#include "ModelImporter.h"
+
+#include <sstream>
+#include <iomanip>
+
+using namespace std;
+using namespace wiSceneComponents;
+
+void OptimizeMeshes(Model* model, const std::string& fileName)
+{
+	vector<Mesh*> meshArray;
+	for (auto& x : model->meshes)
+	{
+		if (x.second != nullptr && !x.second->optimized)
+		{
+			meshArray.push_back(x.second);
+		}
+	}
+	if (meshArray.empty())
+	{
+		return;
+	}
+
+	vector<wiMeshOptimizer::CacheStats> statsBefore(meshArray.size());
+	vector<wiMeshOptimizer::CacheStats> statsAfter(meshArray.size());
+	wiJobSystem::context ctx;
+	wiJobSystem::Dispatch(ctx, (uint32_t)meshArray.size(), 1, [&](wiJobSystem::JobDispatchArgs args) {
+		meshArray[args.jobIndex]->Optimize(&statsBefore[args.jobIndex], &statsAfter[args.jobIndex]);
+	});
+	wiJobSystem::Wait(ctx);
+
+	wiMeshOptimizer::CacheStats before, after;
+	for (size_t i = 0; i < meshArray.size(); ++i)
+	{
+		before += statsBefore[i];
+		after += statsAfter[i];
+	}
+
+	stringstream ss("");
+	ss << fixed << setprecision(3);
+	ss << "[" << fileName << "] optimized " << meshArray.size() << " meshes (" << after.triangleCount << " triangles), vertex cache ACMR: "
+		<< before.GetACMR() << " -> " << after.GetACMR() << ", ATVR: " << before.GetATVR() << " -> " << after.GetATVR();
+	wiBackLog::post(ss.str().c_str());
+}
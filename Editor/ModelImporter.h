@@ -10,3 +10,5 @@ wiSceneComponents::Model* ImportModel_WIO(const std::string& fileName);
 wiSceneComponents::Model* ImportModel_OBJ(const std::string& fileName);
 wiSceneComponents::Model* ImportModel_GLTF(const std::string& fileName);
 
+// Optimize the meshes of an imported model for the GPU in parallel (before FinishLoading() would), and post the vertex cache statistics to the backlog
+void OptimizeMeshes(wiSceneComponents::Model* model, const std::string& fileName);
@@ -22,66 +22,18 @@ const bool transform_to_LH = true;
 
 namespace tinygltf
 {
+	// The encoded image is only copied here, the images are decoded in parallel after the file is parsed (DecodeImage)
 	bool LoadImageData(Image *image, std::string *err, std::string *warn,
 		int req_width, int req_height, const unsigned char *bytes,
 		int size, void *)
 	{
+		(void)err;
 		(void)warn;
 
-		const int requiredComponents = 4;
-
-		int w, h, comp;
-		// if image cannot be decoded, ignore parsing and keep it by its path
-		// don't break in this case
-		// FIXME we should only enter this function if the image is embedded. If
-		// image->uri references
-		// an image file, it should be left as it is. Image loading should not be
-		// mandatory (to support other formats)
-		unsigned char *data = stbi_load_from_memory(bytes, size, &w, &h, &comp, requiredComponents);
-		if (!data) {
-			// NOTE: you can use `warn` instead of `err`
-			if (err) {
-				(*err) += "Unknown image format.\n";
-			}
-			return false;
-		}
-
-		if (w < 1 || h < 1) {
-			free(data);
-			if (err) {
-				(*err) += "Invalid image data.\n";
-			}
-			return false;
-		}
-
-		if (req_width > 0) {
-			if (req_width != w) {
-				free(data);
-				if (err) {
-					(*err) += "Image width mismatch.\n";
-				}
-				return false;
-			}
-		}
-
-		if (req_height > 0) {
-			if (req_height != h) {
-				free(data);
-				if (err) {
-					(*err) += "Image height mismatch.\n";
-				}
-				return false;
-			}
-		}
-
-		image->width = w;
-		image->height = h;
-		//image->component = comp;
-		image->component = requiredComponents;
-		image->image.resize(static_cast<size_t>(w * h * image->component));
-		std::copy(data, data + w * h * image->component, image->image.begin());
-
-		free(data);
+		image->width = req_width;
+		image->height = req_height;
+		image->component = 0; // not decoded yet
+		image->image.assign(bytes, bytes + size);
 
 		return true;
 
@@ -165,6 +117,74 @@ namespace tinygltf
 }
 
 
+// Decode an image that was copied by LoadImageData to rgba8
+bool DecodeImage(tinygltf::Image *image, std::string *err)
+{
+	if (image->image.empty() || image->component != 0)
+	{
+		// external image that couldn't be loaded, or it is decoded already
+		return true;
+	}
+
+	const int requiredComponents = 4;
+	const int req_width = image->width;
+	const int req_height = image->height;
+
+	int w, h, comp;
+	// if image cannot be decoded, ignore parsing and keep it by its path
+	// don't break in this case
+	// FIXME we should only enter this function if the image is embedded. If
+	// image->uri references
+	// an image file, it should be left as it is. Image loading should not be
+	// mandatory (to support other formats)
+	unsigned char *data = stbi_load_from_memory(image->image.data(), (int)image->image.size(), &w, &h, &comp, requiredComponents);
+	if (!data) {
+		// NOTE: you can use `warn` instead of `err`
+		if (err) {
+			(*err) += "Unknown image format.\n";
+		}
+		return false;
+	}
+
+	if (w < 1 || h < 1) {
+		free(data);
+		if (err) {
+			(*err) += "Invalid image data.\n";
+		}
+		return false;
+	}
+
+	if (req_width > 0) {
+		if (req_width != w) {
+			free(data);
+			if (err) {
+				(*err) += "Image width mismatch.\n";
+			}
+			return false;
+		}
+	}
+
+	if (req_height > 0) {
+		if (req_height != h) {
+			free(data);
+			if (err) {
+				(*err) += "Image height mismatch.\n";
+			}
+			return false;
+		}
+	}
+
+	image->width = w;
+	image->height = h;
+	//image->component = comp;
+	image->component = requiredComponents;
+	image->image.assign(data, data + w * h * image->component);
+
+	free(data);
+
+	return true;
+}
+
 void RegisterTexture2D(tinygltf::Image *image)
 {
 	// We will load the texture2d by hand here and register to the resource manager
@@ -174,7 +194,7 @@ void RegisterTexture2D(tinygltf::Image *image)
 		int channelCount = image->component;
 		const unsigned char* rgb = image->image.data();
 
-		if (rgb != nullptr)
+		if (rgb != nullptr && !image->image.empty())
 		{
 			TextureDesc desc;
 			desc.ArraySize = 1;
@@ -220,270 +240,270 @@ void RegisterTexture2D(tinygltf::Image *image)
 	}
 }
 
-void LoadNode(tinygltf::Node* node, tinygltf::Node* parent, Model* model, tinygltf::Model& gltfModel, vector<Mesh*>& meshArray, vector<Armature*>& armatureArray)
+// Convert a glTF mesh. It only reads the glTF model, the materials and the armatures, so meshes can be created in parallel
+Mesh* CreateMesh(const tinygltf::Mesh& x, Model* model, const tinygltf::Model& gltfModel, const vector<Armature*>& armatureArray)
 {
-	if (node == nullptr)
-	{
-		return;
-	}
+	Mesh* mesh = new Mesh(x.name);
 
-	Transform transform;
-	if (!node->scale.empty())
-	{
-		transform.scale_rest = XMFLOAT3((float)node->scale[0], (float)node->scale[1], (float)node->scale[2]);
-	}
-	if (!node->rotation.empty())
-	{
-		transform.rotation_rest = XMFLOAT4((float)node->rotation[0], (float)node->rotation[1], (float)node->rotation[2], (float)node->rotation[3]);
-	}
-	if (!node->translation.empty())
-	{
-		transform.translation_rest = XMFLOAT3((float)node->translation[0], (float)node->translation[1], (float)node->translation[2]);
-	}
-	transform.UpdateTransform();
+	mesh->renderable = true;
 
-	if (parent != nullptr)
-	{
-		transform.parentName = parent->name;
-	}
+	XMFLOAT3 min = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+	XMFLOAT3 max = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
 
-	if(node->mesh >= 0)
+	for (auto& prim : x.primitives)
 	{
-		Object* object = new Object(node->name);
-		model->objects.insert(object);
+		assert(prim.indices >= 0);
 
-		*(Transform*)object = transform;
+		// Fill indices:
+		const tinygltf::Accessor& accessor = gltfModel.accessors[prim.indices];
+		const tinygltf::BufferView& bufferView = gltfModel.bufferViews[accessor.bufferView];
+		const tinygltf::Buffer& buffer = gltfModel.buffers[bufferView.buffer];
 
-		if (node->mesh < meshArray.size())
+		int stride = accessor.ByteStride(bufferView);
+		size_t count = accessor.count;
+
+		size_t offset = mesh->indices.size();
+		mesh->indices.resize(offset + count);
+
+		const unsigned char* data = buffer.data.data() + accessor.byteOffset + bufferView.byteOffset;
+
+		if (stride == 1)
 		{
-			object->mesh = meshArray[node->mesh];
-			object->meshName = object->mesh->name;
+			for (size_t i = 0; i < count; i += 3)
+			{
+				mesh->indices[offset + i + 0] = data[i + 0];
+				mesh->indices[offset + i + 1] = data[i + 1];
+				mesh->indices[offset + i + 2] = data[i + 2];
+			}
+		}
+		else if (stride == 2)
+		{
+			for (size_t i = 0; i < count; i += 3)
+			{
+				mesh->indices[offset + i + 0] = ((uint16_t*)data)[i + 0];
+				mesh->indices[offset + i + 1] = ((uint16_t*)data)[i + 1];
+				mesh->indices[offset + i + 2] = ((uint16_t*)data)[i + 2];
+			}
+		}
+		else if (stride == 4)
+		{
+			for (size_t i = 0; i < count; i += 3)
+			{
+				mesh->indices[offset + i + 0] = ((uint32_t*)data)[i + 0];
+				mesh->indices[offset + i + 1] = ((uint32_t*)data)[i + 1];
+				mesh->indices[offset + i + 2] = ((uint32_t*)data)[i + 2];
+			}
 		}
 		else
 		{
-			auto& x = gltfModel.meshes[node->mesh];
-			Mesh* mesh = new Mesh(x.name);
-			meshArray.push_back(mesh);
-
-			object->mesh = mesh;
-			object->meshName = mesh->name;
+			assert(0 && "unsupported index stride!");
+		}
 
-			mesh->renderable = true;
 
-			XMFLOAT3 min = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
-			XMFLOAT3 max = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		// Create mesh subset:
+		MeshSubset subset;
 
-			for (auto& prim : x.primitives)
+		if (prim.material >= 0)
+		{
+			const string& mat_name = gltfModel.materials[prim.material].name;
+			auto& found_mat = model->materials.find(mat_name);
+			if (found_mat != model->materials.end())
 			{
-				assert(prim.indices >= 0);
+				subset.material = found_mat->second;
+			}
+		}
 
-				// Fill indices:
-				const tinygltf::Accessor& accessor = gltfModel.accessors[prim.indices];
-				const tinygltf::BufferView& bufferView = gltfModel.bufferViews[accessor.bufferView];
-				const tinygltf::Buffer& buffer = gltfModel.buffers[bufferView.buffer];
+		if (subset.material == nullptr)
+		{
+			subset.material = new Material("gltfLoader_defaultMat");
+		}
 
-				int stride = accessor.ByteStride(bufferView);
-				size_t count = accessor.count;
+		mesh->subsets.push_back(subset);
+		mesh->materialNames.push_back(subset.material->name);
+	}
 
-				size_t offset = mesh->indices.size();
-				mesh->indices.resize(offset + count);
+	bool hasBoneWeights = false;
+	bool hasBoneIndices = false;
+	bool hasNormals = false;
 
-				const unsigned char* data = buffer.data.data() + accessor.byteOffset + bufferView.byteOffset;
+	int matIndex = -1;
+	for (auto& prim : x.primitives)
+	{
+		matIndex++;
+		size_t offset = mesh->vertices_FULL.size();
+
+		for (auto& attr : prim.attributes)
+		{
+			const string& attr_name = attr.first;
+			int attr_data = attr.second;
+
+			const tinygltf::Accessor& accessor = gltfModel.accessors[attr_data];
+			const tinygltf::BufferView& bufferView = gltfModel.bufferViews[accessor.bufferView];
+			const tinygltf::Buffer& buffer = gltfModel.buffers[bufferView.buffer];
+
+			int stride = accessor.ByteStride(bufferView);
+			size_t count = accessor.count;
+
+			if (mesh->vertices_FULL.size() == offset)
+			{
+				mesh->vertices_FULL.resize(offset + count);
+			}
+
+			const unsigned char* data = buffer.data.data() + accessor.byteOffset + bufferView.byteOffset;
 
-				if (stride == 1)
+			if (!attr_name.compare("POSITION"))
+			{
+				assert(stride == 12);
+				for (size_t i = 0; i < count; ++i)
 				{
-					for (size_t i = 0; i < count; i += 3)
+					XMFLOAT3 pos = ((XMFLOAT3*)data)[i];
+
+					if (transform_to_LH)
 					{
-						mesh->indices[offset + i + 0] = data[i + 0];
-						mesh->indices[offset + i + 1] = data[i + 1];
-						mesh->indices[offset + i + 2] = data[i + 2];
+						pos.z = -pos.z;
 					}
+
+					mesh->vertices_FULL[offset + i].pos = XMFLOAT4(pos.x, pos.y, pos.z, 0);
+
+					min = wiMath::Min(min, pos);
+					max = wiMath::Max(max, pos);
 				}
-				else if (stride == 2)
+			}
+			else if (!attr_name.compare("NORMAL"))
+			{
+				hasNormals = true;
+				assert(stride == 12);
+				for (size_t i = 0; i < count; ++i)
 				{
-					for (size_t i = 0; i < count; i += 3)
-					{
-						mesh->indices[offset + i + 0] = ((uint16_t*)data)[i + 0];
-						mesh->indices[offset + i + 1] = ((uint16_t*)data)[i + 1];
-						mesh->indices[offset + i + 2] = ((uint16_t*)data)[i + 2];
-					}
+					const XMFLOAT3& nor = ((XMFLOAT3*)data)[i];
+
+					mesh->vertices_FULL[offset + i].nor.x = nor.x;
+					mesh->vertices_FULL[offset + i].nor.y = nor.y;
+					mesh->vertices_FULL[offset + i].nor.z = -nor.z;
 				}
-				else if (stride == 4)
+			}
+			else if (!attr_name.compare("TEXCOORD_0"))
+			{
+				assert(stride == 8);
+				for (size_t i = 0; i < count; ++i)
 				{
-					for (size_t i = 0; i < count; i += 3)
-					{
-						mesh->indices[offset + i + 0] = ((uint32_t*)data)[i + 0];
-						mesh->indices[offset + i + 1] = ((uint32_t*)data)[i + 1];
-						mesh->indices[offset + i + 2] = ((uint32_t*)data)[i + 2];
-					}
+					const XMFLOAT2& tex = ((XMFLOAT2*)data)[i];
+
+					mesh->vertices_FULL[offset + i].tex.x = tex.x;
+					mesh->vertices_FULL[offset + i].tex.y = tex.y;
+					mesh->vertices_FULL[offset + i].tex.z = (float)matIndex /*prim.material*/;
 				}
-				else
+			}
+			else if (!attr_name.compare("JOINTS_0"))
+			{
+				if (stride == 4)
 				{
-					assert(0 && "unsupported index stride!");
-				}
-
+					hasBoneIndices = true;
+					struct JointTmp
+					{
+						uint8_t ind[4];
+					};
 
-				// Create mesh subset:
-				MeshSubset subset;
+					for (size_t i = 0; i < count; ++i)
+					{
+						const JointTmp& joint = ((JointTmp*)data)[i];
 
-				if (prim.material >= 0)
+						mesh->vertices_FULL[offset + i].ind.x = (float)joint.ind[0];
+						mesh->vertices_FULL[offset + i].ind.y = (float)joint.ind[1];
+						mesh->vertices_FULL[offset + i].ind.z = (float)joint.ind[2];
+						mesh->vertices_FULL[offset + i].ind.w = (float)joint.ind[3];
+					}
+				}
+				else if (stride == 8)
 				{
-					const string& mat_name = gltfModel.materials[prim.material].name;
-					auto& found_mat = model->materials.find(mat_name);
-					if (found_mat != model->materials.end())
+					hasBoneIndices = true;
+					struct JointTmp
 					{
-						subset.material = found_mat->second;
+						uint16_t ind[4];
+					};
+
+					for (size_t i = 0; i < count; ++i)
+					{
+						const JointTmp& joint = ((JointTmp*)data)[i];
+
+						mesh->vertices_FULL[offset + i].ind.x = (float)joint.ind[0];
+						mesh->vertices_FULL[offset + i].ind.y = (float)joint.ind[1];
+						mesh->vertices_FULL[offset + i].ind.z = (float)joint.ind[2];
+						mesh->vertices_FULL[offset + i].ind.w = (float)joint.ind[3];
 					}
 				}
-
-				if (subset.material == nullptr)
+				else
 				{
-					subset.material = new Material("gltfLoader_defaultMat");
+					assert(0);
 				}
-
-				mesh->subsets.push_back(subset);
-				mesh->materialNames.push_back(subset.material->name);
 			}
-
-			bool hasBoneWeights = false;
-			bool hasBoneIndices = false;
-
-			int matIndex = -1;
-			for (auto& prim : x.primitives)
+			else if (!attr_name.compare("WEIGHTS_0"))
 			{
-				matIndex++;
-				size_t offset = mesh->vertices_FULL.size();
-
-				for (auto& attr : prim.attributes)
+				hasBoneWeights = true;
+				assert(stride == 16);
+				for (size_t i = 0; i < count; ++i)
 				{
-					const string& attr_name = attr.first;
-					int attr_data = attr.second;
-
-					const tinygltf::Accessor& accessor = gltfModel.accessors[attr_data];
-					const tinygltf::BufferView& bufferView = gltfModel.bufferViews[accessor.bufferView];
-					const tinygltf::Buffer& buffer = gltfModel.buffers[bufferView.buffer];
-
-					int stride = accessor.ByteStride(bufferView);
-					size_t count = accessor.count;
-
-					if (mesh->vertices_FULL.size() == offset)
-					{
-						mesh->vertices_FULL.resize(offset + count);
-					}
+					mesh->vertices_FULL[offset + i].wei = ((XMFLOAT4*)data)[i];
+				}
+			}
 
-					const unsigned char* data = buffer.data.data() + accessor.byteOffset + bufferView.byteOffset;
+		}
 
-					if (!attr_name.compare("POSITION"))
-					{
-						assert(stride == 12);
-						for (size_t i = 0; i < count; ++i)
-						{
-							XMFLOAT3 pos = ((XMFLOAT3*)data)[i];
+	}
 
-							if (transform_to_LH)
-							{
-								pos.z = -pos.z;
-							}
+	mesh->aabb.create(min, max);
 
-							mesh->vertices_FULL[offset + i].pos = XMFLOAT4(pos.x, pos.y, pos.z, 0);
+	if (!hasNormals)
+	{
+		mesh->ComputeNormals(true);
+	}
 
-							min = wiMath::Min(min, pos);
-							max = wiMath::Max(max, pos);
-						}
-					}
-					else if (!attr_name.compare("NORMAL"))
-					{
-						assert(stride == 12);
-						for (size_t i = 0; i < count; ++i)
-						{
-							const XMFLOAT3& nor = ((XMFLOAT3*)data)[i];
-
-							mesh->vertices_FULL[offset + i].nor.x = nor.x;
-							mesh->vertices_FULL[offset + i].nor.y = nor.y;
-							mesh->vertices_FULL[offset + i].nor.z = -nor.z;
-						}
-					}
-					else if (!attr_name.compare("TEXCOORD_0"))
-					{
-						assert(stride == 8);
-						for (size_t i = 0; i < count; ++i)
-						{
-							const XMFLOAT2& tex = ((XMFLOAT2*)data)[i];
-
-							mesh->vertices_FULL[offset + i].tex.x = tex.x;
-							mesh->vertices_FULL[offset + i].tex.y = tex.y;
-							mesh->vertices_FULL[offset + i].tex.z = (float)matIndex /*prim.material*/;
-						}
-					}
-					else if (!attr_name.compare("JOINTS_0"))
-					{
-						if (stride == 4)
-						{
-							hasBoneIndices = true;
-							struct JointTmp
-							{
-								uint8_t ind[4];
-							};
-
-							for (size_t i = 0; i < count; ++i)
-							{
-								const JointTmp& joint = ((JointTmp*)data)[i];
-
-								mesh->vertices_FULL[offset + i].ind.x = (float)joint.ind[0];
-								mesh->vertices_FULL[offset + i].ind.y = (float)joint.ind[1];
-								mesh->vertices_FULL[offset + i].ind.z = (float)joint.ind[2];
-								mesh->vertices_FULL[offset + i].ind.w = (float)joint.ind[3];
-							}
-						}
-						else if (stride == 8)
-						{
-							hasBoneIndices = true;
-							struct JointTmp
-							{
-								uint16_t ind[4];
-							};
-
-							for (size_t i = 0; i < count; ++i)
-							{
-								const JointTmp& joint = ((JointTmp*)data)[i];
-
-								mesh->vertices_FULL[offset + i].ind.x = (float)joint.ind[0];
-								mesh->vertices_FULL[offset + i].ind.y = (float)joint.ind[1];
-								mesh->vertices_FULL[offset + i].ind.z = (float)joint.ind[2];
-								mesh->vertices_FULL[offset + i].ind.w = (float)joint.ind[3];
-							}
-						}
-						else
-						{
-							assert(0);
-						}
-					}
-					else if (!attr_name.compare("WEIGHTS_0"))
-					{
-						hasBoneWeights = true;
-						assert(stride == 16);
-						for (size_t i = 0; i < count; ++i)
-						{
-							mesh->vertices_FULL[offset + i].wei = ((XMFLOAT4*)data)[i];
-						}
-					}
+	if (!armatureArray.empty() && hasBoneIndices && hasBoneWeights)
+	{
+		mesh->armature = armatureArray[0]; // How to resolve?
+		mesh->armatureName = mesh->armature->name;
+	}
 
-				}
+	return mesh;
+}
 
-			}
+void LoadNode(tinygltf::Node* node, tinygltf::Node* parent, Model* model, tinygltf::Model& gltfModel, const vector<Mesh*>& meshArray)
+{
+	if (node == nullptr)
+	{
+		return;
+	}
 
-			mesh->aabb.create(min, max);
+	Transform transform;
+	if (!node->scale.empty())
+	{
+		transform.scale_rest = XMFLOAT3((float)node->scale[0], (float)node->scale[1], (float)node->scale[2]);
+	}
+	if (!node->rotation.empty())
+	{
+		transform.rotation_rest = XMFLOAT4((float)node->rotation[0], (float)node->rotation[1], (float)node->rotation[2], (float)node->rotation[3]);
+	}
+	if (!node->translation.empty())
+	{
+		transform.translation_rest = XMFLOAT3((float)node->translation[0], (float)node->translation[1], (float)node->translation[2]);
+	}
+	transform.UpdateTransform();
 
-			model->meshes.insert(make_pair(mesh->name, mesh));
+	if (parent != nullptr)
+	{
+		transform.parentName = parent->name;
+	}
 
+	if(node->mesh >= 0)
+	{
+		Object* object = new Object(node->name);
+		model->objects.insert(object);
 
-			if (!armatureArray.empty() && hasBoneIndices && hasBoneWeights)
-			{
-				mesh->armature = armatureArray[0]; // How to resolve?
-				mesh->armatureName = mesh->armature->name;
-			}
+		*(Transform*)object = transform;
 
-		}
+		object->mesh = meshArray[node->mesh];
+		object->meshName = object->mesh->name;
+		model->meshes.insert(make_pair(object->mesh->name, object->mesh));
 	}
 
 	if (node->camera >= 0)
@@ -511,7 +531,7 @@ void LoadNode(tinygltf::Node* node, tinygltf::Node* parent, Model* model, tinygl
 	{
 		for (int child : node->children)
 		{
-			LoadNode(&gltfModel.nodes[child], node, model, gltfModel, meshArray, armatureArray);
+			LoadNode(&gltfModel.nodes[child], node, model, gltfModel, meshArray);
 		}
 	}
 }
@@ -550,6 +570,27 @@ Model* ImportModel_GLTF(const std::string& fileName)
 		return nullptr;
 	}
 
+	// The image loader callback only stored the encoded images, decode them in parallel now:
+	{
+		vector<string> imageErrors(gltfModel.images.size());
+		wiJobSystem::context ctx;
+		wiJobSystem::Dispatch(ctx, (uint32_t)gltfModel.images.size(), 1, [&](wiJobSystem::JobDispatchArgs args) {
+			DecodeImage(&gltfModel.images[args.jobIndex], &imageErrors[args.jobIndex]);
+		});
+		wiJobSystem::Wait(ctx);
+
+		string imageError;
+		for (auto& x : imageErrors)
+		{
+			imageError += x;
+		}
+		if (!imageError.empty())
+		{
+			wiHelper::messageBox(imageError, "GLTF error!");
+			return nullptr;
+		}
+	}
+
 	Model* model = new Model;
 	model->name = name;
 
@@ -739,11 +780,11 @@ Model* ImportModel_GLTF(const std::string& fileName)
 
 		// Retrieve textures by name:
 		if (!material->textureName.empty())
-			material->texture = (Texture2D*)wiResourceManager::GetGlobal()->add(material->textureName);
+			material->texture = (Texture2D*)wiResourceManager::GetGlobal()->add(material->textureName, wiResourceManager::IMAGE_BASECOLOR);
 		if (!material->normalMapName.empty())
-			material->normalMap = (Texture2D*)wiResourceManager::GetGlobal()->add(material->normalMapName);
+			material->normalMap = (Texture2D*)wiResourceManager::GetGlobal()->add(material->normalMapName, wiResourceManager::IMAGE_NORMALMAP);
 		if (!material->surfaceMapName.empty())
-			material->surfaceMap = (Texture2D*)wiResourceManager::GetGlobal()->add(material->surfaceMapName);
+			material->surfaceMap = (Texture2D*)wiResourceManager::GetGlobal()->add(material->surfaceMapName, wiResourceManager::IMAGE_LINEAR);
 
 		if (baseColorFactor != x.values.end())
 		{
@@ -853,10 +894,34 @@ Model* ImportModel_GLTF(const std::string& fileName)
 
 	}
 
+	// Materials and armatures are complete, the meshes only read them:
+	meshArray.resize(gltfModel.meshes.size());
+	{
+		wiJobSystem::context ctx;
+		wiJobSystem::Dispatch(ctx, (uint32_t)gltfModel.meshes.size(), 1, [&](wiJobSystem::JobDispatchArgs args) {
+			meshArray[args.jobIndex] = CreateMesh(gltfModel.meshes[args.jobIndex], model, gltfModel, armatureArray);
+		});
+		wiJobSystem::Wait(ctx);
+	}
+
 	const tinygltf::Scene &scene = gltfModel.scenes[gltfModel.defaultScene];
 	for (size_t i = 0; i < scene.nodes.size(); i++)
 	{
-		LoadNode(&gltfModel.nodes[scene.nodes[i]], nullptr, model, gltfModel, meshArray, armatureArray);
+		LoadNode(&gltfModel.nodes[scene.nodes[i]], nullptr, model, gltfModel, meshArray);
+	}
+
+	// Meshes that no node of the scene refers to are not part of the model:
+	unordered_set<Mesh*> referencedMeshes;
+	for (Object* object : model->objects)
+	{
+		referencedMeshes.insert(object->mesh);
+	}
+	for (Mesh* mesh : meshArray)
+	{
+		if (referencedMeshes.count(mesh) == 0)
+		{
+			SAFE_DELETE(mesh);
+		}
 	}
 
 	int animID = 0;
@@ -1033,6 +1098,7 @@ Model* ImportModel_GLTF(const std::string& fileName)
 
 	}
 
+	OptimizeMeshes(model, fileName);
 	model->FinishLoading();
 
 	return model;
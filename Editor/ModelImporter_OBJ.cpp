@@ -31,7 +31,9 @@ Model* ImportModel_OBJ(const std::string& fileName)
 		model->name = name;
 
 		// Load material library:
+		//	The textures are requested asynchronously, so they are decoded in parallel on the loader threads while the meshes are built
 		vector<Material*> materialLibrary = {};
+		vector<pair<Texture2D**, wiResourceManager::AsyncHandle>> textureLoads;
 		for (auto& obj_material : obj_materials)
 		{
 			Material* material = new Material(obj_material.name);
@@ -59,27 +61,27 @@ Model* ImportModel_OBJ(const std::string& fileName)
 			if (!material->surfaceMapName.empty())
 			{
 				material->surfaceMapName = directory + material->surfaceMapName;
-				material->surfaceMap = (Texture2D*)wiResourceManager::GetGlobal()->add(material->surfaceMapName);
+				textureLoads.push_back(make_pair(&material->surfaceMap, wiResourceManager::GetGlobal()->addAsync(material->surfaceMapName, wiResourceManager::IMAGE_LINEAR)));
 			}
 			if (!material->textureName.empty())
 			{
 				material->textureName = directory + material->textureName;
-				material->texture = (Texture2D*)wiResourceManager::GetGlobal()->add(material->textureName);
+				textureLoads.push_back(make_pair(&material->texture, wiResourceManager::GetGlobal()->addAsync(material->textureName, wiResourceManager::IMAGE_BASECOLOR)));
 			}
 			if (!material->normalMapName.empty())
 			{
 				material->normalMapName = directory + material->normalMapName;
-				material->normalMap = (Texture2D*)wiResourceManager::GetGlobal()->add(material->normalMapName);
+				textureLoads.push_back(make_pair(&material->normalMap, wiResourceManager::GetGlobal()->addAsync(material->normalMapName, wiResourceManager::IMAGE_NORMALMAP)));
 			}
 			if (!material->displacementMapName.empty())
 			{
 				material->displacementMapName = directory + material->displacementMapName;
-				material->displacementMap = (Texture2D*)wiResourceManager::GetGlobal()->add(material->displacementMapName);
+				textureLoads.push_back(make_pair(&material->displacementMap, wiResourceManager::GetGlobal()->addAsync(material->displacementMapName, wiResourceManager::IMAGE_LINEAR)));
 			}
 			if (!material->specularMapName.empty())
 			{
 				material->specularMapName = directory + material->specularMapName;
-				material->specularMap = (Texture2D*)wiResourceManager::GetGlobal()->add(material->specularMapName);
+				textureLoads.push_back(make_pair(&material->specularMap, wiResourceManager::GetGlobal()->addAsync(material->specularMapName, wiResourceManager::IMAGE_LINEAR)));
 			}
 
 			material->ConvertToPhysicallyBasedMaterial();
@@ -96,13 +98,15 @@ Model* ImportModel_OBJ(const std::string& fileName)
 			model->materials.insert(make_pair(material->name, material));
 		}
 
-		// Load objects, meshes:
-		for (auto& shape : obj_shapes)
-		{
-			Object* object = new Object(shape.name);
+		// Load meshes:
+		//	Every shape is converted to a mesh on a separate job, they only read the shared data
+		vector<Mesh*> meshArray(obj_shapes.size());
+		wiJobSystem::context ctx;
+		wiJobSystem::Dispatch(ctx, (uint32_t)obj_shapes.size(), 1, [&](wiJobSystem::JobDispatchArgs args) {
+			const tinyobj::shape_t& shape = obj_shapes[args.jobIndex];
 			Mesh* mesh = new Mesh(shape.name + "_mesh");
+			meshArray[args.jobIndex] = mesh;
 
-			object->mesh = mesh;
 			mesh->renderable = true;
 
 			XMFLOAT3 min = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
@@ -198,6 +202,25 @@ Model* ImportModel_OBJ(const std::string& fileName)
 			}
 			mesh->aabb.create(min, max);
 
+			if (obj_attrib.normals.empty())
+			{
+				mesh->ComputeNormals(true);
+			}
+		});
+		wiJobSystem::Wait(ctx);
+
+		for (auto& x : textureLoads)
+		{
+			*x.first = (Texture2D*)wiResourceManager::GetGlobal()->WaitForLoad(x.second);
+		}
+
+		// Load objects, they are added to the model in the order of the shapes:
+		for (size_t i = 0; i < obj_shapes.size(); ++i)
+		{
+			Object* object = new Object(obj_shapes[i].name);
+			Mesh* mesh = meshArray[i];
+			object->mesh = mesh;
+
 			// We need to eliminate colliding mesh names, because objects can reference them by names:
 			//	Note: in engine, object is decoupled from mesh, for instancing support. OBJ file have only meshes and names can collide there.
 			string meshName = mesh->name;
@@ -217,6 +240,7 @@ Model* ImportModel_OBJ(const std::string& fileName)
 			model->meshes.insert(make_pair(mesh->name, mesh));
 		}
 
+		OptimizeMeshes(model, fileName);
 		model->FinishLoading();
 
 		return model;
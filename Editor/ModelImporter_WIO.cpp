@@ -9,10 +9,9 @@ using namespace wiGraphicsTypes;
 using namespace wiSceneComponents;
 
 
-Mesh* LoadMeshFromBinaryFile(const std::string& newName, const std::string& fname, const std::map<std::string, Material*>& materialColl, const unordered_set<Armature*>& armatures)
+// Fill the mesh from a .wimesh file. It only reads the materials and armatures, so meshes can be loaded in parallel
+void LoadMeshFromBinaryFile(Mesh* mesh, const std::string& fname, const std::map<std::string, Material*>& materialColl, const unordered_set<Armature*>& armatures)
 {
-	Mesh* mesh = new Mesh(newName);
-
 	BYTE* buffer;
 	size_t fileSize;
 	if (wiHelper::readByteData(fname, &buffer, fileSize)) {
@@ -301,8 +300,6 @@ Mesh* LoadMeshFromBinaryFile(const std::string& newName, const std::string& fnam
 
 		mesh->renderable = rendermesh == 0 ? false : true;
 	}
-
-	return mesh;
 }
 
 void LoadWiArmatures(const std::string& directory, const std::string& name, unordered_set<Armature*>& armatures)
@@ -401,6 +398,9 @@ void LoadWiMaterialLibrary(const std::string& directory, const std::string& name
 
 	Material* currentMat = NULL;
 
+	// The textures are requested asynchronously, so they are decoded in parallel on the loader threads while the library is parsed
+	vector<pair<Texture2D**, wiResourceManager::AsyncHandle>> textureLoads;
+
 	stringstream filename("");
 	filename << directory << name;
 
@@ -436,7 +436,7 @@ void LoadWiMaterialLibrary(const std::string& directory, const std::string& name
 					stringstream ss("");
 					ss << directory << texturesDir << resourceName.c_str();
 					currentMat->surfaceMapName = ss.str();
-					currentMat->surfaceMap = (Texture2D*)wiResourceManager::GetGlobal()->add(ss.str());
+					textureLoads.push_back(make_pair(&currentMat->surfaceMap, wiResourceManager::GetGlobal()->addAsync(ss.str(), wiResourceManager::IMAGE_LINEAR)));
 				}
 				break;
 				case 'n':
@@ -446,7 +446,7 @@ void LoadWiMaterialLibrary(const std::string& directory, const std::string& name
 					stringstream ss("");
 					ss << directory << texturesDir << resourceName.c_str();
 					currentMat->normalMapName = ss.str();
-					currentMat->normalMap = (Texture2D*)wiResourceManager::GetGlobal()->add(ss.str());
+					textureLoads.push_back(make_pair(&currentMat->normalMap, wiResourceManager::GetGlobal()->addAsync(ss.str(), wiResourceManager::IMAGE_NORMALMAP)));
 				}
 				break;
 				case 't':
@@ -456,7 +456,7 @@ void LoadWiMaterialLibrary(const std::string& directory, const std::string& name
 					stringstream ss("");
 					ss << directory << texturesDir << resourceName.c_str();
 					currentMat->textureName = ss.str();
-					currentMat->texture = (Texture2D*)wiResourceManager::GetGlobal()->add(ss.str());
+					textureLoads.push_back(make_pair(&currentMat->texture, wiResourceManager::GetGlobal()->addAsync(ss.str(), wiResourceManager::IMAGE_BASECOLOR)));
 				}
 				file >> currentMat->premultipliedTexture;
 				break;
@@ -467,7 +467,7 @@ void LoadWiMaterialLibrary(const std::string& directory, const std::string& name
 					stringstream ss("");
 					ss << directory << texturesDir << resourceName.c_str();
 					currentMat->displacementMapName = ss.str();
-					currentMat->displacementMap = (Texture2D*)wiResourceManager::GetGlobal()->add(ss.str());
+					textureLoads.push_back(make_pair(&currentMat->displacementMap, wiResourceManager::GetGlobal()->addAsync(ss.str(), wiResourceManager::IMAGE_LINEAR)));
 				}
 				break;
 				case 'S':
@@ -477,7 +477,7 @@ void LoadWiMaterialLibrary(const std::string& directory, const std::string& name
 					stringstream ss("");
 					ss << directory << texturesDir << resourceName.c_str();
 					currentMat->specularMapName = ss.str();
-					currentMat->specularMap = (Texture2D*)wiResourceManager::GetGlobal()->add(ss.str());
+					textureLoads.push_back(make_pair(&currentMat->specularMap, wiResourceManager::GetGlobal()->addAsync(ss.str(), wiResourceManager::IMAGE_LINEAR)));
 				}
 				break;
 				case 'a':
@@ -542,6 +542,10 @@ void LoadWiMaterialLibrary(const std::string& directory, const std::string& name
 		materials.insert(pair<string, Material*>(currentMat->name, currentMat));
 	}
 
+	for (auto& x : textureLoads)
+	{
+		*x.first = (Texture2D*)wiResourceManager::GetGlobal()->WaitForLoad(x.second);
+	}
 }
 void LoadWiObjects(const std::string& directory, const std::string& name, unordered_set<Object*>& objects
 	, unordered_set<Armature*>& armatures
@@ -551,6 +555,9 @@ void LoadWiObjects(const std::string& directory, const std::string& name, unorde
 	stringstream filename("");
 	filename << directory << name;
 
+	// Binary meshes are loaded on separate jobs while the objects are parsed:
+	wiJobSystem::context ctx;
+
 	ifstream file(filename.str().c_str());
 	if (file)
 	{
@@ -583,7 +590,11 @@ void LoadWiObjects(const std::string& directory, const std::string& name, unorde
 						{
 							stringstream meshFileName("");
 							meshFileName << directory << meshName << ".wimesh";
-							Mesh* mesh = LoadMeshFromBinaryFile(meshName, meshFileName.str(), materials, armatures);
+							string meshFile = meshFileName.str();
+							Mesh* mesh = new Mesh(meshName);
+							wiJobSystem::Execute(ctx, [mesh, meshFile, &materials, &armatures] {
+								LoadMeshFromBinaryFile(mesh, meshFile, materials, armatures);
+							});
 							object->mesh = mesh;
 							meshes.insert(pair<string, Mesh*>(meshName, mesh));
 						}
@@ -645,6 +656,8 @@ void LoadWiObjects(const std::string& directory, const std::string& name, unorde
 					file >> systemName >> visibleEmitter >> materialName >> size >> randfac >> norfac >> count >> life >> randlife;
 					file >> scaleX >> scaleY >> rot;
 
+					// the particle system reads the mesh, so it must be loaded:
+					wiJobSystem::Wait(ctx);
 					if (object->mesh)
 					{
 						object->eParticleSystems.push_back(
@@ -660,6 +673,7 @@ void LoadWiObjects(const std::string& directory, const std::string& name, unorde
 					int count;
 					file >> name >> mat >> len >> count >> densityG >> lenG;
 
+					wiJobSystem::Wait(ctx);
 					object->hParticleSystems.push_back(new wiHairParticle(name, len, count, mat, object, densityG, lenG));
 				}
 				break;
@@ -679,6 +693,8 @@ void LoadWiObjects(const std::string& directory, const std::string& name, unorde
 	}
 	file.close();
 
+	wiJobSystem::Wait(ctx);
+
 }
 void LoadWiMeshes(const std::string& directory, const std::string& name, std::map<std::string, Mesh*>& meshes,
 	const unordered_set<Armature*>& armatures, const std::map<std::string, Material*>& materials)
@@ -1235,6 +1251,7 @@ Model* ImportModel_WIO(const std::string& fileName)
 	LoadWiDecals(directory, decalsFilePath.str(), "textures/", model->decals);
 	LoadWiCameras(directory, camerasFilePath.str(), model->cameras, model->armatures);
 
+	OptimizeMeshes(model, fileName);
 	model->FinishLoading();
 
 	return model;
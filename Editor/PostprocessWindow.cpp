@@ -186,7 +186,8 @@ PostprocessWindow::PostprocessWindow(wiGUI* gui, Renderable3DComponent* comp) :
 				if (GetOpenFileNameA(&ofn) == TRUE) {
 					string fileName = ofn.lpstrFile;
 					//wiRenderer::SetColorGrading((Texture2D*)wiResourceManager::GetGlobal()->add(fileName));
-					component->setColorGradingTexture((Texture2D*)wiResourceManager::GetGlobal()->add(fileName));
+					// lookup table, it must not be compressed or gamma corrected:
+					component->setColorGradingTexture((Texture2D*)wiResourceManager::GetGlobal()->add(fileName, wiResourceManager::IMAGE));
 					if (component->getColorGradingTexture() != nullptr)
 					{
 						colorGradingButton->SetText(fileName);
@@ -15,7 +15,7 @@ RendererWindow::RendererWindow(wiGUI* gui, Renderable3DComponent* component) : G
 	wiRenderer::SetToDrawDebugCameras(true);
 
 	rendererWindow = new wiWindow(GUI, "Renderer Window");
-	rendererWindow->SetSize(XMFLOAT2(640, 760));
+	rendererWindow->SetSize(XMFLOAT2(640, 790));
 	rendererWindow->SetEnabled(true);
 	GUI->AddWidget(rendererWindow);
 
@@ -41,6 +41,16 @@ RendererWindow::RendererWindow(wiGUI* gui, Renderable3DComponent* component) : G
 	occlusionCullingCheckBox->SetCheck(wiRenderer::GetOcclusionCullingEnabled());
 	rendererWindow->AddWidget(occlusionCullingCheckBox);
 
+	softwareOcclusionCullingCheckBox = new wiCheckBox("Software Occlusion Culling: ");
+	softwareOcclusionCullingCheckBox->SetTooltip("Toggle occlusion culling on the CPU. The meshes marked as occluders hide the objects behind them in the same frame.");
+	softwareOcclusionCullingCheckBox->SetScriptTip("SetSoftwareOcclusionCullingEnabled(bool enabled)");
+	softwareOcclusionCullingCheckBox->SetPos(XMFLOAT2(x, y += step));
+	softwareOcclusionCullingCheckBox->OnClick([](wiEventArgs args) {
+		wiRenderer::SetSoftwareOcclusionCullingEnabled(args.bValue);
+	});
+	softwareOcclusionCullingCheckBox->SetCheck(wiRenderer::GetSoftwareOcclusionCullingEnabled());
+	rendererWindow->AddWidget(softwareOcclusionCullingCheckBox);
+
 	resolutionScaleSlider = new wiSlider(0.25f, 2.0f, 1.0f, 7.0f, "Resolution Scale: ");
 	resolutionScaleSlider->SetTooltip("Adjust the internal rendering resolution.");
 	resolutionScaleSlider->SetSize(XMFLOAT2(100, 30));
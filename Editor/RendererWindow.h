@@ -31,6 +31,7 @@ public:
 	wiWindow*	rendererWindow;
 	wiCheckBox* vsyncCheckBox;
 	wiCheckBox* occlusionCullingCheckBox;
+	wiCheckBox* softwareOcclusionCullingCheckBox;
 	wiSlider*	resolutionScaleSlider;
 	wiSlider*	gammaSlider;
 	wiCheckBox* voxelRadianceCheckBox;
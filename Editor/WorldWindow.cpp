@@ -102,7 +102,8 @@ WorldWindow::WorldWindow(wiGUI* gui) : GUI(gui)
 			ofn.Flags = OFN_PATHMUSTEXIST | OFN_FILEMUSTEXIST;
 			if (GetOpenFileNameA(&ofn) == TRUE) {
 				string fileName = ofn.lpstrFile;
-				wiRenderer::SetEnviromentMap((Texture2D*)wiResourceManager::GetGlobal()->add(fileName));
+				// loaded as a plain image, so it isn't compressed:
+				wiRenderer::SetEnviromentMap((Texture2D*)wiResourceManager::GetGlobal()->add(fileName, wiResourceManager::IMAGE));
 				skyButton->SetText(fileName);
 			}
 		}
@@ -0,0 +1,1077 @@
+#include "stdafx.h"
+#include "EngineTests.h"
+#include "wiSoftwareOcclusion.h"
+#include "wiRenderQueue.h"
+#include "wiRenderPassScheduler.h"
+#include "wiGraphicsDevice_Null.h"
+
+#include <sstream>
+#include <random>
+#include <array>
+#include <algorithm>
+#include <numeric>
+#include <set>
+#include <tuple>
+
+using namespace std;
+using namespace wiSceneComponents;
+
+namespace EngineTests
+{
+	// Best time of a few runs, in milliseconds
+	template<typename F>
+	static double Measure(int runs, const F& func)
+	{
+		double best = DBL_MAX;
+		for (int i = 0; i < runs; ++i)
+		{
+			wiTimer timer;
+			func();
+			best = min(best, timer.elapsed());
+		}
+		return best;
+	}
+
+	string FrustumCullingBenchmark()
+	{
+		const uint32_t count = 100000;
+
+		XMFLOAT4X4 projection, view;
+		XMStoreFloat4x4(&projection, XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.1f, 800.0f));
+		XMStoreFloat4x4(&view, XMMatrixLookToLH(XMVectorSet(0, 2, 0, 1), XMVectorSet(0.3f, 0, 1, 0), XMVectorSet(0, 1, 0, 0)));
+		Frustum frustum;
+		frustum.ConstructFrustum(800.0f, projection, view);
+
+		// Random boxes around the camera, about a quarter of them are visible:
+		mt19937 generator(7);
+		uniform_real_distribution<float> position(-500.0f, 500.0f);
+		uniform_real_distribution<float> extent(0.1f, 10.0f);
+		vector<AABB> boxes(count);
+		AABBArray boxArray;
+		boxArray.resize(count);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const XMFLOAT3 center = XMFLOAT3(position(generator), position(generator) * 0.1f, position(generator));
+			const XMFLOAT3 halfWidth = XMFLOAT3(extent(generator), extent(generator), extent(generator));
+			boxes[i].createFromHalfWidth(center, halfWidth);
+			boxArray.set(i, boxes[i]);
+		}
+
+		vector<uint8_t> visibleCorners(count), visibleMinMax(count);
+		vector<uint32_t> mask((count + 31) / 32);
+
+		const double timeCorners = Measure(5, [&] {
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				visibleCorners[i] = frustum.CheckBox(boxes[i]) != 0;
+			}
+		});
+		const double timeMinMax = Measure(5, [&] {
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				visibleMinMax[i] = frustum.CheckBox(boxArray.getMin(i), boxArray.getMax(i)) != 0;
+			}
+		});
+		const double timeBatched = Measure(5, [&] {
+			frustum.CheckBoxes(boxArray, 0, count, mask.data());
+		});
+
+		uint32_t visibleCount = 0, mismatches = 0;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const bool visibleBatched = (mask[i / 32] & (1u << (i % 32))) != 0;
+			visibleCount += visibleBatched ? 1 : 0;
+			mismatches += (visibleBatched != (visibleCorners[i] != 0) || visibleBatched != (visibleMinMax[i] != 0)) ? 1 : 0;
+		}
+
+		stringstream ss;
+		ss << "Frustum culling of " << count << " boxes (" << visibleCount << " visible), best of 5 runs:" << endl;
+		ss << "  CheckBox, 8 corners: " << timeCorners << " ms" << endl;
+		ss << "  CheckBox, min/max: " << timeMinMax << " ms" << endl;
+#if defined(__AVX__)
+		ss << "  CheckBoxes (AVX): " << timeBatched << " ms" << endl;
+#elif defined(_XM_SSE_INTRINSICS_)
+		ss << "  CheckBoxes (SSE): " << timeBatched << " ms" << endl;
+#else
+		ss << "  CheckBoxes (scalar): " << timeBatched << " ms" << endl;
+#endif
+		ss << (mismatches == 0 ? "PASSED" : "FAILED") << ": " << mismatches << " boxes have different results" << endl;
+		return ss.str();
+	}
+
+	// Height field grid where every triangle has its own vertices, like an imported mesh before welding
+	static void CreateSeamedGrid(Mesh& mesh, uint32_t resolution)
+	{
+		mesh.vertices_FULL.clear();
+		mesh.indices.clear();
+		auto addVertex = [&](uint32_t x, uint32_t z) {
+			Mesh::Vertex_FULL vertex;
+			vertex.pos = XMFLOAT4((float)x, sinf(x * 0.3f) * cosf(z * 0.2f) * 2, (float)z, 0);
+			vertex.tex = XMFLOAT4((float)x / resolution, (float)z / resolution, 0, 0);
+			mesh.indices.push_back((uint32_t)mesh.vertices_FULL.size());
+			mesh.vertices_FULL.push_back(vertex);
+		};
+		for (uint32_t z = 0; z < resolution; ++z)
+		{
+			for (uint32_t x = 0; x < resolution; ++x)
+			{
+				addVertex(x, z);
+				addVertex(x + 1, z + 1);
+				addVertex(x, z + 1);
+				addVertex(x, z);
+				addVertex(x + 1, z);
+				addVertex(x + 1, z + 1);
+			}
+		}
+	}
+
+	string NormalsBenchmark()
+	{
+		stringstream ss;
+		ss << "Smooth normals of seamed grids (Mesh::ComputeNormals), best of 3 runs:" << endl;
+		bool passed = true;
+
+		const uint32_t resolutions[] = { 41, 82, 183 };
+		for (uint32_t resolution : resolutions)
+		{
+			Mesh source;
+			CreateSeamedGrid(source, resolution);
+
+			Mesh mesh;
+			double time = DBL_MAX;
+			for (int run = 0; run < 3; ++run)
+			{
+				mesh.vertices_FULL = source.vertices_FULL;
+				mesh.indices = source.indices;
+				wiTimer timer;
+				mesh.ComputeNormals(true);
+				time = min(time, timer.elapsed());
+			}
+
+			// Every grid point is welded into one vertex with a unit normal that points up:
+			bool valid = mesh.vertices_FULL.size() == (resolution + 1) * (resolution + 1) && mesh.indices.size() == source.indices.size();
+			for (auto& vertex : mesh.vertices_FULL)
+			{
+				const float length = XMVectorGetX(XMVector3Length(XMLoadFloat4(&vertex.nor)));
+				valid = valid && fabsf(length - 1) < 1e-3f && vertex.nor.y > 0;
+			}
+
+			ss << "  " << source.vertices_FULL.size() << " vertices -> " << mesh.vertices_FULL.size() << ": " << time << " ms";
+
+			if (resolution == resolutions[0])
+			{
+				// Brute force reference: every vertex sums the face normals of all the triangles that touch its position
+				wiTimer timer;
+				float maxError = 0;
+				for (auto& vertex : mesh.vertices_FULL)
+				{
+					XMVECTOR N = XMVectorZero();
+					for (size_t i = 0; i < source.indices.size(); i += 3)
+					{
+						const XMFLOAT4& p0 = source.vertices_FULL[source.indices[i + 0]].pos;
+						const XMFLOAT4& p1 = source.vertices_FULL[source.indices[i + 1]].pos;
+						const XMFLOAT4& p2 = source.vertices_FULL[source.indices[i + 2]].pos;
+						auto touches = [&](const XMFLOAT4& p) { return p.x == vertex.pos.x && p.y == vertex.pos.y && p.z == vertex.pos.z; };
+						if (touches(p0) || touches(p1) || touches(p2))
+						{
+							const XMVECTOR P0 = XMLoadFloat4(&p0);
+							N += XMVector3Normalize(XMVector3Cross(XMLoadFloat4(&p2) - P0, XMLoadFloat4(&p1) - P0));
+						}
+					}
+					N = XMVector3Normalize(N);
+					// distance of the unit normals, acos() is too imprecise for small angles:
+					const float error = XMVectorGetX(XMVector3Length(N - XMVector3Normalize(XMLoadFloat4(&vertex.nor))));
+					maxError = max(maxError, error);
+				}
+				valid = valid && maxError < 1e-4f;
+				ss << " (brute force: " << timer.elapsed() << " ms, max difference " << maxError << ")";
+			}
+
+			ss << (valid ? "" : " INVALID") << endl;
+			passed = passed && valid;
+		}
+
+		ss << (passed ? "PASSED" : "FAILED") << endl;
+		return ss.str();
+	}
+
+	// Unit sphere with triangles that face outwards
+	static void CreateSphere(uint32_t segments, vector<XMFLOAT4>& positions, vector<uint32_t>& indices)
+	{
+		const uint32_t rings = segments / 2;
+		for (uint32_t ring = 0; ring <= rings; ++ring)
+		{
+			for (uint32_t segment = 0; segment <= segments; ++segment)
+			{
+				const float theta = XM_PI * ring / rings;
+				const float phi = XM_2PI * segment / segments;
+				positions.push_back(XMFLOAT4(sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi), 1));
+			}
+		}
+		for (uint32_t ring = 0; ring < rings; ++ring)
+		{
+			for (uint32_t segment = 0; segment < segments; ++segment)
+			{
+				const uint32_t a = ring * (segments + 1) + segment;
+				const uint32_t b = a + segments + 1;
+				const uint32_t triangles[] = { a, b, a + 1, a + 1, b, b + 1 };
+				indices.insert(indices.end(), triangles, triangles + 6);
+			}
+		}
+	}
+
+	string MeshletTest()
+	{
+		vector<XMFLOAT4> positions;
+		vector<uint32_t> indices;
+		CreateSphere(256, positions, indices);
+		const vector<uint32_t> sourceIndices = indices;
+		const uint32_t triangleCount = (uint32_t)indices.size() / 3;
+		const float* positionData = &positions[0].x;
+		const uint32_t stride = sizeof(XMFLOAT4);
+
+		vector<wiMeshlet::Meshlet> meshlets;
+		wiTimer timer;
+		wiMeshlet::Build(indices.data(), (uint32_t)indices.size(), positionData, (uint32_t)positions.size(), stride, meshlets);
+		const double timeBuild = timer.elapsed();
+
+		stringstream ss;
+		ss << "Meshlets of a sphere with " << triangleCount << " triangles: " << meshlets.size() << " meshlets, built in " << timeBuild << " ms" << endl;
+		bool passed = true;
+
+		// The index list is only reordered, every triangle is kept with its winding:
+		{
+			auto sortedTriangles = [](const vector<uint32_t>& list) {
+				vector<array<uint32_t, 3>> triangles(list.size() / 3);
+				for (size_t i = 0; i < triangles.size(); ++i)
+				{
+					triangles[i] = { list[i * 3 + 0], list[i * 3 + 1], list[i * 3 + 2] };
+				}
+				sort(triangles.begin(), triangles.end());
+				return triangles;
+			};
+			const bool valid = sortedTriangles(indices) == sortedTriangles(sourceIndices);
+			ss << "  triangles preserved: " << (valid ? "yes" : "NO") << endl;
+			passed = passed && valid;
+		}
+
+		// The meshlets are contiguous ranges within the limits, the bounds contain every vertex:
+		{
+			uint32_t errors = 0;
+			uint32_t nextTriangle = 0;
+			for (auto& meshlet : meshlets)
+			{
+				errors += meshlet.triangleOffset != nextTriangle ? 1 : 0;
+				nextTriangle = meshlet.triangleOffset + meshlet.triangleCount;
+
+				vector<uint32_t> vertices(&indices[meshlet.triangleOffset * 3], &indices[nextTriangle * 3]);
+				sort(vertices.begin(), vertices.end());
+				vertices.erase(unique(vertices.begin(), vertices.end()), vertices.end());
+				errors += (vertices.size() != meshlet.vertexCount || meshlet.vertexCount > wiMeshlet::MAX_VERTICES || meshlet.triangleCount > wiMeshlet::MAX_TRIANGLES) ? 1 : 0;
+
+				for (uint32_t vertex : vertices)
+				{
+					const XMFLOAT4& p = positions[vertex];
+					const float distance = XMVectorGetX(XMVector3Length(XMLoadFloat4(&p) - XMLoadFloat3(&meshlet.center)));
+					errors += distance > meshlet.radius * 1.0001f + 1e-6f ? 1 : 0;
+					errors += (p.x < meshlet.aabbMin.x || p.y < meshlet.aabbMin.y || p.z < meshlet.aabbMin.z || p.x > meshlet.aabbMax.x || p.y > meshlet.aabbMax.y || p.z > meshlet.aabbMax.z) ? 1 : 0;
+				}
+			}
+			errors += nextTriangle != triangleCount ? 1 : 0;
+			ss << "  layout, limit and bounds errors: " << errors << endl;
+			passed = passed && errors == 0;
+		}
+
+		// Cone culling is conservative: for random eyes, every triangle of a backfacing meshlet must be backfacing by itself
+		{
+			mt19937 generator(3);
+			uniform_real_distribution<float> coordinate(-4.0f, 4.0f);
+			uint64_t tested = 0, backfacing = 0, culled = 0, wronglyCulled = 0;
+			double timeCones = 0;
+			for (int i = 0; i < 200; ++i)
+			{
+				const XMFLOAT3 eye = XMFLOAT3(coordinate(generator), coordinate(generator), coordinate(generator));
+				const XMVECTOR E = XMLoadFloat3(&eye);
+
+				vector<uint8_t> meshletCulled(meshlets.size());
+				wiTimer coneTimer;
+				for (size_t j = 0; j < meshlets.size(); ++j)
+				{
+					meshletCulled[j] = wiMeshlet::IsBackfacing(meshlets[j], eye) ? 1 : 0;
+				}
+				timeCones += coneTimer.elapsed();
+
+				for (size_t j = 0; j < meshlets.size(); ++j)
+				{
+					const wiMeshlet::Meshlet& meshlet = meshlets[j];
+					for (uint32_t t = meshlet.triangleOffset; t < meshlet.triangleOffset + meshlet.triangleCount; ++t)
+					{
+						const XMVECTOR P0 = XMLoadFloat4(&positions[indices[t * 3 + 0]]);
+						const XMVECTOR P1 = XMLoadFloat4(&positions[indices[t * 3 + 1]]);
+						const XMVECTOR P2 = XMLoadFloat4(&positions[indices[t * 3 + 2]]);
+						const XMVECTOR N = XMVector3Cross(P2 - P0, P1 - P0);
+						const bool triangleBackfacing = XMVectorGetX(XMVector3Dot(N, P0 - E)) >= 0;
+						tested++;
+						backfacing += triangleBackfacing ? 1 : 0;
+						culled += meshletCulled[j];
+						wronglyCulled += (meshletCulled[j] && !triangleBackfacing) ? 1 : 0;
+					}
+				}
+			}
+			ss << "  cone culling from 200 random eyes: " << 100.0 * culled / tested << "% of the triangles culled, " << 100.0 * backfacing / tested << "% are backfacing, "
+				<< wronglyCulled << " front facing triangles culled (" << timeCones / 200 << " ms per eye)" << endl;
+			passed = passed && wronglyCulled == 0;
+		}
+
+		// Draw ranges of a camera looking at the sphere: they cover every visible meshlet and stay within the limit
+		{
+			XMFLOAT4X4 projection, view;
+			XMStoreFloat4x4(&projection, XMMatrixPerspectiveFovLH(XM_PIDIV4, 1.0f, 0.1f, 100.0f));
+			XMStoreFloat4x4(&view, XMMatrixLookAtLH(XMVectorSet(2.5f, 0.5f, 0, 1), XMVectorSet(0, 0.3f, 0.6f, 1), XMVectorSet(0, 1, 0, 0)));
+			Frustum frustum;
+			frustum.ConstructFrustum(100.0f, projection, view);
+			const XMFLOAT3 eye = XMFLOAT3(2.5f, 0.5f, 0);
+
+			vector<uint8_t> covered(triangleCount);
+			vector<wiMeshlet::DrawRange> ranges;
+			uint32_t errors = 0;
+			for (uint32_t maxRanges : { 1u, 16u, 0xFFFFFFFFu })
+			{
+				wiMeshlet::CullStats stats;
+				const uint32_t rangeCount = wiMeshlet::Cull(meshlets.data(), (uint32_t)meshlets.size(), &frustum, eye, true, ranges, maxRanges, &stats);
+				errors += (rangeCount != ranges.size() || rangeCount > maxRanges) ? 1 : 0;
+
+				fill(covered.begin(), covered.end(), 0);
+				for (auto& range : ranges)
+				{
+					for (uint32_t i = range.indexOffset; i < range.indexOffset + range.indexCount; i += 3)
+					{
+						covered[i / 3] = 1;
+					}
+				}
+				for (auto& meshlet : meshlets)
+				{
+					const bool visible = frustum.CheckSphere(meshlet.center, meshlet.radius) && frustum.CheckBox(meshlet.aabbMin, meshlet.aabbMax) && !wiMeshlet::IsBackfacing(meshlet, eye);
+					for (uint32_t t = meshlet.triangleOffset; visible && t < meshlet.triangleOffset + meshlet.triangleCount; ++t)
+					{
+						errors += covered[t] ? 0 : 1;
+					}
+				}
+
+				ss << "  " << (maxRanges == 0xFFFFFFFFu ? string("unlimited") : to_string(maxRanges)) << " draw ranges: " << rangeCount << " used, "
+					<< 100.0f * stats.GetMeshletCullRatio() << "% of the meshlets and " << 100.0f * stats.GetTriangleCullRatio() << "% of the triangles culled" << endl;
+			}
+			ss << "  draw range errors: " << errors << endl;
+			passed = passed && errors == 0;
+		}
+
+		ss << (passed ? "PASSED" : "FAILED") << endl;
+		return ss.str();
+	}
+
+	// Closed box of 12 triangles
+	static void CreateBoxMesh(const XMFLOAT3& boxMin, const XMFLOAT3& boxMax, vector<XMFLOAT3>& positions, vector<uint32_t>& indices)
+	{
+		const uint32_t base = (uint32_t)positions.size();
+		for (uint32_t i = 0; i < 8; ++i)
+		{
+			positions.push_back(XMFLOAT3((i & 1) ? boxMax.x : boxMin.x, (i & 2) ? boxMax.y : boxMin.y, (i & 4) ? boxMax.z : boxMin.z));
+		}
+		const uint32_t faces[6][4] = { { 0,1,3,2 },{ 4,5,7,6 },{ 0,1,5,4 },{ 2,3,7,6 },{ 0,2,6,4 },{ 1,3,7,5 } };
+		for (auto& face : faces)
+		{
+			const uint32_t triangles[] = { face[0], face[1], face[2], face[0], face[2], face[3] };
+			for (uint32_t index : triangles)
+			{
+				indices.push_back(base + index);
+			}
+		}
+	}
+
+	string SoftwareOcclusionTest()
+	{
+		typedef wiSoftwareOcclusion SO;
+		const uint32_t width = SO::WIDTH;
+		const uint32_t height = SO::HEIGHT;
+		const float fov = XM_PI / 3.0f;
+		const float aspect = 16.0f / 9.0f;
+		const float zNear = 0.1f;
+		// Reversed depth like the engine's cameras, the view is the identity
+		const XMMATRIX viewProjection = XMMatrixPerspectiveFovLH(fov, aspect, 1000.0f, zNear);
+
+		// Pixel coordinates and inverse depth of a point like the rasterizer computes them, returns false if it is in front of the near plane
+		auto project = [&](const XMFLOAT3& position, double& x, double& y, double& depth) {
+			XMFLOAT4 clip;
+			XMStoreFloat4(&clip, XMVector3Transform(XMLoadFloat3(&position), viewProjection));
+			if (!(clip.w >= zNear))
+			{
+				return false;
+			}
+			x = (clip.x / clip.w * 0.5 + 0.5) * width;
+			y = (0.5 - clip.y / clip.w * 0.5) * height;
+			depth = 1.0 / clip.w;
+			return true;
+		};
+
+		mt19937 generator(7);
+		uniform_real_distribution<float> random(0.0f, 1.0f);
+		SO occlusion;
+		stringstream ss;
+		ss << "Software occlusion culling, " << width << "x" << height << " depth buffer:" << endl;
+		bool passed = true;
+
+		// Random triangles against a double precision rasterizer (pixels that a triangle edge touches are ambiguous, they are skipped):
+		{
+			vector<XMFLOAT3> positions;
+			vector<uint32_t> indices;
+			for (int i = 0; i < 300; ++i)
+			{
+				const XMFLOAT3 center = XMFLOAT3((random(generator) - 0.5f) * 40, (random(generator) - 0.5f) * 20, 2 + random(generator) * 60);
+				for (int corner = 0; corner < 3; ++corner)
+				{
+					indices.push_back((uint32_t)positions.size());
+					positions.push_back(XMFLOAT3(center.x + (random(generator) - 0.5f) * 8, center.y + (random(generator) - 0.5f) * 8, center.z + (random(generator) - 0.5f) * 3));
+				}
+			}
+			occlusion.Clear(viewProjection, zNear);
+			occlusion.RasterizeTriangles(&positions[0].x, sizeof(XMFLOAT3), (uint32_t)positions.size(), indices.data(), (uint32_t)indices.size(), XMMatrixIdentity());
+
+			vector<double> reference(width * height, 0);
+			vector<uint8_t> ambiguous(width * height, 0);
+			for (size_t i = 0; i < indices.size(); i += 3)
+			{
+				double x[3], y[3], z[3];
+				bool valid = true;
+				for (int k = 0; k < 3; ++k)
+				{
+					valid = valid && project(positions[indices[i + k]], x[k], y[k], z[k]);
+				}
+				const double area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+				if (!valid || fabs(area) < 1e-6)
+				{
+					continue;
+				}
+				for (uint32_t py = 0; py < height; ++py)
+				{
+					for (uint32_t px = 0; px < width; ++px)
+					{
+						const double sx = px + 0.5, sy = py + 0.5;
+						const double w0 = ((x[2] - x[1]) * (sy - y[1]) - (y[2] - y[1]) * (sx - x[1])) / area;
+						const double w1 = ((x[0] - x[2]) * (sy - y[2]) - (y[0] - y[2]) * (sx - x[2])) / area;
+						const double w2 = 1 - w0 - w1;
+						const double edgeDistance = min(w0, min(w1, w2));
+						if (fabs(edgeDistance) < 1e-4)
+						{
+							ambiguous[py * width + px] = 1;
+						}
+						if (edgeDistance >= 0)
+						{
+							reference[py * width + px] = max(reference[py * width + px], w0 * z[0] + w1 * z[1] + w2 * z[2]);
+						}
+					}
+				}
+			}
+
+			uint32_t covered = 0, mismatches = 0;
+			double maxError = 0;
+			for (uint32_t i = 0; i < width * height; ++i)
+			{
+				if (ambiguous[i])
+				{
+					continue;
+				}
+				const float depth = occlusion.GetDepth(i % width, i / width);
+				covered += reference[i] > 0 ? 1 : 0;
+				if ((reference[i] > 0) != (depth > 0))
+				{
+					mismatches++;
+				}
+				else if (reference[i] > 0)
+				{
+					maxError = max(maxError, fabs(depth - reference[i]) / reference[i]);
+				}
+			}
+			const bool valid = mismatches == 0 && maxError < 1e-3;
+			ss << "  300 random triangles: " << covered << " pixels covered, " << mismatches << " coverage mismatches, max relative depth error " << maxError << (valid ? "" : " INVALID") << endl;
+			passed = passed && valid;
+		}
+
+		// Ground plane that crosses the near plane, against the analytic depth:
+		{
+			const vector<XMFLOAT3> positions = { XMFLOAT3(-50, -1, -50), XMFLOAT3(50, -1, -50), XMFLOAT3(50, -1, 50), XMFLOAT3(-50, -1, 50) };
+			const vector<uint32_t> indices = { 0, 1, 2, 0, 2, 3 };
+			occlusion.Clear(viewProjection, zNear);
+			occlusion.RasterizeTriangles(&positions[0].x, sizeof(XMFLOAT3), (uint32_t)positions.size(), indices.data(), (uint32_t)indices.size(), XMMatrixIdentity());
+
+			const double scaleY = 1.0 / tan(fov * 0.5);
+			const double scaleX = scaleY / aspect;
+			uint32_t covered = 0, missing = 0;
+			double maxError = 0;
+			for (uint32_t py = 0; py < height; ++py)
+			{
+				for (uint32_t px = 0; px < width; ++px)
+				{
+					// view ray through the pixel center, where it hits the plane at y = -1:
+					const double rayX = (((px + 0.5) / width) * 2 - 1) / scaleX;
+					const double rayY = (1 - ((py + 0.5) / height) * 2) / scaleY;
+					if (rayY >= 0)
+					{
+						continue;
+					}
+					const double distance = -1 / rayY;
+					if (distance > 50 || fabs(rayX * distance) > 50)
+					{
+						continue;
+					}
+					const double reference = 1 / distance;
+					const float depth = occlusion.GetDepth(px, py);
+					covered++;
+					if (depth <= 0)
+					{
+						missing++;
+					}
+					else
+					{
+						maxError = max(maxError, fabs(depth - reference) / reference);
+					}
+				}
+			}
+			const bool valid = missing == 0 && maxError < 1e-3;
+			ss << "  ground plane through the near plane: " << covered << " pixels covered, " << missing << " missing, max relative depth error " << maxError << (valid ? "" : " INVALID") << endl;
+			passed = passed && valid;
+		}
+
+		// Occluder boxes: the hierarchy and the box tests against brute force over the full resolution depth buffer
+		{
+			vector<XMFLOAT3> positions;
+			vector<uint32_t> indices;
+			for (int i = 0; i < 40; ++i)
+			{
+				const XMFLOAT3 center = XMFLOAT3((random(generator) - 0.5f) * 60, (random(generator) - 0.5f) * 10, 8 + random(generator) * 40);
+				const XMFLOAT3 boxMin = XMFLOAT3(center.x - random(generator) * 6, center.y - 1 - random(generator) * 5, center.z);
+				const XMFLOAT3 boxMax = XMFLOAT3(center.x + random(generator) * 6, center.y + 1 + random(generator) * 5, center.z + 0.5f + random(generator) * 2);
+				CreateBoxMesh(boxMin, boxMax, positions, indices);
+			}
+			occlusion.Clear(viewProjection, zNear);
+			occlusion.RasterizeTriangles(&positions[0].x, sizeof(XMFLOAT3), (uint32_t)positions.size(), indices.data(), (uint32_t)indices.size(), XMMatrixIdentity());
+			occlusion.BuildHierarchy();
+
+			// Every texel holds the depth range of the full resolution pixels below it:
+			uint32_t wrongTexels = 0;
+			for (uint32_t level = 1; level < occlusion.GetLevelCount(); ++level)
+			{
+				for (uint32_t y = 0; y < occlusion.GetLevelHeight(level); ++y)
+				{
+					for (uint32_t x = 0; x < occlusion.GetLevelWidth(level); ++x)
+					{
+						float farthest = FLT_MAX, nearest = 0;
+						for (uint32_t py = y << level; py < min(height, (y + 1) << level); ++py)
+						{
+							for (uint32_t px = x << level; px < min(width, (x + 1) << level); ++px)
+							{
+								farthest = min(farthest, occlusion.GetDepth(px, py));
+								nearest = max(nearest, occlusion.GetDepth(px, py));
+							}
+						}
+						const SO::Texel& texel = occlusion.GetTexel(level, x, y);
+						wrongTexels += (texel.farthest != farthest || texel.nearest != nearest) ? 1 : 0;
+					}
+				}
+			}
+			ss << "  hierarchy: " << occlusion.GetLevelCount() << " levels, " << wrongTexels << " wrong texels" << endl;
+			passed = passed && wrongTexels == 0;
+
+			const uint32_t count = 20000;
+			vector<AABB> boxes(count);
+			for (auto& box : boxes)
+			{
+				const XMFLOAT3 center = XMFLOAT3((random(generator) - 0.5f) * 120, (random(generator) - 0.5f) * 30, random(generator) * 120 - 5);
+				const float extent = 0.1f + random(generator) * random(generator) * 8;
+				box.createFromHalfWidth(center, XMFLOAT3(extent, extent, extent));
+			}
+			vector<uint8_t> visible(count);
+			wiTimer timer;
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				visible[i] = occlusion.IsVisible(boxes[i]) ? 1 : 0;
+			}
+			const double timeVisibility = timer.elapsed();
+
+			uint32_t occluded = 0, disagreements = 0, leaks = 0;
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				const AABB& box = boxes[i];
+
+				// Brute force: the box is occluded if every pixel of its screen rectangle is nearer than its nearest corner
+				bool referenceVisible = false;
+				double minX = DBL_MAX, minY = DBL_MAX, maxX = -DBL_MAX, maxY = -DBL_MAX, nearest = 0;
+				for (int k = 0; k < 8; ++k)
+				{
+					double x, y, depth;
+					if (!project(box.corners[k], x, y, depth))
+					{
+						referenceVisible = true;
+						break;
+					}
+					minX = min(minX, x);
+					minY = min(minY, y);
+					maxX = max(maxX, x);
+					maxY = max(maxY, y);
+					nearest = max(nearest, depth);
+				}
+				if (!referenceVisible)
+				{
+					referenceVisible = maxX < 0 || maxY < 0 || minX >= width || minY >= height;
+					for (int y = max(0, (int)minY); y <= min((int)height - 1, (int)maxY) && !referenceVisible; ++y)
+					{
+						for (int x = max(0, (int)minX); x <= min((int)width - 1, (int)maxX) && !referenceVisible; ++x)
+						{
+							referenceVisible = !(occlusion.GetDepth(x, y) > (float)nearest);
+						}
+					}
+				}
+				disagreements += referenceVisible != (visible[i] != 0) ? 1 : 0;
+
+				if (!visible[i])
+				{
+					// Random points on the surface of an occluded box must all be behind the depth buffer:
+					occluded++;
+					const XMFLOAT3 boxMin = box.getMin();
+					const XMFLOAT3 boxMax = box.getMax();
+					for (int sample = 0; sample < 400; ++sample)
+					{
+						float p[3] = { boxMin.x + (boxMax.x - boxMin.x) * random(generator), boxMin.y + (boxMax.y - boxMin.y) * random(generator), boxMin.z + (boxMax.z - boxMin.z) * random(generator) };
+						const int axis = generator() % 3;
+						p[axis] = (generator() & 1) ? (&boxMax.x)[axis] : (&boxMin.x)[axis];
+						double x, y, depth;
+						if (project(XMFLOAT3(p[0], p[1], p[2]), x, y, depth) && x >= 0 && y >= 0 && x < width && y < height && !(occlusion.GetDepth((uint32_t)x, (uint32_t)y) > (float)depth))
+						{
+							leaks++;
+							break;
+						}
+					}
+				}
+			}
+			const bool valid = disagreements == 0 && leaks == 0;
+			ss << "  " << count << " boxes: " << occluded << " occluded, " << disagreements << " differ from brute force, " << leaks << " occluded boxes with a visible surface point, "
+				<< timeVisibility * 1000 / count << " us per box" << (valid ? "" : " INVALID") << endl;
+			passed = passed && valid;
+		}
+
+		// Timing of a dense occluder, a wall of 20000 triangles:
+		{
+			vector<XMFLOAT3> positions;
+			vector<uint32_t> indices;
+			const uint32_t resolution = 100;
+			for (uint32_t y = 0; y <= resolution; ++y)
+			{
+				for (uint32_t x = 0; x <= resolution; ++x)
+				{
+					positions.push_back(XMFLOAT3((float)x / resolution * 40 - 20, (float)y / resolution * 20 - 10, 30 + sinf(x * 0.3f) * 2));
+				}
+			}
+			for (uint32_t y = 0; y < resolution; ++y)
+			{
+				for (uint32_t x = 0; x < resolution; ++x)
+				{
+					const uint32_t i = y * (resolution + 1) + x;
+					const uint32_t triangles[] = { i, i + 1, i + resolution + 2, i, i + resolution + 2, i + resolution + 1 };
+					indices.insert(indices.end(), triangles, triangles + 6);
+				}
+			}
+			double timeRasterize = DBL_MAX, timeHierarchy = DBL_MAX;
+			for (int run = 0; run < 20; ++run)
+			{
+				wiTimer timer;
+				occlusion.Clear(viewProjection, zNear);
+				occlusion.RasterizeTriangles(&positions[0].x, sizeof(XMFLOAT3), (uint32_t)positions.size(), indices.data(), (uint32_t)indices.size(), XMMatrixIdentity());
+				timeRasterize = min(timeRasterize, timer.elapsed());
+				timer.record();
+				occlusion.BuildHierarchy();
+				timeHierarchy = min(timeHierarchy, timer.elapsed());
+			}
+			ss << "  rasterize " << indices.size() / 3 << " triangles: " << timeRasterize << " ms, build the hierarchy: " << timeHierarchy << " ms (best of 20 runs)" << endl;
+		}
+
+		ss << (passed ? "PASSED" : "FAILED") << endl;
+		return ss.str();
+	}
+
+	string RenderQueueTest()
+	{
+		stringstream ss;
+		ss << "Render queue (CulledCollection, wiRenderQueue):" << endl;
+		bool passed = true;
+
+		mt19937 generator(11);
+		uniform_real_distribution<float> random(0, 1);
+
+		// Visible objects of a scene with a few heavily instanced meshes and many unique ones, added in a random order like the culling does:
+		const uint32_t meshCount = 300;
+		const uint32_t objectCount = 20000;
+		vector<Mesh> meshes(meshCount);
+		vector<Object> objects(objectCount);
+		vector<uint32_t> instancesPerMesh(meshCount);
+		for (Object& object : objects)
+		{
+			const uint32_t meshIndex = min(meshCount - 1, (uint32_t)(meshCount * random(generator) * random(generator) * random(generator)));
+			object.mesh = &meshes[meshIndex];
+			instancesPerMesh[meshIndex]++;
+		}
+		vector<uint32_t> order(objectCount);
+		iota(order.begin(), order.end(), 0);
+		shuffle(order.begin(), order.end(), generator);
+		vector<uint32_t> addedAt(objectCount);
+		CulledCollection culledRenderer;
+		for (uint32_t i = 0; i < objectCount; ++i)
+		{
+			culledRenderer.push_back(&objects[order[i]]);
+			addedAt[order[i]] = i;
+		}
+		wiTimer timer;
+		culledRenderer.Sort();
+		const double timeCollection = timer.elapsed();
+
+		// Every mesh must be one batch with all of its instances, in the order they were added:
+		const vector<CulledCollection::Batch>& batches = culledRenderer.GetBatches();
+		const uint32_t usedMeshes = (uint32_t)count_if(instancesPerMesh.begin(), instancesPerMesh.end(), [](uint32_t x) { return x > 0; });
+		vector<uint8_t> meshSeen(meshCount);
+		uint32_t wrongBatches = 0, instanceTotal = 0;
+		for (const CulledCollection::Batch& batch : batches)
+		{
+			const uint32_t meshIndex = (uint32_t)(batch.mesh - meshes.data());
+			bool valid = !meshSeen[meshIndex] && batch.count == instancesPerMesh[meshIndex];
+			meshSeen[meshIndex] = 1;
+			int64_t prevAddedAt = -1;
+			for (Object* object : culledRenderer.GetInstances(batch))
+			{
+				const uint32_t objectIndex = (uint32_t)(object - objects.data());
+				valid = valid && object->mesh == batch.mesh && (int64_t)addedAt[objectIndex] > prevAddedAt;
+				prevAddedAt = addedAt[objectIndex];
+				instanceTotal++;
+			}
+			wrongBatches += valid ? 0 : 1;
+		}
+		ss << "  " << objectCount << " objects of " << usedMeshes << " meshes grouped into " << batches.size() << " batches, " << wrongBatches << " wrong batches (" << timeCollection << " ms)" << endl;
+		passed = passed && batches.size() == usedMeshes && instanceTotal == objectCount && wrongBatches == 0;
+
+		// Every mesh has a few subsets that are drawn instanced, with pipeline states and materials shared between meshes. Some subsets have no material:
+		const uint32_t psoCount = 12;
+		const uint32_t materialCount = 64;
+		int psos[psoCount] = {};
+		int materials[materialCount] = {};
+		struct Draw
+		{
+			const void* pso;
+			const void* material;
+			const void* mesh;
+			float distance;
+			uint32_t instanceCount;
+		};
+		vector<Draw> draws;
+		wiRenderQueue queue;
+		uint32_t referenceInstanceCount = 0;
+		for (const CulledCollection::Batch& batch : batches)
+		{
+			const uint32_t subsetCount = 1 + generator() % 3;
+			for (uint32_t subset = 0; subset < subsetCount; ++subset)
+			{
+				Draw draw;
+				draw.pso = &psos[generator() % psoCount];
+				draw.material = random(generator) < 0.05f ? nullptr : &materials[generator() % materialCount];
+				draw.mesh = batch.mesh;
+				draw.distance = 1 + random(generator) * 500;
+				draw.instanceCount = batch.count;
+				queue.Add(draw.pso, draw.material, draw.mesh, draw.distance, (uint32_t)draws.size());
+				draws.push_back(draw);
+				referenceInstanceCount += instancesPerMesh[batch.mesh - meshes.data()];
+			}
+		}
+
+		set<const void*> uniquePSOs;
+		set<pair<const void*, const void*>> uniqueStates;
+		set<tuple<const void*, const void*, const void*>> uniqueDraws;
+		for (const Draw& draw : draws)
+		{
+			uniquePSOs.insert(draw.pso);
+			uniqueStates.insert(make_pair(draw.pso, draw.material));
+			uniqueDraws.insert(make_tuple(draw.pso, draw.material, draw.mesh));
+		}
+
+		// Number of times the pipeline state, the pipeline state or material, and any of the three change when drawing in the given order:
+		struct StateChanges
+		{
+			uint32_t pso;
+			uint32_t state;
+			uint32_t draw;
+		};
+		auto CountStateChanges = [&](const vector<uint32_t>& payloads) {
+			StateChanges changes = {};
+			const Draw* prev = nullptr;
+			for (uint32_t payload : payloads)
+			{
+				const Draw& draw = draws[payload];
+				const bool psoChange = prev == nullptr || draw.pso != prev->pso;
+				const bool stateChange = psoChange || draw.material != prev->material;
+				changes.pso += psoChange ? 1 : 0;
+				changes.state += stateChange ? 1 : 0;
+				changes.draw += (stateChange || draw.mesh != prev->mesh) ? 1 : 0;
+				prev = &draw;
+			}
+			return changes;
+		};
+		vector<uint32_t> submissionOrder(draws.size());
+		iota(submissionOrder.begin(), submissionOrder.end(), 0);
+		const StateChanges unsortedChanges = CountStateChanges(submissionOrder);
+
+		// Sorted by state: the keys are ordered, the sort is stable and every state is contiguous, so each one is bound only once
+		{
+			timer.record();
+			queue.Sort(wiRenderQueue::SORT_STATE);
+			const double timeSort = timer.elapsed();
+
+			const vector<wiRenderQueue::Entry>& entries = queue.GetEntries();
+			vector<uint32_t> payloads;
+			vector<uint8_t> payloadSeen(draws.size());
+			uint32_t wrongEntries = 0, drawnInstances = 0;
+			for (size_t i = 0; i < entries.size(); ++i)
+			{
+				const wiRenderQueue::Entry& entry = entries[i];
+				const Draw& draw = draws[entry.payload];
+				bool valid = !payloadSeen[entry.payload] && entry.pso == draw.pso && entry.material == draw.material && entry.mesh == draw.mesh;
+				if (i > 0)
+				{
+					const wiRenderQueue::Entry& prev = entries[i - 1];
+					valid = valid && (prev.key < entry.key || (prev.key == entry.key && prev.payload < entry.payload));
+					if (prev.pso == entry.pso && prev.material == entry.material && prev.mesh == entry.mesh)
+					{
+						// front to back inside the same state, within the precision of the depth buckets:
+						valid = valid && draws[prev.payload].distance <= draw.distance * (1 + 1.0f / 64);
+					}
+				}
+				payloadSeen[entry.payload] = 1;
+				wrongEntries += valid ? 0 : 1;
+				payloads.push_back(entry.payload);
+				drawnInstances += draw.instanceCount;
+			}
+
+			uint32_t wrongBatches = 0, batchedEntries = 0;
+			for (const wiRenderQueue::Batch& batch : queue.GetBatches())
+			{
+				bool valid = batch.offset == batchedEntries && batch.count > 0;
+				for (uint32_t i = batch.offset; i < batch.offset + batch.count && i < entries.size(); ++i)
+				{
+					valid = valid && entries[i].pso == batch.pso && entries[i].material == batch.material;
+				}
+				batchedEntries += batch.count;
+				wrongBatches += valid ? 0 : 1;
+			}
+
+			const StateChanges sortedChanges = CountStateChanges(payloads);
+			const bool valid = wrongEntries == 0 && wrongBatches == 0 && batchedEntries == entries.size() && entries.size() == draws.size() &&
+				queue.GetBatches().size() == uniqueStates.size() && sortedChanges.pso == uniquePSOs.size() && sortedChanges.state == uniqueStates.size() && sortedChanges.draw == uniqueDraws.size() &&
+				queue.GetMeshChangeCount() <= sortedChanges.draw && drawnInstances == referenceInstanceCount;
+			ss << "  " << draws.size() << " instanced draws of " << drawnInstances << " instances, sorted by state: " << wrongEntries << " entries out of order, " << wrongBatches << " wrong batches (" << timeSort << " ms)" << endl;
+			ss << "    state changes in submission order: " << unsortedChanges.pso << " PSO, " << unsortedChanges.state << " PSO/material, " << unsortedChanges.draw << " PSO/material/mesh" << endl;
+			ss << "    state changes in sorted order: " << sortedChanges.pso << " PSO, " << sortedChanges.state << " PSO/material, " << sortedChanges.draw << " PSO/material/mesh (minimum: "
+				<< uniquePSOs.size() << ", " << uniqueStates.size() << ", " << uniqueDraws.size() << ")" << (valid ? "" : " INVALID") << endl;
+			passed = passed && valid;
+		}
+
+		// Sorted back to front: the keys are ordered and no draw is in front of the ones after it, within the precision of the depth buckets
+		{
+			queue.Sort(wiRenderQueue::SORT_BACK_TO_FRONT);
+			const vector<wiRenderQueue::Entry>& entries = queue.GetEntries();
+			uint32_t wrongEntries = 0;
+			for (size_t i = 1; i < entries.size(); ++i)
+			{
+				const wiRenderQueue::Entry& prev = entries[i - 1];
+				const wiRenderQueue::Entry& entry = entries[i];
+				const bool valid = (prev.key < entry.key || (prev.key == entry.key && prev.payload < entry.payload)) &&
+					draws[entry.payload].distance <= draws[prev.payload].distance * (1 + 1.0f / 64);
+				wrongEntries += valid ? 0 : 1;
+			}
+			ss << "  sorted back to front: " << wrongEntries << " entries out of order" << endl;
+			passed = passed && wrongEntries == 0 && entries.size() == draws.size();
+		}
+
+		// Timing of a large queue:
+		{
+			const uint32_t count = 100000;
+			vector<uint32_t> states(count);
+			vector<float> distances(count);
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				states[i] = generator();
+				distances[i] = 1 + random(generator) * 1000;
+			}
+			wiRenderQueue largeQueue;
+			const double timeLarge = Measure(5, [&] {
+				largeQueue.clear();
+				for (uint32_t i = 0; i < count; ++i)
+				{
+					const uint32_t state = states[i];
+					largeQueue.Add(&psos[state % psoCount], &materials[(state >> 8) % materialCount], &meshes[(state >> 16) % meshCount], distances[i], i);
+				}
+				largeQueue.Sort(wiRenderQueue::SORT_STATE);
+			});
+			ss << "  add and sort " << count << " draws: " << timeLarge << " ms (best of 5 runs)" << endl;
+		}
+
+		ss << (passed ? "PASSED" : "FAILED") << endl;
+		return ss.str();
+	}
+
+	string RenderPassSchedulerTest()
+	{
+		stringstream ss;
+		ss << "Render pass scheduler (wiRenderPassScheduler) on the null graphics device:" << endl;
+		bool passed = true;
+
+		typedef wiRenderPassScheduler::PassID PassID;
+		wiGraphicsTypes::GraphicsDevice_Null multithreadedDevice(64, 64, true);
+		wiGraphicsTypes::GraphicsDevice_Null singleThreadedDevice(64, 64, false);
+		wiGraphicsTypes::GraphicsDevice_Null* device = &multithreadedDevice;
+
+		// Every context logs the passes recorded into it. The contexts are submitted in GRAPHICSTHREAD order, so the concatenated logs are the submission order:
+		vector<PassID> recorded[GRAPHICSTHREAD_COUNT];
+		uint32_t contextBegins[GRAPHICSTHREAD_COUNT] = {};
+		auto AddPass = [&](wiRenderPassScheduler& scheduler, const vector<PassID>& dependencies, float cost) {
+			const PassID pass = (PassID)scheduler.GetPasses().size();
+			return scheduler.AddPass("Pass " + to_string(pass), [&, pass](GRAPHICSTHREAD threadID) {
+				recorded[threadID].push_back(pass);
+				device->Draw(3, 0, threadID);
+			}, dependencies, cost);
+		};
+
+		// Executes the compiled passes and counts the errors: every pass must be recorded once, on the context that Compile() assigned to it (or the immediate context
+		//	without multithreaded rendering), after the context was set up, and must be submitted after its dependencies in the execution order
+		auto Execute = [&](wiRenderPassScheduler& scheduler, wiGraphicsTypes::GraphicsDevice_Null* executeDevice) {
+			device = executeDevice;
+			const bool multithreaded = device->CheckCapability(wiGraphicsTypes::GraphicsDevice::GRAPHICSDEVICE_CAPABILITY_MULTITHREADED_RENDERING);
+			for (int i = 0; i < GRAPHICSTHREAD_COUNT; ++i)
+			{
+				recorded[i].clear();
+				contextBegins[i] = 0;
+			}
+			scheduler.SetContextBegin([&](GRAPHICSTHREAD threadID) {
+				contextBegins[threadID]++;
+			});
+			scheduler.Execute(device);
+			device->PresentEnd();
+
+			const vector<wiRenderPassScheduler::Pass>& passes = scheduler.GetPasses();
+			vector<PassID> submission;
+			vector<int> submittedAt(passes.size(), -1);
+			vector<int> recordedOn(passes.size(), -1);
+			uint32_t errors = 0;
+			for (int i = 0; i < GRAPHICSTHREAD_COUNT; ++i)
+			{
+				const bool used = multithreaded && i > GRAPHICSTHREAD_IMMEDIATE && i <= (int)scheduler.GetContextCount();
+				errors += contextBegins[i] != (used ? 1u : 0u) ? 1 : 0;
+				for (PassID pass : recorded[i])
+				{
+					errors += submittedAt[pass] >= 0 ? 1 : 0;
+					submittedAt[pass] = (int)submission.size();
+					recordedOn[pass] = i;
+					submission.push_back(pass);
+				}
+			}
+			errors += submission != scheduler.GetExecutionOrder() ? 1 : 0;
+			errors += device->GetFrameStats().drawCalls != passes.size() ? 1 : 0;
+			for (PassID pass = 0; pass < (PassID)passes.size(); ++pass)
+			{
+				errors += (submittedAt[pass] < 0 || recordedOn[pass] != (multithreaded ? (int)passes[pass].threadID : (int)GRAPHICSTHREAD_IMMEDIATE)) ? 1 : 0;
+				for (PassID dependency : passes[pass].dependencies)
+				{
+					errors += submittedAt[dependency] >= submittedAt[pass] ? 1 : 0;
+				}
+			}
+			return errors;
+		};
+
+		// The passes of the 3D renderer (Renderable3DComponent::RenderParallelPasses):
+		{
+			wiRenderPassScheduler scheduler;
+			const PassID shadows = AddPass(scheduler, {}, 2.0f);
+			const PassID cubeShadows = AddPass(scheduler, {}, 1.0f);
+			const PassID voxelRadiance = AddPass(scheduler, { shadows, cubeShadows }, 1.0f);
+			AddPass(scheduler, { shadows, cubeShadows, voxelRadiance }, 1.0f);
+			AddPass(scheduler, { shadows, cubeShadows, voxelRadiance }, 1.0f);
+			const bool compiled = scheduler.Compile();
+			const uint32_t errors = Execute(scheduler, &multithreadedDevice);
+			const uint32_t errorsSingleThreaded = Execute(scheduler, &singleThreadedDevice);
+			ss << "  renderer passes: " << scheduler.GetPasses().size() << " passes on " << scheduler.GetContextCount() << " contexts, " << errors << " errors, "
+				<< errorsSingleThreaded << " errors without multithreaded rendering" << endl;
+			passed = passed && compiled && errors == 0 && errorsSingleThreaded == 0;
+		}
+
+		// Random dependency graphs. The dependencies are also added to passes that were added earlier, so the execution order differs from the order of adding:
+		{
+			mt19937 generator(5);
+			uniform_real_distribution<float> random(0, 1);
+			uint32_t errors = 0, reordered = 0, contexts = 0;
+			const uint32_t graphCount = 100;
+			for (uint32_t graph = 0; graph < graphCount; ++graph)
+			{
+				const uint32_t passCount = 1 + generator() % 40;
+				vector<uint32_t> rank(passCount);
+				iota(rank.begin(), rank.end(), 0);
+				shuffle(rank.begin(), rank.end(), generator);
+
+				wiRenderPassScheduler scheduler;
+				for (uint32_t i = 0; i < passCount; ++i)
+				{
+					AddPass(scheduler, {}, 0.5f + random(generator) * 4);
+				}
+				for (PassID a = 0; a < passCount; ++a)
+				{
+					for (PassID b = 0; b < passCount; ++b)
+					{
+						if (rank[b] < rank[a] && random(generator) < 0.1f)
+						{
+							scheduler.AddDependency(a, b);
+						}
+					}
+				}
+				errors += scheduler.Compile(1 + generator() % (GRAPHICSTHREAD_COUNT - 1)) ? 0 : 1;
+				errors += Execute(scheduler, &multithreadedDevice);
+				errors += Execute(scheduler, &singleThreadedDevice);
+				for (PassID i = 0; i < passCount; ++i)
+				{
+					reordered += scheduler.GetExecutionOrder()[i] != i ? 1 : 0;
+				}
+				contexts += scheduler.GetContextCount();
+			}
+			ss << "  " << graphCount << " random dependency graphs: " << reordered << " passes reordered, " << (float)contexts / graphCount << " contexts on average, " << errors << " errors" << endl;
+			passed = passed && errors == 0 && reordered > 0;
+		}
+
+		// Independent passes of the same cost are recorded on separate contexts:
+		{
+			wiRenderPassScheduler scheduler;
+			const uint32_t passCount = GRAPHICSTHREAD_COUNT - 1;
+			for (uint32_t i = 0; i < passCount; ++i)
+			{
+				AddPass(scheduler, {}, 1.0f);
+			}
+			const bool compiled = scheduler.Compile();
+			uint32_t errors = Execute(scheduler, &multithreadedDevice);
+			set<int> contexts;
+			for (int i = 0; i < GRAPHICSTHREAD_COUNT; ++i)
+			{
+				errors += recorded[i].size() > 1 ? 1 : 0;
+				if (!recorded[i].empty())
+				{
+					contexts.insert(i);
+				}
+			}
+			errors += (scheduler.GetContextCount() != passCount || contexts.size() != passCount || contexts.count(GRAPHICSTHREAD_IMMEDIATE) > 0) ? 1 : 0;
+			ss << "  " << passCount << " independent passes recorded on " << contexts.size() << " contexts, " << errors << " errors" << endl;
+			passed = passed && compiled && errors == 0;
+		}
+
+		ss << (passed ? "PASSED" : "FAILED") << endl;
+		return ss.str();
+	}
+}
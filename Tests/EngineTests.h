@@ -0,0 +1,20 @@
+#pragma once
+#include <string>
+
+// Tests and benchmarks of engine systems that run on the CPU only, they don't need a graphics device.
+//	Each of them returns a report of the results that the test framework displays.
+namespace EngineTests
+{
+	// Batched SIMD frustum culling (Frustum::CheckBoxes) against the per box paths
+	std::string FrustumCullingBenchmark();
+	// Smooth normal computation with vertex welding (Mesh::ComputeNormals) on large meshes, checked against a brute force reference
+	std::string NormalsBenchmark();
+	// Meshlet building and culling (wiMeshlet), the normal cones are checked against brute force backface tests of every triangle
+	std::string MeshletTest();
+	// Software occlusion culling (wiSoftwareOcclusion): the depth buffer against a double precision reference rasterizer, the hierarchy and the box tests against brute force
+	std::string SoftwareOcclusionTest();
+	// Grouping of the visible objects into instanced batches (CulledCollection) and the draw sorting (wiRenderQueue): key order, state changes and instance counts
+	std::string RenderQueueTest();
+	// Render pass scheduling (wiRenderPassScheduler) on the null graphics device: the submission order respects the dependencies and independent passes are recorded on separate contexts
+	std::string RenderPassSchedulerTest();
+}
@@ -1,5 +1,6 @@
 #include "stdafx.h"
 #include "Tests.h"
+#include "EngineTests.h"
 
 
 Tests::Tests()
@@ -43,6 +44,13 @@ TestsRenderer::TestsRenderer()
 	GetGUI().AddWidget(label);
 
 
+	wiLabel* testResults = new wiLabel("TestResults");
+	testResults->SetText("");
+	testResults->SetSize(XMFLOAT2(1200, 220));
+	testResults->SetPos(XMFLOAT2(10, 170));
+	GetGUI().AddWidget(testResults);
+
+
 	wiComboBox* testSelector = new wiComboBox("TestSelector");
 	testSelector->SetText("Demo: ");
 	testSelector->SetSize(XMFLOAT2(100, 20));
@@ -54,11 +62,18 @@ TestsRenderer::TestsRenderer()
 	testSelector->AddItem("Lua Script");
 	testSelector->AddItem("Soft Body");
 	testSelector->AddItem("Emitter");
+	testSelector->AddItem("Frustum Culling Benchmark");
+	testSelector->AddItem("Normals Benchmark");
+	testSelector->AddItem("Meshlet Test");
+	testSelector->AddItem("Software Occlusion Test");
+	testSelector->AddItem("Render Queue Test");
+	testSelector->AddItem("Render Pass Scheduler Test");
 	testSelector->OnSelect([=](wiEventArgs args) {
 
 		wiRenderer::ClearWorld();
 		this->clearSprites();
 		wiLua::GetGlobal()->KillProcesses();
+		testResults->SetText("");
 
 		switch (args.iValue)
 		{
@@ -84,6 +99,24 @@ TestsRenderer::TestsRenderer()
 		case 4:
 			wiRenderer::LoadModel("../models/Emitter/emitter.wimf")->Translate(XMFLOAT3(0, 2, 2));
 			break;
+		case 5:
+			testResults->SetText(EngineTests::FrustumCullingBenchmark());
+			break;
+		case 6:
+			testResults->SetText(EngineTests::NormalsBenchmark());
+			break;
+		case 7:
+			testResults->SetText(EngineTests::MeshletTest());
+			break;
+		case 8:
+			testResults->SetText(EngineTests::SoftwareOcclusionTest());
+			break;
+		case 9:
+			testResults->SetText(EngineTests::RenderQueueTest());
+			break;
+		case 10:
+			testResults->SetText(EngineTests::RenderPassSchedulerTest());
+			break;
 		}
 
 	});
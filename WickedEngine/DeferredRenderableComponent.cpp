@@ -85,8 +85,7 @@ void DeferredRenderableComponent::Start()
 void DeferredRenderableComponent::Render()
 {
 	RenderFrameSetUp(GRAPHICSTHREAD_IMMEDIATE);
-	RenderShadows(GRAPHICSTHREAD_IMMEDIATE);
-	RenderReflections(GRAPHICSTHREAD_IMMEDIATE);
+	RenderParallelPasses();
 	RenderScene(GRAPHICSTHREAD_IMMEDIATE);
 	RenderSecondaryScene(rtGBuffer, GetFinalRT(), GRAPHICSTHREAD_IMMEDIATE);
 	RenderComposition(GetFinalRT(), rtGBuffer, GRAPHICSTHREAD_IMMEDIATE);
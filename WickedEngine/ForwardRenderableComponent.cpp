@@ -67,8 +67,7 @@ void ForwardRenderableComponent::Start()
 void ForwardRenderableComponent::Render()
 {
 	RenderFrameSetUp(GRAPHICSTHREAD_IMMEDIATE);
-	RenderShadows(GRAPHICSTHREAD_IMMEDIATE);
-	RenderReflections(GRAPHICSTHREAD_IMMEDIATE);
+	RenderParallelPasses();
 	RenderScene(GRAPHICSTHREAD_IMMEDIATE);
 	RenderSecondaryScene(rtMain, rtMain, GRAPHICSTHREAD_IMMEDIATE);
 	RenderComposition(rtMain, rtMain, GRAPHICSTHREAD_IMMEDIATE);
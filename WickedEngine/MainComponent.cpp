@@ -18,6 +18,7 @@
 #include "wiGraphicsDevice_DX11.h"
 #include "wiGraphicsDevice_DX12.h"
 #include "wiGraphicsDevice_Vulkan.h"
+#include "wiGraphicsDevice_Null.h"
 
 
 using namespace std;
@@ -72,6 +73,18 @@ void MainComponent::Initialize()
 			wiHelper::messageBox("Vulkan SDK not found during building the application! Vulkan API disabled!", "Error");
 #endif
 		}
+		else if (wiStartupArguments::HasArgument("nullgraphics"))
+		{
+			// Headless, for measuring the CPU side of the renderer:
+			if (screenW > 0 && screenH > 0)
+			{
+				wiRenderer::graphicsDevice = new GraphicsDevice_Null(screenW, screenH);
+			}
+			else
+			{
+				wiRenderer::graphicsDevice = new GraphicsDevice_Null();
+			}
+		}
 		else if (wiStartupArguments::HasArgument("dx12"))
 		{
 			if (wiStartupArguments::HasArgument("hlsl6"))
@@ -133,6 +146,9 @@ void MainComponent::Run()
 	const double elapsedTime = max(0, timer.elapsed() / 1000.0);
 	timer.record();
 
+	// Register the resources that finished loading in the background, this includes the Content of every component:
+	wiResourceManager::UpdateAllAsyncLoads();
+
 	// Fixed time update:
 	wiProfiler::GetInstance().BeginRange("Fixed Update", wiProfiler::DOMAIN_CPU);
 	if (frameskip)
@@ -246,6 +262,10 @@ void MainComponent::Compose()
 				ss << "[Vulkan]";
 			}
 #endif
+			else if (dynamic_cast<GraphicsDevice_Null*>(wiRenderer::GetDevice()))
+			{
+				ss << "[Null]";
+			}
 
 #ifdef _DEBUG
 			ss << "[DEBUG]";
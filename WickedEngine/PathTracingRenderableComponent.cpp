@@ -112,6 +112,7 @@ void PathTracingRenderableComponent::Update(float dt)
 void PathTracingRenderableComponent::RenderFrameSetUp(GRAPHICSTHREAD threadID)
 {
 	wiRenderer::UpdateRenderData(threadID);
+	wiRenderer::RefreshEnvProbes(threadID);
 
 	if (sam == 0)
 	{
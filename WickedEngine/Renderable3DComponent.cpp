@@ -296,7 +296,42 @@ void Renderable3DComponent::RenderReflections(GRAPHICSTHREAD threadID)
 		}
 	}
 
-	wiProfiler::GetInstance().EndRange(); // Reflection Rendering
+	wiProfiler::GetInstance().EndRange(threadID); // Reflection Rendering
+}
+void Renderable3DComponent::RenderParallelPasses()
+{
+	// These passes only depend on the frame setup, so every one of them can be recorded on a different thread.
+	//	The dependencies only decide the submission order: everything that renders lit geometry is submitted after the shadow maps.
+	passScheduler.clear();
+	passScheduler.SetContextBegin([](GRAPHICSTHREAD threadID) {
+		wiRenderer::BindCommonResources(threadID);
+		wiImage::BindPersistentState(threadID);
+	});
+
+	const wiRenderPassScheduler::PassID shadows = passScheduler.AddPass("Shadows", [this](GRAPHICSTHREAD threadID) {
+		RenderShadows(threadID);
+	}, {}, 2.0f);
+	const wiRenderPassScheduler::PassID cubeShadows = passScheduler.AddPass("Cube Shadows", [this](GRAPHICSTHREAD threadID) {
+		RenderCubeShadows(threadID);
+	});
+	const wiRenderPassScheduler::PassID voxelRadiance = passScheduler.AddPass("Voxel Radiance", [this](GRAPHICSTHREAD threadID) {
+		if (!getStereogramEnabled())
+		{
+			wiRenderer::VoxelRadiance(threadID);
+		}
+	}, { shadows, cubeShadows });
+	passScheduler.AddPass("Environment Probes", [](GRAPHICSTHREAD threadID) {
+		wiRenderer::RefreshEnvProbes(threadID);
+	}, { shadows, cubeShadows, voxelRadiance });
+	passScheduler.AddPass("Reflections", [this](GRAPHICSTHREAD threadID) {
+		RenderReflections(threadID);
+	}, { shadows, cubeShadows, voxelRadiance });
+
+	passScheduler.Compile();
+	passScheduler.Execute(wiRenderer::GetDevice());
+
+	// The passes might have been recorded on deferred contexts, so bind their results for the rest of the frame:
+	wiRenderer::BindCommonResources(GRAPHICSTHREAD_IMMEDIATE);
 }
 void Renderable3DComponent::RenderShadows(GRAPHICSTHREAD threadID)
 {
@@ -308,10 +343,21 @@ void Renderable3DComponent::RenderShadows(GRAPHICSTHREAD threadID)
 
 	if (getShadowsEnabled())
 	{
-		wiRenderer::DrawForShadowMap(threadID, getLayerMask());
+		wiRenderer::DrawForShadowMap2D(threadID, getLayerMask());
+	}
+}
+void Renderable3DComponent::RenderCubeShadows(GRAPHICSTHREAD threadID)
+{
+	if (getStereogramEnabled())
+	{
+		// We don't need the following for stereograms...
+		return;
 	}
 
-	wiRenderer::VoxelRadiance(threadID);
+	if (getShadowsEnabled())
+	{
+		wiRenderer::DrawForShadowMapCube(threadID, getLayerMask());
+	}
 }
 void Renderable3DComponent::RenderSecondaryScene(wiRenderTarget& mainRT, wiRenderTarget& shadedSceneRT, GRAPHICSTHREAD threadID)
 {
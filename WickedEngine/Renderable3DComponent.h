@@ -2,6 +2,7 @@
 #include "Renderable2DComponent.h"
 #include "wiRenderer.h"
 #include "wiGraphicsDevice.h"
+#include "wiRenderPassScheduler.h"
 
 class Renderable3DComponent :
 	public Renderable2DComponent
@@ -63,11 +64,16 @@ protected:
 	static wiDepthTarget dtDepthCopy;
 	static wiGraphicsTypes::Texture2D* smallDepth;
 
+	wiRenderPassScheduler passScheduler;
+
 	virtual void ResizeBuffers() override;
 
 	virtual void RenderFrameSetUp(GRAPHICSTHREAD threadID);
+	// Record the passes that don't depend on the main scene (shadows, voxel radiance, environment probes, reflections) in parallel, and submit them
+	virtual void RenderParallelPasses();
 	virtual void RenderReflections(GRAPHICSTHREAD threadID);
 	virtual void RenderShadows(GRAPHICSTHREAD threadID);
+	virtual void RenderCubeShadows(GRAPHICSTHREAD threadID);
 	virtual void RenderScene(GRAPHICSTHREAD threadID) = 0;
 	virtual void RenderSecondaryScene(wiRenderTarget& mainRT, wiRenderTarget& shadedSceneRT, GRAPHICSTHREAD threadID);
 	virtual void RenderTransparentScene(wiRenderTarget& refractionRT, GRAPHICSTHREAD threadID);
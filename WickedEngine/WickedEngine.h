@@ -50,6 +50,7 @@
 #include "wiWindowRegistration.h"
 #include "wiArchive.h"
 #include "wiSpinLock.h"
+#include "wiJobSystem.h"
 #include "wiRectPacker.h"
 #include "wiProfiler.h"
 #include "wiOcean.h"
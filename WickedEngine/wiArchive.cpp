@@ -1,18 +1,34 @@
 #include "wiArchive.h"
 #include "wiHelper.h"
+#include "Utility/stb_image.h"
 
 #include <fstream>
 #include <sstream>
+#include <climits>
 
 using namespace std;
 
+// the zlib compressor of stb_image_write is implemented in Utility/utility_common.cpp, but it is not declared in the header:
+unsigned char *stbi_zlib_compress(unsigned char *data, int data_len, int *out_len, int quality);
+
 // this should always be only INCREMENTED and only if a new serialization is implemeted somewhere!
-uint64_t __archiveVersion = 21;
+uint64_t __archiveVersion = 26;
 // this is the version number of which below the archive is not compatible with the current version
 uint64_t __archiveVersionBarrier = 1;
 
 // version history is logged in ArchiveVersionHistory.txt file!
 
+// archives that are written to a file are streamed in chunks of this size:
+static const size_t __archiveStreamChunkSize = 1024 * 1024;
+// the table of contents is at the end of the archive, it is followed by its offset and this value:
+static const uint64_t __archiveTableOfContentsMagic = 0x434F544957ull; // "WITOC"
+
+enum SECTION_CODEC
+{
+	SECTION_CODEC_NONE,
+	SECTION_CODEC_ZLIB,
+};
+
 wiArchive::wiArchive()
 {
 	CreateEmpty();
@@ -23,14 +39,8 @@ wiArchive::wiArchive(const std::string& fileName, bool readMode):readMode(readMo
 	{
 		if (readMode)
 		{
-			ifstream file(fileName, ios::binary | ios::ate);
-			if (file.is_open())
+			if (MapFile())
 			{
-				dataSize = (size_t)file.tellg();
-				file.seekg(0, file.beg);
-				DATA = new char[(size_t)dataSize];
-				file.read(DATA, dataSize);
-				file.close();
 				(*this) >> version;
 				if (version < __archiveVersionBarrier)
 				{
@@ -47,11 +57,31 @@ wiArchive::wiArchive(const std::string& fileName, bool readMode):readMode(readMo
 					wiHelper::messageBox(ss.str(), "Error!");
 					Close();
 				}
+				if (IsOpen() && version >= 22)
+				{
+					ReadTableOfContents();
+				}
 			}
 		}
 		else
 		{
-			CreateEmpty();
+			readMode = false;
+			pos = 0;
+			version = __archiveVersion;
+
+			stream = new ofstream(fileName, ios::binary | ios::trunc);
+			if (stream->is_open())
+			{
+				dataSize = __archiveStreamChunkSize;
+				DATA = new char[dataSize];
+				(*this) << version;
+			}
+			else
+			{
+				// the file can't be opened now, keep the data in memory and try saving it on closing:
+				SAFE_DELETE(stream);
+				CreateEmpty();
+			}
 		}
 	}
 }
@@ -84,10 +114,283 @@ void wiArchive::SetReadModeAndResetPos(bool isReadMode)
 	}
 	else
 	{
+		tableOfContents.clear();
 		(*this) << version;
 	}
 }
 
+bool wiArchive::MapFile()
+{
+#if defined(_WIN32) && !defined(WINSTORE_SUPPORT)
+	HANDLE fileHandle = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (GetFileSizeEx(fileHandle, &fileSize) && fileSize.QuadPart > 0 && (uint64_t)fileSize.QuadPart <= (uint64_t)SIZE_MAX)
+	{
+		HANDLE mapping = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping != nullptr)
+		{
+			// the view keeps the mapping and the file alive, so the handles can be closed right away:
+			DATA = (char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			if (DATA != nullptr)
+			{
+				dataSize = (size_t)fileSize.QuadPart;
+				mapped = true;
+			}
+			CloseHandle(mapping);
+		}
+	}
+	CloseHandle(fileHandle);
+
+	if (mapped)
+	{
+		return true;
+	}
+#endif // _WIN32 && !WINSTORE_SUPPORT
+
+	// fall back to reading the whole file into memory:
+	ifstream file(fileName, ios::binary | ios::ate);
+	if (file.is_open())
+	{
+		dataSize = (size_t)file.tellg();
+		file.seekg(0, file.beg);
+		DATA = new char[(size_t)dataSize];
+		file.read(DATA, dataSize);
+		file.close();
+		return true;
+	}
+	return false;
+}
+
+void wiArchive::UnmapFile()
+{
+#if defined(_WIN32) && !defined(WINSTORE_SUPPORT)
+	UnmapViewOfFile(DATA);
+#endif // _WIN32 && !WINSTORE_SUPPORT
+	DATA = nullptr;
+	mapped = false;
+}
+
+void wiArchive::Flush()
+{
+	if (stream != nullptr && pos > 0)
+	{
+		stream->write(DATA, (streamsize)pos);
+		streamedSize += pos;
+		pos = 0;
+	}
+}
+
+void wiArchive::ReadTableOfContents()
+{
+	if (dataSize < sizeof(uint64_t) * 3)
+	{
+		return;
+	}
+	uint64_t magic, tocOffset;
+	memcpy(&magic, DATA + dataSize - sizeof(uint64_t), sizeof(uint64_t));
+	memcpy(&tocOffset, DATA + dataSize - sizeof(uint64_t) * 2, sizeof(uint64_t));
+	if (magic != __archiveTableOfContentsMagic || tocOffset < pos || tocOffset > dataSize - sizeof(uint64_t) * 2)
+	{
+		return;
+	}
+
+	size_t prevPos = pos;
+	pos = (size_t)tocOffset;
+	uint64_t count;
+	(*this) >> count;
+	string name;
+	uint64_t offset;
+	for (uint64_t i = 0; i < count && pos < dataSize; ++i)
+	{
+		(*this) >> name;
+		(*this) >> offset;
+		tableOfContents[name] = offset;
+	}
+	pos = prevPos;
+
+	// the serialized data ends where the table of contents starts:
+	dataSize = (size_t)tocOffset;
+}
+
+void wiArchive::WriteTableOfContents()
+{
+	uint64_t offset = (uint64_t)(streamedSize + pos);
+	(*this) << (uint64_t)tableOfContents.size();
+	for (auto& x : tableOfContents)
+	{
+		(*this) << x.first;
+		(*this) << x.second;
+	}
+	(*this) << offset;
+	(*this) << __archiveTableOfContentsMagic;
+}
+
+void wiArchive::BeginSection(const std::string& name, bool compressed)
+{
+	SectionState outer;
+	outer.DATA = DATA;
+	outer.pos = pos;
+	outer.dataSize = dataSize;
+	outer.mapped = mapped;
+	outer.stream = stream;
+	outer.streamedSize = streamedSize;
+	outer.compressed = compressed;
+	outer.ownsData = false;
+
+	if (readMode)
+	{
+		uint32_t codec;
+		uint64_t rawSize, storedSize;
+		(*this) >> codec;
+		(*this) >> rawSize;
+		(*this) >> storedSize;
+
+		const char* stored = DATA + pos;
+		bool valid = storedSize <= dataSize - pos;
+		outer.pos = valid ? pos + (size_t)storedSize : dataSize;
+
+		// the section is read like a separate archive, reads can't leave it:
+		DATA = nullptr;
+		dataSize = 0;
+		pos = 0;
+		if (valid && codec == SECTION_CODEC_NONE)
+		{
+			DATA = const_cast<char*>(stored);
+			dataSize = (size_t)storedSize;
+		}
+		else if (valid && codec == SECTION_CODEC_ZLIB && rawSize < INT_MAX && storedSize < INT_MAX)
+		{
+			DATA = new char[(size_t)rawSize];
+			outer.ownsData = true;
+			if (stbi_zlib_decode_buffer(DATA, (int)rawSize, stored, (int)storedSize) == (int)rawSize)
+			{
+				dataSize = (size_t)rawSize;
+			}
+		}
+	}
+	else
+	{
+		if (!name.empty() && sections.empty())
+		{
+			tableOfContents[name] = (uint64_t)(streamedSize + pos);
+		}
+
+		// the section is written into its own buffer, because its size is only known at the end and it might be compressed:
+		dataSize = 128;
+		DATA = new char[dataSize];
+		pos = 0;
+		stream = nullptr;
+		streamedSize = 0;
+	}
+	mapped = false;
+
+	sections.push_back(outer);
+}
+
+void wiArchive::EndSection()
+{
+	if (sections.empty())
+	{
+		return;
+	}
+	SectionState outer = sections.back();
+	sections.pop_back();
+
+	char* sectionData = DATA;
+	size_t sectionSize = pos;
+
+	DATA = outer.DATA;
+	pos = outer.pos;
+	dataSize = outer.dataSize;
+	mapped = outer.mapped;
+	stream = outer.stream;
+	streamedSize = outer.streamedSize;
+
+	if (readMode)
+	{
+		if (outer.ownsData)
+		{
+			SAFE_DELETE_ARRAY(sectionData);
+		}
+	}
+	else
+	{
+		uint32_t codec = SECTION_CODEC_NONE;
+		const char* stored = sectionData;
+		size_t storedSize = sectionSize;
+
+		unsigned char* compressedData = nullptr;
+		if (outer.compressed && sectionSize > 0 && sectionSize < INT_MAX)
+		{
+			int compressedSize = 0;
+			compressedData = stbi_zlib_compress((unsigned char*)sectionData, (int)sectionSize, &compressedSize, 5);
+			if (compressedData != nullptr && (size_t)compressedSize < sectionSize)
+			{
+				codec = SECTION_CODEC_ZLIB;
+				stored = (const char*)compressedData;
+				storedSize = (size_t)compressedSize;
+			}
+		}
+
+		(*this) << codec;
+		(*this) << (uint64_t)sectionSize;
+		(*this) << (uint64_t)storedSize;
+		if (storedSize > 0)
+		{
+			_write(*stored, storedSize);
+		}
+
+		free(compressedData);
+		SAFE_DELETE_ARRAY(sectionData);
+	}
+}
+
+bool wiArchive::SeekSection(const std::string& name)
+{
+	if (!readMode || !sections.empty())
+	{
+		return false;
+	}
+	auto& it = tableOfContents.find(name);
+	if (it == tableOfContents.end() || it->second >= dataSize)
+	{
+		return false;
+	}
+	pos = (size_t)it->second;
+	return true;
+}
+
+void wiArchive::_write_overflow(const void* data, size_t size)
+{
+	if (stream != nullptr)
+	{
+		Flush();
+		if (size > dataSize)
+		{
+			// doesn't fit into a chunk, write it directly:
+			stream->write((const char*)data, (streamsize)size);
+			streamedSize += size;
+			return;
+		}
+	}
+	else
+	{
+		size_t _right = pos + size;
+		char* NEWDATA = new char[_right * 2];
+		memcpy(NEWDATA, DATA, pos);
+		dataSize = _right * 2;
+		SAFE_DELETE_ARRAY(DATA);
+		DATA = NEWDATA;
+	}
+	memcpy(DATA + pos, data, size);
+	pos += size;
+}
+
 bool wiArchive::IsOpen()
 {
 	// when it is open, DATA is not null because it contains the version number at least!
@@ -96,16 +399,36 @@ bool wiArchive::IsOpen()
 
 void wiArchive::Close()
 {
-	if (!readMode && !fileName.empty())
+	while (!sections.empty())
+	{
+		EndSection();
+	}
+
+	if (stream != nullptr)
+	{
+		WriteTableOfContents();
+		Flush();
+		stream->close();
+		SAFE_DELETE(stream);
+	}
+	else if (!readMode && !fileName.empty())
 	{
 		SaveFile(fileName);
 	}
-	SAFE_DELETE_ARRAY(DATA);
+
+	if (mapped)
+	{
+		UnmapFile();
+	}
+	else
+	{
+		SAFE_DELETE_ARRAY(DATA);
+	}
 }
 
 bool wiArchive::SaveFile(const std::string& fileName)
 {
-	if (pos <= 0)
+	if (stream != nullptr || pos <= 0)
 	{
 		return false;
 	}
@@ -113,8 +436,15 @@ bool wiArchive::SaveFile(const std::string& fileName)
 	ofstream file(fileName, ios::binary | ios::trunc);
 	if (file.is_open())
 	{
+		// the table of contents is appended only to the file, the archive can still be written after saving:
+		size_t end = pos;
+		if (!readMode)
+		{
+			WriteTableOfContents();
+		}
 		file.write(DATA, (streamsize)pos);
 		file.close();
+		pos = end;
 		return true;
 	}
 
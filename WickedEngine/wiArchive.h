@@ -3,6 +3,10 @@
 #include <stdint.h>
 
 #include <string>
+#include <vector>
+#include <unordered_map>
+#include <type_traits>
+#include <iosfwd>
 
 class wiArchive
 {
@@ -15,24 +19,95 @@ private:
 
 	std::string fileName; // save to this file on closing if not empty
 
+	bool mapped = false; // DATA is a read only view of the mapped file
+	std::ofstream* stream = nullptr; // DATA is a fixed size chunk that is flushed into this file when full
+	size_t streamedSize = 0; // bytes already flushed into the stream
+
+	// the state of the enclosing data while a section is being read or written
+	struct SectionState
+	{
+		char* DATA;
+		size_t pos;
+		size_t dataSize;
+		bool mapped;
+		std::ofstream* stream;
+		size_t streamedSize;
+		bool compressed; // write mode: compress the section when it ends
+		bool ownsData; // read mode: the section was decompressed into its own buffer
+	};
+	std::vector<SectionState> sections;
+	std::unordered_map<std::string, uint64_t> tableOfContents; // named sections and their offsets in the archive
+
 	void CreateEmpty();
+	bool MapFile();
+	void UnmapFile();
+	void Flush();
+	void ReadTableOfContents();
+	void WriteTableOfContents();
+	void _write_overflow(const void* data, size_t size);
 
 public:
 	// Create empty arhive for writing
 	wiArchive();
 	// Create archive and link to file
+	//	readMode = true: the file is memory mapped and deserialized in place
+	//	readMode = false: the data is streamed into the file in fixed size chunks, so the whole archive is never held in memory
 	wiArchive(const std::string& fileName, bool readMode = true);
 	~wiArchive();
 
 	uint64_t GetVersion() { return version; }
 	bool IsReadMode() { return readMode; }
+	// Only for in memory archives, which were created empty
 	void SetReadModeAndResetPos(bool isReadMode);
 	bool IsOpen();
 	void Close();
+	// Save the contents of an in memory archive. Streamed archives are already written to their file
 	bool SaveFile(const std::string& fileName);
 	std::string GetSourceDirectory();
 	std::string GetSourceFileName();
 
+	// Everything serialized between BeginSection() and EndSection() is a section, which can be compressed
+	//	Named top level sections are listed in the table of contents of the archive, so they can be read without parsing the rest of the archive
+	//	The calls must be the same when reading, the parameters are only used for writing
+	void BeginSection(const std::string& name = "", bool compressed = false);
+	void EndSection();
+	// Move the read position to a named section, then BeginSection() can read it. Returns false if there is no such section
+	bool SeekSection(const std::string& name);
+
+	// Arrays of plain data are written with their element count and element size, followed by the elements in a single copy
+	//	Only use types with the same layout on every platform (no pointers, size_t, long, etc.), because the memory is copied as it is!
+	template<typename T>
+	void WriteArray(const std::vector<T>& data)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "wiArchive arrays must contain plain data!");
+		_write((uint64_t)data.size());
+		_write((uint64_t)sizeof(T));
+		if (!data.empty())
+		{
+			_write(data[0], data.size());
+		}
+	}
+	template<typename T>
+	void ReadArray(std::vector<T>& data)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "wiArchive arrays must contain plain data!");
+		uint64_t count, stride;
+		_read(count);
+		_read(stride);
+		if (stride != sizeof(T) || count > (dataSize - pos) / sizeof(T))
+		{
+			// the array was written with a different element layout or it is truncated, skip it:
+			data.clear();
+			pos = (stride > 0 && count <= (dataSize - pos) / stride) ? pos + (size_t)(count * stride) : dataSize;
+			return;
+		}
+		data.resize((size_t)count);
+		if (!data.empty())
+		{
+			_read(data[0], count);
+		}
+	}
+
 	// It could be templated but we have to be extremely careful of different datasizes on different platforms
 	// because serialized data should be interchangeable!
 	// So providing exact copy operations for exact types enforces platform agnosticism
@@ -215,11 +290,17 @@ public:
 	{
 		uint64_t len;
 		_read(len);
-		char* str = new char[(size_t)len];
-		memset(str, '\0', (size_t)(sizeof(char)*len));
-		_read(*str, len);
-		data = std::string(str);
-		delete[] str;
+		// the length comes from the file, pos + len could wrap around:
+		if (len > dataSize - pos)
+		{
+			data.clear();
+			pos = dataSize;
+			return *this;
+		}
+		// read the characters in place, up to the null-terminator:
+		const char* str = DATA + pos;
+		data.assign(str, strnlen(str, (size_t)len));
+		pos += (size_t)len;
 		return *this;
 	}
 
@@ -239,13 +320,11 @@ private:
 		size_t _right = pos + _size;
 		if (_right > dataSize)
 		{
-			char* NEWDATA = new char[_right * 2];
-			memcpy(NEWDATA, DATA, dataSize);
-			dataSize = _right * 2;
-			SAFE_DELETE_ARRAY(DATA);
-			DATA = NEWDATA;
+			// grow the memory buffer, or flush the chunk into the file stream:
+			_write_overflow(&data, _size);
+			return;
 		}
-		memcpy(reinterpret_cast<void*>((uint64_t)DATA + (uint64_t)pos), &data, _size);
+		memcpy(DATA + pos, &data, _size);
 		pos = _right;
 	}
 
@@ -253,8 +332,16 @@ private:
 	template<typename T>
 	void _read(T& data, uint64_t count = 1)
 	{
-		memcpy(&data, reinterpret_cast<void*>((uint64_t)DATA + (uint64_t)pos), (size_t)(sizeof(data)*count));
-		pos += (size_t)(sizeof(data)*count);
+		if (count > (dataSize - pos) / sizeof(data))
+		{
+			// truncated archive, don't read past the end of the data:
+			memset(&data, 0, (size_t)(sizeof(data)*count));
+			pos = dataSize;
+			return;
+		}
+		size_t _size = (size_t)(sizeof(data)*count);
+		memcpy(&data, DATA + pos, _size);
+		pos += _size;
 	}
 };
 
@@ -12,11 +12,99 @@
 #include "BulletSoftBody/btDefaultSoftBodySolver.h"
 #include "BulletSoftBody/btSoftBodyRigidBodyCollisionConfiguration.h"
 
+#include "wiJobSystem.h"
+
+#include <unordered_map>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
 using namespace std;
 using namespace wiSceneComponents;
 
 int PHYSICS::softBodyIterationCount=5;
 bool PHYSICS::rigidBodyPhysicsEnabled = true, PHYSICS::softBodyPhysicsEnabled = true;
+float PHYSICS::fixedTimeStep = 1.0f / 60.0f;
+
+// The simulation can fall behind the game by this many steps, the rest of the time is dropped
+#define WIBULLET_MAX_STEP_LAG 6
+
+// Mesh collision shapes are cached, all objects with the same mesh and scale share one shape:
+enum COLLISIONSHAPE_TYPE
+{
+	COLLISIONSHAPE_CONVEX_HULL,
+	COLLISIONSHAPE_MESH,
+};
+struct CollisionShapeKey
+{
+	const Mesh* mesh;
+	COLLISIONSHAPE_TYPE type;
+	XMFLOAT3 scale;
+
+	bool operator==(const CollisionShapeKey& other) const
+	{
+		return mesh == other.mesh && type == other.type && scale.x == other.scale.x && scale.y == other.scale.y && scale.z == other.scale.z;
+	}
+};
+struct CollisionShapeKeyHasher
+{
+	size_t operator()(const CollisionShapeKey& key) const
+	{
+		size_t seed = hash<const Mesh*>()(key.mesh);
+		seed ^= hash<int>()((int)key.type) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+		seed ^= hash<float>()(key.scale.x) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+		seed ^= hash<float>()(key.scale.y) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+		seed ^= hash<float>()(key.scale.z) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+		return seed;
+	}
+};
+// Triangles of a mesh collider with their hierarchy. The unscaled shape is shared by every scale of the mesh (btScaledBvhTriangleMeshShape)
+struct CollisionTriangleMesh
+{
+	vector<btScalar> positions;
+	vector<int> indices;
+	btTriangleIndexVertexArray* meshInterface = nullptr;
+	btBvhTriangleMeshShape* shape = nullptr;
+	void* bvhBuffer = nullptr; // the hierarchy memory if it was loaded from Mesh::collisionBVH
+
+	~CollisionTriangleMesh()
+	{
+		delete shape;
+		delete meshInterface;
+		if (bvhBuffer != nullptr)
+		{
+			btAlignedFree(bvhBuffer);
+		}
+	}
+};
+// Mesh::collisionBVH starts with this. The hierarchy is only loaded if it was saved for the same triangles by the same Bullet build
+struct CollisionBVHHeader
+{
+	uint32_t bulletVersion;
+	uint32_t pointerSize; // the memory layout of the hierarchy depends on it
+	uint64_t triangleHash;
+	uint64_t size; // bytes of the serialized hierarchy following the header
+};
+
+// A collision object after a simulation step
+struct BodyState
+{
+	XMFLOAT4 rotation;
+	XMFLOAT3 position;
+	XMFLOAT3 aabbMin, aabbMax; // soft bodies only
+	uint32_t nodeOffset, nodeCount; // soft body nodes in the SimulationState
+};
+// The collision objects after a simulation step, in the order of the collision object array
+struct SimulationState
+{
+	vector<BodyState> bodies;
+	vector<XMFLOAT3> nodePositions;
+	vector<XMFLOAT3> nodeNormals;
+	double time = 0;
+	uint64_t objectsVersion = 0; // the collision object indices are only valid while this matches BulletPhysicsWorld::objectsVersion
+};
 
 struct BulletPhysicsWorld
 {
@@ -31,11 +119,249 @@ struct BulletPhysicsWorld
 	btSoftBodySolverOutput* softBodySolverOutput;
 
 	btVector3 wind;
+
+	// Cached mesh collision shapes, see registerObjects(). The triangle meshes are owned by triangleMeshes, the other shapes by collisionShapes:
+	unordered_map<CollisionShapeKey, btCollisionShape*, CollisionShapeKeyHasher> shapeCache;
+	unordered_map<const Mesh*, CollisionTriangleMesh*> triangleMeshCache;
+	unordered_map<const Mesh*, uint64_t> meshHashes; // the triangles of the meshes when their shapes were cached
+	vector<CollisionTriangleMesh*> triangleMeshes;
+
+	// The simulation runs on its own thread with fixed steps, it catches up with the time advanced by Update():
+	thread simulationThread;
+	bool running = false;
+	recursive_mutex worldLock; // held during a step, and between MarkForWrite() and UnMarkForWrite()
+	mutex timeLock;
+	condition_variable timeCondition;
+	double targetTime = 0;
+	double simulatedTime = 0;
+
+	// The last two steps are published for reading without waiting for the simulation, the next one is written by the simulation thread:
+	mutex stateLock; // held between MarkForRead() and UnMarkForRead()
+	SimulationState previousState, currentState, nextState;
+	float interpolation = 0; // between the previous and current state, updated in MarkForRead()
+	atomic<uint64_t> objectsVersion; // incremented when collision objects are removed, because the indices of the others change
 };
 
+// Simulation thread: step the world whenever the game time is ahead by a step, then publish the new state
+static void RunSimulation(BulletPhysicsWorld* world)
+{
+	btSoftRigidDynamicsWorld* dynamicsWorld = (btSoftRigidDynamicsWorld*)world->dynamicsWorld;
+	while (true)
+	{
+		{
+			unique_lock<mutex> lock(world->timeLock);
+			world->timeCondition.wait(lock, [world] {
+				return !world->running || world->simulatedTime + PHYSICS::fixedTimeStep <= world->targetTime;
+			});
+			if (!world->running)
+			{
+				return;
+			}
+		}
+
+		SimulationState& state = world->nextState;
+		{
+			lock_guard<recursive_mutex> lock(world->worldLock);
+
+			if (PHYSICS::rigidBodyPhysicsEnabled || PHYSICS::softBodyPhysicsEnabled)
+			{
+				btSoftBodyArray& softBodies = dynamicsWorld->getSoftBodyArray();
+				for (int i = 0; i < softBodies.size(); ++i)
+				{
+					softBodies[i]->setWindVelocity(world->wind);
+				}
+
+				// A single step of exactly the fixed time step:
+				dynamicsWorld->stepSimulation(PHYSICS::fixedTimeStep, 0);
+			}
+
+			const btCollisionObjectArray& objects = dynamicsWorld->getCollisionObjectArray();
+			state.objectsVersion = world->objectsVersion.load();
+			state.bodies.resize(objects.size());
+			state.nodePositions.clear();
+			state.nodeNormals.clear();
+			for (int i = 0; i < objects.size(); ++i)
+			{
+				BodyState& body = state.bodies[i];
+				btTransform trans;
+				trans.setIdentity();
+
+				btRigidBody* rigidBody = btRigidBody::upcast(objects[i]);
+				if (rigidBody && rigidBody->getMotionState())
+				{
+					rigidBody->getMotionState()->getWorldTransform(trans);
+				}
+
+				body.nodeOffset = (uint32_t)state.nodePositions.size();
+				body.nodeCount = 0;
+				btSoftBody* softBody = btSoftBody::upcast(objects[i]);
+				if (softBody)
+				{
+					trans = softBody->getWorldTransform();
+
+					btVector3 aabbMin, aabbMax;
+					softBody->getAabb(aabbMin, aabbMax);
+					body.aabbMin = XMFLOAT3(aabbMin.x(), aabbMin.y(), aabbMin.z());
+					body.aabbMax = XMFLOAT3(aabbMax.x(), aabbMax.y(), aabbMax.z());
+
+					const btSoftBody::tNodeArray& nodes = softBody->m_nodes;
+					body.nodeCount = (uint32_t)nodes.size();
+					for (int j = 0; j < nodes.size(); ++j)
+					{
+						state.nodePositions.push_back(XMFLOAT3(nodes[j].m_x.getX(), nodes[j].m_x.getY(), nodes[j].m_x.getZ()));
+						state.nodeNormals.push_back(XMFLOAT3(nodes[j].m_n.getX(), nodes[j].m_n.getY(), nodes[j].m_n.getZ()));
+					}
+				}
+
+				btQuaternion rot = trans.getRotation();
+				btVector3 pos = trans.getOrigin();
+				body.rotation = XMFLOAT4(rot.getX(), rot.getY(), rot.getZ(), rot.getW());
+				body.position = XMFLOAT3(pos.getX(), pos.getY(), pos.getZ());
+			}
+		}
+
+		{
+			lock_guard<mutex> lock(world->timeLock);
+			world->simulatedTime += PHYSICS::fixedTimeStep;
+			state.time = world->simulatedTime;
+		}
+		{
+			lock_guard<mutex> lock(world->stateLock);
+			swap(world->previousState, world->currentState);
+			swap(world->currentState, world->nextState);
+		}
+	}
+}
+
+// FNV-1a hash of the collision triangles, the cached shapes of a mesh are discarded when it changes
+static uint64_t HashTriangles(const Mesh* mesh)
+{
+	uint64_t hash = 14695981039346656037ull;
+	auto add = [&](const void* data, size_t size) {
+		const uint8_t* bytes = (const uint8_t*)data;
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+		}
+	};
+	for (const Mesh::Vertex_POS& vertex : mesh->vertices_POS)
+	{
+		add(&vertex.pos, sizeof(vertex.pos));
+	}
+	if (!mesh->indices.empty())
+	{
+		add(mesh->indices.data(), mesh->indices.size() * sizeof(uint32_t));
+	}
+	return hash;
+}
+static btCollisionShape* CreateConvexHull(const Mesh* mesh, const XMFLOAT3& sca)
+{
+	btConvexHullShape* shape = new btConvexHullShape();
+	for (const Mesh::Vertex_POS& vertex : mesh->vertices_POS)
+	{
+		// the bounds are computed once after all the points, not after every one:
+		shape->addPoint(btVector3(vertex.pos.x, vertex.pos.y, vertex.pos.z), false);
+	}
+	shape->recalcLocalAabb();
+	shape->setLocalScaling(btVector3(sca.x, sca.y, sca.z));
+	shape->setMargin(btScalar(0.05));
+	return shape;
+}
+// Create the triangle collider of a mesh. The hierarchy is loaded from the mesh if it was saved there, otherwise it is built and saved to the mesh
+static CollisionTriangleMesh* CreateTriangleMesh(Mesh* mesh, uint64_t triangleHash)
+{
+	CollisionTriangleMesh* triangleMesh = new CollisionTriangleMesh;
+
+	triangleMesh->positions.resize(mesh->vertices_POS.size() * 3);
+	for (size_t i = 0; i < mesh->vertices_POS.size(); ++i)
+	{
+		triangleMesh->positions[i * 3 + 0] = btScalar(mesh->vertices_POS[i].pos.x);
+		triangleMesh->positions[i * 3 + 1] = btScalar(mesh->vertices_POS[i].pos.y);
+		triangleMesh->positions[i * 3 + 2] = btScalar(mesh->vertices_POS[i].pos.z);
+	}
+	triangleMesh->indices.assign(mesh->indices.begin(), mesh->indices.end());
+
+	triangleMesh->meshInterface = new btTriangleIndexVertexArray(
+		(int)triangleMesh->indices.size() / 3,
+		triangleMesh->indices.data(),
+		3 * sizeof(int),
+		(int)mesh->vertices_POS.size(),
+		triangleMesh->positions.data(),
+		3 * sizeof(btScalar)
+		);
+
+	bool useQuantizedAabbCompression = true;
+
+	CollisionBVHHeader header;
+	if (mesh->collisionBVH.size() > sizeof(header))
+	{
+		memcpy(&header, mesh->collisionBVH.data(), sizeof(header));
+		if (header.bulletVersion == (uint32_t)btGetVersion() && header.pointerSize == (uint32_t)sizeof(void*) &&
+			header.triangleHash == triangleHash && header.size == mesh->collisionBVH.size() - sizeof(header))
+		{
+			// The hierarchy is used in place, it needs aligned memory that lives as long as the shape:
+			triangleMesh->bvhBuffer = btAlignedAlloc((size_t)header.size, 16);
+			memcpy(triangleMesh->bvhBuffer, mesh->collisionBVH.data() + sizeof(header), (size_t)header.size);
+			btOptimizedBvh* bvh = btOptimizedBvh::deSerializeInPlace(triangleMesh->bvhBuffer, (unsigned int)header.size, false);
+			if (bvh != nullptr)
+			{
+				triangleMesh->shape = new btBvhTriangleMeshShape(triangleMesh->meshInterface, useQuantizedAabbCompression, false);
+				triangleMesh->shape->setOptimizedBvh(bvh);
+			}
+			else
+			{
+				btAlignedFree(triangleMesh->bvhBuffer);
+				triangleMesh->bvhBuffer = nullptr;
+			}
+		}
+	}
+
+	if (triangleMesh->shape == nullptr)
+	{
+		triangleMesh->shape = new btBvhTriangleMeshShape(triangleMesh->meshInterface, useQuantizedAabbCompression);
+
+		btOptimizedBvh* bvh = triangleMesh->shape->getOptimizedBvh();
+		const unsigned int size = bvh->calculateSerializeBufferSize();
+		void* buffer = btAlignedAlloc(size, 16);
+		if (bvh->serializeInPlace(buffer, size, false))
+		{
+			header.bulletVersion = (uint32_t)btGetVersion();
+			header.pointerSize = (uint32_t)sizeof(void*);
+			header.triangleHash = triangleHash;
+			header.size = size;
+			mesh->collisionBVH.resize(sizeof(header) + size);
+			memcpy(mesh->collisionBVH.data(), &header, sizeof(header));
+			memcpy(mesh->collisionBVH.data() + sizeof(header), buffer, size);
+		}
+		btAlignedFree(buffer);
+	}
+
+	triangleMesh->shape->setMargin(btScalar(0.05));
+	return triangleMesh;
+}
+static bool GetCollisionShapeKey(const Object* object, CollisionShapeKey& key)
+{
+	if (!object->collisionShape.compare("CONVEX_HULL"))
+	{
+		key.type = COLLISIONSHAPE_CONVEX_HULL;
+	}
+	else if (!object->collisionShape.compare("MESH"))
+	{
+		key.type = COLLISIONSHAPE_MESH;
+	}
+	else
+	{
+		return false;
+	}
+	key.mesh = object->mesh;
+	key.scale = object->scale;
+	return true;
+}
+
 wiBULLET::wiBULLET()
 {
 	bulletPhysics = new BulletPhysicsWorld;
+	bulletPhysics->objectsVersion = 0;
 
 	registeredObjects=-1;
 
@@ -81,6 +407,9 @@ wiBULLET::wiBULLET()
 #endif
 
 	///-----initialization_end-----
+
+	bulletPhysics->running = true;
+	bulletPhysics->simulationThread = thread(RunSimulation, bulletPhysics);
 }
 
 wiBULLET::~wiBULLET()
@@ -89,6 +418,13 @@ wiBULLET::~wiBULLET()
 	
 	///-----cleanup_start-----
 
+	{
+		lock_guard<mutex> lock(bulletPhysics->timeLock);
+		bulletPhysics->running = false;
+	}
+	bulletPhysics->timeCondition.notify_one();
+	bulletPhysics->simulationThread.join();
+
 	ClearWorld();
 
 	//delete dynamics world
@@ -116,6 +452,7 @@ wiBULLET::~wiBULLET()
 
 
 void wiBULLET::addWind(const XMFLOAT3& wind){
+	lock_guard<recursive_mutex> lock(bulletPhysics->worldLock);
 	this->bulletPhysics->wind = btVector3(btScalar(wind.x),btScalar(wind.y),btScalar(wind.z));
 }
 
@@ -592,39 +929,36 @@ void wiBULLET::connectVerticesToSoftBody(Mesh* const mesh, int objectI){
 	if (!softBodyPhysicsEnabled)
 		return;
 
-	btCollisionObject* obj = bulletPhysics->dynamicsWorld->getCollisionObjectArray()[objectI];
-	btSoftBody* softBody = btSoftBody::upcast(obj);
-
-
-	if(softBody){
-		btVector3 min, max;
-		softBody->getAabb(min, max);
-		mesh->aabb.create(XMFLOAT3(min.x(), min.y(), min.z()), XMFLOAT3(max.x(), max.y(), max.z()));
+	// The vertices are read from the last simulation step (between MarkForRead() and UnMarkForRead()):
+	const SimulationState& state = bulletPhysics->currentState;
+	if (state.objectsVersion != bulletPhysics->objectsVersion.load() || objectI < 0 || objectI >= (int)state.bodies.size())
+		return;
+	const BodyState& body = state.bodies[objectI];
 
-		softBody->setWindVelocity(bulletPhysics->wind);
+	if(body.nodeCount > 0){
+		mesh->aabb.create(body.aabbMin, body.aabbMax);
 
-		btSoftBody::tNodeArray&   nodes(softBody->m_nodes);
-		
-		int gvg = mesh->goalVG;
+		const XMFLOAT3* nodePositions = &state.nodePositions[body.nodeOffset];
+		const XMFLOAT3* nodeNormals = &state.nodeNormals[body.nodeOffset];
 		for (unsigned int i = 0; i<mesh->vertices_POS.size(); ++i)
 		{
 			int indexP = mesh->physicalmapGP[i];
-			float weight = mesh->vertexGroups[gvg].vertices[indexP];
 
 			Mesh::Vertex_POS& vert = mesh->vertices_Transformed_POS[i];
 
 			mesh->vertices_Transformed_PRE[i] = vert;
-			vert.pos.x = nodes[indexP].m_x.getX();
-			vert.pos.y = nodes[indexP].m_x.getY();
-			vert.pos.z = nodes[indexP].m_x.getZ();
-			mesh->vertices_Transformed_POS[i].MakeFromParams(XMFLOAT3(-nodes[indexP].m_n.getX(), -nodes[indexP].m_n.getY(), -nodes[indexP].m_n.getZ())/*, vert.GetWind(), vert.GetMaterialIndex()*/);
+			vert.pos = nodePositions[indexP];
+			mesh->vertices_Transformed_POS[i].MakeFromParams(XMFLOAT3(-nodeNormals[indexP].x, -nodeNormals[indexP].y, -nodeNormals[indexP].z)/*, vert.GetWind(), vert.GetMaterialIndex()*/);
 		}
+		mesh->softBodyVersion++;
 	}
 }
 void wiBULLET::connectSoftBodyToVertices(const Mesh* const mesh, int objectI){
 	if (!softBodyPhysicsEnabled)
 		return;
 
+	lock_guard<recursive_mutex> lock(bulletPhysics->worldLock);
+
 	if(!firstRunWorld){
 		btCollisionObject* obj = bulletPhysics->dynamicsWorld->getCollisionObjectArray()[objectI];
 		btSoftBody* softBody = btSoftBody::upcast(obj);
@@ -652,6 +986,8 @@ void wiBULLET::transformBody(const XMFLOAT4& rot, const XMFLOAT3& pos, int objec
 		return;
 	}
 
+	lock_guard<recursive_mutex> lock(bulletPhysics->worldLock);
+
 	btCollisionObject* obj = bulletPhysics->dynamicsWorld->getCollisionObjectArray()[objectI];
 	btRigidBody* rigidBody = btRigidBody::upcast(obj);
 	if(rigidBody){
@@ -664,121 +1000,265 @@ void wiBULLET::transformBody(const XMFLOAT4& rot, const XMFLOAT3& pos, int objec
 }
 
 PHYSICS::PhysicsTransform* wiBULLET::getObject(int index){
-	
-	btCollisionObject* obj = bulletPhysics->dynamicsWorld->getCollisionObjectArray()[index];
-	btTransform trans;
-
-	btRigidBody* body = btRigidBody::upcast(obj);
-	if (body && body->getMotionState())
+	// Interpolate between the last two simulation steps (between MarkForRead() and UnMarkForRead()).
+	//	Bodies that weren't simulated yet keep the transform that they were registered with:
+	const SimulationState& previous = bulletPhysics->previousState;
+	const SimulationState& current = bulletPhysics->currentState;
+	if (current.objectsVersion == bulletPhysics->objectsVersion.load() && index < (int)current.bodies.size())
 	{
-		body->getMotionState()->getWorldTransform(trans);
+		const BodyState& b = current.bodies[index];
+		const BodyState& a = (previous.objectsVersion == current.objectsVersion && index < (int)previous.bodies.size()) ? previous.bodies[index] : b;
+		const float t = bulletPhysics->interpolation;
+		XMStoreFloat4(&transforms[index]->rotation, XMQuaternionSlerp(XMLoadFloat4(&a.rotation), XMLoadFloat4(&b.rotation), t));
+		XMStoreFloat3(&transforms[index]->position, XMVectorLerp(XMLoadFloat3(&a.position), XMLoadFloat3(&b.position), t));
 	}
-
-	btSoftBody* softBody = btSoftBody::upcast(obj);
-	if(softBody)
-	{
-		trans = softBody->getWorldTransform();
-	}
-	
-	btQuaternion rot = trans.getRotation();
-	btVector3 pos = trans.getOrigin();
-	transforms[index]->rotation=XMFLOAT4(rot.getX(),rot.getY(),rot.getZ(),rot.getW());
-	transforms[index]->position=XMFLOAT3(pos.getX(),pos.getY(),pos.getZ());
 	return transforms[index];
 }
 
-void wiBULLET::registerObject(Object* object){
-	if(object->rigidBody && object->mesh != nullptr && rigidBodyPhysicsEnabled){
-		XMFLOAT3 S,T;
-		XMFLOAT4 R;
-		object->applyTransform();
-		object->attachTo(object->GetRoot());
-
-		S = object->scale;
-		T = object->translation;
-		R = object->rotation;
-
-		if(!object->collisionShape.compare("BOX")){
-			addBox(
-				S,R,T
-				,object->mass,object->friction,object->restitution
-				,object->damping,object->kinematic
+void wiBULLET::addRigidBody(btCollisionShape* shape, const XMFLOAT4& rot, const XMFLOAT3& pos
+					, float newMass, float newFriction, float newRestitution, float newDamping, bool kinematic){
+	btTransform shapeTransform;
+	shapeTransform.setIdentity();
+	shapeTransform.setOrigin(btVector3(pos.x,pos.y,pos.z));
+	shapeTransform.setRotation(btQuaternion(rot.x,rot.y,rot.z,rot.w));
+	{
+		btScalar mass(newMass);
+
+		//rigidbody is dynamic if and only if mass is non zero, otherwise static
+		bool isDynamic = (mass != 0.f && !kinematic);
+
+		btVector3 localInertia(0,0,0);
+		if (isDynamic)
+			shape->calculateLocalInertia(mass,localInertia);
+		else
+			mass=0;
+
+		//using motionstate is recommended, it provides interpolation capabilities, and only synchronizes 'active' objects
+		btDefaultMotionState* myMotionState = new btDefaultMotionState(shapeTransform);
+		btRigidBody::btRigidBodyConstructionInfo rbInfo(mass,myMotionState,shape,localInertia);
+		rbInfo.m_friction=newFriction;
+		rbInfo.m_restitution=newRestitution;
+		rbInfo.m_linearDamping = newDamping;
+		rbInfo.m_angularDamping = newDamping;
+		btRigidBody* body = new btRigidBody(rbInfo);
+		if(kinematic) body->setCollisionFlags( body->getCollisionFlags() | btCollisionObject::CF_KINEMATIC_OBJECT);
+		body->setActivationState( DISABLE_DEACTIVATION );
+
+		//add the body to the dynamics world
+		bulletPhysics->dynamicsWorld->addRigidBody(body);
+
+		btTransform trans;
+		body->getMotionState()->getWorldTransform(trans);
+		btQuaternion nRot = trans.getRotation();
+		btVector3 nPos = trans.getOrigin();
+		transforms.push_back(new PhysicsTransform(
+			XMFLOAT4(nRot.getX(),nRot.getY(),nRot.getZ(),nRot.getW()),XMFLOAT3(nPos.getX(),nPos.getY(),nPos.getZ()))
 			);
-			object->physicsObjectID = ++registeredObjects;
+	}
+}
+void wiBULLET::prepareCollisionShapes(Object* const* objects, size_t count){
+	// The meshes that need a cached shape, their shapes are discarded if the triangles changed since they were cached:
+	vector<Mesh*> meshes;
+	for (size_t i = 0; i < count; ++i)
+	{
+		CollisionShapeKey key;
+		if (objects[i]->rigidBody && objects[i]->mesh != nullptr && GetCollisionShapeKey(objects[i], key))
+		{
+			meshes.push_back(objects[i]->mesh);
 		}
-		if(!object->collisionShape.compare("SPHERE")){
-			addSphere(
-				S.x,T
-				,object->mass,object->friction,object->restitution
-				,object->damping,object->kinematic
-			);
-			object->physicsObjectID = ++registeredObjects;
+	}
+	if (meshes.empty())
+	{
+		return;
+	}
+	sort(meshes.begin(), meshes.end());
+	meshes.erase(unique(meshes.begin(), meshes.end()), meshes.end());
+
+	vector<uint64_t> hashes(meshes.size());
+	wiJobSystem::context ctx;
+	wiJobSystem::Dispatch(ctx, (uint32_t)meshes.size(), 1, [&](wiJobSystem::JobDispatchArgs args) {
+		hashes[args.jobIndex] = HashTriangles(meshes[args.jobIndex]);
+	});
+	wiJobSystem::Wait(ctx);
+
+	for (size_t i = 0; i < meshes.size(); ++i)
+	{
+		auto it = bulletPhysics->meshHashes.find(meshes[i]);
+		if (it != bulletPhysics->meshHashes.end() && it->second != hashes[i])
+		{
+			// The bodies that already use the old shapes keep them, they are deleted with the world:
+			bulletPhysics->triangleMeshCache.erase(meshes[i]);
+			for (auto shape = bulletPhysics->shapeCache.begin(); shape != bulletPhysics->shapeCache.end();)
+			{
+				shape = shape->first.mesh == meshes[i] ? bulletPhysics->shapeCache.erase(shape) : next(shape);
+			}
 		}
-		if(!object->collisionShape.compare("CAPSULE")){
-			addCapsule(
-				S.x,S.y,R,T
-				,object->mass,object->friction,object->restitution
-				,object->damping,object->kinematic
-			);
-			object->physicsObjectID = ++registeredObjects;
+		bulletPhysics->meshHashes[meshes[i]] = hashes[i];
+	}
+
+	// The missing hulls and triangle hierarchies are the expensive part of loading a level, they are created in parallel:
+	vector<CollisionShapeKey> missingHulls;
+	vector<pair<Mesh*, uint64_t>> missingTriangleMeshes;
+	for (size_t i = 0; i < count; ++i)
+	{
+		CollisionShapeKey key;
+		if (!objects[i]->rigidBody || objects[i]->mesh == nullptr || !GetCollisionShapeKey(objects[i], key) ||
+			bulletPhysics->shapeCache.count(key) > 0)
+		{
+			continue;
 		}
-		if(!object->collisionShape.compare("CONVEX_HULL")){
-			vector<XMFLOAT4> pos_stream(object->mesh->vertices_POS.size());
-			for (size_t i = 0; i < object->mesh->vertices_POS.size(); ++i)
+		if (key.type == COLLISIONSHAPE_CONVEX_HULL)
+		{
+			if (find(missingHulls.begin(), missingHulls.end(), key) == missingHulls.end())
 			{
-				pos_stream[i].x = object->mesh->vertices_POS[i].pos.x;
-				pos_stream[i].y = object->mesh->vertices_POS[i].pos.y;
-				pos_stream[i].z = object->mesh->vertices_POS[i].pos.z;
-				pos_stream[i].w = 1;
+				missingHulls.push_back(key);
 			}
-
-			addConvexHull(
-				pos_stream,
-				S,R,T
-				,object->mass,object->friction,object->restitution
-				,object->damping,object->kinematic
-			);
-			object->physicsObjectID = ++registeredObjects;
 		}
-		if(!object->collisionShape.compare("MESH")){
-			vector<XMFLOAT4> pos_stream(object->mesh->vertices_POS.size());
-			for (size_t i = 0; i < object->mesh->vertices_POS.size(); ++i)
+		else if (bulletPhysics->triangleMeshCache.count(key.mesh) == 0)
+		{
+			const auto missing = make_pair(objects[i]->mesh, bulletPhysics->meshHashes[key.mesh]);
+			if (find(missingTriangleMeshes.begin(), missingTriangleMeshes.end(), missing) == missingTriangleMeshes.end())
 			{
-				pos_stream[i].x = object->mesh->vertices_POS[i].pos.x;
-				pos_stream[i].y = object->mesh->vertices_POS[i].pos.y;
-				pos_stream[i].z = object->mesh->vertices_POS[i].pos.z;
-				pos_stream[i].w = 1;
+				missingTriangleMeshes.push_back(missing);
 			}
+		}
+	}
 
-			addTriangleMesh(
-				pos_stream,object->mesh->indices,
-				S,R,T
-				,object->mass,object->friction,object->restitution
-				,object->damping,object->kinematic
-			);
-			object->physicsObjectID = ++registeredObjects;
+	vector<btCollisionShape*> hulls(missingHulls.size());
+	vector<CollisionTriangleMesh*> triangleMeshes(missingTriangleMeshes.size());
+	wiJobSystem::Dispatch(ctx, (uint32_t)(missingHulls.size() + missingTriangleMeshes.size()), 1, [&](wiJobSystem::JobDispatchArgs args) {
+		if (args.jobIndex < missingHulls.size())
+		{
+			hulls[args.jobIndex] = CreateConvexHull(missingHulls[args.jobIndex].mesh, missingHulls[args.jobIndex].scale);
+		}
+		else
+		{
+			const size_t index = args.jobIndex - missingHulls.size();
+			triangleMeshes[index] = CreateTriangleMesh(missingTriangleMeshes[index].first, missingTriangleMeshes[index].second);
 		}
+	});
+	wiJobSystem::Wait(ctx);
+
+	for (size_t i = 0; i < missingHulls.size(); ++i)
+	{
+		bulletPhysics->collisionShapes.push_back(hulls[i]);
+		bulletPhysics->shapeCache[missingHulls[i]] = hulls[i];
+	}
+	for (size_t i = 0; i < missingTriangleMeshes.size(); ++i)
+	{
+		bulletPhysics->triangleMeshes.push_back(triangleMeshes[i]);
+		bulletPhysics->triangleMeshCache[missingTriangleMeshes[i].first] = triangleMeshes[i];
 	}
 
-	if(object->mesh != nullptr && object->mesh->softBody && softBodyPhysicsEnabled){
-		XMFLOAT3 s,t;
-		XMFLOAT4 r;
-		if(object->mesh->hasArmature()){
-			s=object->mesh->armature->scale;
-			r=object->mesh->armature->rotation;
-			t=object->mesh->armature->translation;
+	// The scaled triangle meshes only refer to the shared hierarchy, they are cheap:
+	for (size_t i = 0; i < count; ++i)
+	{
+		CollisionShapeKey key;
+		if (!objects[i]->rigidBody || objects[i]->mesh == nullptr || !GetCollisionShapeKey(objects[i], key) ||
+			key.type != COLLISIONSHAPE_MESH || bulletPhysics->shapeCache.count(key) > 0)
+		{
+			continue;
 		}
-		else{
-			s=object->scale;
-			r=object->rotation;
-			t=object->translation;
+		btBvhTriangleMeshShape* shape = bulletPhysics->triangleMeshCache[key.mesh]->shape;
+		if (key.scale.x == 1 && key.scale.y == 1 && key.scale.z == 1)
+		{
+			bulletPhysics->shapeCache[key] = shape;
+		}
+		else
+		{
+			btCollisionShape* scaledShape = new btScaledBvhTriangleMeshShape(shape, btVector3(key.scale.x, key.scale.y, key.scale.z));
+			bulletPhysics->collisionShapes.push_back(scaledShape);
+			bulletPhysics->shapeCache[key] = scaledShape;
+		}
+	}
+}
+
+void wiBULLET::registerObject(Object* object){
+	registerObjects(&object, 1);
+}
+void wiBULLET::registerObjects(Object* const* objects, size_t count){
+	lock_guard<recursive_mutex> lock(bulletPhysics->worldLock);
+
+	// The transforms are applied first, the shapes are cached with the final object scale:
+	for (size_t i = 0; i < count; ++i)
+	{
+		Object* object = objects[i];
+		if(object->rigidBody && object->mesh != nullptr && rigidBodyPhysicsEnabled){
+			object->applyTransform();
+			object->attachTo(object->GetRoot());
+		}
+	}
+	if (rigidBodyPhysicsEnabled)
+	{
+		prepareCollisionShapes(objects, count);
+	}
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		Object* object = objects[i];
+		if(object->rigidBody && object->mesh != nullptr && rigidBodyPhysicsEnabled){
+			XMFLOAT3 S,T;
+			XMFLOAT4 R;
+			S = object->scale;
+			T = object->translation;
+			R = object->rotation;
+
+			if(!object->collisionShape.compare("BOX")){
+				addBox(
+					S,R,T
+					,object->mass,object->friction,object->restitution
+					,object->damping,object->kinematic
+				);
+				object->physicsObjectID = ++registeredObjects;
+			}
+			if(!object->collisionShape.compare("SPHERE")){
+				addSphere(
+					S.x,T
+					,object->mass,object->friction,object->restitution
+					,object->damping,object->kinematic
+				);
+				object->physicsObjectID = ++registeredObjects;
+			}
+			if(!object->collisionShape.compare("CAPSULE")){
+				addCapsule(
+					S.x,S.y,R,T
+					,object->mass,object->friction,object->restitution
+					,object->damping,object->kinematic
+				);
+				object->physicsObjectID = ++registeredObjects;
+			}
+			CollisionShapeKey key;
+			if(GetCollisionShapeKey(object, key)){
+				addRigidBody(
+					bulletPhysics->shapeCache[key],
+					R,T
+					,object->mass,object->friction,object->restitution
+					,object->damping,object->kinematic
+				);
+				object->physicsObjectID = ++registeredObjects;
+			}
+		}
+
+		if(object->mesh != nullptr && object->mesh->softBody && softBodyPhysicsEnabled){
+			XMFLOAT3 s,t;
+			XMFLOAT4 r;
+			if(object->mesh->hasArmature()){
+				s=object->mesh->armature->scale;
+				r=object->mesh->armature->rotation;
+				t=object->mesh->armature->translation;
+			}
+			else{
+				s=object->scale;
+				r=object->rotation;
+				t=object->translation;
+			}
+			addSoftBodyTriangleMesh(
+				object->mesh
+				,s,r,t
+				,object->mass,object->mesh->friction,object->restitution,object->damping
+			);
+			object->physicsObjectID = ++registeredObjects;
 		}
-		addSoftBodyTriangleMesh(
-			object->mesh
-			,s,r,t
-			,object->mass,object->mesh->friction,object->restitution,object->damping
-		);
-		object->physicsObjectID = ++registeredObjects;
 	}
 }
 void wiBULLET::removeObject(Object* object)
@@ -788,27 +1268,46 @@ void wiBULLET::removeObject(Object* object)
 		return;
 	}
 
+	lock_guard<recursive_mutex> lock(bulletPhysics->worldLock);
 	deleteObject(object->physicsObjectID);
 	object->physicsObjectID = -1;
 }
 
 void wiBULLET::Update(float dt){
-	if (rigidBodyPhysicsEnabled || softBodyPhysicsEnabled)
-		bulletPhysics->dynamicsWorld->stepSimulation(dt, 6);
+	{
+		lock_guard<mutex> lock(bulletPhysics->timeLock);
+		bulletPhysics->targetTime += dt;
+		const double maxLag = WIBULLET_MAX_STEP_LAG * fixedTimeStep;
+		if (bulletPhysics->targetTime - bulletPhysics->simulatedTime > maxLag)
+		{
+			bulletPhysics->simulatedTime = bulletPhysics->targetTime - maxLag;
+		}
+	}
+	bulletPhysics->timeCondition.notify_one();
 }
 void wiBULLET::MarkForRead(){
+	bulletPhysics->stateLock.lock();
 
+	double targetTime;
+	{
+		lock_guard<mutex> lock(bulletPhysics->timeLock);
+		targetTime = bulletPhysics->targetTime;
+	}
+	const double alpha = (targetTime - bulletPhysics->currentState.time) / fixedTimeStep;
+	bulletPhysics->interpolation = (float)max(0.0, min(1.0, alpha));
 }
 void wiBULLET::UnMarkForRead(){
-
+	bulletPhysics->stateLock.unlock();
 }
 void wiBULLET::MarkForWrite(){
-
+	bulletPhysics->worldLock.lock();
 }
 void wiBULLET::UnMarkForWrite(){
-
+	bulletPhysics->worldLock.unlock();
 }
 void wiBULLET::ClearWorld(){
+	lock_guard<recursive_mutex> lock(bulletPhysics->worldLock);
+
 	for(int i= bulletPhysics->dynamicsWorld->getNumCollisionObjects()-1;i>=0;i--)
 	{
 		deleteObject(i);
@@ -821,6 +1320,17 @@ void wiBULLET::ClearWorld(){
 		bulletPhysics->collisionShapes[j] = 0;
 		delete shape;
 	}
+	bulletPhysics->collisionShapes.clear();
+
+	//delete the cached triangle meshes after the scaled shapes that refer to them
+	for (CollisionTriangleMesh* triangleMesh : bulletPhysics->triangleMeshes)
+	{
+		delete triangleMesh;
+	}
+	bulletPhysics->triangleMeshes.clear();
+	bulletPhysics->triangleMeshCache.clear();
+	bulletPhysics->shapeCache.clear();
+	bulletPhysics->meshHashes.clear();
 
 	//delete transfom interface
 	for (unsigned int i = 0; i<transforms.size(); ++i)
@@ -866,6 +1376,7 @@ void wiBULLET::deleteObject(int id)
 	delete obj;
 
 	registeredObjects--;
+	bulletPhysics->objectsVersion++;
 }
 
 //
@@ -2,6 +2,7 @@
 #include "wiPHYSICS.h"
 
 struct BulletPhysicsWorld;
+class btCollisionShape;
 
 struct RAY;
 
@@ -11,6 +12,10 @@ private:
 	BulletPhysicsWorld * bulletPhysics = nullptr;
 
 	void deleteObject(int id);
+	void addRigidBody(btCollisionShape* shape, const XMFLOAT4& rot, const XMFLOAT3& pos
+		, float newMass, float newFriction, float newRestitution, float newDamping, bool kinematic);
+	// Create the cached mesh collision shapes (convex hulls and triangle meshes) that the objects need, the missing ones are built in parallel
+	void prepareCollisionShapes(wiSceneComponents::Object* const* objects, size_t count);
 public:
 	wiBULLET();
 	~wiBULLET();
@@ -40,6 +45,7 @@ public:
 	PhysicsTransform* getObject(int index);
 
 	void registerObject(wiSceneComponents::Object* object);
+	void registerObjects(wiSceneComponents::Object* const* objects, size_t count);
 	void removeObject(wiSceneComponents::Object* object);
 
 	void Update(float dt);
@@ -93,4 +93,12 @@ int wiCpuInfo::GetCpuPercentage()
 	return usage;
 }
 
+int wiCpuInfo::GetCoreCount()
+{
+	SYSTEM_INFO sysinfo;
+	GetSystemInfo(&sysinfo);
+
+	return (int)sysinfo.dwNumberOfProcessors;
+}
+
 #endif
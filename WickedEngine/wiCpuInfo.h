@@ -6,6 +6,8 @@
 #pragma comment(lib,"pdh.lib")
 #endif
 
+#include <thread>
+
 class wiCpuInfo
 {
 #ifndef WINSTORE_SUPPORT
@@ -24,6 +26,7 @@ public:
 	static void Shutdown();
 	static void Frame();
 	static int GetCpuPercentage();
+	static int GetCoreCount();
 
 #else
 public:
@@ -34,6 +37,7 @@ public:
 	static void Shutdown(){}
 	static void Frame(){}
 	static int GetCpuPercentage(){ return -1; }
+	static int GetCoreCount(){ return (int)std::thread::hardware_concurrency(); }
 #endif
 };
 
@@ -1,6 +1,10 @@
 #include "wiFrustum.h"
 #include "wiIntersectables.h"
 
+#ifdef __AVX__
+#include <immintrin.h>
+#endif // __AVX__
+
 Frustum::Frustum()
 {
 }
@@ -121,6 +125,148 @@ int Frustum::CheckBox(const AABB& box) const
 	return(BOX_FRUSTUM_INTERSECTS);
 }
 
+int Frustum::CheckBox(const XMFLOAT3& min, const XMFLOAT3& max) const
+{
+	// Only the box corner which is the furthest along the plane normal can be inside, and the nearest one can be outside:
+	int iTotalIn = 0;
+	for (int p = 0; p < 6; ++p)
+	{
+		const XMFLOAT4& plane = m_planesNorm[p];
+
+		const float farthest =
+			plane.x * (plane.x > 0 ? max.x : min.x) +
+			plane.y * (plane.y > 0 ? max.y : min.y) +
+			plane.z * (plane.z > 0 ? max.z : min.z) + plane.w;
+		if (farthest < 0.0f)
+			return(false);
+
+		const float nearest =
+			plane.x * (plane.x > 0 ? min.x : max.x) +
+			plane.y * (plane.y > 0 ? min.y : max.y) +
+			plane.z * (plane.z > 0 ? min.z : max.z) + plane.w;
+		if (nearest >= 0.0f)
+			++iTotalIn;
+	}
+	if (iTotalIn == 6)
+		return(BOX_FRUSTUM_INSIDE);
+	return(BOX_FRUSTUM_INTERSECTS);
+}
+
+void Frustum::CheckBoxes(const AABBArray& boxes, uint32_t first, uint32_t count, uint32_t* mask) const
+{
+	// A box is outside if its center is further behind any plane than the projected extent:
+	//	dot(plane.xyz, center) + plane.w + dot(abs(plane.xyz), extent) < 0
+
+	for (uint32_t i = 0; i < (count + 31) / 32; ++i)
+	{
+		mask[i] = 0;
+	}
+
+	const float* cx = boxes.center_x.data() + first;
+	const float* cy = boxes.center_y.data() + first;
+	const float* cz = boxes.center_z.data() + first;
+	const float* ex = boxes.extent_x.data() + first;
+	const float* ey = boxes.extent_y.data() + first;
+	const float* ez = boxes.extent_z.data() + first;
+
+	uint32_t i = 0;
+
+#ifdef __AVX__
+	{
+		__m256 planes[6][4];
+		for (int p = 0; p < 6; ++p)
+		{
+			planes[p][0] = _mm256_set1_ps(m_planesNorm[p].x);
+			planes[p][1] = _mm256_set1_ps(m_planesNorm[p].y);
+			planes[p][2] = _mm256_set1_ps(m_planesNorm[p].z);
+			planes[p][3] = _mm256_set1_ps(m_planesNorm[p].w);
+		}
+		const __m256 signMask = _mm256_set1_ps(-0.0f);
+		const __m256 zero = _mm256_setzero_ps();
+
+		for (; i + 8 <= count; i += 8)
+		{
+			const __m256 center_x = _mm256_loadu_ps(cx + i);
+			const __m256 center_y = _mm256_loadu_ps(cy + i);
+			const __m256 center_z = _mm256_loadu_ps(cz + i);
+			const __m256 extent_x = _mm256_loadu_ps(ex + i);
+			const __m256 extent_y = _mm256_loadu_ps(ey + i);
+			const __m256 extent_z = _mm256_loadu_ps(ez + i);
+
+			__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (int p = 0; p < 6; ++p)
+			{
+				__m256 dist = _mm256_add_ps(_mm256_mul_ps(planes[p][0], center_x), planes[p][3]);
+				dist = _mm256_add_ps(dist, _mm256_mul_ps(planes[p][1], center_y));
+				dist = _mm256_add_ps(dist, _mm256_mul_ps(planes[p][2], center_z));
+				__m256 radius = _mm256_mul_ps(_mm256_andnot_ps(signMask, planes[p][0]), extent_x);
+				radius = _mm256_add_ps(radius, _mm256_mul_ps(_mm256_andnot_ps(signMask, planes[p][1]), extent_y));
+				radius = _mm256_add_ps(radius, _mm256_mul_ps(_mm256_andnot_ps(signMask, planes[p][2]), extent_z));
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(dist, radius), zero, _CMP_GE_OQ));
+			}
+
+			mask[i / 32] |= (uint32_t)_mm256_movemask_ps(inside) << (i % 32);
+		}
+	}
+#endif // __AVX__
+
+#ifdef _XM_SSE_INTRINSICS_
+	{
+		__m128 planes[6][4];
+		for (int p = 0; p < 6; ++p)
+		{
+			planes[p][0] = _mm_set1_ps(m_planesNorm[p].x);
+			planes[p][1] = _mm_set1_ps(m_planesNorm[p].y);
+			planes[p][2] = _mm_set1_ps(m_planesNorm[p].z);
+			planes[p][3] = _mm_set1_ps(m_planesNorm[p].w);
+		}
+		const __m128 signMask = _mm_set1_ps(-0.0f);
+		const __m128 zero = _mm_setzero_ps();
+
+		for (; i + 4 <= count; i += 4)
+		{
+			const __m128 center_x = _mm_loadu_ps(cx + i);
+			const __m128 center_y = _mm_loadu_ps(cy + i);
+			const __m128 center_z = _mm_loadu_ps(cz + i);
+			const __m128 extent_x = _mm_loadu_ps(ex + i);
+			const __m128 extent_y = _mm_loadu_ps(ey + i);
+			const __m128 extent_z = _mm_loadu_ps(ez + i);
+
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int p = 0; p < 6; ++p)
+			{
+				__m128 dist = _mm_add_ps(_mm_mul_ps(planes[p][0], center_x), planes[p][3]);
+				dist = _mm_add_ps(dist, _mm_mul_ps(planes[p][1], center_y));
+				dist = _mm_add_ps(dist, _mm_mul_ps(planes[p][2], center_z));
+				__m128 radius = _mm_mul_ps(_mm_andnot_ps(signMask, planes[p][0]), extent_x);
+				radius = _mm_add_ps(radius, _mm_mul_ps(_mm_andnot_ps(signMask, planes[p][1]), extent_y));
+				radius = _mm_add_ps(radius, _mm_mul_ps(_mm_andnot_ps(signMask, planes[p][2]), extent_z));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(dist, radius), zero));
+			}
+
+			mask[i / 32] |= (uint32_t)_mm_movemask_ps(inside) << (i % 32);
+		}
+	}
+#endif // _XM_SSE_INTRINSICS_
+
+	// Scalar path for the remainder, or if there are no SIMD instructions:
+	for (; i < count; ++i)
+	{
+		bool inside = true;
+		for (int p = 0; p < 6 && inside; ++p)
+		{
+			const XMFLOAT4& plane = m_planesNorm[p];
+			const float dist = plane.x * cx[i] + plane.y * cy[i] + plane.z * cz[i] + plane.w;
+			const float radius = abs(plane.x) * ex[i] + abs(plane.y) * ey[i] + abs(plane.z) * ez[i];
+			inside = dist + radius >= 0.0f;
+		}
+		if (inside)
+		{
+			mask[i / 32] |= 1u << (i % 32);
+		}
+	}
+}
+
 const XMFLOAT4& Frustum::getLeftPlane() const { return m_planesNorm[2]; }
 const XMFLOAT4& Frustum::getRightPlane() const { return m_planesNorm[3]; }
 const XMFLOAT4& Frustum::getTopPlane() const { return m_planesNorm[4]; }
@@ -2,6 +2,7 @@
 #include "CommonInclude.h"
 
 struct AABB;
+struct AABBArray;
 
 class Frustum
 {
@@ -21,6 +22,12 @@ public:
 #define BOX_FRUSTUM_INTERSECTS 1
 #define BOX_FRUSTUM_INSIDE 2
 	int CheckBox(const AABB& box) const;
+	int CheckBox(const XMFLOAT3& min, const XMFLOAT3& max) const;
+
+	// Batched box culling, tests multiple boxes at once with SIMD instructions if they are available
+	//	first, count	: range of the boxes to test
+	//	mask			: one bit per tested box, it is set if the box is at least partially inside the frustum. Must hold (count + 31) / 32 elements
+	void CheckBoxes(const AABBArray& boxes, uint32_t first, uint32_t count, uint32_t* mask) const;
 
 	const XMFLOAT4& getLeftPlane() const;
 	const XMFLOAT4& getRightPlane() const;
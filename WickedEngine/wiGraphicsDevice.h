@@ -70,6 +70,10 @@ namespace wiGraphicsTypes
 
 		virtual void SetName(GPUResource* pResource, const std::string& name) = 0;
 
+		// The driver can reuse the compiled pipeline states of an earlier run that were saved to a file. Devices that can't do this return false.
+		virtual bool LoadPipelineCache(const std::string& fileName) { return false; }
+		virtual bool SavePipelineCache(const std::string& fileName) { return false; }
+
 		virtual void PresentBegin() = 0;
 		virtual void PresentEnd() = 0;
 
@@ -17,6 +17,7 @@
 #endif // _DEBUG
 
 #include <sstream>
+#include <fstream>
 #include <wincodec.h>
 
 using namespace std;
@@ -1175,6 +1176,66 @@ namespace wiGraphicsTypes
 		return ((uLocation + (uAlign - 1)) & ~(uAlign - 1));
 	}
 
+	// 64 bit FNV-1a hash, pipeline states are identified by it in the pipeline cache
+	inline void HashBytes(uint64_t& hash, const void* data, size_t size)
+	{
+		const uint8_t* bytes = (const uint8_t*)data;
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+	}
+	inline uint64_t HashPipelineDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		HashBytes(hash, desc.VS.pShaderBytecode, desc.VS.BytecodeLength);
+		HashBytes(hash, desc.HS.pShaderBytecode, desc.HS.BytecodeLength);
+		HashBytes(hash, desc.DS.pShaderBytecode, desc.DS.BytecodeLength);
+		HashBytes(hash, desc.GS.pShaderBytecode, desc.GS.BytecodeLength);
+		HashBytes(hash, desc.PS.pShaderBytecode, desc.PS.BytecodeLength);
+		HashBytes(hash, &desc.BlendState, sizeof(desc.BlendState));
+		HashBytes(hash, &desc.SampleMask, sizeof(desc.SampleMask));
+		HashBytes(hash, &desc.RasterizerState, sizeof(desc.RasterizerState));
+		HashBytes(hash, &desc.DepthStencilState, sizeof(desc.DepthStencilState));
+		for (UINT i = 0; i < desc.InputLayout.NumElements; ++i)
+		{
+			const D3D12_INPUT_ELEMENT_DESC& element = desc.InputLayout.pInputElementDescs[i];
+			HashBytes(hash, element.SemanticName, strlen(element.SemanticName));
+			HashBytes(hash, &element.SemanticIndex, sizeof(element.SemanticIndex));
+			HashBytes(hash, &element.Format, sizeof(element.Format));
+			HashBytes(hash, &element.InputSlot, sizeof(element.InputSlot));
+			HashBytes(hash, &element.AlignedByteOffset, sizeof(element.AlignedByteOffset));
+			HashBytes(hash, &element.InputSlotClass, sizeof(element.InputSlotClass));
+			HashBytes(hash, &element.InstanceDataStepRate, sizeof(element.InstanceDataStepRate));
+		}
+		HashBytes(hash, &desc.IBStripCutValue, sizeof(desc.IBStripCutValue));
+		HashBytes(hash, &desc.PrimitiveTopologyType, sizeof(desc.PrimitiveTopologyType));
+		HashBytes(hash, &desc.NumRenderTargets, sizeof(desc.NumRenderTargets));
+		HashBytes(hash, desc.RTVFormats, sizeof(desc.RTVFormats));
+		HashBytes(hash, &desc.DSVFormat, sizeof(desc.DSVFormat));
+		HashBytes(hash, &desc.SampleDesc, sizeof(desc.SampleDesc));
+		return hash;
+	}
+	inline uint64_t HashPipelineDesc(const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		HashBytes(hash, "COMPUTE", 7);
+		HashBytes(hash, desc.CS.pShaderBytecode, desc.CS.BytecodeLength);
+		return hash;
+	}
+
+	// Pipeline cache file: header, then hash, size and data of every blob
+	static const uint32_t PIPELINECACHE_MAGIC = 0x43505857; // "WXPC"
+	static const uint32_t PIPELINECACHE_VERSION = 1;
+	struct PipelineCacheHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		LUID adapter;
+		uint64_t count;
+	};
+
 	// Allocator heaps:
 
 	GraphicsDevice_DX12::DescriptorAllocator::DescriptorAllocator(ID3D12Device* device, D3D12_DESCRIPTOR_HEAP_TYPE type, UINT maxCount) : wiThreadSafeManager()
@@ -3151,9 +3212,28 @@ namespace wiGraphicsTypes
 
 		desc.pRootSignature = graphicsRootSig;
 
+		const uint64_t hash = HashPipelineDesc(desc);
+		vector<uint8_t> cachedBlob;
+		if (GetCachedPipeline(hash, cachedBlob))
+		{
+			desc.CachedPSO.pCachedBlob = cachedBlob.data();
+			desc.CachedPSO.CachedBlobSizeInBytes = cachedBlob.size();
+		}
+
 		HRESULT hr = device->CreateGraphicsPipelineState(&desc, __uuidof(ID3D12PipelineState), (void**)&pso->pipeline_DX12);
+		if (FAILED(hr) && desc.CachedPSO.pCachedBlob != nullptr)
+		{
+			// The blob was created by an other driver or root signature, compile again:
+			desc.CachedPSO = {};
+			hr = device->CreateGraphicsPipelineState(&desc, __uuidof(ID3D12PipelineState), (void**)&pso->pipeline_DX12);
+		}
 		assert(SUCCEEDED(hr));
 
+		if (SUCCEEDED(hr) && desc.CachedPSO.pCachedBlob == nullptr)
+		{
+			StoreCachedPipeline(hash, (ID3D12PipelineState*)pso->pipeline_DX12);
+		}
+
 		SAFE_DELETE_ARRAY(elements);
 
 		return hr;
@@ -3174,12 +3254,167 @@ namespace wiGraphicsTypes
 
 		desc.pRootSignature = computeRootSig;
 
+		const uint64_t hash = HashPipelineDesc(desc);
+		vector<uint8_t> cachedBlob;
+		if (GetCachedPipeline(hash, cachedBlob))
+		{
+			desc.CachedPSO.pCachedBlob = cachedBlob.data();
+			desc.CachedPSO.CachedBlobSizeInBytes = cachedBlob.size();
+		}
+
 		HRESULT hr = device->CreateComputePipelineState(&desc, __uuidof(ID3D12PipelineState), (void**)&pso->pipeline_DX12);
+		if (FAILED(hr) && desc.CachedPSO.pCachedBlob != nullptr)
+		{
+			desc.CachedPSO = {};
+			hr = device->CreateComputePipelineState(&desc, __uuidof(ID3D12PipelineState), (void**)&pso->pipeline_DX12);
+		}
 		assert(SUCCEEDED(hr));
 
+		if (SUCCEEDED(hr) && desc.CachedPSO.pCachedBlob == nullptr)
+		{
+			StoreCachedPipeline(hash, (ID3D12PipelineState*)pso->pipeline_DX12);
+		}
+
 		return hr;
 	}
 
+	bool GraphicsDevice_DX12::GetCachedPipeline(uint64_t hash, vector<uint8_t>& blob)
+	{
+		bool found = false;
+		pipelineCacheLock.lock();
+		auto& it = pipelineCache.find(hash);
+		if (it != pipelineCache.end())
+		{
+			// copied, because it can be replaced by an other thread while the driver reads it
+			blob = it->second;
+			found = true;
+		}
+		pipelineCacheLock.unlock();
+		return found;
+	}
+	void GraphicsDevice_DX12::StoreCachedPipeline(uint64_t hash, ID3D12PipelineState* pipeline)
+	{
+		ID3DBlob* blob = nullptr;
+		if (FAILED(pipeline->GetCachedBlob(&blob)))
+		{
+			return;
+		}
+		const uint8_t* data = (const uint8_t*)blob->GetBufferPointer();
+		vector<uint8_t> copy(data, data + blob->GetBufferSize());
+		blob->Release();
+
+		pipelineCacheLock.lock();
+		pipelineCache[hash] = move(copy);
+		pipelineCacheLock.unlock();
+	}
+	bool GraphicsDevice_DX12::LoadPipelineCache(const std::string& fileName)
+	{
+		ifstream file(fileName, ios::binary);
+		if (!file.is_open())
+		{
+			return false;
+		}
+
+		// Blobs of an other adapter would be rejected by the driver anyway:
+		PipelineCacheHeader header;
+		const LUID adapter = device->GetAdapterLuid();
+		if (!file.read((char*)&header, sizeof(header)) ||
+			header.magic != PIPELINECACHE_MAGIC ||
+			header.version != PIPELINECACHE_VERSION ||
+			header.adapter.LowPart != adapter.LowPart ||
+			header.adapter.HighPart != adapter.HighPart)
+		{
+			return false;
+		}
+
+		// The sizes in the file are not trusted before they are checked against the bytes left in the file, a corrupt cache must not allocate or read garbage:
+		const streamoff dataStart = file.tellg();
+		file.seekg(0, ios::end);
+		const streamoff dataEnd = file.tellg();
+		file.seekg(dataStart);
+		if (!file.good() || dataEnd < dataStart)
+		{
+			return false;
+		}
+		uint64_t remaining = (uint64_t)(dataEnd - dataStart);
+		const uint64_t blobHeaderSize = sizeof(uint64_t) * 2;
+		if (header.count > remaining / blobHeaderSize)
+		{
+			return false;
+		}
+
+		unordered_map<uint64_t, vector<uint8_t>> blobs;
+		for (uint64_t i = 0; i < header.count; ++i)
+		{
+			uint64_t hash, size;
+			if (remaining < blobHeaderSize || !file.read((char*)&hash, sizeof(hash)) || !file.read((char*)&size, sizeof(size)))
+			{
+				return false;
+			}
+			remaining -= blobHeaderSize;
+			if (size > remaining)
+			{
+				return false;
+			}
+			remaining -= size;
+			vector<uint8_t>& blob = blobs[hash];
+			blob.resize((size_t)size);
+			if (!file.read((char*)blob.data(), blob.size()))
+			{
+				return false;
+			}
+		}
+		if (remaining != 0)
+		{
+			return false;
+		}
+
+		pipelineCacheLock.lock();
+		pipelineCache.swap(blobs);
+		pipelineCacheLock.unlock();
+		return true;
+	}
+	bool GraphicsDevice_DX12::SavePipelineCache(const std::string& fileName)
+	{
+		ofstream file(fileName, ios::binary | ios::trunc);
+		if (!file.is_open())
+		{
+			return false;
+		}
+
+		// The cache is only serialized to memory under the lock, so pipeline creation on other threads doesn't wait for the file write:
+		vector<uint8_t> data;
+		pipelineCacheLock.lock();
+		PipelineCacheHeader header;
+		header.magic = PIPELINECACHE_MAGIC;
+		header.version = PIPELINECACHE_VERSION;
+		header.adapter = device->GetAdapterLuid();
+		header.count = pipelineCache.size();
+		size_t dataSize = sizeof(header);
+		for (auto& x : pipelineCache)
+		{
+			dataSize += sizeof(uint64_t) * 2 + x.second.size();
+		}
+		data.resize(dataSize);
+		uint8_t* dst = data.data();
+		memcpy(dst, &header, sizeof(header));
+		dst += sizeof(header);
+		for (auto& x : pipelineCache)
+		{
+			const uint64_t size = x.second.size();
+			memcpy(dst, &x.first, sizeof(x.first));
+			dst += sizeof(x.first);
+			memcpy(dst, &size, sizeof(size));
+			dst += sizeof(size);
+			memcpy(dst, x.second.data(), x.second.size());
+			dst += x.second.size();
+		}
+		pipelineCacheLock.unlock();
+
+		file.write((const char*)data.data(), data.size());
+		return file.good();
+	}
+
 
 	void GraphicsDevice_DX12::DestroyResource(GPUResource* pResource)
 	{
@@ -5,6 +5,9 @@
 #include "wiGraphicsDevice.h"
 #include "wiWindowRegistration.h"
 
+#include <unordered_map>
+#include <vector>
+
 struct IDXGISwapChain3;
 enum D3D_DRIVER_TYPE;
 enum D3D_FEATURE_LEVEL;
@@ -148,6 +151,12 @@ namespace wiGraphicsTypes
 
 		PRIMITIVETOPOLOGY prev_pt[GRAPHICSTHREAD_COUNT] = {};
 
+		// Compiled pipeline state blobs by the hash of the pipeline description and shaders, the driver reuses them when the same pipeline state is created
+		std::unordered_map<uint64_t, std::vector<uint8_t>> pipelineCache;
+		wiSpinLock					pipelineCacheLock;
+		bool GetCachedPipeline(uint64_t hash, std::vector<uint8_t>& blob);
+		void StoreCachedPipeline(uint64_t hash, ID3D12PipelineState* pipeline);
+
 	public:
 		GraphicsDevice_DX12(wiWindowRegistration::window_type window, bool fullscreen = false, bool debuglayer = false);
 
@@ -196,6 +205,9 @@ namespace wiGraphicsTypes
 
 		virtual void SetName(GPUResource* pResource, const std::string& name) override;
 
+		virtual bool LoadPipelineCache(const std::string& fileName) override;
+		virtual bool SavePipelineCache(const std::string& fileName) override;
+
 		virtual void PresentBegin() override;
 		virtual void PresentEnd() override;
 
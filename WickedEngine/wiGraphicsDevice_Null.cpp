@@ -0,0 +1,416 @@
+#include "wiGraphicsDevice_Null.h"
+
+#include <cstring>
+
+using namespace std;
+
+namespace wiGraphicsTypes
+{
+
+GraphicsDevice_Null::GraphicsDevice_Null(int width, int height, bool multithreadedRendering) : GraphicsDevice()
+{
+	SCREENWIDTH = width;
+	SCREENHEIGHT = height;
+
+	// Report the features that the renderer has separate paths for, so that those paths are exercised too:
+	TESSELLATION = true;
+	MULTITHREADED_RENDERING = multithreadedRendering;
+
+	memset(frameStats, 0, sizeof(frameStats));
+	memset(&lastFrameStats, 0, sizeof(lastFrameStats));
+}
+GraphicsDevice_Null::~GraphicsDevice_Null()
+{
+}
+
+void GraphicsDevice_Null::SetResolution(int width, int height)
+{
+	if ((width != SCREENWIDTH || height != SCREENHEIGHT) && width > 0 && height > 0)
+	{
+		SCREENWIDTH = width;
+		SCREENHEIGHT = height;
+		RESOLUTIONCHANGED = true;
+	}
+}
+
+Texture2D GraphicsDevice_Null::GetBackBuffer()
+{
+	Texture2D result;
+	result.desc.Width = SCREENWIDTH;
+	result.desc.Height = SCREENHEIGHT;
+	result.desc.Format = GetBackBufferFormat();
+	result.desc.BindFlags = BIND_RENDER_TARGET;
+	return result;
+}
+
+HRESULT GraphicsDevice_Null::CreateBuffer(const GPUBufferDesc *pDesc, const SubresourceData* pInitialData, GPUBuffer *ppBuffer)
+{
+	ppBuffer->Register(this);
+
+	ppBuffer->desc = *pDesc;
+
+	// Buffers are backed by CPU memory, so that ring buffer allocations and downloads return valid data:
+	uint8_t* memory = new uint8_t[max(pDesc->ByteWidth, 1u)];
+	if (pInitialData != nullptr && pInitialData->pSysMem != nullptr)
+	{
+		memcpy(memory, pInitialData->pSysMem, pDesc->ByteWidth);
+	}
+	else
+	{
+		memset(memory, 0, pDesc->ByteWidth);
+	}
+	ppBuffer->resource_Null = (wiCPUHandle)memory;
+
+	return S_OK;
+}
+HRESULT GraphicsDevice_Null::CreateTexture1D(const TextureDesc* pDesc, const SubresourceData *pInitialData, Texture1D **ppTexture1D)
+{
+	if ((*ppTexture1D) == nullptr)
+	{
+		(*ppTexture1D) = new Texture1D;
+	}
+	(*ppTexture1D)->Register(this);
+
+	(*ppTexture1D)->desc = *pDesc;
+
+	return S_OK;
+}
+HRESULT GraphicsDevice_Null::CreateTexture2D(const TextureDesc* pDesc, const SubresourceData *pInitialData, Texture2D **ppTexture2D)
+{
+	if ((*ppTexture2D) == nullptr)
+	{
+		(*ppTexture2D) = new Texture2D;
+	}
+	(*ppTexture2D)->Register(this);
+
+	(*ppTexture2D)->desc = *pDesc;
+
+	return S_OK;
+}
+HRESULT GraphicsDevice_Null::CreateTexture3D(const TextureDesc* pDesc, const SubresourceData *pInitialData, Texture3D **ppTexture3D)
+{
+	if ((*ppTexture3D) == nullptr)
+	{
+		(*ppTexture3D) = new Texture3D;
+	}
+	(*ppTexture3D)->Register(this);
+
+	(*ppTexture3D)->desc = *pDesc;
+
+	return S_OK;
+}
+HRESULT GraphicsDevice_Null::CreateInputLayout(const VertexLayoutDesc *pInputElementDescs, UINT NumElements,
+	const void *pShaderBytecodeWithInputSignature, SIZE_T BytecodeLength, VertexLayout *pInputLayout)
+{
+	pInputLayout->Register(this);
+
+	pInputLayout->desc.assign(pInputElementDescs, pInputElementDescs + NumElements);
+
+	return S_OK;
+}
+
+// The shaders keep their bytecode, like on the other devices:
+static void CopyByteCode(ShaderByteCode& code, const void *pShaderBytecode, SIZE_T BytecodeLength)
+{
+	code.data = new BYTE[BytecodeLength];
+	memcpy(code.data, pShaderBytecode, BytecodeLength);
+	code.size = BytecodeLength;
+}
+HRESULT GraphicsDevice_Null::CreateVertexShader(const void *pShaderBytecode, SIZE_T BytecodeLength, VertexShader *pVertexShader)
+{
+	pVertexShader->Register(this);
+	CopyByteCode(pVertexShader->code, pShaderBytecode, BytecodeLength);
+	return S_OK;
+}
+HRESULT GraphicsDevice_Null::CreatePixelShader(const void *pShaderBytecode, SIZE_T BytecodeLength, PixelShader *pPixelShader)
+{
+	pPixelShader->Register(this);
+	CopyByteCode(pPixelShader->code, pShaderBytecode, BytecodeLength);
+	return S_OK;
+}
+HRESULT GraphicsDevice_Null::CreateGeometryShader(const void *pShaderBytecode, SIZE_T BytecodeLength, GeometryShader *pGeometryShader)
+{
+	pGeometryShader->Register(this);
+	CopyByteCode(pGeometryShader->code, pShaderBytecode, BytecodeLength);
+	return S_OK;
+}
+HRESULT GraphicsDevice_Null::CreateHullShader(const void *pShaderBytecode, SIZE_T BytecodeLength, HullShader *pHullShader)
+{
+	pHullShader->Register(this);
+	CopyByteCode(pHullShader->code, pShaderBytecode, BytecodeLength);
+	return S_OK;
+}
+HRESULT GraphicsDevice_Null::CreateDomainShader(const void *pShaderBytecode, SIZE_T BytecodeLength, DomainShader *pDomainShader)
+{
+	pDomainShader->Register(this);
+	CopyByteCode(pDomainShader->code, pShaderBytecode, BytecodeLength);
+	return S_OK;
+}
+HRESULT GraphicsDevice_Null::CreateComputeShader(const void *pShaderBytecode, SIZE_T BytecodeLength, ComputeShader *pComputeShader)
+{
+	pComputeShader->Register(this);
+	CopyByteCode(pComputeShader->code, pShaderBytecode, BytecodeLength);
+	return S_OK;
+}
+HRESULT GraphicsDevice_Null::CreateBlendState(const BlendStateDesc *pBlendStateDesc, BlendState *pBlendState)
+{
+	pBlendState->Register(this);
+
+	pBlendState->desc = *pBlendStateDesc;
+
+	return S_OK;
+}
+HRESULT GraphicsDevice_Null::CreateDepthStencilState(const DepthStencilStateDesc *pDepthStencilStateDesc, DepthStencilState *pDepthStencilState)
+{
+	pDepthStencilState->Register(this);
+
+	pDepthStencilState->desc = *pDepthStencilStateDesc;
+
+	return S_OK;
+}
+HRESULT GraphicsDevice_Null::CreateRasterizerState(const RasterizerStateDesc *pRasterizerStateDesc, RasterizerState *pRasterizerState)
+{
+	pRasterizerState->Register(this);
+
+	pRasterizerState->desc = *pRasterizerStateDesc;
+
+	return S_OK;
+}
+HRESULT GraphicsDevice_Null::CreateSamplerState(const SamplerDesc *pSamplerDesc, Sampler *pSamplerState)
+{
+	pSamplerState->Register(this);
+
+	pSamplerState->desc = *pSamplerDesc;
+
+	return S_OK;
+}
+HRESULT GraphicsDevice_Null::CreateQuery(const GPUQueryDesc *pDesc, GPUQuery *pQuery)
+{
+	pQuery->Register(this);
+
+	pQuery->desc = *pDesc;
+	pQuery->async_frameshift = pQuery->desc.async_latency;
+
+	// The query doesn't get a native resource, so it is not valid and the occlusion culling skips it:
+	return E_FAIL;
+}
+HRESULT GraphicsDevice_Null::CreateGraphicsPSO(const GraphicsPSODesc* pDesc, GraphicsPSO* pso)
+{
+	pso->Register(this);
+
+	pso->desc = *pDesc;
+
+	return S_OK;
+}
+HRESULT GraphicsDevice_Null::CreateComputePSO(const ComputePSODesc* pDesc, ComputePSO* pso)
+{
+	pso->Register(this);
+
+	pso->desc = *pDesc;
+
+	return S_OK;
+}
+
+
+void GraphicsDevice_Null::DestroyResource(GPUResource* pResource)
+{
+	delete[] (uint8_t*)pResource->resource_Null;
+	pResource->resource_Null = WI_NULL_HANDLE;
+}
+
+
+void GraphicsDevice_Null::PresentBegin()
+{
+}
+void GraphicsDevice_Null::PresentEnd()
+{
+	memset(&lastFrameStats, 0, sizeof(lastFrameStats));
+	for (int threadID = 0; threadID < GRAPHICSTHREAD_COUNT; ++threadID)
+	{
+		const FrameStats& stats = frameStats[threadID];
+		lastFrameStats.drawCalls += stats.drawCalls;
+		lastFrameStats.dispatchCalls += stats.dispatchCalls;
+		lastFrameStats.vertexCount += stats.vertexCount;
+		lastFrameStats.pipelineBinds += stats.pipelineBinds;
+		lastFrameStats.resourceBinds += stats.resourceBinds;
+		lastFrameStats.geometryBinds += stats.geometryBinds;
+		lastFrameStats.renderTargetBinds += stats.renderTargetBinds;
+		lastFrameStats.bufferUploads += stats.bufferUploads;
+		lastFrameStats.bufferUploadBytes += stats.bufferUploadBytes;
+		lastFrameStats.ringBufferAllocations += stats.ringBufferAllocations;
+		lastFrameStats.ringBufferBytes += stats.ringBufferBytes;
+		lastFrameStats.copies += stats.copies;
+	}
+	memset(frameStats, 0, sizeof(frameStats));
+
+	FRAMECOUNT++;
+
+	RESOLUTIONCHANGED = false;
+}
+
+
+void GraphicsDevice_Null::BindRenderTargets(UINT NumViews, Texture2D* const *ppRenderTargets, Texture2D* depthStencilTexture, GRAPHICSTHREAD threadID, int arrayIndex)
+{
+	frameStats[threadID].renderTargetBinds++;
+}
+void GraphicsDevice_Null::BindResource(SHADERSTAGE stage, GPUResource* resource, int slot, GRAPHICSTHREAD threadID, int arrayIndex)
+{
+	frameStats[threadID].resourceBinds++;
+}
+void GraphicsDevice_Null::BindResources(SHADERSTAGE stage, GPUResource *const* resources, int slot, int count, GRAPHICSTHREAD threadID)
+{
+	frameStats[threadID].resourceBinds += count;
+}
+void GraphicsDevice_Null::BindUAV(SHADERSTAGE stage, GPUResource* resource, int slot, GRAPHICSTHREAD threadID, int arrayIndex)
+{
+	frameStats[threadID].resourceBinds++;
+}
+void GraphicsDevice_Null::BindUAVs(SHADERSTAGE stage, GPUResource *const* resources, int slot, int count, GRAPHICSTHREAD threadID)
+{
+	frameStats[threadID].resourceBinds += count;
+}
+void GraphicsDevice_Null::BindSampler(SHADERSTAGE stage, Sampler* sampler, int slot, GRAPHICSTHREAD threadID)
+{
+	frameStats[threadID].resourceBinds++;
+}
+void GraphicsDevice_Null::BindConstantBuffer(SHADERSTAGE stage, GPUBuffer* buffer, int slot, GRAPHICSTHREAD threadID)
+{
+	frameStats[threadID].resourceBinds++;
+}
+void GraphicsDevice_Null::BindVertexBuffers(GPUBuffer* const *vertexBuffers, int slot, int count, const UINT* strides, const UINT* offsets, GRAPHICSTHREAD threadID)
+{
+	frameStats[threadID].geometryBinds++;
+}
+void GraphicsDevice_Null::BindIndexBuffer(GPUBuffer* indexBuffer, const INDEXBUFFER_FORMAT format, UINT offset, GRAPHICSTHREAD threadID)
+{
+	frameStats[threadID].geometryBinds++;
+}
+void GraphicsDevice_Null::BindGraphicsPSO(GraphicsPSO* pso, GRAPHICSTHREAD threadID)
+{
+	frameStats[threadID].pipelineBinds++;
+}
+void GraphicsDevice_Null::BindComputePSO(ComputePSO* pso, GRAPHICSTHREAD threadID)
+{
+	frameStats[threadID].pipelineBinds++;
+}
+void GraphicsDevice_Null::Draw(int vertexCount, UINT startVertexLocation, GRAPHICSTHREAD threadID)
+{
+	frameStats[threadID].drawCalls++;
+	frameStats[threadID].vertexCount += vertexCount;
+}
+void GraphicsDevice_Null::DrawIndexed(int indexCount, UINT startIndexLocation, UINT baseVertexLocation, GRAPHICSTHREAD threadID)
+{
+	frameStats[threadID].drawCalls++;
+	frameStats[threadID].vertexCount += indexCount;
+}
+void GraphicsDevice_Null::DrawInstanced(int vertexCount, int instanceCount, UINT startVertexLocation, UINT startInstanceLocation, GRAPHICSTHREAD threadID)
+{
+	frameStats[threadID].drawCalls++;
+	frameStats[threadID].vertexCount += (uint64_t)vertexCount * instanceCount;
+}
+void GraphicsDevice_Null::DrawIndexedInstanced(int indexCount, int instanceCount, UINT startIndexLocation, UINT baseVertexLocation, UINT startInstanceLocation, GRAPHICSTHREAD threadID)
+{
+	frameStats[threadID].drawCalls++;
+	frameStats[threadID].vertexCount += (uint64_t)indexCount * instanceCount;
+}
+void GraphicsDevice_Null::DrawInstancedIndirect(GPUBuffer* args, UINT args_offset, GRAPHICSTHREAD threadID)
+{
+	frameStats[threadID].drawCalls++;
+}
+void GraphicsDevice_Null::DrawIndexedInstancedIndirect(GPUBuffer* args, UINT args_offset, GRAPHICSTHREAD threadID)
+{
+	frameStats[threadID].drawCalls++;
+}
+void GraphicsDevice_Null::Dispatch(UINT threadGroupCountX, UINT threadGroupCountY, UINT threadGroupCountZ, GRAPHICSTHREAD threadID)
+{
+	frameStats[threadID].dispatchCalls++;
+}
+void GraphicsDevice_Null::DispatchIndirect(GPUBuffer* args, UINT args_offset, GRAPHICSTHREAD threadID)
+{
+	frameStats[threadID].dispatchCalls++;
+}
+void GraphicsDevice_Null::CopyTexture2D(Texture2D* pDst, Texture2D* pSrc, GRAPHICSTHREAD threadID)
+{
+	frameStats[threadID].copies++;
+}
+void GraphicsDevice_Null::CopyTexture2D_Region(Texture2D* pDst, UINT dstMip, UINT dstX, UINT dstY, Texture2D* pSrc, UINT srcMip, GRAPHICSTHREAD threadID)
+{
+	frameStats[threadID].copies++;
+}
+void GraphicsDevice_Null::MSAAResolve(Texture2D* pDst, Texture2D* pSrc, GRAPHICSTHREAD threadID)
+{
+	frameStats[threadID].copies++;
+}
+void GraphicsDevice_Null::UpdateBuffer(GPUBuffer* buffer, const void* data, GRAPHICSTHREAD threadID, int dataSize)
+{
+	assert(buffer->desc.Usage != USAGE_IMMUTABLE && "Cannot update IMMUTABLE GPUBuffer!");
+	assert((int)buffer->desc.ByteWidth >= dataSize || dataSize < 0 && "Data size is too big!");
+
+	if (dataSize == 0)
+	{
+		return;
+	}
+
+	dataSize = min((int)buffer->desc.ByteWidth, dataSize);
+	dataSize = (dataSize >= 0 ? dataSize : buffer->desc.ByteWidth);
+
+	memcpy((void*)buffer->resource_Null, data, dataSize);
+
+	frameStats[threadID].bufferUploads++;
+	frameStats[threadID].bufferUploadBytes += dataSize;
+}
+void* GraphicsDevice_Null::AllocateFromRingBuffer(GPURingBuffer* buffer, size_t dataSize, UINT& offsetIntoBuffer, GRAPHICSTHREAD threadID)
+{
+	assert(buffer->desc.Usage == USAGE_DYNAMIC && (buffer->desc.CPUAccessFlags & CPU_ACCESS_WRITE) && "Ringbuffer must be writable by the CPU!");
+	assert(buffer->desc.ByteWidth > dataSize && "Data of the required size cannot fit!");
+
+	if (dataSize == 0)
+	{
+		return nullptr;
+	}
+
+	dataSize = min((size_t)buffer->desc.ByteWidth, dataSize);
+
+	size_t position = buffer->byteOffset;
+	bool wrap = position + dataSize > buffer->desc.ByteWidth || buffer->residentFrame != FRAMECOUNT;
+	position = wrap ? 0 : position;
+
+	// Thread safety is compromised!
+	buffer->byteOffset = position + dataSize;
+	buffer->residentFrame = FRAMECOUNT;
+
+	frameStats[threadID].ringBufferAllocations++;
+	frameStats[threadID].ringBufferBytes += dataSize;
+
+	offsetIntoBuffer = (UINT)position;
+	return reinterpret_cast<void*>(buffer->resource_Null + position);
+}
+bool GraphicsDevice_Null::DownloadResource(GPUResource* resourceToDownload, GPUResource* resourceDest, void* dataDest, GRAPHICSTHREAD threadID)
+{
+	// Only buffers have memory, they are downloaded immediately:
+	GPUBuffer* bufferToDownload = dynamic_cast<GPUBuffer*>(resourceToDownload);
+	GPUBuffer* bufferDest = dynamic_cast<GPUBuffer*>(resourceDest);
+
+	if (bufferToDownload != nullptr && bufferDest != nullptr)
+	{
+		assert(bufferToDownload->desc.ByteWidth <= bufferDest->desc.ByteWidth);
+		assert(dataDest != nullptr);
+
+		memcpy(dataDest, (const void*)bufferToDownload->resource_Null, bufferToDownload->desc.ByteWidth);
+		return true;
+	}
+
+	return false;
+}
+bool GraphicsDevice_Null::QueryRead(GPUQuery *query, GRAPHICSTHREAD threadID)
+{
+	// Every query is immediately available, occlusion queries pass and timestamps measure zero time:
+	query->result_passed = TRUE;
+	query->result_passed_sample_count = 1;
+	query->result_timestamp = 0;
+	query->result_timestamp_frequency = 1;
+	query->result_disjoint = FALSE;
+	return true;
+}
+
+}
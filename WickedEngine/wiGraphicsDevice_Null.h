@@ -0,0 +1,150 @@
+#ifndef _GRAPHICSDEVICE_NULL_H_
+#define _GRAPHICSDEVICE_NULL_H_
+
+#include "CommonInclude.h"
+#include "wiGraphicsDevice.h"
+
+namespace wiGraphicsTypes
+{
+
+	// Graphics device without a GPU. Buffers live in CPU memory, every other resource only keeps its description and commands are not executed.
+	//	The commands are counted instead, so the CPU side of the renderer can be run and measured headless (for example on a build server).
+	class GraphicsDevice_Null : public GraphicsDevice
+	{
+	public:
+		struct FrameStats
+		{
+			uint32_t drawCalls;
+			uint32_t dispatchCalls;
+			uint64_t vertexCount;		// vertices or indices submitted by non-indirect draws (multiplied by the instance count)
+			uint32_t pipelineBinds;		// graphics and compute PSOs
+			uint32_t resourceBinds;		// shader resources, UAVs, samplers, constant buffers
+			uint32_t geometryBinds;		// vertex and index buffers
+			uint32_t renderTargetBinds;
+			uint32_t bufferUploads;		// UpdateBuffer calls
+			uint64_t bufferUploadBytes;
+			uint32_t ringBufferAllocations;
+			uint64_t ringBufferBytes;
+			uint32_t copies;			// texture copies and resolves
+		};
+
+	private:
+		// Counters of the frame that is being recorded, one for every context so that they can be recorded in parallel:
+		FrameStats frameStats[GRAPHICSTHREAD_COUNT];
+		// Summed counters of the last presented frame:
+		FrameStats lastFrameStats;
+
+	public:
+		GraphicsDevice_Null(int width = 1920, int height = 1080, bool multithreadedRendering = true);
+
+		~GraphicsDevice_Null();
+
+		virtual HRESULT CreateBuffer(const GPUBufferDesc *pDesc, const SubresourceData* pInitialData, GPUBuffer *ppBuffer) override;
+		virtual HRESULT CreateTexture1D(const TextureDesc* pDesc, const SubresourceData *pInitialData, Texture1D **ppTexture1D) override;
+		virtual HRESULT CreateTexture2D(const TextureDesc* pDesc, const SubresourceData *pInitialData, Texture2D **ppTexture2D) override;
+		virtual HRESULT CreateTexture3D(const TextureDesc* pDesc, const SubresourceData *pInitialData, Texture3D **ppTexture3D) override;
+		virtual HRESULT CreateInputLayout(const VertexLayoutDesc *pInputElementDescs, UINT NumElements,
+			const void *pShaderBytecodeWithInputSignature, SIZE_T BytecodeLength, VertexLayout *pInputLayout) override;
+		virtual HRESULT CreateVertexShader(const void *pShaderBytecode, SIZE_T BytecodeLength, VertexShader *pVertexShader) override;
+		virtual HRESULT CreatePixelShader(const void *pShaderBytecode, SIZE_T BytecodeLength, PixelShader *pPixelShader) override;
+		virtual HRESULT CreateGeometryShader(const void *pShaderBytecode, SIZE_T BytecodeLength, GeometryShader *pGeometryShader) override;
+		virtual HRESULT CreateHullShader(const void *pShaderBytecode, SIZE_T BytecodeLength, HullShader *pHullShader) override;
+		virtual HRESULT CreateDomainShader(const void *pShaderBytecode, SIZE_T BytecodeLength, DomainShader *pDomainShader) override;
+		virtual HRESULT CreateComputeShader(const void *pShaderBytecode, SIZE_T BytecodeLength, ComputeShader *pComputeShader) override;
+		virtual HRESULT CreateBlendState(const BlendStateDesc *pBlendStateDesc, BlendState *pBlendState) override;
+		virtual HRESULT CreateDepthStencilState(const DepthStencilStateDesc *pDepthStencilStateDesc, DepthStencilState *pDepthStencilState) override;
+		virtual HRESULT CreateRasterizerState(const RasterizerStateDesc *pRasterizerStateDesc, RasterizerState *pRasterizerState) override;
+		virtual HRESULT CreateSamplerState(const SamplerDesc *pSamplerDesc, Sampler *pSamplerState) override;
+		virtual HRESULT CreateQuery(const GPUQueryDesc *pDesc, GPUQuery *pQuery) override;
+		virtual HRESULT CreateGraphicsPSO(const GraphicsPSODesc* pDesc, GraphicsPSO* pso) override;
+		virtual HRESULT CreateComputePSO(const ComputePSODesc* pDesc, ComputePSO* pso) override;
+
+
+		virtual void DestroyResource(GPUResource* pResource) override;
+		virtual void DestroyBuffer(GPUBuffer *pBuffer) override {}
+		virtual void DestroyTexture1D(Texture1D *pTexture1D) override {}
+		virtual void DestroyTexture2D(Texture2D *pTexture2D) override {}
+		virtual void DestroyTexture3D(Texture3D *pTexture3D) override {}
+		virtual void DestroyInputLayout(VertexLayout *pInputLayout) override {}
+		virtual void DestroyVertexShader(VertexShader *pVertexShader) override {}
+		virtual void DestroyPixelShader(PixelShader *pPixelShader) override {}
+		virtual void DestroyGeometryShader(GeometryShader *pGeometryShader) override {}
+		virtual void DestroyHullShader(HullShader *pHullShader) override {}
+		virtual void DestroyDomainShader(DomainShader *pDomainShader) override {}
+		virtual void DestroyComputeShader(ComputeShader *pComputeShader) override {}
+		virtual void DestroyBlendState(BlendState *pBlendState) override {}
+		virtual void DestroyDepthStencilState(DepthStencilState *pDepthStencilState) override {}
+		virtual void DestroyRasterizerState(RasterizerState *pRasterizerState) override {}
+		virtual void DestroySamplerState(Sampler *pSamplerState) override {}
+		virtual void DestroyQuery(GPUQuery *pQuery) override {}
+		virtual void DestroyGraphicsPSO(GraphicsPSO* pso) override {}
+		virtual void DestroyComputePSO(ComputePSO* pso) override {}
+
+
+		virtual void SetName(GPUResource* pResource, const std::string& name) override {}
+
+		virtual void PresentBegin() override;
+		virtual void PresentEnd() override;
+
+		virtual void ExecuteDeferredContexts() override {}
+		virtual void FinishCommandList(GRAPHICSTHREAD thread) override {}
+
+		virtual void SetResolution(int width, int height) override;
+
+		virtual Texture2D GetBackBuffer() override;
+
+		// Counters of the last presented frame, summed over every context
+		const FrameStats& GetFrameStats() const { return lastFrameStats; }
+
+		///////////////Thread-sensitive////////////////////////
+
+		virtual void BindScissorRects(UINT numRects, const Rect* rects, GRAPHICSTHREAD threadID) override {}
+		virtual void BindViewports(UINT NumViewports, const ViewPort *pViewports, GRAPHICSTHREAD threadID) override {}
+		virtual void BindRenderTargets(UINT NumViews, Texture2D* const *ppRenderTargets, Texture2D* depthStencilTexture, GRAPHICSTHREAD threadID, int arrayIndex = -1) override;
+		virtual void ClearRenderTarget(Texture* pTexture, const FLOAT ColorRGBA[4], GRAPHICSTHREAD threadID, int arrayIndex = -1) override {}
+		virtual void ClearDepthStencil(Texture2D* pTexture, UINT ClearFlags, FLOAT Depth, UINT8 Stencil, GRAPHICSTHREAD threadID, int arrayIndex = -1) override {}
+		virtual void BindResource(SHADERSTAGE stage, GPUResource* resource, int slot, GRAPHICSTHREAD threadID, int arrayIndex = -1) override;
+		virtual void BindResources(SHADERSTAGE stage, GPUResource *const* resources, int slot, int count, GRAPHICSTHREAD threadID) override;
+		virtual void BindUAV(SHADERSTAGE stage, GPUResource* resource, int slot, GRAPHICSTHREAD threadID, int arrayIndex = -1) override;
+		virtual void BindUAVs(SHADERSTAGE stage, GPUResource *const* resources, int slot, int count, GRAPHICSTHREAD threadID) override;
+		virtual void UnbindResources(int slot, int num, GRAPHICSTHREAD threadID) override {}
+		virtual void UnbindUAVs(int slot, int num, GRAPHICSTHREAD threadID) override {}
+		virtual void BindSampler(SHADERSTAGE stage, Sampler* sampler, int slot, GRAPHICSTHREAD threadID) override;
+		virtual void BindConstantBuffer(SHADERSTAGE stage, GPUBuffer* buffer, int slot, GRAPHICSTHREAD threadID) override;
+		virtual void BindVertexBuffers(GPUBuffer* const *vertexBuffers, int slot, int count, const UINT* strides, const UINT* offsets, GRAPHICSTHREAD threadID) override;
+		virtual void BindIndexBuffer(GPUBuffer* indexBuffer, const INDEXBUFFER_FORMAT format, UINT offset, GRAPHICSTHREAD threadID) override;
+		virtual void BindStencilRef(UINT value, GRAPHICSTHREAD threadID) override {}
+		virtual void BindBlendFactor(XMFLOAT4 value, GRAPHICSTHREAD threadID) override {}
+		virtual void BindGraphicsPSO(GraphicsPSO* pso, GRAPHICSTHREAD threadID) override;
+		virtual void BindComputePSO(ComputePSO* pso, GRAPHICSTHREAD threadID) override;
+		virtual void Draw(int vertexCount, UINT startVertexLocation, GRAPHICSTHREAD threadID) override;
+		virtual void DrawIndexed(int indexCount, UINT startIndexLocation, UINT baseVertexLocation, GRAPHICSTHREAD threadID) override;
+		virtual void DrawInstanced(int vertexCount, int instanceCount, UINT startVertexLocation, UINT startInstanceLocation, GRAPHICSTHREAD threadID) override;
+		virtual void DrawIndexedInstanced(int indexCount, int instanceCount, UINT startIndexLocation, UINT baseVertexLocation, UINT startInstanceLocation, GRAPHICSTHREAD threadID) override;
+		virtual void DrawInstancedIndirect(GPUBuffer* args, UINT args_offset, GRAPHICSTHREAD threadID) override;
+		virtual void DrawIndexedInstancedIndirect(GPUBuffer* args, UINT args_offset, GRAPHICSTHREAD threadID) override;
+		virtual void Dispatch(UINT threadGroupCountX, UINT threadGroupCountY, UINT threadGroupCountZ, GRAPHICSTHREAD threadID) override;
+		virtual void DispatchIndirect(GPUBuffer* args, UINT args_offset, GRAPHICSTHREAD threadID) override;
+		virtual void CopyTexture2D(Texture2D* pDst, Texture2D* pSrc, GRAPHICSTHREAD threadID) override;
+		virtual void CopyTexture2D_Region(Texture2D* pDst, UINT dstMip, UINT dstX, UINT dstY, Texture2D* pSrc, UINT srcMip, GRAPHICSTHREAD threadID) override;
+		virtual void MSAAResolve(Texture2D* pDst, Texture2D* pSrc, GRAPHICSTHREAD threadID) override;
+		virtual void UpdateBuffer(GPUBuffer* buffer, const void* data, GRAPHICSTHREAD threadID, int dataSize = -1) override;
+		virtual void* AllocateFromRingBuffer(GPURingBuffer* buffer, size_t dataSize, UINT& offsetIntoBuffer, GRAPHICSTHREAD threadID) override;
+		virtual void InvalidateBufferAccess(GPUBuffer* buffer, GRAPHICSTHREAD threadID) override {}
+		virtual bool DownloadResource(GPUResource* resourceToDownload, GPUResource* resourceDest, void* dataDest, GRAPHICSTHREAD threadID) override;
+		virtual void QueryBegin(GPUQuery *query, GRAPHICSTHREAD threadID) override {}
+		virtual void QueryEnd(GPUQuery *query, GRAPHICSTHREAD threadID) override {}
+		virtual bool QueryRead(GPUQuery *query, GRAPHICSTHREAD threadID) override;
+		virtual void UAVBarrier(GPUResource *const* uavs, UINT NumBarriers, GRAPHICSTHREAD threadID) override {}
+		virtual void TransitionBarrier(GPUResource *const* resources, UINT NumBarriers, RESOURCE_STATES stateBefore, RESOURCE_STATES stateAfter, GRAPHICSTHREAD threadID) override {}
+
+		virtual void WaitForGPU() override {}
+
+		virtual void EventBegin(const std::string& name, GRAPHICSTHREAD threadID) override {}
+		virtual void EventEnd(GRAPHICSTHREAD threadID) override {}
+		virtual void SetMarker(const std::string& name, GRAPHICSTHREAD threadID) override {}
+	};
+
+}
+
+#endif // _GRAPHICSDEVICE_NULL_H_
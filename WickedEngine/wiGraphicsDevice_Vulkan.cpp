@@ -4,6 +4,7 @@
 #include "ShaderInterop_Vulkan.h"
 
 #include <sstream>
+#include <fstream>
 #include <vector>
 #include <cstring>
 #include <iostream>
@@ -1728,6 +1729,15 @@ namespace wiGraphicsTypes
 			vkGetDeviceQueue(device, queueIndices.copyFamily, 0, &copyQueue);
 		}
 
+		// Empty pipeline cache, it can be replaced by LoadPipelineCache():
+		{
+			VkPipelineCacheCreateInfo createInfo = {};
+			createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+			if (vkCreatePipelineCache(device, &createInfo, nullptr, &pipelineCache) != VK_SUCCESS) {
+				throw std::runtime_error("failed to create pipeline cache!");
+			}
+		}
+
 
 		// Create default pipeline:
 		{
@@ -2408,6 +2418,7 @@ namespace wiGraphicsTypes
 			vkDestroyImage(device, x, nullptr);
 		}
 		vkDestroySwapchainKHR(device, swapChain, nullptr);
+		vkDestroyPipelineCache(device, pipelineCache, nullptr);
 		vkDestroyDevice(device, nullptr);
 		DestroyDebugReportCallbackEXT(instance, callback, nullptr);
 		vkDestroyInstance(instance, nullptr);
@@ -3927,7 +3938,7 @@ namespace wiGraphicsTypes
 		pipelineInfo.pDynamicState = &dynamicState;
 
 
-		VkResult res = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, reinterpret_cast<VkPipeline*>(&pso->pipeline_Vulkan));
+		VkResult res = vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, reinterpret_cast<VkPipeline*>(&pso->pipeline_Vulkan));
 		HRESULT hr = res == VK_SUCCESS ? S_OK : E_FAIL;
 		assert(SUCCEEDED(hr));
 
@@ -3974,7 +3985,7 @@ namespace wiGraphicsTypes
 		}
 
 
-		VkResult res = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, reinterpret_cast<VkPipeline*>(&pso->pipeline_Vulkan));
+		VkResult res = vkCreateComputePipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, reinterpret_cast<VkPipeline*>(&pso->pipeline_Vulkan));
 		HRESULT hr = res == VK_SUCCESS ? S_OK : E_FAIL;
 		assert(SUCCEEDED(hr));
 
@@ -4137,6 +4148,73 @@ namespace wiGraphicsTypes
 
 	}
 
+	bool GraphicsDevice_Vulkan::LoadPipelineCache(const std::string& fileName)
+	{
+		std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+		if (!file.is_open())
+		{
+			return false;
+		}
+		std::vector<uint8_t> data((size_t)file.tellg());
+		file.seekg(0, file.beg);
+		if (!file.read((char*)data.data(), data.size()))
+		{
+			return false;
+		}
+
+		// The header identifies the device and driver that created the data, it is not used for an other one:
+		uint32_t header[4];
+		if (data.size() < sizeof(header) + VK_UUID_SIZE)
+		{
+			return false;
+		}
+		memcpy(header, data.data(), sizeof(header));
+		if (header[1] != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+			header[2] != physicalDeviceProperties.vendorID ||
+			header[3] != physicalDeviceProperties.deviceID ||
+			memcmp(data.data() + sizeof(header), physicalDeviceProperties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+		{
+			return false;
+		}
+
+		VkPipelineCacheCreateInfo createInfo = {};
+		createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		createInfo.initialDataSize = data.size();
+		createInfo.pInitialData = data.data();
+
+		VkPipelineCache loadedCache = VK_NULL_HANDLE;
+		if (vkCreatePipelineCache(device, &createInfo, nullptr, &loadedCache) != VK_SUCCESS)
+		{
+			return false;
+		}
+
+		// No pipelines can be created while the cache is replaced
+		vkDestroyPipelineCache(device, pipelineCache, nullptr);
+		pipelineCache = loadedCache;
+		return true;
+	}
+	bool GraphicsDevice_Vulkan::SavePipelineCache(const std::string& fileName)
+	{
+		size_t size = 0;
+		if (vkGetPipelineCacheData(device, pipelineCache, &size, nullptr) != VK_SUCCESS || size == 0)
+		{
+			return false;
+		}
+		std::vector<uint8_t> data(size);
+		if (vkGetPipelineCacheData(device, pipelineCache, &size, data.data()) != VK_SUCCESS)
+		{
+			return false;
+		}
+
+		std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			return false;
+		}
+		file.write((const char*)data.data(), size);
+		return file.good();
+	}
+
 
 	void GraphicsDevice_Vulkan::PresentBegin()
 	{
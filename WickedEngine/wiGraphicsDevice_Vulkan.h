@@ -51,6 +51,8 @@ namespace wiGraphicsTypes
 
 		VkPhysicalDeviceProperties physicalDeviceProperties;
 
+		VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+
 		VkQueue copyQueue;
 		VkCommandPool copyCommandPool;
 		VkCommandBuffer copyCommandBuffer;
@@ -244,6 +246,9 @@ namespace wiGraphicsTypes
 
 		virtual void SetName(GPUResource* pResource, const std::string& name) override;
 
+		virtual bool LoadPipelineCache(const std::string& fileName) override;
+		virtual bool SavePipelineCache(const std::string& fileName) override;
+
 		virtual void PresentBegin() override;
 		virtual void PresentEnd() override;
 
@@ -101,6 +101,7 @@ namespace wiGraphicsTypes
 		resource_DX12 = WI_NULL_HANDLE;
 		resource_Vulkan = WI_NULL_HANDLE;
 		resourceMemory_Vulkan = WI_NULL_HANDLE;
+		resource_Null = WI_NULL_HANDLE;
 	}
 	GPUResource::~GPUResource()
 	{
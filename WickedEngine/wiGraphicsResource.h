@@ -52,6 +52,7 @@ namespace wiGraphicsTypes
 		friend class GraphicsDevice_DX11;
 		friend class GraphicsDevice_DX12;
 		friend class GraphicsDevice_Vulkan;
+		friend class GraphicsDevice_Null;
 	private:
 		ID3D11VertexShader*		resource_DX11;
 	public:
@@ -66,6 +67,7 @@ namespace wiGraphicsTypes
 		friend class GraphicsDevice_DX11;
 		friend class GraphicsDevice_DX12;
 		friend class GraphicsDevice_Vulkan;
+		friend class GraphicsDevice_Null;
 	private:
 		ID3D11PixelShader*		resource_DX11;
 	public:
@@ -80,6 +82,7 @@ namespace wiGraphicsTypes
 		friend class GraphicsDevice_DX11;
 		friend class GraphicsDevice_DX12;
 		friend class GraphicsDevice_Vulkan;
+		friend class GraphicsDevice_Null;
 	private:
 		ID3D11GeometryShader*	resource_DX11;
 	public:
@@ -94,6 +97,7 @@ namespace wiGraphicsTypes
 		friend class GraphicsDevice_DX11;
 		friend class GraphicsDevice_DX12;
 		friend class GraphicsDevice_Vulkan;
+		friend class GraphicsDevice_Null;
 	private:
 		ID3D11HullShader*		resource_DX11;
 	public:
@@ -108,6 +112,7 @@ namespace wiGraphicsTypes
 		friend class GraphicsDevice_DX11;
 		friend class GraphicsDevice_DX12;
 		friend class GraphicsDevice_Vulkan;
+		friend class GraphicsDevice_Null;
 	private:
 		ID3D11DomainShader*		resource_DX11;
 	public:
@@ -122,6 +127,7 @@ namespace wiGraphicsTypes
 		friend class GraphicsDevice_DX11;
 		friend class GraphicsDevice_DX12;
 		friend class GraphicsDevice_Vulkan;
+		friend class GraphicsDevice_Null;
 	private:
 		ID3D11ComputeShader*	resource_DX11;
 	public:
@@ -136,6 +142,7 @@ namespace wiGraphicsTypes
 		friend class GraphicsDevice_DX11;
 		friend class GraphicsDevice_DX12;
 		friend class GraphicsDevice_Vulkan;
+		friend class GraphicsDevice_Null;
 	private:
 		ID3D11SamplerState*				resource_DX11;
 		wiCPUHandle						resource_DX12;
@@ -154,6 +161,7 @@ namespace wiGraphicsTypes
 		friend class GraphicsDevice_DX11;
 		friend class GraphicsDevice_DX12;
 		friend class GraphicsDevice_Vulkan;
+		friend class GraphicsDevice_Null;
 	protected:
 		ID3D11ShaderResourceView*					SRV_DX11;					// main resource SRV
 		std::vector<ID3D11ShaderResourceView*>		additionalSRVs_DX11;		// can be used for sub-resources if requested
@@ -173,6 +181,7 @@ namespace wiGraphicsTypes
 		wiCPUHandle									resource_DX12;
 		wiCPUHandle									resource_Vulkan;
 		wiCPUHandle									resourceMemory_Vulkan;
+		wiCPUHandle									resource_Null;				// CPU memory of buffers on the null device
 
 		GPUResource();
 		virtual ~GPUResource();
@@ -183,6 +192,7 @@ namespace wiGraphicsTypes
 		friend class GraphicsDevice_DX11;
 		friend class GraphicsDevice_DX12;
 		friend class GraphicsDevice_Vulkan;
+		friend class GraphicsDevice_Null;
 	private:
 		wiCPUHandle									CBV_DX12;
 		GPUBufferDesc desc;
@@ -190,7 +200,7 @@ namespace wiGraphicsTypes
 		GPUBuffer();
 		virtual ~GPUBuffer();
 
-		bool IsValid() { return resource_DX11 != WI_NULL_HANDLE || resource_DX12 != WI_NULL_HANDLE || resource_Vulkan != WI_NULL_HANDLE; }
+		bool IsValid() { return resource_DX11 != WI_NULL_HANDLE || resource_DX12 != WI_NULL_HANDLE || resource_Vulkan != WI_NULL_HANDLE || resource_Null != WI_NULL_HANDLE; }
 		GPUBufferDesc GetDesc() { return desc; }
 	};
 
@@ -199,6 +209,7 @@ namespace wiGraphicsTypes
 		friend class GraphicsDevice_DX11;
 		friend class GraphicsDevice_DX12;
 		friend class GraphicsDevice_Vulkan;
+		friend class GraphicsDevice_Null;
 	private:
 		size_t byteOffset;
 		uint64_t residentFrame;
@@ -215,6 +226,7 @@ namespace wiGraphicsTypes
 		friend class GraphicsDevice_DX11;
 		friend class GraphicsDevice_DX12;
 		friend class GraphicsDevice_Vulkan;
+		friend class GraphicsDevice_Null;
 	private:
 		ID3D11InputLayout*	resource_DX11;
 
@@ -229,6 +241,7 @@ namespace wiGraphicsTypes
 		friend class GraphicsDevice_DX11;
 		friend class GraphicsDevice_DX12;
 		friend class GraphicsDevice_Vulkan;
+		friend class GraphicsDevice_Null;
 	private:
 		ID3D11BlendState*	resource_DX11;
 		BlendStateDesc desc;
@@ -244,6 +257,7 @@ namespace wiGraphicsTypes
 		friend class GraphicsDevice_DX11;
 		friend class GraphicsDevice_DX12;
 		friend class GraphicsDevice_Vulkan;
+		friend class GraphicsDevice_Null;
 	private:
 		ID3D11DepthStencilState*	resource_DX11;
 		DepthStencilStateDesc desc;
@@ -259,6 +273,7 @@ namespace wiGraphicsTypes
 		friend class GraphicsDevice_DX11;
 		friend class GraphicsDevice_DX12;
 		friend class GraphicsDevice_Vulkan;
+		friend class GraphicsDevice_Null;
 	private:
 		ID3D11RasterizerState*	resource_DX11;
 		RasterizerStateDesc desc;
@@ -274,6 +289,7 @@ namespace wiGraphicsTypes
 		friend class GraphicsDevice_DX11;
 		friend class GraphicsDevice_DX12;
 		friend class GraphicsDevice_Vulkan;
+		friend class GraphicsDevice_Null;
 	private:
 		TextureDesc									desc;
 		ID3D11RenderTargetView*						RTV_DX11;
@@ -310,6 +326,7 @@ namespace wiGraphicsTypes
 		friend class GraphicsDevice_DX11;
 		friend class GraphicsDevice_DX12;
 		friend class GraphicsDevice_Vulkan;
+		friend class GraphicsDevice_Null;
 	private:
 	public:
 		Texture1D();
@@ -321,6 +338,7 @@ namespace wiGraphicsTypes
 		friend class GraphicsDevice_DX11;
 		friend class GraphicsDevice_DX12;
 		friend class GraphicsDevice_Vulkan;
+		friend class GraphicsDevice_Null;
 	private:
 		ID3D11DepthStencilView*						DSV_DX11;
 		std::vector<ID3D11DepthStencilView*>		additionalDSVs_DX11;
@@ -339,6 +357,7 @@ namespace wiGraphicsTypes
 		friend class GraphicsDevice_DX11;
 		friend class GraphicsDevice_DX12;
 		friend class GraphicsDevice_Vulkan;
+		friend class GraphicsDevice_Null;
 	private:
 	public:
 		Texture3D();
@@ -353,6 +372,7 @@ namespace wiGraphicsTypes
 		friend class GraphicsDevice_DX11;
 		friend class GraphicsDevice_DX12;
 		friend class GraphicsDevice_Vulkan;
+		friend class GraphicsDevice_Null;
 	private:
 		std::vector<ID3D11Query*>	resource_DX11;
 		std::vector<int>			active;
@@ -378,6 +398,7 @@ namespace wiGraphicsTypes
 		friend class GraphicsDevice_DX11;
 		friend class GraphicsDevice_DX12;
 		friend class GraphicsDevice_Vulkan;
+		friend class GraphicsDevice_Null;
 	private:
 		wiCPUHandle						pipeline_DX12;
 		wiCPUHandle						pipeline_Vulkan;
@@ -394,6 +415,7 @@ namespace wiGraphicsTypes
 		friend class GraphicsDevice_DX11;
 		friend class GraphicsDevice_DX12;
 		friend class GraphicsDevice_Vulkan;
+		friend class GraphicsDevice_Null;
 	private:
 		wiCPUHandle						pipeline_DX12;
 		wiCPUHandle						pipeline_Vulkan;
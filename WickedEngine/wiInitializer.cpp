@@ -11,6 +11,7 @@
 #include "wiHelper.h"
 #include "wiWidget.h"
 #include "wiGPUSortLib.h"
+#include "wiJobSystem.h"
 
 using namespace std;
 
@@ -22,8 +23,15 @@ namespace wiInitializer
 		wiBackLog::Initialize();
 		wiFrameRate::Initialize();
 		wiCpuInfo::Initialize();
+		wiJobSystem::Initialize();
 
 		wiRenderer::SetUpStaticComponents();
+
+		// These only load shaders and create pipeline states, so they are loaded in the background while the rest is initialized:
+		wiJobSystem::context ctx;
+		wiJobSystem::Execute(ctx, [] { wiWidget::LoadShaders(); });
+		wiJobSystem::Execute(ctx, [] { wiGPUSortLib::LoadShaders(); });
+
 		wiLensFlare::Initialize();
 
 		wiImage::Load();
@@ -33,9 +41,9 @@ namespace wiInitializer
 
 		wiOcean::SetUpStatic();
 
-		wiWidget::LoadShaders();
+		wiJobSystem::Wait(ctx);
 
-		wiGPUSortLib::LoadShaders();
+		wiRenderer::GetDevice()->SavePipelineCache(wiRenderer::PIPELINECACHEPATH);
 
 		if (FAILED(wiSoundEffect::Initialize()) || FAILED(wiMusic::Initialize()))
 		{
@@ -185,6 +185,28 @@ void AABB::Serialize(wiArchive& archive)
 
 
 
+void AABBArray::resize(size_t count) {
+	center_x.resize(count);
+	center_y.resize(count);
+	center_z.resize(count);
+	extent_x.resize(count);
+	extent_y.resize(count);
+	extent_z.resize(count);
+}
+void AABBArray::set(size_t index, const XMFLOAT3& min, const XMFLOAT3& max) {
+	center_x[index] = (min.x + max.x)*0.5f;
+	center_y[index] = (min.y + max.y)*0.5f;
+	center_z[index] = (min.z + max.z)*0.5f;
+	extent_x[index] = (max.x - min.x)*0.5f;
+	extent_y[index] = (max.y - min.y)*0.5f;
+	extent_z[index] = (max.z - min.z)*0.5f;
+}
+
+
+
+
+
+
 bool SPHERE::intersects(const AABB& b) const {
 	XMFLOAT3 min = b.getMin();
 	XMFLOAT3 max = b.getMax();
@@ -3,6 +3,8 @@
 #include "CommonInclude.h"
 #include "wiArchive.h"
 
+#include <vector>
+
 struct SPHERE;
 struct RAY;
 struct AABB;
@@ -37,6 +39,18 @@ struct AABB {
 	static AABB Merge(const AABB& a, const AABB& b);
 	void Serialize(wiArchive& archive);
 };
+// Structure of arrays storage of bounding boxes as centers and half widths, for batched intersection tests
+struct AABBArray {
+	std::vector<float> center_x, center_y, center_z;
+	std::vector<float> extent_x, extent_y, extent_z;
+
+	void resize(size_t count);
+	void set(size_t index, const XMFLOAT3& min, const XMFLOAT3& max);
+	void set(size_t index, const AABB& box) { set(index, box.getMin(), box.getMax()); }
+	XMFLOAT3 getMin(size_t index) const { return XMFLOAT3(center_x[index] - extent_x[index], center_y[index] - extent_y[index], center_z[index] - extent_z[index]); }
+	XMFLOAT3 getMax(size_t index) const { return XMFLOAT3(center_x[index] + extent_x[index], center_y[index] + extent_y[index], center_z[index] + extent_z[index]); }
+	size_t size() const { return center_x.size(); }
+};
 struct SPHERE {
 	float radius;
 	XMFLOAT3 center;
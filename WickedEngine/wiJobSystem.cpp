@@ -0,0 +1,243 @@
+#include "wiJobSystem.h"
+#include "wiSpinLock.h"
+#include "wiCpuInfo.h"
+#include "wiBackLog.h"
+
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <sstream>
+
+using namespace std;
+
+namespace wiJobSystem
+{
+	struct Job
+	{
+		function<void()> task;
+		context* ctx = nullptr;
+	};
+
+	// Every worker owns one of these. The owner pushes and pops at the back, thieves take from the front.
+	struct WorkerQueue
+	{
+		deque<Job> jobs;
+		wiSpinLock lock;
+
+		void push_back(Job&& job)
+		{
+			lock.lock();
+			jobs.push_back(std::move(job));
+			lock.unlock();
+		}
+		bool pop_back(Job& job)
+		{
+			lock.lock();
+			if (jobs.empty())
+			{
+				lock.unlock();
+				return false;
+			}
+			job = std::move(jobs.back());
+			jobs.pop_back();
+			lock.unlock();
+			return true;
+		}
+		bool pop_front(Job& job)
+		{
+			lock.lock();
+			if (jobs.empty())
+			{
+				lock.unlock();
+				return false;
+			}
+			job = std::move(jobs.front());
+			jobs.pop_front();
+			lock.unlock();
+			return true;
+		}
+	};
+
+	uint32_t numThreads = 0;
+	unique_ptr<WorkerQueue[]> queues;
+	atomic<uint32_t> nextQueue(0);
+	atomic<uint32_t> pendingJobs(0);
+	mutex wakeMutex;
+	condition_variable wakeCondition;
+
+	// Worker threads know their own queue, other threads will only steal
+	thread_local uint32_t workerIndex = ~0u;
+
+	// Try to execute one job. Returns false if there was no job available.
+	bool work()
+	{
+		Job job;
+		const bool isWorker = workerIndex < numThreads;
+		const uint32_t start = isWorker ? workerIndex : 0;
+		for (uint32_t i = 0; i < numThreads; ++i)
+		{
+			WorkerQueue& queue = queues[(start + i) % numThreads];
+			const bool found = (isWorker && i == 0) ? queue.pop_back(job) : queue.pop_front(job);
+			if (found)
+			{
+				pendingJobs.fetch_sub(1);
+				job.task();
+				job.ctx->counter.fetch_sub(1);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void submit(Job&& job)
+	{
+		const uint32_t target = workerIndex < numThreads ? workerIndex : (nextQueue.fetch_add(1) % numThreads);
+		pendingJobs.fetch_add(1);
+		queues[target].push_back(std::move(job));
+	}
+
+	void wake(bool all)
+	{
+		// Taking the lock here guarantees that a worker can not miss the wakeup between checking for work and going to sleep
+		{
+			lock_guard<mutex> lock(wakeMutex);
+		}
+		if (all)
+		{
+			wakeCondition.notify_all();
+		}
+		else
+		{
+			wakeCondition.notify_one();
+		}
+	}
+
+	void Initialize()
+	{
+		if (numThreads > 0)
+		{
+			return;
+		}
+
+		// Leave one core for the main thread:
+		const uint32_t numCores = (uint32_t)max(1, wiCpuInfo::GetCoreCount());
+		numThreads = max(1u, numCores - 1);
+
+		queues.reset(new WorkerQueue[numThreads]);
+
+		for (uint32_t threadID = 0; threadID < numThreads; ++threadID)
+		{
+			thread worker([threadID] {
+
+				workerIndex = threadID;
+
+				while (true)
+				{
+					if (!work())
+					{
+						unique_lock<mutex> lock(wakeMutex);
+						wakeCondition.wait(lock, [] { return pendingJobs.load() > 0; });
+					}
+				}
+
+			});
+
+			worker.detach();
+		}
+
+		stringstream ss("");
+		ss << "wiJobSystem Initialized with [" << numCores << " cores] [" << numThreads << " threads]";
+		wiBackLog::post(ss.str().c_str());
+	}
+
+	uint32_t GetThreadCount()
+	{
+		return numThreads;
+	}
+
+	void Execute(context& ctx, const function<void()>& job)
+	{
+		if (numThreads == 0)
+		{
+			// Not initialized, execute on the calling thread:
+			job();
+			return;
+		}
+
+		ctx.counter.fetch_add(1);
+
+		Job newJob;
+		newJob.task = job;
+		newJob.ctx = &ctx;
+		submit(std::move(newJob));
+
+		wake(false);
+	}
+
+	void Dispatch(context& ctx, uint32_t jobCount, uint32_t groupSize, const function<void(JobDispatchArgs)>& job)
+	{
+		if (jobCount == 0 || groupSize == 0)
+		{
+			return;
+		}
+
+		const uint32_t groupCount = (jobCount + groupSize - 1) / groupSize;
+
+		if (numThreads == 0 || groupCount == 1)
+		{
+			// Nothing to parallelize, execute on the calling thread:
+			JobDispatchArgs args;
+			for (uint32_t i = 0; i < jobCount; ++i)
+			{
+				args.jobIndex = i;
+				args.groupIndex = i / groupSize;
+				job(args);
+			}
+			return;
+		}
+
+		ctx.counter.fetch_add(groupCount);
+
+		for (uint32_t groupIndex = 0; groupIndex < groupCount; ++groupIndex)
+		{
+			Job newJob;
+			newJob.ctx = &ctx;
+			newJob.task = [jobCount, groupSize, groupIndex, job] {
+
+				const uint32_t groupJobOffset = groupIndex * groupSize;
+				const uint32_t groupJobEnd = min(groupJobOffset + groupSize, jobCount);
+
+				JobDispatchArgs args;
+				args.groupIndex = groupIndex;
+
+				for (uint32_t i = groupJobOffset; i < groupJobEnd; ++i)
+				{
+					args.jobIndex = i;
+					job(args);
+				}
+			};
+			submit(std::move(newJob));
+		}
+
+		wake(true);
+	}
+
+	bool IsBusy(const context& ctx)
+	{
+		return ctx.counter.load() > 0;
+	}
+
+	void Wait(const context& ctx)
+	{
+		while (IsBusy(ctx))
+		{
+			// Help with the work instead of just spinning:
+			if (!work())
+			{
+				this_thread::yield();
+			}
+		}
+	}
+}
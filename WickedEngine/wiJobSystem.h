@@ -0,0 +1,46 @@
+#pragma once
+#include "CommonInclude.h"
+
+#include <atomic>
+#include <functional>
+
+// Work stealing job scheduler
+//	Every worker thread owns a job queue. Workers first take work from their own queue, then try to steal from others.
+//	Jobs are grouped by a context (job counter), which can be waited on. The waiting thread will also help to execute jobs.
+namespace wiJobSystem
+{
+	struct JobDispatchArgs
+	{
+		uint32_t jobIndex;		// index of the job inside the whole dispatch
+		uint32_t groupIndex;	// index of the group that the job belongs to
+	};
+
+	// Job counter. Every job that is submitted with a context increments it, and decrements it when finished.
+	struct context
+	{
+		std::atomic<uint32_t> counter;
+
+		context() :counter(0) {}
+	};
+
+	// Create the worker threads. Thread count is determined from the available CPU cores.
+	void Initialize();
+
+	// Number of worker threads
+	uint32_t GetThreadCount();
+
+	// Add a job to execute asynchronously. Any idle thread will execute this job.
+	void Execute(context& ctx, const std::function<void()>& job);
+
+	// Divide a job into multiple jobs and execute in parallel.
+	//	jobCount	: how many jobs to generate for this task.
+	//	groupSize	: how many jobs to execute per thread. Jobs inside a group execute serially. It might be worth to increase for small jobs
+	//	job			: receives a JobDispatchArgs as parameter
+	void Dispatch(context& ctx, uint32_t jobCount, uint32_t groupSize, const std::function<void(JobDispatchArgs)>& job);
+
+	// Check if any jobs of the context are still being executed
+	bool IsBusy(const context& ctx);
+
+	// Wait until all jobs of the context finished. The calling thread will also execute pending jobs while waiting.
+	void Wait(const context& ctx);
+}
@@ -0,0 +1,372 @@
+#include "wiMeshOptimizer.h"
+
+#include <cfloat>
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+
+using namespace std;
+
+namespace wiMeshOptimizer
+{
+	// FIFO post-transform cache simulation: a vertex is in the cache while fewer than cacheSize vertices were transformed after it
+	struct FifoCache
+	{
+		vector<uint32_t> timestamps;
+		uint32_t time;
+		uint32_t size;
+
+		FifoCache(uint32_t vertexCount, uint32_t cacheSize) : timestamps(vertexCount, 0), time(cacheSize + 1), size(cacheSize) {}
+
+		inline bool Contains(uint32_t vertex) const
+		{
+			return time - timestamps[vertex] <= size;
+		}
+		// Returns the number of transformed vertices
+		inline uint32_t Triangle(const uint32_t* triangle)
+		{
+			uint32_t misses = 0;
+			for (uint32_t i = 0; i < 3; ++i)
+			{
+				const uint32_t vertex = triangle[i];
+				if (!Contains(vertex))
+				{
+					timestamps[vertex] = time++;
+					misses++;
+				}
+			}
+			return misses;
+		}
+		inline void Flush()
+		{
+			time += size;
+		}
+	};
+
+	static inline XMFLOAT3 GetPosition(const float* positions, uint32_t stride, uint32_t index)
+	{
+		const float* p = (const float*)((const uint8_t*)positions + (size_t)index * stride);
+		return XMFLOAT3(p[0], p[1], p[2]);
+	}
+
+
+	CacheStats AnalyzeVertexCache(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize)
+	{
+		CacheStats stats;
+		stats.triangleCount = indexCount / 3;
+
+		FifoCache cache(vertexCount, cacheSize);
+		for (uint32_t t = 0; t < stats.triangleCount; ++t)
+		{
+			for (uint32_t i = 0; i < 3; ++i)
+			{
+				assert(indices[t * 3 + i] < vertexCount);
+				if (cache.timestamps[indices[t * 3 + i]] == 0)
+				{
+					stats.vertexCount++;
+				}
+			}
+			stats.transformCount += cache.Triangle(&indices[t * 3]);
+		}
+
+		return stats;
+	}
+
+	void OptimizeVertexCache(uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize, vector<uint32_t>* clusters)
+	{
+		assert(cacheSize >= 3);
+
+		if (clusters != nullptr)
+		{
+			clusters->clear();
+		}
+		const uint32_t triangleCount = indexCount / 3;
+		if (triangleCount == 0)
+		{
+			return;
+		}
+
+		// Vertex -> triangle adjacency, the triangles of vertex v are adjacency[adjacencyOffsets[v], adjacencyOffsets[v + 1]):
+		vector<uint32_t> liveCounts(vertexCount, 0);
+		for (uint32_t i = 0; i < triangleCount * 3; ++i)
+		{
+			assert(indices[i] < vertexCount);
+			liveCounts[indices[i]]++;
+		}
+		vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+		for (uint32_t v = 0; v < vertexCount; ++v)
+		{
+			adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveCounts[v];
+		}
+		vector<uint32_t> adjacency(triangleCount * 3);
+		{
+			vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (uint32_t i = 0; i < triangleCount * 3; ++i)
+			{
+				adjacency[fill[indices[i]]++] = i / 3;
+			}
+		}
+
+		vector<uint32_t> cacheTimes(vertexCount, 0);
+		vector<uint8_t> emitted(triangleCount, 0);
+		vector<uint32_t> deadEnds;
+		deadEnds.reserve(triangleCount * 3);
+		vector<uint32_t> candidates;
+		vector<uint32_t> result;
+		result.reserve(triangleCount * 3);
+		vector<uint32_t> hardBoundaries;
+
+		uint32_t time = cacheSize + 1;
+		uint32_t cursor = 0;
+
+		// When the fan can't continue from a cached vertex, it continues from the most recently referenced vertex with triangles left,
+		//	or the next one in index order. Returns ~0 when every triangle is emitted:
+		auto skipDeadEnd = [&]() -> uint32_t {
+			while (!deadEnds.empty())
+			{
+				const uint32_t vertex = deadEnds.back();
+				deadEnds.pop_back();
+				if (liveCounts[vertex] > 0)
+				{
+					return vertex;
+				}
+			}
+			while (cursor < vertexCount)
+			{
+				if (liveCounts[cursor] > 0)
+				{
+					return cursor;
+				}
+				cursor++;
+			}
+			return ~0u;
+		};
+
+		uint32_t fanning = skipDeadEnd();
+		hardBoundaries.push_back(0);
+		while (fanning != ~0u)
+		{
+			// Emit every remaining triangle around the fanning vertex:
+			candidates.clear();
+			for (uint32_t i = adjacencyOffsets[fanning]; i < adjacencyOffsets[fanning + 1]; ++i)
+			{
+				const uint32_t t = adjacency[i];
+				if (emitted[t])
+				{
+					continue;
+				}
+				emitted[t] = 1;
+				for (uint32_t j = 0; j < 3; ++j)
+				{
+					const uint32_t vertex = indices[t * 3 + j];
+					result.push_back(vertex);
+					deadEnds.push_back(vertex);
+					candidates.push_back(vertex);
+					liveCounts[vertex]--;
+					if (time - cacheTimes[vertex] > cacheSize)
+					{
+						cacheTimes[vertex] = time++;
+					}
+				}
+			}
+
+			// The next fanning vertex is the oldest candidate that would still be in the cache after emitting its triangles:
+			uint32_t next = ~0u;
+			int bestPriority = -1;
+			for (uint32_t vertex : candidates)
+			{
+				if (liveCounts[vertex] == 0)
+				{
+					continue;
+				}
+				int priority = 0;
+				const uint32_t age = time - cacheTimes[vertex];
+				if (age + 2 * liveCounts[vertex] <= cacheSize)
+				{
+					priority = (int)age;
+				}
+				if (priority > bestPriority)
+				{
+					bestPriority = priority;
+					next = vertex;
+				}
+			}
+			if (next == ~0u)
+			{
+				next = skipDeadEnd();
+				if (next != ~0u)
+				{
+					hardBoundaries.push_back((uint32_t)result.size() / 3);
+				}
+			}
+			fanning = next;
+		}
+
+		assert(result.size() == triangleCount * 3);
+		std::copy(result.begin(), result.end(), indices);
+
+		if (clusters == nullptr)
+		{
+			return;
+		}
+
+		// The hard boundaries are split further where restarting the cache costs little, so that the overdraw optimization has finer clusters to sort:
+		hardBoundaries.push_back(triangleCount);
+		FifoCache cache(vertexCount, cacheSize);
+		for (size_t c = 0; c + 1 < hardBoundaries.size(); ++c)
+		{
+			const uint32_t first = hardBoundaries[c];
+			const uint32_t last = hardBoundaries[c + 1];
+
+			cache.Flush();
+			uint32_t misses = 0;
+			for (uint32_t t = first; t < last; ++t)
+			{
+				misses += cache.Triangle(&indices[t * 3]);
+			}
+			const float clusterACMR = (float)misses / (float)(last - first);
+
+			cache.Flush();
+			clusters->push_back(first);
+			uint32_t start = first;
+			misses = 0;
+			for (uint32_t t = first; t < last; ++t)
+			{
+				misses += cache.Triangle(&indices[t * 3]);
+				if (t + 1 < last && (float)misses <= (float)(t + 1 - start) * clusterACMR * OVERDRAW_THRESHOLD)
+				{
+					cache.Flush();
+					clusters->push_back(t + 1);
+					start = t + 1;
+					misses = 0;
+				}
+			}
+		}
+	}
+
+	void OptimizeOverdraw(uint32_t* indices, uint32_t indexCount, const float* positions, uint32_t vertexCount, uint32_t stride, const vector<uint32_t>& clusters)
+	{
+		const uint32_t triangleCount = indexCount / 3;
+		if (triangleCount == 0 || clusters.size() < 2)
+		{
+			return;
+		}
+
+		// Area weighted centroid and normal of every cluster and of the whole mesh:
+		struct ClusterSort
+		{
+			uint32_t first;
+			uint32_t count;
+			XMFLOAT3 centroid;
+			XMFLOAT3 normal;
+			float area;
+			float sortKey;
+		};
+		vector<ClusterSort> sorted(clusters.size());
+		XMFLOAT3 meshCentroid = XMFLOAT3(0, 0, 0);
+		float meshArea = 0;
+		for (size_t c = 0; c < clusters.size(); ++c)
+		{
+			ClusterSort& cluster = sorted[c];
+			cluster.first = clusters[c];
+			cluster.count = (c + 1 < clusters.size() ? clusters[c + 1] : triangleCount) - cluster.first;
+			assert(cluster.first + cluster.count <= triangleCount);
+
+			cluster.centroid = XMFLOAT3(0, 0, 0);
+			cluster.normal = XMFLOAT3(0, 0, 0);
+			cluster.area = 0;
+			for (uint32_t t = cluster.first; t < cluster.first + cluster.count; ++t)
+			{
+				assert(indices[t * 3 + 0] < vertexCount && indices[t * 3 + 1] < vertexCount && indices[t * 3 + 2] < vertexCount);
+				const XMFLOAT3 p0 = GetPosition(positions, stride, indices[t * 3 + 0]);
+				const XMFLOAT3 p1 = GetPosition(positions, stride, indices[t * 3 + 1]);
+				const XMFLOAT3 p2 = GetPosition(positions, stride, indices[t * 3 + 2]);
+				// Same orientation as Mesh::ComputeNormals(), it points to the front side:
+				const XMFLOAT3 e0 = XMFLOAT3(p2.x - p0.x, p2.y - p0.y, p2.z - p0.z);
+				const XMFLOAT3 e1 = XMFLOAT3(p1.x - p0.x, p1.y - p0.y, p1.z - p0.z);
+				const XMFLOAT3 faceNormal = XMFLOAT3(e0.y * e1.z - e0.z * e1.y, e0.z * e1.x - e0.x * e1.z, e0.x * e1.y - e0.y * e1.x);
+				const float faceArea = sqrtf(faceNormal.x * faceNormal.x + faceNormal.y * faceNormal.y + faceNormal.z * faceNormal.z) * 0.5f;
+
+				const float weight = faceArea / 3.0f;
+				cluster.centroid.x += (p0.x + p1.x + p2.x) * weight;
+				cluster.centroid.y += (p0.y + p1.y + p2.y) * weight;
+				cluster.centroid.z += (p0.z + p1.z + p2.z) * weight;
+				cluster.normal.x += faceNormal.x;
+				cluster.normal.y += faceNormal.y;
+				cluster.normal.z += faceNormal.z;
+				cluster.area += faceArea;
+			}
+
+			meshCentroid.x += cluster.centroid.x;
+			meshCentroid.y += cluster.centroid.y;
+			meshCentroid.z += cluster.centroid.z;
+			meshArea += cluster.area;
+		}
+		if (meshArea <= 0)
+		{
+			return;
+		}
+		meshCentroid.x /= meshArea;
+		meshCentroid.y /= meshArea;
+		meshCentroid.z /= meshArea;
+
+		// Clusters that face away from the center are more likely to occlude the rest of the mesh, they are drawn first:
+		for (ClusterSort& cluster : sorted)
+		{
+			const XMFLOAT3& n = cluster.normal;
+			const float normalLength = sqrtf(n.x * n.x + n.y * n.y + n.z * n.z);
+			if (cluster.area > 0 && normalLength > 0)
+			{
+				const XMFLOAT3 offset = XMFLOAT3(
+					cluster.centroid.x / cluster.area - meshCentroid.x,
+					cluster.centroid.y / cluster.area - meshCentroid.y,
+					cluster.centroid.z / cluster.area - meshCentroid.z
+				);
+				cluster.sortKey = (offset.x * n.x + offset.y * n.y + offset.z * n.z) / normalLength;
+			}
+			else
+			{
+				cluster.sortKey = -FLT_MAX;
+			}
+		}
+		std::stable_sort(sorted.begin(), sorted.end(), [](const ClusterSort& a, const ClusterSort& b) {
+			return a.sortKey > b.sortKey;
+		});
+
+		vector<uint32_t> result;
+		result.reserve(triangleCount * 3);
+		for (const ClusterSort& cluster : sorted)
+		{
+			result.insert(result.end(), indices + cluster.first * 3, indices + (cluster.first + cluster.count) * 3);
+		}
+		std::copy(result.begin(), result.end(), indices);
+	}
+
+	uint32_t OptimizeVertexFetch(uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, vector<uint32_t>& remap)
+	{
+		remap.assign(vertexCount, ~0u);
+
+		uint32_t next = 0;
+		for (uint32_t i = 0; i < indexCount; ++i)
+		{
+			uint32_t& index = indices[i];
+			assert(index < vertexCount);
+			if (remap[index] == ~0u)
+			{
+				remap[index] = next++;
+			}
+			index = remap[index];
+		}
+		const uint32_t referenced = next;
+
+		for (uint32_t v = 0; v < vertexCount; ++v)
+		{
+			if (remap[v] == ~0u)
+			{
+				remap[v] = next++;
+			}
+		}
+
+		return referenced;
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include "CommonInclude.h"
+
+#include <vector>
+
+// Mesh optimization: reorder the triangles for the post-transform vertex cache and less overdraw, reorder the vertices for fetch locality
+//	Triangles are reordered with Tipsify (Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"),
+//	the clusters of it are then sorted front to back by how likely they are to occlude the rest of the mesh.
+namespace wiMeshOptimizer
+{
+	// Cache size that the triangles are optimized for and the statistics are simulated with (FIFO, like most GPUs)
+	static const uint32_t CACHE_SIZE = 16;
+	// A cluster can be split where the cache efficiency up to that point is within this factor of the whole cluster's
+	static const float OVERDRAW_THRESHOLD = 1.05f;
+
+	struct CacheStats
+	{
+		uint32_t triangleCount = 0;
+		uint32_t vertexCount = 0;		// unique vertices referenced by the triangles
+		uint32_t transformCount = 0;	// vertex shader invocations (cache misses)
+
+		// Average cache miss ratio: transformed vertices per triangle (0.5 is ideal for large regular meshes, 3 is the worst)
+		float GetACMR() const { return triangleCount > 0 ? (float)transformCount / (float)triangleCount : 0.0f; }
+		// Average transformed vertex ratio: transformed vertices per vertex (1 is ideal)
+		float GetATVR() const { return vertexCount > 0 ? (float)transformCount / (float)vertexCount : 0.0f; }
+
+		CacheStats& operator+=(const CacheStats& other)
+		{
+			triangleCount += other.triangleCount;
+			vertexCount += other.vertexCount;
+			transformCount += other.transformCount;
+			return *this;
+		}
+	};
+
+	// Simulate a FIFO post-transform cache over a triangle list
+	CacheStats AnalyzeVertexCache(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize = CACHE_SIZE);
+
+	// Reorder the triangles for the post-transform vertex cache (Tipsify), in place
+	//	clusters			: optional, receives the first triangle of every cluster that can be reordered without hurting the cache much (see OptimizeOverdraw())
+	void OptimizeVertexCache(uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize = CACHE_SIZE, std::vector<uint32_t>* clusters = nullptr);
+	// Reorder the clusters of a vertex cache optimized triangle list so that the ones facing outwards from the mesh center are drawn first, in place
+	//	positions			: first vertex position, the vertices are stride bytes apart
+	//	clusters			: first triangle of every cluster, as returned by OptimizeVertexCache()
+	void OptimizeOverdraw(uint32_t* indices, uint32_t indexCount, const float* positions, uint32_t vertexCount, uint32_t stride, const std::vector<uint32_t>& clusters);
+	// Number the vertices in the order that the triangles first reference them, for vertex fetch locality. The indices are remapped in place.
+	//	remap				: receives the new index of every vertex, unreferenced vertices are moved after the referenced ones (in their original order)
+	//	Returns the number of referenced vertices.
+	uint32_t OptimizeVertexFetch(uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, std::vector<uint32_t>& remap);
+}
@@ -0,0 +1,531 @@
+#include "wiMeshlet.h"
+#include "wiFrustum.h"
+
+#include <cfloat>
+#include <cmath>
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+
+using namespace std;
+
+namespace wiMeshlet
+{
+	static inline XMFLOAT3 GetPosition(const float* positions, uint32_t stride, uint32_t index)
+	{
+		const float* p = (const float*)((const uint8_t*)positions + (size_t)index * stride);
+		return XMFLOAT3(p[0], p[1], p[2]);
+	}
+	static inline XMFLOAT3 Subtract(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z);
+	}
+	static inline float Dot(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+	static inline XMFLOAT3 Cross(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+	}
+	static inline float Length(const XMFLOAT3& a)
+	{
+		return sqrtf(Dot(a, a));
+	}
+	static inline XMFLOAT3 Normalize(const XMFLOAT3& a)
+	{
+		const float len = Length(a);
+		return len > 0 ? XMFLOAT3(a.x / len, a.y / len, a.z / len) : XMFLOAT3(0, 0, 0);
+	}
+	// Face normal with the same orientation as Mesh::ComputeNormals(), it points to the front side of the triangle
+	static inline XMFLOAT3 FaceNormal(const XMFLOAT3& p0, const XMFLOAT3& p1, const XMFLOAT3& p2)
+	{
+		return Cross(Subtract(p2, p0), Subtract(p1, p0));
+	}
+
+
+	void Build(uint32_t* indices, uint32_t indexCount, const float* positions, uint32_t vertexCount, uint32_t stride, vector<Meshlet>& meshlets,
+		uint32_t maxVertices, uint32_t maxTriangles)
+	{
+		assert(maxVertices >= 3 && maxTriangles > 0);
+
+		const uint32_t triangleCount = indexCount / 3;
+		if (triangleCount == 0)
+		{
+			return;
+		}
+
+		// Triangle centroids and unit normals drive the growth of the meshlets:
+		vector<XMFLOAT3> centroids(triangleCount);
+		vector<XMFLOAT3> normals(triangleCount);
+		for (uint32_t t = 0; t < triangleCount; ++t)
+		{
+			assert(indices[t * 3 + 0] < vertexCount && indices[t * 3 + 1] < vertexCount && indices[t * 3 + 2] < vertexCount);
+			const XMFLOAT3 p0 = GetPosition(positions, stride, indices[t * 3 + 0]);
+			const XMFLOAT3 p1 = GetPosition(positions, stride, indices[t * 3 + 1]);
+			const XMFLOAT3 p2 = GetPosition(positions, stride, indices[t * 3 + 2]);
+			centroids[t] = XMFLOAT3((p0.x + p1.x + p2.x) / 3.0f, (p0.y + p1.y + p2.y) / 3.0f, (p0.z + p1.z + p2.z) / 3.0f);
+			normals[t] = Normalize(FaceNormal(p0, p1, p2));
+		}
+
+		// Vertex -> triangle adjacency, the triangles of vertex v are adjacency[adjacencyOffsets[v], adjacencyOffsets[v + 1]):
+		vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+		for (uint32_t i = 0; i < triangleCount * 3; ++i)
+		{
+			adjacencyOffsets[indices[i] + 1]++;
+		}
+		for (uint32_t v = 0; v < vertexCount; ++v)
+		{
+			adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+		}
+		vector<uint32_t> adjacency(triangleCount * 3);
+		vector<uint32_t> liveCount(vertexCount); // triangles of the vertex that are not in a meshlet yet
+		{
+			vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (uint32_t t = 0; t < triangleCount; ++t)
+			{
+				for (uint32_t k = 0; k < 3; ++k)
+				{
+					adjacency[fill[indices[t * 3 + k]]++] = t;
+				}
+			}
+		}
+		for (uint32_t v = 0; v < vertexCount; ++v)
+		{
+			liveCount[v] = adjacencyOffsets[v + 1] - adjacencyOffsets[v];
+		}
+
+		vector<uint8_t> emitted(triangleCount, 0);
+		vector<uint32_t> vertexMeshlet(vertexCount, ~0u); // last meshlet that the vertex was added to
+		vector<uint32_t> order; // triangles in meshlet order
+		order.reserve(triangleCount);
+		vector<uint32_t> candidates; // triangles adjacent to the current meshlet, can contain emitted triangles and duplicates
+
+		const size_t firstMeshlet = meshlets.size();
+		uint32_t meshletID = 0;
+		uint32_t emittedCount = 0;
+		uint32_t scanCursor = 0;
+
+		Meshlet current;
+		XMFLOAT3 centroidSum = XMFLOAT3(0, 0, 0);
+		XMFLOAT3 normalSum = XMFLOAT3(0, 0, 0);
+		XMFLOAT3 boundsMin = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+		XMFLOAT3 boundsMax = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+		auto countNewVertices = [&](uint32_t t) {
+			return
+				(vertexMeshlet[indices[t * 3 + 0]] != meshletID ? 1u : 0u) +
+				(vertexMeshlet[indices[t * 3 + 1]] != meshletID ? 1u : 0u) +
+				(vertexMeshlet[indices[t * 3 + 2]] != meshletID ? 1u : 0u);
+		};
+		auto finishMeshlet = [&]() {
+			meshlets.push_back(current);
+			current = Meshlet();
+			current.triangleOffset = (uint32_t)order.size();
+			centroidSum = XMFLOAT3(0, 0, 0);
+			normalSum = XMFLOAT3(0, 0, 0);
+			boundsMin = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+			boundsMax = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+			meshletID++;
+		};
+		auto addTriangle = [&](uint32_t t) {
+			emitted[t] = 1;
+			emittedCount++;
+			order.push_back(t);
+			current.triangleCount++;
+			centroidSum = XMFLOAT3(centroidSum.x + centroids[t].x, centroidSum.y + centroids[t].y, centroidSum.z + centroids[t].z);
+			normalSum = XMFLOAT3(normalSum.x + normals[t].x, normalSum.y + normals[t].y, normalSum.z + normals[t].z);
+
+			for (uint32_t k = 0; k < 3; ++k)
+			{
+				const uint32_t v = indices[t * 3 + k];
+				liveCount[v]--;
+				if (vertexMeshlet[v] != meshletID)
+				{
+					vertexMeshlet[v] = meshletID;
+					current.vertexCount++;
+
+					const XMFLOAT3 p = GetPosition(positions, stride, v);
+					boundsMin = XMFLOAT3(min(boundsMin.x, p.x), min(boundsMin.y, p.y), min(boundsMin.z, p.z));
+					boundsMax = XMFLOAT3(max(boundsMax.x, p.x), max(boundsMax.y, p.y), max(boundsMax.z, p.z));
+
+					// The triangles of a new vertex become candidates:
+					for (uint32_t a = adjacencyOffsets[v]; a < adjacencyOffsets[v + 1]; ++a)
+					{
+						if (!emitted[adjacency[a]])
+						{
+							candidates.push_back(adjacency[a]);
+						}
+					}
+				}
+			}
+
+			if (current.triangleCount >= maxTriangles)
+			{
+				finishMeshlet();
+			}
+		};
+
+		while (emittedCount < triangleCount)
+		{
+			if (current.triangleCount == 0)
+			{
+				// Start the next meshlet next to the previous one if possible, so that neighbouring meshlets are close in the index list too:
+				uint32_t seed = ~0u;
+				for (uint32_t t : candidates)
+				{
+					if (!emitted[t])
+					{
+						seed = t;
+						break;
+					}
+				}
+				if (seed == ~0u)
+				{
+					while (emitted[scanCursor])
+					{
+						scanCursor++;
+					}
+					seed = scanCursor;
+				}
+				candidates.clear();
+				addTriangle(seed);
+				continue;
+			}
+
+			// Choose the candidate that adds the fewest new vertices, then the closest one that is facing the same way.
+			//	Triangles that use up the last triangle of a vertex are preferred, so that isolated triangles are not left behind.
+			const float invCount = 1.0f / current.triangleCount;
+			const XMFLOAT3 centroid = XMFLOAT3(centroidSum.x * invCount, centroidSum.y * invCount, centroidSum.z * invCount);
+			const XMFLOAT3 axis = Normalize(normalSum);
+			const float extent = max(Length(Subtract(boundsMax, boundsMin)) * 0.5f, FLT_EPSILON);
+			const float coneWeight = 0.25f;
+
+			uint32_t best = ~0u;
+			uint32_t bestPriority = ~0u;
+			float bestScore = FLT_MAX;
+			bool blocked = false; // a candidate didn't fit into the vertex limit
+			for (size_t c = 0; c < candidates.size();)
+			{
+				const uint32_t t = candidates[c];
+				if (emitted[t])
+				{
+					candidates[c] = candidates.back();
+					candidates.pop_back();
+					continue;
+				}
+				++c;
+
+				const uint32_t newVertices = countNewVertices(t);
+				if (current.vertexCount + newVertices > maxVertices)
+				{
+					blocked = true;
+					continue;
+				}
+				const bool finishesVertex = liveCount[indices[t * 3 + 0]] == 1 || liveCount[indices[t * 3 + 1]] == 1 || liveCount[indices[t * 3 + 2]] == 1;
+				const uint32_t priority = (newVertices > 0 && finishesVertex) ? newVertices - 1 : newVertices;
+				const float distance = Length(Subtract(centroids[t], centroid)) / extent;
+				const float spread = 1 - Dot(normals[t], axis);
+				const float score = (1 - coneWeight) * distance + coneWeight * spread;
+				if (priority < bestPriority || (priority == bestPriority && score < bestScore))
+				{
+					best = t;
+					bestPriority = priority;
+					bestScore = score;
+				}
+			}
+
+			if (best == ~0u && !blocked)
+			{
+				// The meshlet has no neighbours left (disconnected geometry), continue with the nearest of the next few triangles in index order:
+				while (emitted[scanCursor])
+				{
+					scanCursor++;
+				}
+				float bestDistance = FLT_MAX;
+				uint32_t found = 0;
+				for (uint32_t t = scanCursor; t < triangleCount && found < 32; ++t)
+				{
+					if (emitted[t])
+					{
+						continue;
+					}
+					found++;
+					if (current.vertexCount + countNewVertices(t) > maxVertices)
+					{
+						continue;
+					}
+					const float distance = Length(Subtract(centroids[t], centroid));
+					if (distance < bestDistance)
+					{
+						best = t;
+						bestDistance = distance;
+					}
+				}
+			}
+
+			if (best == ~0u)
+			{
+				finishMeshlet();
+				continue;
+			}
+
+			addTriangle(best);
+		}
+		if (current.triangleCount > 0)
+		{
+			finishMeshlet();
+		}
+
+		// Reorder the triangles into meshlet order, then compute the final bounds of every meshlet:
+		vector<uint32_t> reordered(triangleCount * 3);
+		for (uint32_t i = 0; i < triangleCount; ++i)
+		{
+			reordered[i * 3 + 0] = indices[order[i] * 3 + 0];
+			reordered[i * 3 + 1] = indices[order[i] * 3 + 1];
+			reordered[i * 3 + 2] = indices[order[i] * 3 + 2];
+		}
+		memcpy(indices, reordered.data(), reordered.size() * sizeof(uint32_t));
+
+		for (size_t i = firstMeshlet; i < meshlets.size(); ++i)
+		{
+			Meshlet& meshlet = meshlets[i];
+			ComputeBounds(indices + meshlet.triangleOffset * 3, meshlet.triangleCount, positions, stride, meshlet);
+		}
+	}
+
+	void ComputeBounds(const uint32_t* indices, uint32_t triangleCount, const float* positions, uint32_t stride, Meshlet& meshlet)
+	{
+		const uint32_t indexCount = triangleCount * 3;
+		if (indexCount == 0)
+		{
+			return;
+		}
+
+		// Box:
+		XMFLOAT3 _min = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+		XMFLOAT3 _max = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		for (uint32_t i = 0; i < indexCount; ++i)
+		{
+			const XMFLOAT3 p = GetPosition(positions, stride, indices[i]);
+			_min = XMFLOAT3(min(_min.x, p.x), min(_min.y, p.y), min(_min.z, p.z));
+			_max = XMFLOAT3(max(_max.x, p.x), max(_max.y, p.y), max(_max.z, p.z));
+		}
+		meshlet.aabbMin = _min;
+		meshlet.aabbMax = _max;
+
+		// Sphere (Ritter): start from two distant points, then grow the sphere to include the rest
+		{
+			const XMFLOAT3 p0 = GetPosition(positions, stride, indices[0]);
+			XMFLOAT3 a = p0;
+			float farthest = -1;
+			for (uint32_t i = 0; i < indexCount; ++i)
+			{
+				const XMFLOAT3 p = GetPosition(positions, stride, indices[i]);
+				const float d = Length(Subtract(p, p0));
+				if (d > farthest)
+				{
+					farthest = d;
+					a = p;
+				}
+			}
+			XMFLOAT3 b = a;
+			farthest = -1;
+			for (uint32_t i = 0; i < indexCount; ++i)
+			{
+				const XMFLOAT3 p = GetPosition(positions, stride, indices[i]);
+				const float d = Length(Subtract(p, a));
+				if (d > farthest)
+				{
+					farthest = d;
+					b = p;
+				}
+			}
+			XMFLOAT3 center = XMFLOAT3((a.x + b.x) * 0.5f, (a.y + b.y) * 0.5f, (a.z + b.z) * 0.5f);
+			float radius = farthest * 0.5f;
+			for (uint32_t i = 0; i < indexCount; ++i)
+			{
+				const XMFLOAT3 p = GetPosition(positions, stride, indices[i]);
+				const float d = Length(Subtract(p, center));
+				if (d > radius)
+				{
+					const float newRadius = (radius + d) * 0.5f;
+					const float k = (newRadius - radius) / d;
+					center = XMFLOAT3(center.x + (p.x - center.x) * k, center.y + (p.y - center.y) * k, center.z + (p.z - center.z) * k);
+					radius = newRadius;
+				}
+			}
+			meshlet.center = center;
+			meshlet.radius = radius;
+		}
+
+		// Normal cone: the axis is the average normal, the cutoff comes from the normal that deviates the most from it
+		XMFLOAT3 normalSum = XMFLOAT3(0, 0, 0);
+		for (uint32_t t = 0; t < triangleCount; ++t)
+		{
+			const XMFLOAT3 n = Normalize(FaceNormal(
+				GetPosition(positions, stride, indices[t * 3 + 0]),
+				GetPosition(positions, stride, indices[t * 3 + 1]),
+				GetPosition(positions, stride, indices[t * 3 + 2])));
+			normalSum = XMFLOAT3(normalSum.x + n.x, normalSum.y + n.y, normalSum.z + n.z);
+		}
+		const XMFLOAT3 axis = Normalize(normalSum);
+		meshlet.coneAxis = axis;
+		meshlet.coneApex = meshlet.center;
+		meshlet.coneCutoff = 1;
+
+		float minDot = 1;
+		for (uint32_t t = 0; t < triangleCount; ++t)
+		{
+			const XMFLOAT3 n = Normalize(FaceNormal(
+				GetPosition(positions, stride, indices[t * 3 + 0]),
+				GetPosition(positions, stride, indices[t * 3 + 1]),
+				GetPosition(positions, stride, indices[t * 3 + 2])));
+			if (Dot(n, n) > 0)
+			{
+				minDot = min(minDot, Dot(n, axis));
+			}
+		}
+		if (Dot(axis, axis) == 0 || minDot <= 0.1f)
+		{
+			// the cone would be wider than ~170 degrees, culling it is unlikely to ever succeed
+			return;
+		}
+
+		// Move the apex back along the axis until every triangle plane is in front of it, this makes the cone test conservative:
+		float maxT = 0;
+		for (uint32_t t = 0; t < triangleCount; ++t)
+		{
+			const XMFLOAT3 p0 = GetPosition(positions, stride, indices[t * 3 + 0]);
+			const XMFLOAT3 n = Normalize(FaceNormal(p0,
+				GetPosition(positions, stride, indices[t * 3 + 1]),
+				GetPosition(positions, stride, indices[t * 3 + 2])));
+			if (Dot(n, n) == 0)
+			{
+				continue;
+			}
+			const float dc = Dot(Subtract(meshlet.center, p0), n);
+			const float dn = Dot(axis, n);
+			maxT = max(maxT, dc / dn);
+		}
+		meshlet.coneApex = XMFLOAT3(meshlet.center.x - axis.x * maxT, meshlet.center.y - axis.y * maxT, meshlet.center.z - axis.z * maxT);
+		meshlet.coneCutoff = sqrtf(1 - minDot * minDot);
+	}
+
+	bool IsBackfacing(const Meshlet& meshlet, const XMFLOAT3& eye)
+	{
+		if (meshlet.coneCutoff >= 1)
+		{
+			return false;
+		}
+		const XMFLOAT3 direction = Subtract(meshlet.coneApex, eye);
+		const float distance = Length(direction);
+		return distance > 0 && Dot(direction, meshlet.coneAxis) >= meshlet.coneCutoff * distance;
+	}
+
+	uint32_t Cull(const Meshlet* meshlets, uint32_t meshletCount, const Frustum* frustum, const XMFLOAT3& eye, bool coneCulling,
+		vector<DrawRange>& ranges, uint32_t maxRanges, CullStats* stats)
+	{
+		assert(maxRanges > 0);
+
+		ranges.clear();
+		uint32_t testedTriangles = 0;
+		for (uint32_t i = 0; i < meshletCount; ++i)
+		{
+			const Meshlet& meshlet = meshlets[i];
+			testedTriangles += meshlet.triangleCount;
+
+			bool visible = true;
+			if (frustum != nullptr && (!frustum->CheckSphere(meshlet.center, meshlet.radius) || !frustum->CheckBox(meshlet.aabbMin, meshlet.aabbMax)))
+			{
+				visible = false;
+			}
+			else if (coneCulling && IsBackfacing(meshlet, eye))
+			{
+				visible = false;
+			}
+
+			if (!visible)
+			{
+				if (stats != nullptr)
+				{
+					stats->meshletsCulled++;
+				}
+				continue;
+			}
+
+			const uint32_t indexOffset = meshlet.triangleOffset * 3;
+			const uint32_t indexCount = meshlet.triangleCount * 3;
+			if (!ranges.empty() && ranges.back().indexOffset + ranges.back().indexCount == indexOffset)
+			{
+				ranges.back().indexCount += indexCount;
+			}
+			else
+			{
+				DrawRange range;
+				range.indexOffset = indexOffset;
+				range.indexCount = indexCount;
+				ranges.push_back(range);
+			}
+		}
+
+		if (ranges.size() > maxRanges)
+		{
+			// Too many draws, close the smallest gaps between the ranges. The culled meshlets inside the closed gaps are drawn.
+			//	First find the size of the largest gap that must be closed, then close the gaps in order up to that size:
+			const size_t mergeCount = ranges.size() - maxRanges;
+			vector<uint32_t> gaps(ranges.size() - 1);
+			for (size_t i = 0; i < gaps.size(); ++i)
+			{
+				gaps[i] = ranges[i + 1].indexOffset - (ranges[i].indexOffset + ranges[i].indexCount);
+			}
+			vector<uint32_t> sortedGaps = gaps;
+			nth_element(sortedGaps.begin(), sortedGaps.begin() + (mergeCount - 1), sortedGaps.end());
+			const uint32_t threshold = sortedGaps[mergeCount - 1];
+			size_t thresholdMerges = 0; // gaps equal to the threshold that can be closed
+			for (uint32_t gap : gaps)
+			{
+				thresholdMerges += gap < threshold ? 1 : 0;
+			}
+			thresholdMerges = mergeCount - thresholdMerges;
+
+			size_t count = 1;
+			for (size_t i = 1; i < ranges.size(); ++i)
+			{
+				const uint32_t gap = gaps[i - 1];
+				bool merge = gap < threshold;
+				if (!merge && gap == threshold && thresholdMerges > 0)
+				{
+					merge = true;
+					thresholdMerges--;
+				}
+
+				if (merge)
+				{
+					DrawRange& last = ranges[count - 1];
+					last.indexCount = ranges[i].indexOffset + ranges[i].indexCount - last.indexOffset;
+				}
+				else
+				{
+					ranges[count++] = ranges[i];
+				}
+			}
+			ranges.resize(count);
+		}
+
+		if (stats != nullptr)
+		{
+			// Culled triangles are the ones that are not drawn, closed gaps can contain culled meshlets:
+			uint32_t drawnTriangles = 0;
+			for (const DrawRange& range : ranges)
+			{
+				drawnTriangles += range.indexCount / 3;
+			}
+			stats->meshletCount += meshletCount;
+			stats->triangleCount += testedTriangles;
+			stats->trianglesCulled += testedTriangles - drawnTriangles;
+			stats->drawRanges += (uint32_t)ranges.size();
+		}
+		return (uint32_t)ranges.size();
+	}
+}
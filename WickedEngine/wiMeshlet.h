@@ -0,0 +1,77 @@
+#pragma once
+#include "CommonInclude.h"
+
+#include <vector>
+
+class Frustum;
+
+// Meshlets: small clusters of triangles with their own bounds, used for culling inside a mesh
+//	The builder reorders the triangles of an index list so that every meshlet is a contiguous range of it,
+//	this way the visible meshlets can be drawn from the original index buffer without any index copies.
+namespace wiMeshlet
+{
+	static const uint32_t MAX_VERTICES = 64;
+	static const uint32_t MAX_TRIANGLES = 124;
+	// Meshes with fewer triangles are not worth the culling, they are drawn whole
+	static const uint32_t MIN_MESH_TRIANGLES = 4096;
+
+	struct Meshlet
+	{
+		uint32_t subset = 0;			// mesh subset that the triangles belong to
+		uint32_t triangleOffset = 0;	// first triangle in the index list (of the subset)
+		uint32_t triangleCount = 0;
+		uint32_t vertexCount = 0;		// unique vertices referenced by the triangles
+
+		// Bounding sphere and box:
+		XMFLOAT3 center = XMFLOAT3(0, 0, 0);
+		float radius = 0;
+		XMFLOAT3 aabbMin = XMFLOAT3(0, 0, 0);
+		XMFLOAT3 aabbMax = XMFLOAT3(0, 0, 0);
+
+		// Normal cone: every triangle is backfacing when the eye is inside the cone that opens from the apex in the opposite direction
+		//	coneCutoff is 1 if the normals are too spread out, then the meshlet is never backface culled
+		XMFLOAT3 coneApex = XMFLOAT3(0, 0, 0);
+		XMFLOAT3 coneAxis = XMFLOAT3(0, 0, 0);
+		float coneCutoff = 1;
+	};
+
+	// A range of the index list that can be drawn with one draw call
+	struct DrawRange
+	{
+		uint32_t indexOffset;
+		uint32_t indexCount;
+	};
+
+	struct CullStats
+	{
+		uint32_t meshletCount = 0;
+		uint32_t meshletsCulled = 0;
+		uint32_t triangleCount = 0;
+		uint32_t trianglesCulled = 0;
+		uint32_t drawRanges = 0;
+
+		float GetMeshletCullRatio() const { return meshletCount > 0 ? (float)meshletsCulled / (float)meshletCount : 0.0f; }
+		float GetTriangleCullRatio() const { return triangleCount > 0 ? (float)trianglesCulled / (float)triangleCount : 0.0f; }
+	};
+
+	// Partition a triangle list into meshlets of at most maxVertices unique vertices and maxTriangles triangles.
+	//	The triangles are grown from neighbours that add the fewest new vertices, then by the distance and the normal spread.
+	//	indices				: triangle list, it is reordered so that every meshlet is a contiguous range of it
+	//	positions			: first vertex position, the vertices are stride bytes apart
+	//	meshlets			: the new meshlets are appended here, their triangle offsets are relative to the start of the index list
+	void Build(uint32_t* indices, uint32_t indexCount, const float* positions, uint32_t vertexCount, uint32_t stride, std::vector<Meshlet>& meshlets,
+		uint32_t maxVertices = MAX_VERTICES, uint32_t maxTriangles = MAX_TRIANGLES);
+	// Compute the bounds and normal cone of a meshlet from its triangles (the index list must start at the first triangle of the meshlet)
+	void ComputeBounds(const uint32_t* indices, uint32_t triangleCount, const float* positions, uint32_t stride, Meshlet& meshlet);
+
+	// Whether every triangle of the meshlet is facing away from the eye (eye in the meshlet's space)
+	bool IsBackfacing(const Meshlet& meshlet, const XMFLOAT3& eye);
+
+	// Cull a range of meshlets and merge the visible ones into draw ranges of the index list
+	//	frustum				: frustum in the meshlet's space, or nullptr to skip frustum culling
+	//	coneCulling			: backface culling by the normal cones, only valid if the triangles are drawn with backface culling
+	//	ranges				: output draw ranges, adjacent visible meshlets are merged. Above maxRanges the smallest gaps are closed (drawing the culled meshlets in them)
+	//	Returns the number of draw ranges, zero if every meshlet is culled.
+	uint32_t Cull(const Meshlet* meshlets, uint32_t meshletCount, const Frustum* frustum, const XMFLOAT3& eye, bool coneCulling,
+		std::vector<DrawRange>& ranges, uint32_t maxRanges, CullStats* stats = nullptr);
+}
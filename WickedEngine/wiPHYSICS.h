@@ -26,6 +26,7 @@ public:
 	};
 	static int softBodyIterationCount;
 	static bool rigidBodyPhysicsEnabled, softBodyPhysicsEnabled;
+	static float fixedTimeStep; // seconds simulated by one step, the simulation always advances in these steps
 protected:
 	std::vector<PhysicsTransform*> transforms;
 	bool firstRunWorld;
@@ -35,9 +36,12 @@ public:
 	void NextRunWorld(){firstRunWorld=false;}
 	int getObjectCount(){return registeredObjects+1;}
 
+	// Advance the game time by dt, the simulation catches up with it in fixed steps (it can run asynchronously)
 	virtual void Update(float dt)=0;
+	// Read the simulation results (getObject(), connectVerticesToSoftBody()) between these, they are not changed by the simulation meanwhile
 	virtual void MarkForRead()=0;
 	virtual void UnMarkForRead()=0;
+	// Modify the simulated world between these, the simulation doesn't step meanwhile
 	virtual void MarkForWrite()=0;
 	virtual void UnMarkForWrite()=0;
 	virtual void ClearWorld()=0;
@@ -68,6 +72,14 @@ public:
 
 	// add object to the simulation
 	virtual void registerObject(wiSceneComponents::Object* object) = 0;
+	// add many objects to the simulation, their collision shapes can be prepared together
+	virtual void registerObjects(wiSceneComponents::Object* const* objects, size_t count)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			registerObject(objects[i]);
+		}
+	}
 	// remove object from simulation
 	virtual void removeObject(wiSceneComponents::Object* object) = 0;
 };
@@ -23,7 +23,10 @@ void wiProfiler::EndFrame()
 	wiRenderer::GetDevice()->QueryEnd(&disjoint, GRAPHICSTHREAD_IMMEDIATE);
 	while(!wiRenderer::GetDevice()->QueryRead(&disjoint, GRAPHICSTHREAD_IMMEDIATE));
 
-	assert(rangeStack.empty() && "There was a range which was not ended!");
+	for (int i = 0; i < GRAPHICSTHREAD_COUNT; ++i)
+	{
+		assert(rangeStack[i].empty() && "There was a range which was not ended!");
+	}
 
 	if (disjoint.result_disjoint == FALSE)
 	{
@@ -53,6 +56,8 @@ void wiProfiler::BeginRange(const std::string& name, PROFILER_DOMAIN domain, GRA
 	if (!ENABLED)
 		return;
 
+	lock.lock();
+
 	if (ranges.find(name) == ranges.end())
 	{
 		Range* range = new Range;
@@ -85,39 +90,47 @@ void wiProfiler::BeginRange(const std::string& name, PROFILER_DOMAIN domain, GRA
 		ranges.insert(make_pair(name, range));
 	}
 
+	Range* range = ranges[name];
+
+	lock.unlock();
+
 	switch (domain)
 	{
 	case wiProfiler::DOMAIN_CPU:
-		ranges[name]->cpuBegin.record();
+		range->cpuBegin.record();
 		break;
 	case wiProfiler::DOMAIN_GPU:
-		wiRenderer::GetDevice()->QueryEnd(&ranges[name]->gpuBegin, threadID);
+		wiRenderer::GetDevice()->QueryEnd(&range->gpuBegin, threadID);
 		break;
 	default:
 		assert(0);
 		break;
 	}
 
-	rangeStack.push(name);
+	rangeStack[threadID].push(name);
 }
 void wiProfiler::EndRange(GRAPHICSTHREAD threadID)
 {
 	if (!ENABLED)
 		return;
 
-	assert(!rangeStack.empty() && "There is no range to end!");
-	const std::string& top = rangeStack.top();
+	assert(!rangeStack[threadID].empty() && "There is no range to end!");
+	const std::string& top = rangeStack[threadID].top();
+
+	lock.lock();
+	auto it = ranges.find(top);
+	Range* range = it != ranges.end() ? it->second : nullptr;
+	lock.unlock();
 
-	auto& it = ranges.find(top);
-	if (it != ranges.end())
+	if (range != nullptr)
 	{
-		switch (it->second->domain)
+		switch (range->domain)
 		{
 		case wiProfiler::DOMAIN_CPU:
-			it->second->cpuEnd.record();
+			range->cpuEnd.record();
 			break;
 		case wiProfiler::DOMAIN_GPU:
-			wiRenderer::GetDevice()->QueryEnd(&it->second->gpuEnd, threadID);
+			wiRenderer::GetDevice()->QueryEnd(&range->gpuEnd, threadID);
 			break;
 		default:
 			assert(0);
@@ -129,7 +142,7 @@ void wiProfiler::EndRange(GRAPHICSTHREAD threadID)
 		assert(0);
 	}
 
-	rangeStack.pop();
+	rangeStack[threadID].pop();
 }
 
 void wiProfiler::DrawData(int x, int y, GRAPHICSTHREAD threadID)
@@ -6,6 +6,7 @@
 #include "wiEnums.h"
 #include "wiTimer.h"
 #include "wiGraphicsResource.h"
+#include "wiSpinLock.h"
 
 class wiProfiler
 {
@@ -48,8 +49,10 @@ private:
 	wiProfiler();
 	~wiProfiler();
 
+	// Ranges can be recorded from multiple threads (one per graphics context), so every context has its own stack
 	std::unordered_map<std::string, Range*> ranges;
-	std::stack<std::string> rangeStack;
+	std::stack<std::string> rangeStack[GRAPHICSTHREAD_COUNT];
+	wiSpinLock lock;
 	wiGraphicsTypes::GPUQuery disjoint;
 };
 
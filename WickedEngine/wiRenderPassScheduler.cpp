@@ -0,0 +1,176 @@
+#include "wiRenderPassScheduler.h"
+#include "wiGraphicsDevice.h"
+#include "wiJobSystem.h"
+
+#include <algorithm>
+
+using namespace std;
+using namespace wiGraphicsTypes;
+
+wiRenderPassScheduler::PassID wiRenderPassScheduler::AddPass(const string& name, const RecordFunction& record, const vector<PassID>& dependencies, float cost)
+{
+	Pass pass;
+	pass.name = name;
+	pass.record = record;
+	pass.dependencies = dependencies;
+	pass.cost = max(cost, 0.0f);
+	pass.threadID = GRAPHICSTHREAD_IMMEDIATE;
+	passes.push_back(pass);
+	return (PassID)(passes.size() - 1);
+}
+
+void wiRenderPassScheduler::clear()
+{
+	passes.clear();
+	order.clear();
+	contextRanges.clear();
+}
+
+bool wiRenderPassScheduler::Compile(uint32_t contextCount)
+{
+	order.clear();
+	contextRanges.clear();
+
+	const uint32_t passCount = (uint32_t)passes.size();
+	if (passCount == 0)
+	{
+		return true;
+	}
+
+	// Topological sort. Of the passes whose dependencies are all ordered, the one that was added first comes next, so the order is deterministic:
+	vector<uint32_t> remainingDependencies(passCount, 0);
+	vector<vector<PassID>> dependents(passCount);
+	for (PassID i = 0; i < passCount; ++i)
+	{
+		for (PassID dependency : passes[i].dependencies)
+		{
+			assert(dependency < passCount && "Invalid render pass dependency!");
+			if (dependency >= passCount)
+			{
+				return false;
+			}
+			remainingDependencies[i]++;
+			dependents[dependency].push_back(i);
+		}
+	}
+
+	vector<PassID> ready;
+	for (PassID i = 0; i < passCount; ++i)
+	{
+		if (remainingDependencies[i] == 0)
+		{
+			ready.push_back(i);
+		}
+	}
+	while (!ready.empty())
+	{
+		auto next = min_element(ready.begin(), ready.end());
+		const PassID pass = *next;
+		ready.erase(next);
+		order.push_back(pass);
+
+		for (PassID dependent : dependents[pass])
+		{
+			if (--remainingDependencies[dependent] == 0)
+			{
+				ready.push_back(dependent);
+			}
+		}
+	}
+
+	if (order.size() != passCount)
+	{
+		// The passes left out are on a cycle
+		assert(0 && "Render pass dependencies have a cycle!");
+		order.clear();
+		return false;
+	}
+
+	// Split the ordered passes into contiguous ranges of similar cost, one for each context:
+	contextCount = max(1u, min(contextCount, min(passCount, (uint32_t)GRAPHICSTHREAD_COUNT - 1)));
+
+	float remainingCost = 0;
+	for (const Pass& pass : passes)
+	{
+		remainingCost += pass.cost;
+	}
+
+	ContextRange range;
+	range.threadID = (GRAPHICSTHREAD)(GRAPHICSTHREAD_IMMEDIATE + 1);
+	range.first = 0;
+	range.count = 0;
+	float rangeCost = 0;
+	float targetCost = remainingCost / contextCount;
+	for (uint32_t i = 0; i < passCount; ++i)
+	{
+		Pass& pass = passes[order[i]];
+		pass.threadID = range.threadID;
+		range.count++;
+		rangeCost += pass.cost;
+		remainingCost -= pass.cost;
+
+		const uint32_t contextsLeft = contextCount - (uint32_t)contextRanges.size() - 1;
+		const uint32_t passesLeft = passCount - i - 1;
+		if (contextsLeft > 0 && passesLeft > 0 && (rangeCost >= targetCost || passesLeft <= contextsLeft))
+		{
+			contextRanges.push_back(range);
+			range.threadID = (GRAPHICSTHREAD)(range.threadID + 1);
+			range.first = i + 1;
+			range.count = 0;
+			rangeCost = 0;
+			targetCost = remainingCost / contextsLeft;
+		}
+	}
+	contextRanges.push_back(range);
+
+	return true;
+}
+
+void wiRenderPassScheduler::Record(const ContextRange& range)
+{
+	if (contextBegin)
+	{
+		contextBegin(range.threadID);
+	}
+	for (uint32_t i = 0; i < range.count; ++i)
+	{
+		passes[order[range.first + i]].record(range.threadID);
+	}
+}
+
+void wiRenderPassScheduler::Execute(GraphicsDevice* device)
+{
+	if (order.empty())
+	{
+		return;
+	}
+
+	if (!device->CheckCapability(GraphicsDevice::GRAPHICSDEVICE_CAPABILITY_MULTITHREADED_RENDERING))
+	{
+		// Everything is recorded on the immediate context, which already has the state set up:
+		for (PassID pass : order)
+		{
+			passes[pass].record(GRAPHICSTHREAD_IMMEDIATE);
+		}
+		return;
+	}
+
+	wiJobSystem::context ctx;
+	for (const ContextRange& range : contextRanges)
+	{
+		wiJobSystem::Execute(ctx, [this, &range, device] {
+			Record(range);
+			device->FinishCommandList(range.threadID);
+		});
+	}
+
+	// The device submits every deferred context, so the unused ones are closed empty:
+	for (int i = GRAPHICSTHREAD_IMMEDIATE + 1 + (int)contextRanges.size(); i < GRAPHICSTHREAD_COUNT; ++i)
+	{
+		device->FinishCommandList((GRAPHICSTHREAD)i);
+	}
+
+	wiJobSystem::Wait(ctx);
+
+	device->ExecuteDeferredContexts();
+}
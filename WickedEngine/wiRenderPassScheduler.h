@@ -0,0 +1,66 @@
+#pragma once
+#include "CommonInclude.h"
+#include "wiEnums.h"
+
+#include <vector>
+#include <string>
+#include <functional>
+
+namespace wiGraphicsTypes
+{
+	class GraphicsDevice;
+}
+
+// Records render passes in parallel into the deferred contexts of the graphics device
+//	Passes declare which other passes they depend on. Compile() orders them by their dependencies and distributes the ordered list
+//	among the deferred contexts in contiguous ranges. The device submits the deferred contexts in GRAPHICSTHREAD order,
+//	so a pass is always submitted after its dependencies, while every context can be recorded on a different thread.
+class wiRenderPassScheduler
+{
+public:
+	typedef uint32_t PassID;
+	typedef std::function<void(GRAPHICSTHREAD threadID)> RecordFunction;
+
+	struct Pass
+	{
+		std::string name;
+		RecordFunction record;
+		std::vector<PassID> dependencies;
+		float cost;				// relative recording cost, used to balance the contexts
+		GRAPHICSTHREAD threadID;	// assigned by Compile()
+	};
+
+	// Add a pass. It will be submitted after the passes in dependencies
+	PassID AddPass(const std::string& name, const RecordFunction& record, const std::vector<PassID>& dependencies = std::vector<PassID>(), float cost = 1.0f);
+	// Add a dependency to an existing pass
+	void AddDependency(PassID pass, PassID dependency) { passes[pass].dependencies.push_back(dependency); }
+	// Called on every context before recording its passes, to set up the state that the passes expect (a deferred context starts with empty state)
+	void SetContextBegin(const RecordFunction& record) { contextBegin = record; }
+	void clear();
+
+	// Order the passes by their dependencies and assign them to at most contextCount contexts. Returns false if the dependencies have a cycle.
+	bool Compile(uint32_t contextCount = GRAPHICSTHREAD_COUNT - 1);
+	// Record and submit the compiled passes. If the device doesn't support multithreaded rendering, every pass is recorded on the immediate context in order.
+	void Execute(wiGraphicsTypes::GraphicsDevice* device);
+
+	const std::vector<Pass>& GetPasses() const { return passes; }
+	// Pass indices in submission order, valid after Compile()
+	const std::vector<PassID>& GetExecutionOrder() const { return order; }
+	// Number of contexts that received passes, valid after Compile()
+	uint32_t GetContextCount() const { return (uint32_t)contextRanges.size(); }
+
+private:
+	std::vector<Pass> passes;
+	std::vector<PassID> order;
+	// Range of the execution order recorded by each context
+	struct ContextRange
+	{
+		GRAPHICSTHREAD threadID;
+		uint32_t first;
+		uint32_t count;
+	};
+	std::vector<ContextRange> contextRanges;
+	RecordFunction contextBegin;
+
+	void Record(const ContextRange& range);
+};
@@ -0,0 +1,222 @@
+#include "wiRenderQueue.h"
+
+#include <cstring>
+
+using namespace std;
+
+// Depth buckets are the upper 16 bits of the distance as a float: sign, exponent and 7 bits of mantissa.
+//	For non-negative floats the bit pattern grows with the value, so the buckets are ordered and have a relative precision of 1/128.
+static inline uint16_t GetDepthBucket(float distance)
+{
+	if (!(distance > 0))
+	{
+		return 0;
+	}
+	uint32_t bits;
+	memcpy(&bits, &distance, sizeof(bits));
+	return (uint16_t)(bits >> 16);
+}
+
+uint16_t wiRenderQueue::IDMap::Get(const void* object)
+{
+	if (object == nullptr)
+	{
+		return 0; // reserved, null is the empty slot of the table so it can't be stored
+	}
+	if (object == lastObject)
+	{
+		return lastID;
+	}
+
+	if ((count + 1) * 2 > objects.size())
+	{
+		// Grow and reinsert, the ids are kept:
+		vector<const void*> oldObjects;
+		vector<uint16_t> oldIDs;
+		oldObjects.swap(objects);
+		oldIDs.swap(ids);
+
+		const size_t capacity = max((size_t)64, oldObjects.size() * 2);
+		objects.assign(capacity, nullptr);
+		ids.resize(capacity);
+		for (size_t i = 0; i < oldObjects.size(); ++i)
+		{
+			if (oldObjects[i] != nullptr)
+			{
+				size_t slot = ((uintptr_t)oldObjects[i] >> 4) * 0x9E3779B1u & (capacity - 1);
+				while (objects[slot] != nullptr)
+				{
+					slot = (slot + 1) & (capacity - 1);
+				}
+				objects[slot] = oldObjects[i];
+				ids[slot] = oldIDs[i];
+			}
+		}
+	}
+
+	const size_t mask = objects.size() - 1;
+	size_t slot = ((uintptr_t)object >> 4) * 0x9E3779B1u & mask;
+	while (objects[slot] != nullptr && objects[slot] != object)
+	{
+		slot = (slot + 1) & mask;
+	}
+	if (objects[slot] == nullptr)
+	{
+		// The id saturates, so with more than 65534 different objects the last ones are not separated by the sort.
+		//	The batches are still correct, because they compare the objects themselves.
+		objects[slot] = object;
+		ids[slot] = (uint16_t)min(count + 1, 0xFFFFu);
+		count++;
+	}
+
+	lastObject = object;
+	lastID = ids[slot];
+	return lastID;
+}
+
+void wiRenderQueue::IDMap::clear()
+{
+	if (count > 0)
+	{
+		std::fill(objects.begin(), objects.end(), nullptr);
+	}
+	count = 0;
+	lastObject = nullptr;
+	lastID = 0;
+}
+
+void wiRenderQueue::Add(const void* pso, const void* material, const void* mesh, float distance, uint32_t payload)
+{
+	Entry entry;
+	entry.key = 0;
+	entry.pso = pso;
+	entry.material = material;
+	entry.mesh = mesh;
+	entry.payload = payload;
+	entry.psoID = psoIDs.Get(pso);
+	entry.materialID = materialIDs.Get(material);
+	entry.meshID = meshIDs.Get(mesh);
+	entry.depth = GetDepthBucket(distance);
+	entries.push_back(entry);
+}
+
+void wiRenderQueue::Sort(SORT_MODE mode)
+{
+	batches.clear();
+
+	const size_t count = entries.size();
+	if (count == 0)
+	{
+		return;
+	}
+
+	// Build the keys, the most significant bits decide first:
+	for (Entry& entry : entries)
+	{
+		switch (mode)
+		{
+		case SORT_BACK_TO_FRONT:
+			entry.key =
+				((uint64_t)(0xFFFF - entry.depth) << 48) |
+				((uint64_t)entry.psoID << 32) |
+				((uint64_t)entry.materialID << 16) |
+				((uint64_t)entry.meshID);
+			break;
+		case SORT_STATE:
+		default:
+			entry.key =
+				((uint64_t)entry.psoID << 48) |
+				((uint64_t)entry.materialID << 32) |
+				((uint64_t)entry.meshID << 16) |
+				((uint64_t)entry.depth);
+			break;
+		}
+	}
+
+	// Least significant digit radix sort, one byte per pass. Passes where every key has the same digit are skipped,
+	//	which is common for the upper bytes of the ids when there are only a few different state objects.
+	static const int passCount = sizeof(uint64_t);
+	uint32_t histogram[passCount][256] = {};
+	for (const Entry& entry : entries)
+	{
+		for (int pass = 0; pass < passCount; ++pass)
+		{
+			histogram[pass][(entry.key >> (pass * 8)) & 0xFF]++;
+		}
+	}
+
+	sortTemp.resize(count);
+	Entry* src = entries.data();
+	Entry* dst = sortTemp.data();
+	for (int pass = 0; pass < passCount; ++pass)
+	{
+		const int shift = pass * 8;
+		const uint32_t* digitCounts = histogram[pass];
+		if (digitCounts[(src[0].key >> shift) & 0xFF] == count)
+		{
+			continue;
+		}
+
+		uint32_t offsets[256];
+		uint32_t offset = 0;
+		for (int digit = 0; digit < 256; ++digit)
+		{
+			offsets[digit] = offset;
+			offset += digitCounts[digit];
+		}
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			dst[offsets[(src[i].key >> shift) & 0xFF]++] = src[i];
+		}
+
+		std::swap(src, dst);
+	}
+	if (src != entries.data())
+	{
+		entries.swap(sortTemp);
+	}
+
+	Batch batch;
+	batch.pso = entries[0].pso;
+	batch.material = entries[0].material;
+	batch.offset = 0;
+	batch.count = 0;
+	for (const Entry& entry : entries)
+	{
+		if (entry.pso != batch.pso || entry.material != batch.material)
+		{
+			batches.push_back(batch);
+			batch.pso = entry.pso;
+			batch.material = entry.material;
+			batch.offset += batch.count;
+			batch.count = 0;
+		}
+		batch.count++;
+	}
+	batches.push_back(batch);
+}
+
+void wiRenderQueue::clear()
+{
+	entries.clear();
+	batches.clear();
+	psoIDs.clear();
+	materialIDs.clear();
+	meshIDs.clear();
+}
+
+uint32_t wiRenderQueue::GetMeshChangeCount() const
+{
+	uint32_t changes = 0;
+	const void* prevMesh = nullptr;
+	for (const Entry& entry : entries)
+	{
+		if (entry.mesh != prevMesh)
+		{
+			changes++;
+			prevMesh = entry.mesh;
+		}
+	}
+	return changes;
+}
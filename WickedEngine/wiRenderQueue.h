@@ -0,0 +1,77 @@
+#pragma once
+#include "CommonInclude.h"
+
+#include <vector>
+
+// Sorted list of draw calls
+//	Every draw is described by its state objects (pipeline state, material, mesh), its distance to the camera and a user payload.
+//	The draws are radix sorted by a 64 bit key built from these, so draws that share state end up next to each other.
+//	The queue only works with opaque pointers, so it doesn't need a graphics device.
+class wiRenderQueue
+{
+public:
+	enum SORT_MODE
+	{
+		// Group by pipeline state, then material, then mesh. Draws with the same state are sorted front to back
+		SORT_STATE,
+		// Sort back to front first (for blending), then by state inside the same depth bucket
+		SORT_BACK_TO_FRONT,
+	};
+
+	struct Entry
+	{
+		uint64_t key;
+		const void* pso;
+		const void* material;
+		const void* mesh;
+		uint32_t payload;
+		// Dense ids of the state objects and the depth bucket, these make up the sort key
+		uint16_t psoID;
+		uint16_t materialID;
+		uint16_t meshID;
+		uint16_t depth;
+	};
+	// Consecutive sorted entries that use the same pipeline state and material
+	struct Batch
+	{
+		const void* pso;
+		const void* material;
+		uint32_t offset;
+		uint32_t count;
+	};
+
+	void Add(const void* pso, const void* material, const void* mesh, float distance, uint32_t payload);
+	// Sort the entries and build the batches. Must be called after adding entries and before iterating them.
+	//	The sort is stable, entries with the same key keep the order in which they were added.
+	void Sort(SORT_MODE mode = SORT_STATE);
+	void clear();
+	bool empty() const { return entries.empty(); }
+	size_t size() const { return entries.size(); }
+
+	const std::vector<Entry>& GetEntries() const { return entries; }
+	const std::vector<Batch>& GetBatches() const { return batches; }
+	// Number of times the mesh changes when drawing the sorted entries in order
+	uint32_t GetMeshChangeCount() const;
+
+private:
+	std::vector<Entry> entries;
+	std::vector<Entry> sortTemp;
+	std::vector<Batch> batches;
+
+	// Assigns 16 bit ids to state objects in the order of first use, with an open addressing hash table.
+	//	The last lookup is cached, because consecutive draws often share state. Null objects always get id 0.
+	struct IDMap
+	{
+		std::vector<const void*> objects;
+		std::vector<uint16_t> ids;
+		uint32_t count = 0;
+		const void* lastObject = nullptr;
+		uint16_t lastID = 0;
+
+		uint16_t Get(const void* object);
+		void clear();
+	};
+	IDMap psoIDs;
+	IDMap materialIDs;
+	IDMap meshIDs;
+};
@@ -21,6 +21,8 @@
 #include "wiBackLog.h"
 #include "wiProfiler.h"
 #include "wiOcean.h"
+#include "wiJobSystem.h"
+#include "wiRenderQueue.h"
 #include "ShaderInterop_CloudGenerator.h"
 #include "ShaderInterop_Skinning.h"
 #include "ShaderInterop_TracedRendering.h"
@@ -28,6 +30,7 @@
 #include "ShaderInterop_Utility.h"
 #include "wiWidget.h"
 #include "wiGPUSortLib.h"
+#include "wiSoftwareOcclusion.h"
 
 #include <algorithm>
 
@@ -55,7 +58,7 @@ GPUBuffer			*wiRenderer::resourceBuffers[RBTYPE_LAST];
 Texture				*wiRenderer::textures[TEXTYPE_LAST];
 Sampler				*wiRenderer::customsamplers[SSTYPE_LAST];
 
-GPURingBuffer		*wiRenderer::dynamicVertexBufferPool;
+GPURingBuffer		*wiRenderer::dynamicVertexBufferPools[GRAPHICSTHREAD_COUNT] = {};
 
 float wiRenderer::GAMMA = 2.2f;
 int wiRenderer::SHADOWRES_2D = 1024, wiRenderer::SHADOWRES_CUBE = 256, wiRenderer::SHADOWCOUNT_2D = 5 + 3 + 3, wiRenderer::SHADOWCOUNT_CUBE = 5, wiRenderer::SOFTSHADOWQUALITY_2D = 2;
@@ -80,6 +83,8 @@ Texture2D* wiRenderer::enviroMap = nullptr;
 float wiRenderer::GameSpeed=1;
 bool wiRenderer::debugLightCulling = false;
 bool wiRenderer::occlusionCulling = false;
+bool wiRenderer::softwareOcclusionCulling = false;
+bool wiRenderer::meshletCulling = true;
 bool wiRenderer::temporalAA = false, wiRenderer::temporalAADEBUG = false;
 wiRenderer::VoxelizedSceneData wiRenderer::voxelSceneData = VoxelizedSceneData();
 Camera *wiRenderer::cam = nullptr, *wiRenderer::refCam = nullptr, *wiRenderer::prevFrameCam = nullptr;
@@ -87,6 +92,7 @@ PHYSICS* wiRenderer::physicsEngine = nullptr;
 wiOcean* wiRenderer::ocean = nullptr;
 
 string wiRenderer::SHADERPATH = "shaders/";
+string wiRenderer::PIPELINECACHEPATH = "pipelinecache.bin";
 #pragma endregion
 
 #pragma region STATIC TEMP
@@ -207,6 +213,7 @@ void wiRenderer::SetUpStaticComponents()
 
 	SetUpStates();
 	LoadBuffers();
+	GetDevice()->LoadPipelineCache(PIPELINECACHEPATH);
 	LoadShaders();
 	
 	wiHairParticle::SetUpStatic();
@@ -288,7 +295,10 @@ void wiRenderer::CleanUpStatic()
 		SAFE_DELETE(customsamplers[i]);
 	}
 
-	SAFE_DELETE(dynamicVertexBufferPool);
+	for (int i = 0; i < GRAPHICSTHREAD_COUNT; ++i)
+	{
+		SAFE_DELETE(dynamicVertexBufferPools[i]);
+	}
 
 	if (physicsEngine) physicsEngine->CleanUp();
 
@@ -492,14 +502,19 @@ void wiRenderer::LoadBuffers()
 	GPUBufferDesc bd;
 
 	// Ring buffer allows fast allocation of dynamic buffers for one frame:
-	dynamicVertexBufferPool = new GPURingBuffer;
+	//	Every context that can record in parallel has its own, because allocations are not thread safe
 	bd.BindFlags = BIND_VERTEX_BUFFER;
 	bd.ByteWidth = 1024 * 1024 * 64;
 	bd.Usage = USAGE_DYNAMIC;
 	bd.CPUAccessFlags = CPU_ACCESS_WRITE;
 	bd.MiscFlags = 0;
-	GetDevice()->CreateBuffer(&bd, nullptr, dynamicVertexBufferPool);
-	GetDevice()->SetName(dynamicVertexBufferPool, "DynamicVertexBufferPool");
+	const int dynamicVertexBufferPoolCount = GetDevice()->CheckCapability(GraphicsDevice::GRAPHICSDEVICE_CAPABILITY_MULTITHREADED_RENDERING) ? GRAPHICSTHREAD_COUNT : 1;
+	for (int i = 0; i < dynamicVertexBufferPoolCount; ++i)
+	{
+		dynamicVertexBufferPools[i] = new GPURingBuffer;
+		GetDevice()->CreateBuffer(&bd, nullptr, dynamicVertexBufferPools[i]);
+		GetDevice()->SetName(dynamicVertexBufferPools[i], "DynamicVertexBufferPool");
+	}
 
 
 	for (int i = 0; i < CBTYPE_LAST; ++i)
@@ -602,7 +617,7 @@ void wiRenderer::LoadBuffers()
 	bd.StructureByteStride = sizeof(XMMATRIX);
 	GetDevice()->CreateBuffer(&bd, nullptr, resourceBuffers[RBTYPE_MATRIXARRAY]);
 
-	SAFE_DELETE(resourceBuffers[RBTYPE_VOXELSCENE]); // lazy init on request
+	SAFE_DELETE(resourceBuffers[RBTYPE_VOXELSCENE]); // created by UpdateRenderData() when voxel GI is enabled
 }
 
 enum OBJECTRENDERING_DOUBLESIDED
@@ -1184,20 +1199,23 @@ void wiRenderer::LoadShaders()
 {
 	GraphicsDevice* device = GetDevice();
 
+	// Shader files are loaded and created in parallel, then the pipeline states are created in parallel after all of them finished
+	wiJobSystem::context ctx;
+
 	for (int i = 0; i < VLTYPE_LAST; ++i)
 	{
 		vertexLayouts[i] = new VertexLayout;
 	}
 
-	{
+	wiJobSystem::Execute(ctx, [device] {
 		VertexLayoutDesc layout[] =
 		{
 			{ "POSITION_NORMAL_WIND_MATID",	0, Mesh::Vertex_POS::FORMAT, 0, APPEND_ALIGNED_ELEMENT, INPUT_PER_VERTEX_DATA, 0 },
 		};
 		vertexShaders[VSTYPE_OBJECT_DEBUG] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectVS_debug.cso", wiResourceManager::VERTEXSHADER));
 		device->CreateInputLayout(layout, ARRAYSIZE(layout), vertexShaders[VSTYPE_OBJECT_DEBUG]->code.data, vertexShaders[VSTYPE_OBJECT_DEBUG]->code.size, vertexLayouts[VLTYPE_OBJECT_DEBUG]);
-	}
-	{
+	});
+	wiJobSystem::Execute(ctx, [device] {
 		VertexLayoutDesc layout[] =
 		{
 			{ "POSITION_NORMAL_WIND_MATID",	0, Mesh::Vertex_POS::FORMAT, 0, APPEND_ALIGNED_ELEMENT, INPUT_PER_VERTEX_DATA, 0 },
@@ -1215,8 +1233,8 @@ void wiRenderer::LoadShaders()
 		vertexShaders[VSTYPE_OBJECT_COMMON] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectVS_common.cso", wiResourceManager::VERTEXSHADER));
 		device->CreateInputLayout(layout, ARRAYSIZE(layout), vertexShaders[VSTYPE_OBJECT_COMMON]->code.data, vertexShaders[VSTYPE_OBJECT_COMMON]->code.size, vertexLayouts[VLTYPE_OBJECT_ALL]);
 		
-	}
-	{
+	});
+	wiJobSystem::Execute(ctx, [device] {
 		VertexLayoutDesc layout[] =
 		{
 			{ "POSITION_NORMAL_WIND_MATID",	0, Mesh::Vertex_POS::FORMAT, 0, APPEND_ALIGNED_ELEMENT, INPUT_PER_VERTEX_DATA, 0 },
@@ -1229,8 +1247,8 @@ void wiRenderer::LoadShaders()
 		vertexShaders[VSTYPE_OBJECT_POSITIONSTREAM] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectVS_positionstream.cso", wiResourceManager::VERTEXSHADER));
 		device->CreateInputLayout(layout, ARRAYSIZE(layout), vertexShaders[VSTYPE_OBJECT_POSITIONSTREAM]->code.data, vertexShaders[VSTYPE_OBJECT_POSITIONSTREAM]->code.size, vertexLayouts[VLTYPE_OBJECT_POS]);
 
-	}
-	{
+	});
+	wiJobSystem::Execute(ctx, [device] {
 		VertexLayoutDesc layout[] =
 		{
 			{ "POSITION_NORMAL_WIND_MATID",	0, Mesh::Vertex_POS::FORMAT, 0, APPEND_ALIGNED_ELEMENT, INPUT_PER_VERTEX_DATA, 0 },
@@ -1244,8 +1262,8 @@ void wiRenderer::LoadShaders()
 		vertexShaders[VSTYPE_OBJECT_SIMPLE] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectVS_simple.cso", wiResourceManager::VERTEXSHADER));
 		device->CreateInputLayout(layout, ARRAYSIZE(layout), vertexShaders[VSTYPE_OBJECT_SIMPLE]->code.data, vertexShaders[VSTYPE_OBJECT_SIMPLE]->code.size, vertexLayouts[VLTYPE_OBJECT_POS_TEX]);
 
-	}
-	{
+	});
+	wiJobSystem::Execute(ctx, [device] {
 		VertexLayoutDesc layout[] =
 		{
 			{ "POSITION_NORMAL_WIND_MATID",	0, Mesh::Vertex_POS::FORMAT, 0, APPEND_ALIGNED_ELEMENT, INPUT_PER_VERTEX_DATA, 0 },
@@ -1258,8 +1276,8 @@ void wiRenderer::LoadShaders()
 		vertexShaders[VSTYPE_SHADOW] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "shadowVS.cso", wiResourceManager::VERTEXSHADER));
 		device->CreateInputLayout(layout, ARRAYSIZE(layout), vertexShaders[VSTYPE_SHADOW]->code.data, vertexShaders[VSTYPE_SHADOW]->code.size, vertexLayouts[VLTYPE_SHADOW_POS]);
 
-	}
-	{
+	});
+	wiJobSystem::Execute(ctx, [device] {
 		VertexLayoutDesc layout[] =
 		{
 			{ "POSITION_NORMAL_WIND_MATID",	0, Mesh::Vertex_POS::FORMAT, 0, APPEND_ALIGNED_ELEMENT, INPUT_PER_VERTEX_DATA, 0 },
@@ -1276,9 +1294,9 @@ void wiRenderer::LoadShaders()
 
 		vertexShaders[VSTYPE_SHADOW_TRANSPARENT] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "shadowVS_transparent.cso", wiResourceManager::VERTEXSHADER));
 
-	}
+	});
 
-	{
+	wiJobSystem::Execute(ctx, [device] {
 		VertexLayoutDesc layout[] =
 		{
 			{ "POSITION", 0, FORMAT_R32G32B32A32_FLOAT, 0, APPEND_ALIGNED_ELEMENT, INPUT_PER_VERTEX_DATA, 0 },
@@ -1287,9 +1305,9 @@ void wiRenderer::LoadShaders()
 		vertexShaders[VSTYPE_LINE] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "linesVS.cso", wiResourceManager::VERTEXSHADER));
 		device->CreateInputLayout(layout, ARRAYSIZE(layout), vertexShaders[VSTYPE_LINE]->code.data, vertexShaders[VSTYPE_LINE]->code.size, vertexLayouts[VLTYPE_LINE]);
 
-	}
+	});
 
-	{
+	wiJobSystem::Execute(ctx, [device] {
 		VertexLayoutDesc layout[] =
 		{
 			{ "POSITION", 0, FORMAT_R32G32B32_FLOAT, 0, APPEND_ALIGNED_ELEMENT, INPUT_PER_VERTEX_DATA, 0 },
@@ -1299,166 +1317,167 @@ void wiRenderer::LoadShaders()
 		vertexShaders[VSTYPE_TRAIL] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "trailVS.cso", wiResourceManager::VERTEXSHADER));
 		device->CreateInputLayout(layout, ARRAYSIZE(layout), vertexShaders[VSTYPE_TRAIL]->code.data, vertexShaders[VSTYPE_TRAIL]->code.size, vertexLayouts[VLTYPE_TRAIL]);
 
-	}
+	});
 
-	vertexShaders[VSTYPE_OBJECT_COMMON_TESSELLATION] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectVS_common_tessellation.cso", wiResourceManager::VERTEXSHADER));
-	vertexShaders[VSTYPE_OBJECT_SIMPLE_TESSELLATION] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectVS_simple_tessellation.cso", wiResourceManager::VERTEXSHADER));
-	vertexShaders[VSTYPE_DIRLIGHT] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "dirLightVS.cso", wiResourceManager::VERTEXSHADER));
-	vertexShaders[VSTYPE_POINTLIGHT] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "pointLightVS.cso", wiResourceManager::VERTEXSHADER));
-	vertexShaders[VSTYPE_SPOTLIGHT] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "spotLightVS.cso", wiResourceManager::VERTEXSHADER));
-	vertexShaders[VSTYPE_LIGHTVISUALIZER_SPOTLIGHT] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "vSpotLightVS.cso", wiResourceManager::VERTEXSHADER));
-	vertexShaders[VSTYPE_LIGHTVISUALIZER_POINTLIGHT] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "vPointLightVS.cso", wiResourceManager::VERTEXSHADER));
-	vertexShaders[VSTYPE_LIGHTVISUALIZER_SPHERELIGHT] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "vSphereLightVS.cso", wiResourceManager::VERTEXSHADER));
-	vertexShaders[VSTYPE_LIGHTVISUALIZER_DISCLIGHT] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "vDiscLightVS.cso", wiResourceManager::VERTEXSHADER));
-	vertexShaders[VSTYPE_LIGHTVISUALIZER_RECTANGLELIGHT] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "vRectangleLightVS.cso", wiResourceManager::VERTEXSHADER));
-	vertexShaders[VSTYPE_LIGHTVISUALIZER_TUBELIGHT] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "vTubeLightVS.cso", wiResourceManager::VERTEXSHADER));
-	vertexShaders[VSTYPE_DECAL] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "decalVS.cso", wiResourceManager::VERTEXSHADER));
-	vertexShaders[VSTYPE_ENVMAP] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "envMapVS.cso", wiResourceManager::VERTEXSHADER));
-	vertexShaders[VSTYPE_ENVMAP_SKY] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "envMap_skyVS.cso", wiResourceManager::VERTEXSHADER));
-	vertexShaders[VSTYPE_SPHERE] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "sphereVS.cso", wiResourceManager::VERTEXSHADER));
-	vertexShaders[VSTYPE_CUBE] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "cubeVS.cso", wiResourceManager::VERTEXSHADER));
-	vertexShaders[VSTYPE_SHADOWCUBEMAPRENDER] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "cubeShadowVS.cso", wiResourceManager::VERTEXSHADER));
-	vertexShaders[VSTYPE_SHADOWCUBEMAPRENDER_ALPHATEST] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "cubeShadowVS_alphatest.cso", wiResourceManager::VERTEXSHADER));
-	vertexShaders[VSTYPE_SKY] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "skyVS.cso", wiResourceManager::VERTEXSHADER));
-	vertexShaders[VSTYPE_WATER] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "waterVS.cso", wiResourceManager::VERTEXSHADER));
-	vertexShaders[VSTYPE_VOXELIZER] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectVS_voxelizer.cso", wiResourceManager::VERTEXSHADER));
-	vertexShaders[VSTYPE_VOXEL] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "voxelVS.cso", wiResourceManager::VERTEXSHADER));
-	vertexShaders[VSTYPE_FORCEFIELDVISUALIZER_POINT] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "forceFieldPointVisualizerVS.cso", wiResourceManager::VERTEXSHADER));
-	vertexShaders[VSTYPE_FORCEFIELDVISUALIZER_PLANE] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "forceFieldPlaneVisualizerVS.cso", wiResourceManager::VERTEXSHADER));
-
-
-	pixelShaders[PSTYPE_OBJECT_DEFERRED] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_deferred.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_OBJECT_DEFERRED_NORMALMAP] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_deferred_normalmap.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_OBJECT_DEFERRED_POM] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_deferred_pom.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_OBJECT_DEFERRED_NORMALMAP_POM] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_deferred_normalmap_pom.cso", wiResourceManager::PIXELSHADER));
-
-	pixelShaders[PSTYPE_OBJECT_FORWARD] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_forward.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_OBJECT_FORWARD_NORMALMAP] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_forward_normalmap.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_OBJECT_FORWARD_TRANSPARENT] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_forward_transparent.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_OBJECT_FORWARD_TRANSPARENT_NORMALMAP] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_forward_transparent_normalmap.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_OBJECT_FORWARD_PLANARREFLECTION] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_forward_planarreflection.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_OBJECT_FORWARD_NORMALMAP_PLANARREFLECTION] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_forward_normalmap_planarreflection.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_OBJECT_FORWARD_TRANSPARENT_PLANARREFLECTION] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_forward_transparent_planarreflection.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_OBJECT_FORWARD_TRANSPARENT_NORMALMAP_PLANARREFLECTION] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_forward_transparent_normalmap_planarreflection.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_OBJECT_FORWARD_POM] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_forward_pom.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_OBJECT_FORWARD_NORMALMAP_POM] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_forward_normalmap_pom.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_OBJECT_FORWARD_TRANSPARENT_POM] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_forward_transparent_pom.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_OBJECT_FORWARD_TRANSPARENT_NORMALMAP_POM] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_forward_transparent_normalmap_pom.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_OBJECT_FORWARD_WATER] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_forward_water.cso", wiResourceManager::PIXELSHADER));
-
-	pixelShaders[PSTYPE_OBJECT_TILEDFORWARD] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_tiledforward.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_OBJECT_TILEDFORWARD_NORMALMAP] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_tiledforward_normalmap.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_OBJECT_TILEDFORWARD_TRANSPARENT] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_tiledforward_transparent.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_OBJECT_TILEDFORWARD_TRANSPARENT_NORMALMAP] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_tiledforward_transparent_normalmap.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_OBJECT_TILEDFORWARD_PLANARREFLECTION] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_tiledforward_planarreflection.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_OBJECT_TILEDFORWARD_NORMALMAP_PLANARREFLECTION] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_tiledforward_normalmap_planarreflection.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_OBJECT_TILEDFORWARD_TRANSPARENT_PLANARREFLECTION] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_tiledforward_transparent_planarreflection.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_OBJECT_TILEDFORWARD_TRANSPARENT_NORMALMAP_PLANARREFLECTION] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_tiledforward_transparent_normalmap_planarreflection.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_OBJECT_TILEDFORWARD_POM] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_tiledforward_pom.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_OBJECT_TILEDFORWARD_NORMALMAP_POM] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_tiledforward_normalmap_pom.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_OBJECT_TILEDFORWARD_TRANSPARENT_POM] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_tiledforward_transparent_pom.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_OBJECT_TILEDFORWARD_TRANSPARENT_NORMALMAP_POM] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_tiledforward_transparent_normalmap_pom.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_OBJECT_TILEDFORWARD_WATER] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_tiledforward_water.cso", wiResourceManager::PIXELSHADER));
-
-	pixelShaders[PSTYPE_OBJECT_HOLOGRAM] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_hologram.cso", wiResourceManager::PIXELSHADER));
-
-
-	pixelShaders[PSTYPE_OBJECT_DEBUG] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_debug.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_OBJECT_SIMPLEST] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_simplest.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_OBJECT_BLACKOUT] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_blackout.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_OBJECT_TEXTUREONLY] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_textureonly.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_OBJECT_ALPHATESTONLY] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_alphatestonly.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_ENVIRONMENTALLIGHT] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "environmentalLightPS.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_DIRLIGHT] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "dirLightPS.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_POINTLIGHT] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "pointLightPS.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_SPOTLIGHT] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "spotLightPS.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_SPHERELIGHT] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "sphereLightPS.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_DISCLIGHT] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "discLightPS.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_RECTANGLELIGHT] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "rectangleLightPS.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_TUBELIGHT] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "tubeLightPS.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_LIGHTVISUALIZER] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "lightVisualizerPS.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_VOLUMETRICLIGHT_DIRECTIONAL] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "volumetricLight_DirectionalPS.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_VOLUMETRICLIGHT_POINT] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "volumetricLight_PointPS.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_VOLUMETRICLIGHT_SPOT] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "volumetricLight_SpotPS.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_DECAL] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "decalPS.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_ENVMAP] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "envMapPS.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_ENVMAP_SKY_STATIC] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "envMap_skyPS_static.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_ENVMAP_SKY_DYNAMIC] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "envMap_skyPS_dynamic.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_CAPTUREIMPOSTOR] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "captureImpostorPS.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_CUBEMAP] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "cubemapPS.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_LINE] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "linesPS.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_SKY_STATIC] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "skyPS_static.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_SKY_DYNAMIC] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "skyPS_dynamic.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_SUN] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "sunPS.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_SHADOW_ALPHATEST] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "shadowPS_alphatest.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_SHADOW_TRANSPARENT] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "shadowPS_transparent.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_SHADOW_WATER] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "shadowPS_water.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_SHADOWCUBEMAPRENDER] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "cubeShadowPS.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_SHADOWCUBEMAPRENDER_ALPHATEST] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "cubeShadowPS_alphatest.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_TRAIL] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "trailPS.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_VOXELIZER] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_voxelizer.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_VOXEL] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "voxelPS.cso", wiResourceManager::PIXELSHADER));
-	pixelShaders[PSTYPE_FORCEFIELDVISUALIZER] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "forceFieldVisualizerPS.cso", wiResourceManager::PIXELSHADER));
-
-	geometryShaders[GSTYPE_ENVMAP] = static_cast<GeometryShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "envMapGS.cso", wiResourceManager::GEOMETRYSHADER));
-	geometryShaders[GSTYPE_ENVMAP_SKY] = static_cast<GeometryShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "envMap_skyGS.cso", wiResourceManager::GEOMETRYSHADER));
-	geometryShaders[GSTYPE_SHADOWCUBEMAPRENDER] = static_cast<GeometryShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "cubeShadowGS.cso", wiResourceManager::GEOMETRYSHADER));
-	geometryShaders[GSTYPE_SHADOWCUBEMAPRENDER_ALPHATEST] = static_cast<GeometryShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "cubeShadowGS_alphatest.cso", wiResourceManager::GEOMETRYSHADER));
-	geometryShaders[GSTYPE_VOXELIZER] = static_cast<GeometryShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectGS_voxelizer.cso", wiResourceManager::GEOMETRYSHADER));
-	geometryShaders[GSTYPE_VOXEL] = static_cast<GeometryShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "voxelGS.cso", wiResourceManager::GEOMETRYSHADER));
-
-
-	computeShaders[CSTYPE_LUMINANCE_PASS1] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "luminancePass1CS.cso", wiResourceManager::COMPUTESHADER));
-	computeShaders[CSTYPE_LUMINANCE_PASS2] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "luminancePass2CS.cso", wiResourceManager::COMPUTESHADER));
-	computeShaders[CSTYPE_TILEFRUSTUMS] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "tileFrustumsCS.cso", wiResourceManager::COMPUTESHADER));
-	computeShaders[CSTYPE_RESOLVEMSAADEPTHSTENCIL] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "resolveMSAADepthStencilCS.cso", wiResourceManager::COMPUTESHADER));
-	computeShaders[CSTYPE_VOXELSCENECOPYCLEAR] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "voxelSceneCopyClearCS.cso", wiResourceManager::COMPUTESHADER));
-	computeShaders[CSTYPE_VOXELSCENECOPYCLEAR_TEMPORALSMOOTHING] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "voxelSceneCopyClear_TemporalSmoothing.cso", wiResourceManager::COMPUTESHADER));
-	computeShaders[CSTYPE_VOXELRADIANCESECONDARYBOUNCE] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "voxelRadianceSecondaryBounceCS.cso", wiResourceManager::COMPUTESHADER));
-	computeShaders[CSTYPE_VOXELCLEARONLYNORMAL] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "voxelClearOnlyNormalCS.cso", wiResourceManager::COMPUTESHADER));
-	computeShaders[CSTYPE_GENERATEMIPCHAIN2D_UNORM4_SIMPLEFILTER] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "generateMIPChain2D_unorm4_SimpleFilterCS.cso", wiResourceManager::COMPUTESHADER));
-	computeShaders[CSTYPE_GENERATEMIPCHAIN2D_FLOAT4_SIMPLEFILTER] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "generateMIPChain2D_float4_SimpleFilterCS.cso", wiResourceManager::COMPUTESHADER));
-	computeShaders[CSTYPE_GENERATEMIPCHAIN2D_UNORM4_GAUSSIAN] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "generateMIPChain2D_unorm4_GaussianCS.cso", wiResourceManager::COMPUTESHADER));
-	computeShaders[CSTYPE_GENERATEMIPCHAIN2D_FLOAT4_GAUSSIAN] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "generateMIPChain2D_float4_GaussianCS.cso", wiResourceManager::COMPUTESHADER));
-	computeShaders[CSTYPE_GENERATEMIPCHAIN3D_UNORM4_SIMPLEFILTER] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "generateMIPChain3D_unorm4_SimpleFilterCS.cso", wiResourceManager::COMPUTESHADER));
-	computeShaders[CSTYPE_GENERATEMIPCHAIN3D_FLOAT4_SIMPLEFILTER] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "generateMIPChain3D_float4_SimpleFilterCS.cso", wiResourceManager::COMPUTESHADER));
-	computeShaders[CSTYPE_GENERATEMIPCHAIN3D_UNORM4_GAUSSIAN] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "generateMIPChain3D_unorm4_GaussianCS.cso", wiResourceManager::COMPUTESHADER));
-	computeShaders[CSTYPE_GENERATEMIPCHAIN3D_FLOAT4_GAUSSIAN] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "generateMIPChain3D_float4_GaussianCS.cso", wiResourceManager::COMPUTESHADER));
-	computeShaders[CSTYPE_GENERATEMIPCHAINCUBE_UNORM4_SIMPLEFILTER] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "generateMIPChainCube_unorm4_SimpleFilterCS.cso", wiResourceManager::COMPUTESHADER));
-	computeShaders[CSTYPE_GENERATEMIPCHAINCUBE_FLOAT4_SIMPLEFILTER] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "generateMIPChainCube_float4_SimpleFilterCS.cso", wiResourceManager::COMPUTESHADER));
-	computeShaders[CSTYPE_GENERATEMIPCHAINCUBEARRAY_UNORM4_SIMPLEFILTER] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "generateMIPChainCubeArray_unorm4_SimpleFilterCS.cso", wiResourceManager::COMPUTESHADER));
-	computeShaders[CSTYPE_GENERATEMIPCHAINCUBEARRAY_FLOAT4_SIMPLEFILTER] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "generateMIPChainCubeArray_float4_SimpleFilterCS.cso", wiResourceManager::COMPUTESHADER));
-	computeShaders[CSTYPE_FILTERENVMAP] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "filterEnvMapCS.cso", wiResourceManager::COMPUTESHADER));
-	computeShaders[CSTYPE_COPYTEXTURE2D_UNORM4] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "copytexture2D_unorm4CS.cso", wiResourceManager::COMPUTESHADER));
-	computeShaders[CSTYPE_COPYTEXTURE2D_UNORM4_BORDEREXPAND] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "copytexture2D_unorm4_borderexpandCS.cso", wiResourceManager::COMPUTESHADER));
-	computeShaders[CSTYPE_SKINNING] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "skinningCS.cso", wiResourceManager::COMPUTESHADER));
-	computeShaders[CSTYPE_SKINNING_LDS] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "skinningCS_LDS.cso", wiResourceManager::COMPUTESHADER));
-	computeShaders[CSTYPE_CLOUDGENERATOR] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "cloudGeneratorCS.cso", wiResourceManager::COMPUTESHADER));
-	computeShaders[CSTYPE_BVH_RESET] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "bvh_resetCS.cso", wiResourceManager::COMPUTESHADER));
-	computeShaders[CSTYPE_BVH_CLASSIFICATION] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "bvh_classificationCS.cso", wiResourceManager::COMPUTESHADER));
-	computeShaders[CSTYPE_BVH_KICKJOBS] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "bvh_kickjobsCS.cso", wiResourceManager::COMPUTESHADER));
-	computeShaders[CSTYPE_BVH_CLUSTERPROCESSOR] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "bvh_clusterprocessorCS.cso", wiResourceManager::COMPUTESHADER));
-	computeShaders[CSTYPE_BVH_HIERARCHY] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "bvh_hierarchyCS.cso", wiResourceManager::COMPUTESHADER));
-	computeShaders[CSTYPE_BVH_PROPAGATEAABB] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "bvh_propagateaabbCS.cso", wiResourceManager::COMPUTESHADER));
-	computeShaders[CSTYPE_RAYTRACE_CLEAR] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "raytrace_clearCS.cso", wiResourceManager::COMPUTESHADER));
-	computeShaders[CSTYPE_RAYTRACE_LAUNCH] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "raytrace_launchCS.cso", wiResourceManager::COMPUTESHADER));
-	computeShaders[CSTYPE_RAYTRACE_KICKJOBS] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "raytrace_kickjobsCS.cso", wiResourceManager::COMPUTESHADER));
-	computeShaders[CSTYPE_RAYTRACE_PRIMARY] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "raytrace_primaryCS.cso", wiResourceManager::COMPUTESHADER));
-	computeShaders[CSTYPE_RAYTRACE_LIGHTSAMPLING] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "raytrace_lightsamplingCS.cso", wiResourceManager::COMPUTESHADER));
-
-
-	hullShaders[HSTYPE_OBJECT] = static_cast<HullShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectHS.cso", wiResourceManager::HULLSHADER));
-
-
-	domainShaders[DSTYPE_OBJECT] = static_cast<DomainShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectDS.cso", wiResourceManager::DOMAINSHADER));
-
-
-	vector<thread> thread_pool(0);
-
-	thread_pool.push_back(thread([&] {
-		// default objectshaders:
-		for (int shaderType = 0; shaderType < SHADERTYPE_COUNT; ++shaderType)
-		{
+	wiJobSystem::Execute(ctx, [] { vertexShaders[VSTYPE_OBJECT_COMMON_TESSELLATION] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectVS_common_tessellation.cso", wiResourceManager::VERTEXSHADER)); });
+	wiJobSystem::Execute(ctx, [] { vertexShaders[VSTYPE_OBJECT_SIMPLE_TESSELLATION] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectVS_simple_tessellation.cso", wiResourceManager::VERTEXSHADER)); });
+	wiJobSystem::Execute(ctx, [] { vertexShaders[VSTYPE_DIRLIGHT] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "dirLightVS.cso", wiResourceManager::VERTEXSHADER)); });
+	wiJobSystem::Execute(ctx, [] { vertexShaders[VSTYPE_POINTLIGHT] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "pointLightVS.cso", wiResourceManager::VERTEXSHADER)); });
+	wiJobSystem::Execute(ctx, [] { vertexShaders[VSTYPE_SPOTLIGHT] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "spotLightVS.cso", wiResourceManager::VERTEXSHADER)); });
+	wiJobSystem::Execute(ctx, [] { vertexShaders[VSTYPE_LIGHTVISUALIZER_SPOTLIGHT] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "vSpotLightVS.cso", wiResourceManager::VERTEXSHADER)); });
+	wiJobSystem::Execute(ctx, [] { vertexShaders[VSTYPE_LIGHTVISUALIZER_POINTLIGHT] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "vPointLightVS.cso", wiResourceManager::VERTEXSHADER)); });
+	wiJobSystem::Execute(ctx, [] { vertexShaders[VSTYPE_LIGHTVISUALIZER_SPHERELIGHT] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "vSphereLightVS.cso", wiResourceManager::VERTEXSHADER)); });
+	wiJobSystem::Execute(ctx, [] { vertexShaders[VSTYPE_LIGHTVISUALIZER_DISCLIGHT] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "vDiscLightVS.cso", wiResourceManager::VERTEXSHADER)); });
+	wiJobSystem::Execute(ctx, [] { vertexShaders[VSTYPE_LIGHTVISUALIZER_RECTANGLELIGHT] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "vRectangleLightVS.cso", wiResourceManager::VERTEXSHADER)); });
+	wiJobSystem::Execute(ctx, [] { vertexShaders[VSTYPE_LIGHTVISUALIZER_TUBELIGHT] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "vTubeLightVS.cso", wiResourceManager::VERTEXSHADER)); });
+	wiJobSystem::Execute(ctx, [] { vertexShaders[VSTYPE_DECAL] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "decalVS.cso", wiResourceManager::VERTEXSHADER)); });
+	wiJobSystem::Execute(ctx, [] { vertexShaders[VSTYPE_ENVMAP] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "envMapVS.cso", wiResourceManager::VERTEXSHADER)); });
+	wiJobSystem::Execute(ctx, [] { vertexShaders[VSTYPE_ENVMAP_SKY] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "envMap_skyVS.cso", wiResourceManager::VERTEXSHADER)); });
+	wiJobSystem::Execute(ctx, [] { vertexShaders[VSTYPE_SPHERE] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "sphereVS.cso", wiResourceManager::VERTEXSHADER)); });
+	wiJobSystem::Execute(ctx, [] { vertexShaders[VSTYPE_CUBE] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "cubeVS.cso", wiResourceManager::VERTEXSHADER)); });
+	wiJobSystem::Execute(ctx, [] { vertexShaders[VSTYPE_SHADOWCUBEMAPRENDER] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "cubeShadowVS.cso", wiResourceManager::VERTEXSHADER)); });
+	wiJobSystem::Execute(ctx, [] { vertexShaders[VSTYPE_SHADOWCUBEMAPRENDER_ALPHATEST] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "cubeShadowVS_alphatest.cso", wiResourceManager::VERTEXSHADER)); });
+	wiJobSystem::Execute(ctx, [] { vertexShaders[VSTYPE_SKY] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "skyVS.cso", wiResourceManager::VERTEXSHADER)); });
+	wiJobSystem::Execute(ctx, [] { vertexShaders[VSTYPE_WATER] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "waterVS.cso", wiResourceManager::VERTEXSHADER)); });
+	wiJobSystem::Execute(ctx, [] { vertexShaders[VSTYPE_VOXELIZER] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectVS_voxelizer.cso", wiResourceManager::VERTEXSHADER)); });
+	wiJobSystem::Execute(ctx, [] { vertexShaders[VSTYPE_VOXEL] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "voxelVS.cso", wiResourceManager::VERTEXSHADER)); });
+	wiJobSystem::Execute(ctx, [] { vertexShaders[VSTYPE_FORCEFIELDVISUALIZER_POINT] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "forceFieldPointVisualizerVS.cso", wiResourceManager::VERTEXSHADER)); });
+	wiJobSystem::Execute(ctx, [] { vertexShaders[VSTYPE_FORCEFIELDVISUALIZER_PLANE] = static_cast<VertexShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "forceFieldPlaneVisualizerVS.cso", wiResourceManager::VERTEXSHADER)); });
+
+
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_OBJECT_DEFERRED] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_deferred.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_OBJECT_DEFERRED_NORMALMAP] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_deferred_normalmap.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_OBJECT_DEFERRED_POM] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_deferred_pom.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_OBJECT_DEFERRED_NORMALMAP_POM] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_deferred_normalmap_pom.cso", wiResourceManager::PIXELSHADER)); });
+
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_OBJECT_FORWARD] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_forward.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_OBJECT_FORWARD_NORMALMAP] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_forward_normalmap.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_OBJECT_FORWARD_TRANSPARENT] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_forward_transparent.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_OBJECT_FORWARD_TRANSPARENT_NORMALMAP] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_forward_transparent_normalmap.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_OBJECT_FORWARD_PLANARREFLECTION] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_forward_planarreflection.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_OBJECT_FORWARD_NORMALMAP_PLANARREFLECTION] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_forward_normalmap_planarreflection.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_OBJECT_FORWARD_TRANSPARENT_PLANARREFLECTION] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_forward_transparent_planarreflection.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_OBJECT_FORWARD_TRANSPARENT_NORMALMAP_PLANARREFLECTION] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_forward_transparent_normalmap_planarreflection.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_OBJECT_FORWARD_POM] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_forward_pom.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_OBJECT_FORWARD_NORMALMAP_POM] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_forward_normalmap_pom.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_OBJECT_FORWARD_TRANSPARENT_POM] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_forward_transparent_pom.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_OBJECT_FORWARD_TRANSPARENT_NORMALMAP_POM] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_forward_transparent_normalmap_pom.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_OBJECT_FORWARD_WATER] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_forward_water.cso", wiResourceManager::PIXELSHADER)); });
+
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_OBJECT_TILEDFORWARD] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_tiledforward.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_OBJECT_TILEDFORWARD_NORMALMAP] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_tiledforward_normalmap.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_OBJECT_TILEDFORWARD_TRANSPARENT] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_tiledforward_transparent.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_OBJECT_TILEDFORWARD_TRANSPARENT_NORMALMAP] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_tiledforward_transparent_normalmap.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_OBJECT_TILEDFORWARD_PLANARREFLECTION] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_tiledforward_planarreflection.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_OBJECT_TILEDFORWARD_NORMALMAP_PLANARREFLECTION] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_tiledforward_normalmap_planarreflection.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_OBJECT_TILEDFORWARD_TRANSPARENT_PLANARREFLECTION] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_tiledforward_transparent_planarreflection.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_OBJECT_TILEDFORWARD_TRANSPARENT_NORMALMAP_PLANARREFLECTION] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_tiledforward_transparent_normalmap_planarreflection.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_OBJECT_TILEDFORWARD_POM] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_tiledforward_pom.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_OBJECT_TILEDFORWARD_NORMALMAP_POM] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_tiledforward_normalmap_pom.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_OBJECT_TILEDFORWARD_TRANSPARENT_POM] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_tiledforward_transparent_pom.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_OBJECT_TILEDFORWARD_TRANSPARENT_NORMALMAP_POM] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_tiledforward_transparent_normalmap_pom.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_OBJECT_TILEDFORWARD_WATER] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_tiledforward_water.cso", wiResourceManager::PIXELSHADER)); });
+
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_OBJECT_HOLOGRAM] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_hologram.cso", wiResourceManager::PIXELSHADER)); });
+
+
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_OBJECT_DEBUG] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_debug.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_OBJECT_SIMPLEST] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_simplest.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_OBJECT_BLACKOUT] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_blackout.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_OBJECT_TEXTUREONLY] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_textureonly.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_OBJECT_ALPHATESTONLY] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_alphatestonly.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_ENVIRONMENTALLIGHT] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "environmentalLightPS.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_DIRLIGHT] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "dirLightPS.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_POINTLIGHT] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "pointLightPS.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_SPOTLIGHT] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "spotLightPS.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_SPHERELIGHT] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "sphereLightPS.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_DISCLIGHT] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "discLightPS.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_RECTANGLELIGHT] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "rectangleLightPS.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_TUBELIGHT] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "tubeLightPS.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_LIGHTVISUALIZER] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "lightVisualizerPS.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_VOLUMETRICLIGHT_DIRECTIONAL] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "volumetricLight_DirectionalPS.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_VOLUMETRICLIGHT_POINT] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "volumetricLight_PointPS.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_VOLUMETRICLIGHT_SPOT] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "volumetricLight_SpotPS.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_DECAL] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "decalPS.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_ENVMAP] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "envMapPS.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_ENVMAP_SKY_STATIC] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "envMap_skyPS_static.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_ENVMAP_SKY_DYNAMIC] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "envMap_skyPS_dynamic.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_CAPTUREIMPOSTOR] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "captureImpostorPS.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_CUBEMAP] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "cubemapPS.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_LINE] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "linesPS.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_SKY_STATIC] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "skyPS_static.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_SKY_DYNAMIC] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "skyPS_dynamic.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_SUN] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "sunPS.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_SHADOW_ALPHATEST] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "shadowPS_alphatest.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_SHADOW_TRANSPARENT] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "shadowPS_transparent.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_SHADOW_WATER] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "shadowPS_water.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_SHADOWCUBEMAPRENDER] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "cubeShadowPS.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_SHADOWCUBEMAPRENDER_ALPHATEST] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "cubeShadowPS_alphatest.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_TRAIL] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "trailPS.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_VOXELIZER] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectPS_voxelizer.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_VOXEL] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "voxelPS.cso", wiResourceManager::PIXELSHADER)); });
+	wiJobSystem::Execute(ctx, [] { pixelShaders[PSTYPE_FORCEFIELDVISUALIZER] = static_cast<PixelShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "forceFieldVisualizerPS.cso", wiResourceManager::PIXELSHADER)); });
+
+	wiJobSystem::Execute(ctx, [] { geometryShaders[GSTYPE_ENVMAP] = static_cast<GeometryShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "envMapGS.cso", wiResourceManager::GEOMETRYSHADER)); });
+	wiJobSystem::Execute(ctx, [] { geometryShaders[GSTYPE_ENVMAP_SKY] = static_cast<GeometryShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "envMap_skyGS.cso", wiResourceManager::GEOMETRYSHADER)); });
+	wiJobSystem::Execute(ctx, [] { geometryShaders[GSTYPE_SHADOWCUBEMAPRENDER] = static_cast<GeometryShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "cubeShadowGS.cso", wiResourceManager::GEOMETRYSHADER)); });
+	wiJobSystem::Execute(ctx, [] { geometryShaders[GSTYPE_SHADOWCUBEMAPRENDER_ALPHATEST] = static_cast<GeometryShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "cubeShadowGS_alphatest.cso", wiResourceManager::GEOMETRYSHADER)); });
+	wiJobSystem::Execute(ctx, [] { geometryShaders[GSTYPE_VOXELIZER] = static_cast<GeometryShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectGS_voxelizer.cso", wiResourceManager::GEOMETRYSHADER)); });
+	wiJobSystem::Execute(ctx, [] { geometryShaders[GSTYPE_VOXEL] = static_cast<GeometryShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "voxelGS.cso", wiResourceManager::GEOMETRYSHADER)); });
+
+
+	wiJobSystem::Execute(ctx, [] { computeShaders[CSTYPE_LUMINANCE_PASS1] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "luminancePass1CS.cso", wiResourceManager::COMPUTESHADER)); });
+	wiJobSystem::Execute(ctx, [] { computeShaders[CSTYPE_LUMINANCE_PASS2] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "luminancePass2CS.cso", wiResourceManager::COMPUTESHADER)); });
+	wiJobSystem::Execute(ctx, [] { computeShaders[CSTYPE_TILEFRUSTUMS] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "tileFrustumsCS.cso", wiResourceManager::COMPUTESHADER)); });
+	wiJobSystem::Execute(ctx, [] { computeShaders[CSTYPE_RESOLVEMSAADEPTHSTENCIL] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "resolveMSAADepthStencilCS.cso", wiResourceManager::COMPUTESHADER)); });
+	wiJobSystem::Execute(ctx, [] { computeShaders[CSTYPE_VOXELSCENECOPYCLEAR] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "voxelSceneCopyClearCS.cso", wiResourceManager::COMPUTESHADER)); });
+	wiJobSystem::Execute(ctx, [] { computeShaders[CSTYPE_VOXELSCENECOPYCLEAR_TEMPORALSMOOTHING] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "voxelSceneCopyClear_TemporalSmoothing.cso", wiResourceManager::COMPUTESHADER)); });
+	wiJobSystem::Execute(ctx, [] { computeShaders[CSTYPE_VOXELRADIANCESECONDARYBOUNCE] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "voxelRadianceSecondaryBounceCS.cso", wiResourceManager::COMPUTESHADER)); });
+	wiJobSystem::Execute(ctx, [] { computeShaders[CSTYPE_VOXELCLEARONLYNORMAL] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "voxelClearOnlyNormalCS.cso", wiResourceManager::COMPUTESHADER)); });
+	wiJobSystem::Execute(ctx, [] { computeShaders[CSTYPE_GENERATEMIPCHAIN2D_UNORM4_SIMPLEFILTER] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "generateMIPChain2D_unorm4_SimpleFilterCS.cso", wiResourceManager::COMPUTESHADER)); });
+	wiJobSystem::Execute(ctx, [] { computeShaders[CSTYPE_GENERATEMIPCHAIN2D_FLOAT4_SIMPLEFILTER] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "generateMIPChain2D_float4_SimpleFilterCS.cso", wiResourceManager::COMPUTESHADER)); });
+	wiJobSystem::Execute(ctx, [] { computeShaders[CSTYPE_GENERATEMIPCHAIN2D_UNORM4_GAUSSIAN] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "generateMIPChain2D_unorm4_GaussianCS.cso", wiResourceManager::COMPUTESHADER)); });
+	wiJobSystem::Execute(ctx, [] { computeShaders[CSTYPE_GENERATEMIPCHAIN2D_FLOAT4_GAUSSIAN] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "generateMIPChain2D_float4_GaussianCS.cso", wiResourceManager::COMPUTESHADER)); });
+	wiJobSystem::Execute(ctx, [] { computeShaders[CSTYPE_GENERATEMIPCHAIN3D_UNORM4_SIMPLEFILTER] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "generateMIPChain3D_unorm4_SimpleFilterCS.cso", wiResourceManager::COMPUTESHADER)); });
+	wiJobSystem::Execute(ctx, [] { computeShaders[CSTYPE_GENERATEMIPCHAIN3D_FLOAT4_SIMPLEFILTER] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "generateMIPChain3D_float4_SimpleFilterCS.cso", wiResourceManager::COMPUTESHADER)); });
+	wiJobSystem::Execute(ctx, [] { computeShaders[CSTYPE_GENERATEMIPCHAIN3D_UNORM4_GAUSSIAN] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "generateMIPChain3D_unorm4_GaussianCS.cso", wiResourceManager::COMPUTESHADER)); });
+	wiJobSystem::Execute(ctx, [] { computeShaders[CSTYPE_GENERATEMIPCHAIN3D_FLOAT4_GAUSSIAN] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "generateMIPChain3D_float4_GaussianCS.cso", wiResourceManager::COMPUTESHADER)); });
+	wiJobSystem::Execute(ctx, [] { computeShaders[CSTYPE_GENERATEMIPCHAINCUBE_UNORM4_SIMPLEFILTER] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "generateMIPChainCube_unorm4_SimpleFilterCS.cso", wiResourceManager::COMPUTESHADER)); });
+	wiJobSystem::Execute(ctx, [] { computeShaders[CSTYPE_GENERATEMIPCHAINCUBE_FLOAT4_SIMPLEFILTER] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "generateMIPChainCube_float4_SimpleFilterCS.cso", wiResourceManager::COMPUTESHADER)); });
+	wiJobSystem::Execute(ctx, [] { computeShaders[CSTYPE_GENERATEMIPCHAINCUBEARRAY_UNORM4_SIMPLEFILTER] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "generateMIPChainCubeArray_unorm4_SimpleFilterCS.cso", wiResourceManager::COMPUTESHADER)); });
+	wiJobSystem::Execute(ctx, [] { computeShaders[CSTYPE_GENERATEMIPCHAINCUBEARRAY_FLOAT4_SIMPLEFILTER] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "generateMIPChainCubeArray_float4_SimpleFilterCS.cso", wiResourceManager::COMPUTESHADER)); });
+	wiJobSystem::Execute(ctx, [] { computeShaders[CSTYPE_FILTERENVMAP] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "filterEnvMapCS.cso", wiResourceManager::COMPUTESHADER)); });
+	wiJobSystem::Execute(ctx, [] { computeShaders[CSTYPE_COPYTEXTURE2D_UNORM4] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "copytexture2D_unorm4CS.cso", wiResourceManager::COMPUTESHADER)); });
+	wiJobSystem::Execute(ctx, [] { computeShaders[CSTYPE_COPYTEXTURE2D_UNORM4_BORDEREXPAND] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "copytexture2D_unorm4_borderexpandCS.cso", wiResourceManager::COMPUTESHADER)); });
+	wiJobSystem::Execute(ctx, [] { computeShaders[CSTYPE_SKINNING] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "skinningCS.cso", wiResourceManager::COMPUTESHADER)); });
+	wiJobSystem::Execute(ctx, [] { computeShaders[CSTYPE_SKINNING_LDS] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "skinningCS_LDS.cso", wiResourceManager::COMPUTESHADER)); });
+	wiJobSystem::Execute(ctx, [] { computeShaders[CSTYPE_CLOUDGENERATOR] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "cloudGeneratorCS.cso", wiResourceManager::COMPUTESHADER)); });
+	wiJobSystem::Execute(ctx, [] { computeShaders[CSTYPE_BVH_RESET] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "bvh_resetCS.cso", wiResourceManager::COMPUTESHADER)); });
+	wiJobSystem::Execute(ctx, [] { computeShaders[CSTYPE_BVH_CLASSIFICATION] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "bvh_classificationCS.cso", wiResourceManager::COMPUTESHADER)); });
+	wiJobSystem::Execute(ctx, [] { computeShaders[CSTYPE_BVH_KICKJOBS] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "bvh_kickjobsCS.cso", wiResourceManager::COMPUTESHADER)); });
+	wiJobSystem::Execute(ctx, [] { computeShaders[CSTYPE_BVH_CLUSTERPROCESSOR] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "bvh_clusterprocessorCS.cso", wiResourceManager::COMPUTESHADER)); });
+	wiJobSystem::Execute(ctx, [] { computeShaders[CSTYPE_BVH_HIERARCHY] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "bvh_hierarchyCS.cso", wiResourceManager::COMPUTESHADER)); });
+	wiJobSystem::Execute(ctx, [] { computeShaders[CSTYPE_BVH_PROPAGATEAABB] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "bvh_propagateaabbCS.cso", wiResourceManager::COMPUTESHADER)); });
+	wiJobSystem::Execute(ctx, [] { computeShaders[CSTYPE_RAYTRACE_CLEAR] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "raytrace_clearCS.cso", wiResourceManager::COMPUTESHADER)); });
+	wiJobSystem::Execute(ctx, [] { computeShaders[CSTYPE_RAYTRACE_LAUNCH] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "raytrace_launchCS.cso", wiResourceManager::COMPUTESHADER)); });
+	wiJobSystem::Execute(ctx, [] { computeShaders[CSTYPE_RAYTRACE_KICKJOBS] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "raytrace_kickjobsCS.cso", wiResourceManager::COMPUTESHADER)); });
+	wiJobSystem::Execute(ctx, [] { computeShaders[CSTYPE_RAYTRACE_PRIMARY] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "raytrace_primaryCS.cso", wiResourceManager::COMPUTESHADER)); });
+	wiJobSystem::Execute(ctx, [] { computeShaders[CSTYPE_RAYTRACE_LIGHTSAMPLING] = static_cast<ComputeShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "raytrace_lightsamplingCS.cso", wiResourceManager::COMPUTESHADER)); });
+
+
+	wiJobSystem::Execute(ctx, [] { hullShaders[HSTYPE_OBJECT] = static_cast<HullShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectHS.cso", wiResourceManager::HULLSHADER)); });
+
+
+	wiJobSystem::Execute(ctx, [] { domainShaders[DSTYPE_OBJECT] = static_cast<DomainShader*>(wiResourceManager::GetShaderManager()->add(SHADERPATH + "objectDS.cso", wiResourceManager::DOMAINSHADER)); });
+
+
+	// The pipeline states depend on the shaders:
+	wiJobSystem::Wait(ctx);
+
+	// default objectshaders, the pipeline states of each shader type are created by a separate job:
+	for (int shaderType = 0; shaderType < SHADERTYPE_COUNT; ++shaderType)
+	{
+		wiJobSystem::Execute(ctx, [&, shaderType] {
 			for (int doublesided = 0; doublesided < OBJECTRENDERING_DOUBLESIDED_COUNT; ++doublesided)
 			{
 				for (int tessellation = 0; tessellation < OBJECTRENDERING_TESSELLATION_COUNT; ++tessellation)
@@ -1628,8 +1647,10 @@ void wiRenderer::LoadShaders()
 					}
 				}
 			}
-		}
+		});
+	}
 
+	wiJobSystem::Execute(ctx, [&] {
 		// Custom objectshader presets:
 		for (auto& x : Material::customShaderPresets)
 		{
@@ -1664,9 +1685,9 @@ void wiRenderer::LoadShaders()
 			device->CreateGraphicsPSO(&desc, customShader->passes[SHADERTYPE_TILEDFORWARD].pso);
 			Material::customShaderPresets.push_back(customShader);
 		}
-	}));
+	});
 
-	thread_pool.push_back(thread([&] {
+	wiJobSystem::Execute(ctx, [&] {
 		{
 			GraphicsPSODesc desc;
 			desc.vs = vertexShaders[VSTYPE_WATER];
@@ -1818,9 +1839,9 @@ void wiRenderer::LoadShaders()
 			RECREATE(PSO_captureimpostor);
 			device->CreateGraphicsPSO(&desc, PSO_captureimpostor);
 		}
-	}));
+	});
 
-	thread_pool.push_back(thread([&] {
+	wiJobSystem::Execute(ctx, [&] {
 		for (int type = 0; type < Light::LIGHTTYPE_COUNT; ++type)
 		{
 			GraphicsPSODesc desc;
@@ -2120,10 +2141,10 @@ void wiRenderer::LoadShaders()
 			RECREATE(PSO_debug[debug]);
 			device->CreateGraphicsPSO(&desc, PSO_debug[debug]);
 		}
-	}));
+	});
 
 
-	thread_pool.push_back(thread([&] {
+	wiJobSystem::Execute(ctx, [&] {
 		for (int i = 0; i < TILEDLIGHTING_TYPE_COUNT; ++i)
 		{
 			for (int j = 0; j < TILEDLIGHTING_CULLING_COUNT; ++j)
@@ -2160,14 +2181,9 @@ void wiRenderer::LoadShaders()
 			RECREATE(CPSO[i]);
 			device->CreateComputePSO(&desc, CPSO[i]);
 		}
-	}));
-
+	});
 
-	for (auto& x : thread_pool)
-	{
-		x.join();
-	}
-	thread_pool.clear();
+	wiJobSystem::Wait(ctx);
 }
 
 void wiRenderer::ReloadShaders(const std::string& path)
@@ -2182,15 +2198,20 @@ void wiRenderer::ReloadShaders(const std::string& path)
 
 	wiResourceManager::GetShaderManager()->CleanUp();
 	LoadShaders();
-	wiHairParticle::LoadShaders();
-	wiEmittedParticle::LoadShaders();
-	wiFont::LoadShaders();
-	wiImage::LoadShaders();
-	wiLensFlare::LoadShaders();
-	wiOcean::LoadShaders();
-	CSFFT_512x512_Data_t::LoadShaders();
-	wiWidget::LoadShaders();
-	wiGPUSortLib::LoadShaders();
+
+	// The other systems only create their own shaders and pipeline states, they can be loaded in parallel:
+	wiJobSystem::context ctx;
+	wiJobSystem::Execute(ctx, [] { wiHairParticle::LoadShaders(); });
+	wiJobSystem::Execute(ctx, [] { wiEmittedParticle::LoadShaders(); });
+	wiJobSystem::Execute(ctx, [] { wiFont::LoadShaders(); });
+	wiJobSystem::Execute(ctx, [] { wiImage::LoadShaders(); });
+	wiJobSystem::Execute(ctx, [] { wiLensFlare::LoadShaders(); });
+	wiJobSystem::Execute(ctx, [] { wiOcean::LoadShaders(); }); // also loads the CSFFT_512x512_Data_t shaders
+	wiJobSystem::Execute(ctx, [] { wiWidget::LoadShaders(); });
+	wiJobSystem::Execute(ctx, [] { wiGPUSortLib::LoadShaders(); });
+	wiJobSystem::Wait(ctx);
+
+	GetDevice()->SavePipelineCache(PIPELINECACHEPATH);
 }
 
 
@@ -2735,37 +2756,63 @@ void wiRenderer::BindPersistentState(GRAPHICSTHREAD threadID)
 	device->BindConstantBuffer(VS, constantBuffers[CBTYPE_API], CB_GETBINDSLOT(APICB), threadID);
 	device->BindConstantBuffer(PS, constantBuffers[CBTYPE_API], CB_GETBINDSLOT(APICB), threadID);
 }
+static Texture2D* decalAtlasTexture = nullptr;
+void wiRenderer::BindCommonResources(GRAPHICSTHREAD threadID)
+{
+	GraphicsDevice* device = GetDevice();
+
+	BindPersistentState(threadID);
+
+	GPUResource* resources[] = {
+		resourceBuffers[RBTYPE_ENTITYARRAY],
+		resourceBuffers[RBTYPE_MATRIXARRAY],
+	};
+	device->BindResources(VS, resources, SBSLOT_ENTITYARRAY, ARRAYSIZE(resources), threadID);
+	device->BindResources(PS, resources, SBSLOT_ENTITYARRAY, ARRAYSIZE(resources), threadID);
+	device->BindResources(CS, resources, SBSLOT_ENTITYARRAY, ARRAYSIZE(resources), threadID);
+
+	device->BindResource(PS, Light::shadowMapArray_2D, TEXSLOT_SHADOWARRAY_2D, threadID);
+	device->BindResource(PS, Light::shadowMapArray_Cube, TEXSLOT_SHADOWARRAY_CUBE, threadID);
+	if (GetTransparentShadowsEnabled())
+	{
+		device->BindResource(PS, Light::shadowMapArray_Transparent, TEXSLOT_SHADOWARRAY_TRANSPARENT, threadID);
+	}
+
+	if (textures[TEXTYPE_CUBEARRAY_ENVMAPARRAY] != nullptr)
+	{
+		device->BindResource(PS, textures[TEXTYPE_CUBEARRAY_ENVMAPARRAY], TEXSLOT_ENVMAPARRAY, threadID);
+		device->BindResource(CS, textures[TEXTYPE_CUBEARRAY_ENVMAPARRAY], TEXSLOT_ENVMAPARRAY, threadID);
+	}
+
+	if (GetVoxelRadianceEnabled() && textures[TEXTYPE_3D_VOXELRADIANCE] != nullptr)
+	{
+		GPUResource* result = (voxelSceneData.secondaryBounceEnabled && textures[TEXTYPE_3D_VOXELRADIANCE_HELPER] != nullptr) ?
+			textures[TEXTYPE_3D_VOXELRADIANCE_HELPER] : textures[TEXTYPE_3D_VOXELRADIANCE];
+		if (voxelHelper)
+		{
+			device->BindResource(VS, result, TEXSLOT_VOXELRADIANCE, threadID);
+		}
+		device->BindResource(PS, result, TEXSLOT_VOXELRADIANCE, threadID);
+		device->BindResource(CS, result, TEXSLOT_VOXELRADIANCE, threadID);
+	}
+
+	if (decalAtlasTexture != nullptr)
+	{
+		device->BindResource(PS, decalAtlasTexture, TEXSLOT_DECALATLAS, threadID);
+	}
+}
 
 Transform* wiRenderer::getTransformByName(const std::string& get)
 {
-	//auto transf = transforms.find(get);
-	//if (transf != transforms.end())
-	//{
-	//	return transf->second;
-	//}
-	return GetScene().GetWorldNode()->find(get);
+	return GetScene().FindTransform(get);
 }
 Transform* wiRenderer::getTransformByID(uint64_t id)
 {
-	for (Model* model : GetScene().models)
-	{
-		Transform* found = model->find(id);
-		if (found != nullptr)
-		{
-			return found;
-		}
-	}
-	return nullptr;
+	return GetScene().FindTransform(id);
 }
 Armature* wiRenderer::getArmatureByName(const std::string& get)
 {
-	for (Model* model : GetScene().models)
-	{
-		for (Armature* armature : model->armatures)
-			if (!armature->name.compare(get))
-				return armature;
-	}
-	return nullptr;
+	return GetScene().FindArmature(get);
 }
 int wiRenderer::getActionByName(Armature* armature, const std::string& get)
 {
@@ -2788,57 +2835,19 @@ int wiRenderer::getBoneByName(Armature* armature, const std::string& get)
 }
 Material* wiRenderer::getMaterialByName(const std::string& get)
 {
-	for (Model* model : GetScene().models)
-	{
-		auto& iter = model->materials.find(get);
-		if (iter != model->materials.end())
-			return iter->second;
-	}
-	return NULL;
+	return GetScene().FindMaterial(get);
 }
 Object* wiRenderer::getObjectByName(const std::string& name)
 {
-	for (Model* model : GetScene().models)
-	{
-		for (auto& x : model->objects)
-		{
-			if (!x->name.compare(name))
-			{
-				return x;
-			}
-		}
-	}
-
-	return nullptr;
+	return GetScene().FindObject(name);
 }
 Camera* wiRenderer::getCameraByName(const std::string& name)
 {
-	for (Model* model : GetScene().models)
-	{
-		for (auto& x : model->cameras)
-		{
-			if (!x->name.compare(name))
-			{
-				return x;
-			}
-		}
-	}
-
-	return nullptr;
+	return GetScene().FindCamera(name);
 }
 Light* wiRenderer::getLightByName(const std::string& name)
 {
-	for (Model* model : GetScene().models)
-	{
-		for (auto& x : model->lights)
-		{
-			if (!x->name.compare(name))
-			{
-				return x;
-			}
-		}
-	}
-	return nullptr;
+	return GetScene().FindLight(name);
 }
 
 void wiRenderer::FixedUpdate()
@@ -2851,29 +2860,78 @@ void wiRenderer::FixedUpdate()
 	GetScene().Update();
 
 }
+static const UINT ENVPROBE_RESOLUTION = 128;
+static const UINT ENVPROBE_COUNT = 16;
+static const UINT ENVPROBE_MIPS = 8;
+
+// Occluders are drawn front to back until they reach this many triangles:
+static const uint32_t SOFTWARE_OCCLUSION_TRIANGLE_BUDGET = 100000;
+static const uint32_t SOFTWARE_OCCLUSION_GROUPSIZE = 64;
+static wiSoftwareOcclusion softwareOcclusion; // only used by the main camera's culling
+
+// Draw the occluder meshes of the visible objects on the CPU, then remove the objects that are completely behind them
+//	The objects are sorted front to back, so the closest occluders get into the triangle budget first
+static void SoftwareOcclusionCulling(const Camera* camera, CulledList& culledObjects)
+{
+	softwareOcclusion.Clear(camera->GetViewProjection(), camera->zNearP);
+
+	uint32_t triangleCount = 0;
+	for (Cullable* x : culledObjects)
+	{
+		Object* object = (Object*)x;
+		Mesh* mesh = object->mesh;
+		// Only rigid meshes are drawn: the deformed ones (and billboards, which are turned to the camera in the vertex shader) are not where their vertices are
+		if (mesh == nullptr || !mesh->occluder || mesh->softBody || mesh->isBillboarded || object->isArmatureDeformed() || mesh->vertices_POS.empty())
+		{
+			continue;
+		}
+		softwareOcclusion.RasterizeTriangles(&mesh->vertices_POS[0].pos.x, sizeof(Mesh::Vertex_POS), (uint32_t)mesh->vertices_POS.size(),
+			mesh->indices.data(), (uint32_t)mesh->indices.size(), object->getMatrix());
+		triangleCount += (uint32_t)mesh->indices.size() / 3;
+		if (triangleCount >= SOFTWARE_OCCLUSION_TRIANGLE_BUDGET)
+		{
+			break;
+		}
+	}
+	if (triangleCount == 0)
+	{
+		return;
+	}
+	softwareOcclusion.BuildHierarchy();
+
+	std::vector<uint8_t> visible(culledObjects.size());
+	wiJobSystem::context ctx;
+	wiJobSystem::Dispatch(ctx, (uint32_t)culledObjects.size(), SOFTWARE_OCCLUSION_GROUPSIZE, [&](wiJobSystem::JobDispatchArgs args) {
+		Object* object = (Object*)culledObjects[args.jobIndex];
+		// hair particles can grow out of the object's bounds:
+		visible[args.jobIndex] = !object->hParticleSystems.empty() || softwareOcclusion.IsVisible(object->bounds);
+	});
+	wiJobSystem::Wait(ctx);
+
+	size_t count = 0;
+	for (size_t i = 0; i < culledObjects.size(); ++i)
+	{
+		if (visible[i])
+		{
+			culledObjects[count++] = culledObjects[i];
+		}
+	}
+	culledObjects.resize(count);
+}
+
 void wiRenderer::UpdatePerFrameData(float dt)
 {
 	// update the space partitioning trees:
 	wiProfiler::GetInstance().BeginRange("SPTree Update", wiProfiler::DOMAIN_CPU);
 	if (GetGameSpeed() > 0)
 	{
-		if (spTree != nullptr && spTree->root != nullptr)
+		if (spTree != nullptr)
 		{
-			wiSPTree* newTree = spTree->updateTree();
-			if (newTree != nullptr)
-			{
-				SAFE_DELETE(spTree);
-				spTree = newTree;
-			}
+			spTree->Update();
 		}
-		if (spTree_lights != nullptr && spTree_lights->root != nullptr)
+		if (spTree_lights != nullptr)
 		{
-			wiSPTree* newTree = spTree_lights->updateTree();
-			if (newTree != nullptr)
-			{
-				SAFE_DELETE(spTree_lights);
-				spTree_lights = newTree;
-			}
+			spTree_lights->Update();
 		}
 	}
 	wiProfiler::GetInstance().EndRange(); // SPTree Update
@@ -2900,10 +2958,54 @@ void wiRenderer::UpdatePerFrameData(float dt)
 	requestReflectionRendering = false;
 	wiProfiler::GetInstance().BeginRange("SPTree Culling", wiProfiler::DOMAIN_CPU);
 	{
+		// Every camera is culled as a separate job. Only the main camera's job writes shared state (reflection plane, light properties)
+		//	The reflector is found into locals and published after the jobs are finished, so that other views don't read it while it is written
+		bool reflectorFound = false;
+		XMFLOAT4 reflectorPlane;
+		std::vector<std::pair<Camera*, FrameCulling*>> views;
+		views.reserve(frameCullings.size());
 		for (auto& x : frameCullings)
 		{
-			Camera* camera = x.first;
-			FrameCulling& culling = x.second;
+			views.push_back(std::make_pair(x.first, &x.second));
+		}
+
+		// Decals and environment probes are gathered once, every view culls them in batches:
+		std::vector<Decal*> decals;
+		std::vector<EnvironmentProbe*> probes;
+		for (Model* model : GetScene().models)
+		{
+			for (Decal* decal : model->decals)
+			{
+				if (decal->texture || decal->normal)
+				{
+					decals.push_back(decal);
+				}
+			}
+			for (EnvironmentProbe* probe : model->environmentProbes)
+			{
+				if (probe->textureIndex >= 0)
+				{
+					probes.push_back(probe);
+				}
+			}
+		}
+		AABBArray decalBounds, probeBounds;
+		decalBounds.resize(decals.size());
+		for (size_t i = 0; i < decals.size(); ++i)
+		{
+			decalBounds.set(i, decals[i]->bounds);
+		}
+		probeBounds.resize(probes.size());
+		for (size_t i = 0; i < probes.size(); ++i)
+		{
+			probeBounds.set(i, probes[i]->bounds);
+		}
+
+		wiJobSystem::context ctx;
+		wiJobSystem::Dispatch(ctx, (uint32_t)views.size(), 1, [&](wiJobSystem::JobDispatchArgs args) {
+
+			Camera* camera = views[args.jobIndex].first;
+			FrameCulling& culling = *views[args.jobIndex].second;
 			culling.Clear();
 
 			if (!freezeCullingCamera)
@@ -2915,24 +3017,28 @@ void wiRenderer::UpdatePerFrameData(float dt)
 			{
 				CulledList culledObjects;
 				spTree->getVisible(culling.frustum, culledObjects, wiSPTree::SortType::SP_TREE_SORT_FRONT_TO_BACK);
+				if (GetSoftwareOcclusionCullingEnabled() && camera == getCamera() && !freezeCullingCamera)
+				{
+					SoftwareOcclusionCulling(camera, culledObjects);
+				}
 				for (Cullable* x : culledObjects)
 				{
 					Object* object = (Object*)x;
-					culling.culledRenderer[object->mesh].push_front(object);
+					culling.culledRenderer.push_back(object);
 					for (wiHairParticle* hair : object->hParticleSystems)
 					{
 						culling.culledHairParticleSystems.push_back(hair);
 					}
 					if (object->GetRenderTypes() & RENDERTYPE_OPAQUE)
 					{
-						culling.culledRenderer_opaque[object->mesh].push_front(object);
+						culling.culledRenderer_opaque.push_back(object);
 					}
-					if (!requestReflectionRendering && camera == getCamera() && object->IsReflector())
+					if (camera == getCamera() && !reflectorFound && object->IsReflector())
 					{
 						// If it is the main camera's culling, then obtain the reflectors:
 						XMVECTOR _refPlane = XMPlaneFromPointNormal(XMLoadFloat3(&object->/*bounds.getCenter()*/translation), XMVectorSet(0, 1, 0, 0));
-						XMStoreFloat4(&waterPlane, _refPlane);
-						requestReflectionRendering = true;
+						XMStoreFloat4(&reflectorPlane, _refPlane);
+						reflectorFound = true;
 					}
 				}
 				wiSPTree::Sort(camera->translation, culledObjects, wiSPTree::SortType::SP_TREE_SORT_BACK_TO_FRONT);
@@ -2941,28 +3047,34 @@ void wiRenderer::UpdatePerFrameData(float dt)
 					Object* object = (Object*)x;
 					if (object->GetRenderTypes() & RENDERTYPE_TRANSPARENT || object->GetRenderTypes() & RENDERTYPE_WATER)
 					{
-						culling.culledRenderer_transparent[object->mesh].push_front(object);
+						culling.culledRenderer_transparent.push_back(object);
 					}
 				}
+
+				// Group the objects by mesh. The order inside the batches is kept, so opaques stay front to back and transparents back to front
+				culling.culledRenderer.Sort();
+				culling.culledRenderer_opaque.Sort();
+				culling.culledRenderer_transparent.Sort();
 			}
 			if (camera==getCamera() && spTree_lights != nullptr) // only the main camera can render lights and write light array properties (yet)!
 			{
-				for (Model* model : GetScene().models)
+				std::vector<uint32_t> mask((max(decals.size(), probes.size()) + 31) / 32);
+
+				culling.frustum.CheckBoxes(decalBounds, 0, (uint32_t)decals.size(), mask.data());
+				for (size_t i = 0; i < decals.size(); ++i)
 				{
-					for (Decal* decal : model->decals)
+					if (mask[i / 32] & (1u << (i % 32)))
 					{
-						if ((decal->texture || decal->normal) && culling.frustum.CheckBox(decal->bounds))
-						{
-							x.second.culledDecals.push_back(decal);
-						}
+						culling.culledDecals.push_back(decals[i]);
 					}
+				}
 
-					for (EnvironmentProbe* probe : model->environmentProbes)
+				culling.frustum.CheckBoxes(probeBounds, 0, (uint32_t)probes.size(), mask.data());
+				for (size_t i = 0; i < probes.size(); ++i)
+				{
+					if (mask[i / 32] & (1u << (i % 32)))
 					{
-						if (probe->textureIndex >= 0 && culling.frustum.CheckBox(probe->bounds))
-						{
-							x.second.culledEnvProbes.push_back(probe);
-						}
+						culling.culledEnvProbes.push_back(probes[i]);
 					}
 				}
 
@@ -3029,7 +3141,98 @@ void wiRenderer::UpdatePerFrameData(float dt)
 
 					i++;
 				}
+
+				// Shadow casters are culled per light, in parallel with the other views:
+				culling.culledShadows.resize(culling.culledLights.size());
+				wiJobSystem::context shadowCtx;
+				wiJobSystem::Dispatch(shadowCtx, (uint32_t)culling.culledLights.size(), 1, [&](wiJobSystem::JobDispatchArgs shadowArgs) {
+
+					Light* l = (Light*)culling.culledLights[shadowArgs.jobIndex];
+					FrameCulling::ShadowCulling& shadow = culling.culledShadows[shadowArgs.jobIndex];
+					for (int cascade = 0; cascade < ARRAYSIZE(shadow.culledRenderer); ++cascade)
+					{
+						shadow.culledRenderer[cascade].clear();
+						shadow.transparentShadowsRequested[cascade] = false;
+					}
+
+					if (spTree == nullptr || !l->shadow || !l->IsActive() || l->shadowMap_index < 0)
+					{
+						return;
+					}
+
+					CulledList culledObjects;
+					switch (l->GetType())
+					{
+					case Light::DIRECTIONAL:
+						for (int cascade = 0; cascade < 3; ++cascade)
+						{
+							const float siz = l->shadowCam_dirLight[cascade].size * 0.5f;
+							const float f = l->shadowCam_dirLight[cascade].farplane * 0.5f;
+							AABB boundingbox;
+							boundingbox.createFromHalfWidth(XMFLOAT3(0, 0, 0), XMFLOAT3(siz, siz, f));
+
+							culledObjects.clear();
+							spTree->getVisible(boundingbox.get(XMMatrixInverse(0, XMLoadFloat4x4(&l->shadowCam_dirLight[cascade].View))), culledObjects);
+							for (Cullable* x : culledObjects)
+							{
+								Object* object = (Object*)x;
+								if (cascade < object->cascadeMask || !object->IsCastingShadow())
+								{
+									continue;
+								}
+								shadow.culledRenderer[cascade].push_back(object);
+								if (object->GetRenderTypes() & RENDERTYPE_TRANSPARENT || object->GetRenderTypes() & RENDERTYPE_WATER)
+								{
+									shadow.transparentShadowsRequested[cascade] = true;
+								}
+							}
+							shadow.culledRenderer[cascade].Sort();
+						}
+						break;
+					case Light::SPOT:
+						{
+							Frustum frustum;
+							frustum.ConstructFrustum(l->shadowCam_spotLight[0].farplane, l->shadowCam_spotLight[0].realProjection, l->shadowCam_spotLight[0].View);
+							spTree->getVisible(frustum, culledObjects);
+							for (Cullable* x : culledObjects)
+							{
+								Object* object = (Object*)x;
+								if (!object->IsCastingShadow())
+								{
+									continue;
+								}
+								shadow.culledRenderer[0].push_back(object);
+								if (object->GetRenderTypes() & RENDERTYPE_TRANSPARENT || object->GetRenderTypes() & RENDERTYPE_WATER)
+								{
+									shadow.transparentShadowsRequested[0] = true;
+								}
+							}
+							shadow.culledRenderer[0].Sort();
+						}
+						break;
+					default:
+						spTree->getVisible(l->bounds, culledObjects);
+						for (Cullable* x : culledObjects)
+						{
+							Object* object = (Object*)x;
+							if (object->IsCastingShadow())
+							{
+								shadow.culledRenderer[0].push_back(object);
+							}
+						}
+						shadow.culledRenderer[0].Sort();
+						break;
+					}
+				});
+				wiJobSystem::Wait(shadowCtx);
 			}
+		});
+		wiJobSystem::Wait(ctx);
+
+		if (reflectorFound)
+		{
+			waterPlane = reflectorPlane;
+			requestReflectionRendering = true;
 		}
 	}
 	wiProfiler::GetInstance().EndRange(); // SPTree Culling
@@ -3087,6 +3290,75 @@ void wiRenderer::UpdateRenderData(GRAPHICSTHREAD threadID)
 	deferredMIPGenLock.unlock();
 
 
+	// Create the resources of the parallel passes up front, because BindCommonResources() reads them while the passes are recorded on other threads:
+	if (textures[TEXTYPE_CUBEARRAY_ENVMAPARRAY] == nullptr)
+	{
+		TextureDesc desc;
+		desc.ArraySize = ENVPROBE_COUNT * 6;
+		desc.BindFlags = BIND_SHADER_RESOURCE | BIND_RENDER_TARGET | BIND_UNORDERED_ACCESS;
+		desc.CPUAccessFlags = 0;
+		desc.Format = RTFormat_hdr;
+		desc.Height = ENVPROBE_RESOLUTION;
+		desc.Width = ENVPROBE_RESOLUTION;
+		desc.MipLevels = ENVPROBE_MIPS;
+		desc.MiscFlags = RESOURCE_MISC_TEXTURECUBE /*| RESOURCE_MISC_GENERATE_MIPS*/;
+		desc.Usage = USAGE_DEFAULT;
+
+		textures[TEXTYPE_CUBEARRAY_ENVMAPARRAY] = new Texture2D;
+		textures[TEXTYPE_CUBEARRAY_ENVMAPARRAY]->RequestIndependentRenderTargetArraySlices(true);
+		textures[TEXTYPE_CUBEARRAY_ENVMAPARRAY]->RequestIndependentShaderResourceArraySlices(true);
+		textures[TEXTYPE_CUBEARRAY_ENVMAPARRAY]->RequestIndependentShaderResourcesForMIPs(true);
+		textures[TEXTYPE_CUBEARRAY_ENVMAPARRAY]->RequestIndependentUnorderedAccessResourcesForMIPs(true);
+		HRESULT hr = GetDevice()->CreateTexture2D(&desc, nullptr, (Texture2D**)&textures[TEXTYPE_CUBEARRAY_ENVMAPARRAY]);
+		assert(SUCCEEDED(hr));
+	}
+	if (GetVoxelRadianceEnabled())
+	{
+		if (textures[TEXTYPE_3D_VOXELRADIANCE] == nullptr)
+		{
+			TextureDesc desc;
+			ZeroMemory(&desc, sizeof(desc));
+			desc.Width = voxelSceneData.res;
+			desc.Height = voxelSceneData.res;
+			desc.Depth = voxelSceneData.res;
+			desc.MipLevels = 0;
+			desc.Format = RTFormat_voxelradiance;
+			desc.BindFlags = BIND_UNORDERED_ACCESS | BIND_SHADER_RESOURCE;
+			desc.Usage = USAGE_DEFAULT;
+			desc.CPUAccessFlags = 0;
+			desc.MiscFlags = 0;
+
+			textures[TEXTYPE_3D_VOXELRADIANCE] = new Texture3D;
+			textures[TEXTYPE_3D_VOXELRADIANCE]->RequestIndependentShaderResourcesForMIPs(true);
+			textures[TEXTYPE_3D_VOXELRADIANCE]->RequestIndependentUnorderedAccessResourcesForMIPs(true);
+			HRESULT hr = GetDevice()->CreateTexture3D(&desc, nullptr, (Texture3D**)&textures[TEXTYPE_3D_VOXELRADIANCE]);
+			assert(SUCCEEDED(hr));
+		}
+		if (voxelSceneData.secondaryBounceEnabled && textures[TEXTYPE_3D_VOXELRADIANCE_HELPER] == nullptr)
+		{
+			TextureDesc desc = ((Texture3D*)textures[TEXTYPE_3D_VOXELRADIANCE])->GetDesc();
+			textures[TEXTYPE_3D_VOXELRADIANCE_HELPER] = new Texture3D;
+			textures[TEXTYPE_3D_VOXELRADIANCE_HELPER]->RequestIndependentShaderResourcesForMIPs(true);
+			textures[TEXTYPE_3D_VOXELRADIANCE_HELPER]->RequestIndependentUnorderedAccessResourcesForMIPs(true);
+			HRESULT hr = GetDevice()->CreateTexture3D(&desc, nullptr, (Texture3D**)&textures[TEXTYPE_3D_VOXELRADIANCE_HELPER]);
+			assert(SUCCEEDED(hr));
+		}
+		if (resourceBuffers[RBTYPE_VOXELSCENE] == nullptr)
+		{
+			GPUBufferDesc desc;
+			desc.StructureByteStride = sizeof(UINT) * 2;
+			desc.ByteWidth = desc.StructureByteStride * voxelSceneData.res * voxelSceneData.res * voxelSceneData.res;
+			desc.BindFlags = BIND_UNORDERED_ACCESS | BIND_SHADER_RESOURCE;
+			desc.CPUAccessFlags = 0;
+			desc.MiscFlags = RESOURCE_MISC_BUFFER_STRUCTURED;
+			desc.Usage = USAGE_DEFAULT;
+
+			resourceBuffers[RBTYPE_VOXELSCENE] = new GPUBuffer;
+			HRESULT hr = GetDevice()->CreateBuffer(&desc, nullptr, resourceBuffers[RBTYPE_VOXELSCENE]);
+			assert(SUCCEEDED(hr));
+		}
+	}
+
 	const FrameCulling& mainCameraCulling = frameCullings[getCamera()];
 
 	// Fill Light Array with lights + envprobes + decals in the frustum:
@@ -3299,15 +3571,35 @@ void wiRenderer::UpdateRenderData(GRAPHICSTHREAD threadID)
 
 	ManageDecalAtlas(threadID);
 
-	wiProfiler::GetInstance().BeginRange("Skinning", wiProfiler::DOMAIN_GPU, threadID);
-	GetDevice()->EventBegin("Skinning", threadID);
+	// Prepare bone matrices for GPU skinning in parallel, the upload loop below only copies them:
 	{
-		bool streamOutSetUp = false;
-		CSTYPES lastCS = CSTYPE_SKINNING_LDS;
-
+		std::vector<Armature*> armatures;
 		for (Model* model : GetScene().models)
 		{
-			// Update material constant buffers:
+			armatures.insert(armatures.end(), model->armatures.begin(), model->armatures.end());
+		}
+
+		wiJobSystem::context ctx;
+		wiJobSystem::Dispatch(ctx, (uint32_t)armatures.size(), 1, [&](wiJobSystem::JobDispatchArgs args) {
+			Armature* armature = armatures[args.jobIndex];
+			armature->boneData.resize(armature->boneCollection.size());
+			for (size_t k = 0; k < armature->boneCollection.size(); k++)
+			{
+				armature->boneData[k].Create(armature->boneCollection[k]->boneRelativity);
+			}
+		});
+		wiJobSystem::Wait(ctx);
+	}
+
+	wiProfiler::GetInstance().BeginRange("Skinning", wiProfiler::DOMAIN_GPU, threadID);
+	GetDevice()->EventBegin("Skinning", threadID);
+	{
+		bool streamOutSetUp = false;
+		CSTYPES lastCS = CSTYPE_SKINNING_LDS;
+
+		for (Model* model : GetScene().models)
+		{
+			// Update material constant buffers:
 			MaterialCB materialGPUData;
 			for (auto& it : model->materials)
 			{
@@ -3360,10 +3652,6 @@ void wiRenderer::UpdateRenderData(GRAPHICSTHREAD threadID)
 					}
 
 					// Upload bones for skinning to shader
-					for (unsigned int k = 0; k < armature->boneCollection.size(); k++)
-					{
-						armature->boneData[k].Create(armature->boneCollection[k]->boneRelativity);
-					}
 					GetDevice()->UpdateBuffer(&armature->boneBuffer, armature->boneData.data(), threadID, (int)(sizeof(Armature::ShaderBoneType) * armature->boneCollection.size()));
 					GetDevice()->BindResource(CS, &armature->boneBuffer, SKINNINGSLOT_IN_BONEBUFFER, threadID);
 
@@ -3390,12 +3678,12 @@ void wiRenderer::UpdateRenderData(GRAPHICSTHREAD threadID)
 					size_t size_pos = sizeof(Mesh::Vertex_POS)*mesh->vertices_Transformed_POS.size();
 					size_t size_pre = sizeof(Mesh::Vertex_POS)*mesh->vertices_Transformed_PRE.size();
 					UINT offset;
-					void* vertexData = GetDevice()->AllocateFromRingBuffer(dynamicVertexBufferPool, size_pos + size_pre, offset, threadID);
+					void* vertexData = GetDevice()->AllocateFromRingBuffer(dynamicVertexBufferPools[threadID], size_pos + size_pre, offset, threadID);
 					mesh->bufferOffset_POS = offset;
 					mesh->bufferOffset_PRE = offset + (UINT)size_pos;
 					memcpy(vertexData, mesh->vertices_Transformed_POS.data(), size_pos);
 					memcpy(reinterpret_cast<void*>(reinterpret_cast<size_t>(vertexData) + size_pos), mesh->vertices_Transformed_PRE.data(), size_pre);
-					GetDevice()->InvalidateBufferAccess(dynamicVertexBufferPool, threadID);
+					GetDevice()->InvalidateBufferAccess(dynamicVertexBufferPools[threadID], threadID);
 				}
 			}
 		}
@@ -3448,9 +3736,6 @@ void wiRenderer::UpdateRenderData(GRAPHICSTHREAD threadID)
 		float cloudPhase = renderTime * GetScene().worldInfo.cloudSpeed;
 		GenerateClouds((Texture2D*)textures[TEXTYPE_2D_CLOUDS], 5, cloudPhase, GRAPHICSTHREAD_IMMEDIATE);
 	}
-
-	// Render out of date environment probes:
-	RefreshEnvProbes(threadID);
 }
 void wiRenderer::OcclusionCulling_Render(GRAPHICSTHREAD threadID)
 {
@@ -3481,14 +3766,14 @@ void wiRenderer::OcclusionCulling_Render(GRAPHICSTHREAD threadID)
 
 		int queryID = 0;
 
-		for (CulledCollection::const_iterator iter = culledRenderer.begin(); iter != culledRenderer.end(); ++iter)
+		for (const CulledCollection::Batch& batch : culledRenderer.GetBatches())
 		{
-			Mesh* mesh = iter->first;
+			Mesh* mesh = batch.mesh;
 			if (!mesh->renderable)
 			{
 				continue;
 			}
-			const CulledObjectList& visibleInstances = iter->second;
+			const CulledCollection::Instances visibleInstances = culledRenderer.GetInstances(batch);
 
 			MiscCB cb;
 			for (Object* instance : visibleInstances)
@@ -3550,15 +3835,15 @@ void wiRenderer::OcclusionCulling_Read()
 	{
 		GetDevice()->EventBegin("Occlusion Culling Read", GRAPHICSTHREAD_IMMEDIATE);
 
-		for (CulledCollection::const_iterator iter = culledRenderer.begin(); iter != culledRenderer.end(); ++iter)
+		for (const CulledCollection::Batch& batch : culledRenderer.GetBatches())
 		{
-			Mesh* mesh = iter->first;
+			Mesh* mesh = batch.mesh;
 			if (!mesh->renderable || mesh->softBody) // todo: correct softbody
 			{
 				continue;
 			}
 
-			const CulledObjectList& visibleInstances = iter->second;
+			const CulledCollection::Instances visibleInstances = culledRenderer.GetInstances(batch);
 
 			for (Object* instance : visibleInstances)
 			{
@@ -3660,7 +3945,7 @@ void wiRenderer::DrawDebugWorld(Camera* camera, GRAPHICSTHREAD threadID)
 					XMFLOAT4 a, colorA, b, colorB;
 				};
 				UINT offset;
-				void* mem = device->AllocateFromRingBuffer(dynamicVertexBufferPool, sizeof(LineSegment) * armature->boneCollection.size(), offset, threadID);
+				void* mem = device->AllocateFromRingBuffer(dynamicVertexBufferPools[threadID], sizeof(LineSegment) * armature->boneCollection.size(), offset, threadID);
 
 				int i = 0;
 				for (auto& bone : armature->boneCollection)
@@ -3681,10 +3966,10 @@ void wiRenderer::DrawDebugWorld(Camera* camera, GRAPHICSTHREAD threadID)
 					i++;
 				}
 
-				device->InvalidateBufferAccess(dynamicVertexBufferPool, threadID);
+				device->InvalidateBufferAccess(dynamicVertexBufferPools[threadID], threadID);
 
 				GPUBuffer* vbs[] = {
-					dynamicVertexBufferPool,
+					dynamicVertexBufferPools[threadID],
 				};
 				const UINT strides[] = {
 					sizeof(XMFLOAT4) + sizeof(XMFLOAT4),
@@ -3718,7 +4003,7 @@ void wiRenderer::DrawDebugWorld(Camera* camera, GRAPHICSTHREAD threadID)
 			XMFLOAT4 a, colorA, b, colorB;
 		};
 		UINT offset;
-		void* mem = device->AllocateFromRingBuffer(dynamicVertexBufferPool, sizeof(LineSegment) * renderableLines.size(), offset, threadID);
+		void* mem = device->AllocateFromRingBuffer(dynamicVertexBufferPools[threadID], sizeof(LineSegment) * renderableLines.size(), offset, threadID);
 
 		int i = 0;
 		for (auto& line : renderableLines)
@@ -3732,10 +4017,10 @@ void wiRenderer::DrawDebugWorld(Camera* camera, GRAPHICSTHREAD threadID)
 			i++;
 		}
 
-		device->InvalidateBufferAccess(dynamicVertexBufferPool, threadID);
+		device->InvalidateBufferAccess(dynamicVertexBufferPools[threadID], threadID);
 
 		GPUBuffer* vbs[] = {
-			dynamicVertexBufferPool,
+			dynamicVertexBufferPools[threadID],
 		};
 		const UINT strides[] = {
 			sizeof(XMFLOAT4) + sizeof(XMFLOAT4),
@@ -3770,28 +4055,15 @@ void wiRenderer::DrawDebugWorld(Camera* camera, GRAPHICSTHREAD threadID)
 		MiscCB sb;
 
 
-		wiSPTree::Node* nodes[100];
-		UINT stackpos = 0;
-
-		nodes[stackpos++] = spTree->root;
-
-		do
+		for (size_t i = 0; i < spTree->GetNodeCount(); ++i)
 		{
-			wiSPTree::Node* node = nodes[--stackpos];
-
-			for (auto& child : node->children)
-			{
-				nodes[stackpos++] = child;
-			}
-			
-			sb.mTransform = XMMatrixTranspose(node->box.getAsBoxMatrix() * camera->GetViewProjection());
+			sb.mTransform = XMMatrixTranspose(spTree->GetNodeBounds(i).getAsBoxMatrix() * camera->GetViewProjection());
 			sb.mColor = XMFLOAT4(1, 1, 0, 1);
 
 			device->UpdateBuffer(constantBuffers[CBTYPE_MISC], &sb, threadID);
 
 			device->DrawIndexed(24, 0, 0, threadID);
-
-		} while (stackpos > 0);
+		}
 
 		device->EventEnd(threadID);
 	}
@@ -4549,7 +4821,7 @@ void wiRenderer::SetShadowPropsCube(int resolution, int count)
 	desc.MiscFlags = RESOURCE_MISC_TEXTURECUBE;
 	GetDevice()->CreateTexture2D(&desc, nullptr, &Light::shadowMapArray_Cube);
 }
-void wiRenderer::DrawForShadowMap(GRAPHICSTHREAD threadID, uint32_t layerMask)
+void wiRenderer::DrawForShadowMap2D(GRAPHICSTHREAD threadID, uint32_t layerMask)
 {
 	if (wireRender)
 		return;
@@ -4563,69 +4835,39 @@ void wiRenderer::DrawForShadowMap(GRAPHICSTHREAD threadID, uint32_t layerMask)
 		GetDevice()->EventBegin("ShadowMap Render", threadID);
 		wiProfiler::GetInstance().BeginRange("Shadow Rendering", wiProfiler::DOMAIN_GPU, threadID);
 
-		const bool all_layers = layerMask == 0xFFFFFFFF; // this can avoid the recursive call per object : GetLayerMask()
-
 		const FrameCulling& culling = frameCullings[getCamera()];
 		const CulledList& culledLights = culling.culledLights;
 
-		ViewPort vp;
-
 		// RGB: Shadow tint (multiplicative), A: Refraction caustics(additive)
 		const float transparentShadowClearColor[] = { 1,1,1,0 };
 
 		if (!culledLights.empty())
 		{
-			GetDevice()->UnbindResources(TEXSLOT_SHADOWARRAY_2D, 2, threadID);
+			GetDevice()->UnbindResources(TEXSLOT_SHADOWARRAY_2D, 1, threadID);
+
+			ViewPort vp;
+			vp.TopLeftX = 0;
+			vp.TopLeftY = 0;
+			vp.Width = (float)SHADOWRES_2D;
+			vp.Height = (float)SHADOWRES_2D;
+			vp.MinDepth = 0.0f;
+			vp.MaxDepth = 1.0f;
+			GetDevice()->BindViewports(1, &vp, threadID);
 
 			int shadowCounter_2D = 0;
-			int shadowCounter_Cube = 0;
-			for (int type = 0; type < Light::LIGHTTYPE_COUNT; ++type)
+			const Light::LightType types[] = { Light::DIRECTIONAL, Light::SPOT };
+			for (Light::LightType type : types)
 			{
-				switch (type)
+				for (size_t lightIndex = 0; lightIndex < culledLights.size(); ++lightIndex)
 				{
-				case Light::DIRECTIONAL:
-				case Light::SPOT:
-				{
-					vp.TopLeftX = 0;
-					vp.TopLeftY = 0;
-					vp.Width = (float)SHADOWRES_2D;
-					vp.Height = (float)SHADOWRES_2D;
-					vp.MinDepth = 0.0f;
-					vp.MaxDepth = 1.0f;
-					GetDevice()->BindViewports(1, &vp, threadID);
-					break;
-				}
-				break;
-				case Light::POINT:
-				case Light::SPHERE:
-				case Light::DISC:
-				case Light::RECTANGLE:
-				case Light::TUBE:
-				{
-					vp.TopLeftX = 0;
-					vp.TopLeftY = 0;
-					vp.Width = (float)SHADOWRES_CUBE;
-					vp.Height = (float)SHADOWRES_CUBE;
-					vp.MinDepth = 0.0f;
-					vp.MaxDepth = 1.0f;
-					GetDevice()->BindViewports(1, &vp, threadID);
-
-					GetDevice()->BindConstantBuffer(GS, constantBuffers[CBTYPE_CUBEMAPRENDER], CB_GETBINDSLOT(CubeMapRenderCB), threadID);
-					break;
-				}
-				break;
-				default:
-					break;
-				}
-
-				for (Cullable* c : culledLights)
-				{
-					Light* l = (Light*)c;
+					Light* l = (Light*)culledLights[lightIndex];
 					if (l->GetType() != type || !l->shadow || !l->IsActive())
 					{
 						continue;
 					}
 
+					const FrameCulling::ShadowCulling& shadow = culling.culledShadows[lightIndex];
+
 					switch (type)
 					{
 					case Light::DIRECTIONAL:
@@ -4636,193 +4878,202 @@ void wiRenderer::DrawForShadowMap(GRAPHICSTHREAD threadID, uint32_t layerMask)
 
 						for (int cascade = 0; cascade < 3; ++cascade)
 						{
-							const float siz = l->shadowCam_dirLight[cascade].size * 0.5f;
-							const float f = l->shadowCam_dirLight[cascade].farplane * 0.5f;
-							AABB boundingbox;
-							boundingbox.createFromHalfWidth(XMFLOAT3(0, 0, 0), XMFLOAT3(siz, siz, f));
-							if (spTree != nullptr)
-							{
-								CulledList culledObjects;
-								CulledCollection culledRenderer;
-								spTree->getVisible(boundingbox.get(XMMatrixInverse(0, XMLoadFloat4x4(&l->shadowCam_dirLight[cascade].View))), culledObjects);
-								bool transparentShadowsRequested = false;
-								for (Cullable* x : culledObjects)
-								{
-									Object* object = (Object*)x;
-									if (cascade < object->cascadeMask)
-									{
-										continue;
-									}
-									if (all_layers || (layerMask & object->GetLayerMask()))
-									{
-										if (object->IsCastingShadow())
-										{
-											culledRenderer[object->mesh].push_front(object);
-
-											if (object->GetRenderTypes() & RENDERTYPE_TRANSPARENT || object->GetRenderTypes() & RENDERTYPE_WATER)
-											{
-												transparentShadowsRequested = true;
-											}
-										}
-									}
-								}
-								if (!culledRenderer.empty())
-								{
-									CameraCB cb;
-									cb.mVP = l->shadowCam_dirLight[cascade].getVP();
-									GetDevice()->UpdateBuffer(constantBuffers[CBTYPE_CAMERA], &cb, threadID);
-
-									GetDevice()->ClearDepthStencil(Light::shadowMapArray_2D, CLEAR_DEPTH, 0.0f, 0, threadID, l->shadowMap_index + cascade);
-
-									// unfortunately we will always have to clear the associated transparent shadowmap to avoid discrepancy with shadowmap indexing changes across frames
-									GetDevice()->ClearRenderTarget(Light::shadowMapArray_Transparent, transparentShadowClearColor, threadID, l->shadowMap_index + cascade);
-
-									// render opaque shadowmap:
-									GetDevice()->BindRenderTargets(0, nullptr, Light::shadowMapArray_2D, threadID, l->shadowMap_index + cascade);
-									RenderMeshes(l->shadowCam_dirLight[cascade].Eye, culledRenderer, SHADERTYPE_SHADOW, RENDERTYPE_OPAQUE, threadID);
-
-									if (GetTransparentShadowsEnabled() && transparentShadowsRequested)
-									{
-										// render transparent shadowmap:
-										Texture2D* rts[] = {
-											Light::shadowMapArray_Transparent
-										};
-										GetDevice()->BindRenderTargets(ARRAYSIZE(rts), rts, Light::shadowMapArray_2D, threadID, l->shadowMap_index + cascade);
-										RenderMeshes(l->shadowCam_dirLight[cascade].Eye, culledRenderer, SHADERTYPE_SHADOW, RENDERTYPE_TRANSPARENT | RENDERTYPE_WATER, threadID);
-									}
-								}
-							}
-						}
-					}
-					break;
-					case Light::SPOT:
-					{
-						if (shadowCounter_2D >= SHADOWCOUNT_2D || l->shadowMap_index < 0 || l->shadowCam_spotLight.empty())
-							break;
-						shadowCounter_2D++; // shadow indices are already complete so a shadow slot is consumed here even if no rendering actually happens!
-
-						Frustum frustum;
-						frustum.ConstructFrustum(l->shadowCam_spotLight[0].farplane, l->shadowCam_spotLight[0].realProjection, l->shadowCam_spotLight[0].View);
-						if (spTree != nullptr)
-						{
-							CulledList culledObjects;
-							CulledCollection culledRenderer;
-							spTree->getVisible(frustum, culledObjects);
-							bool transparentShadowsRequested = false;
-							for (Cullable* x : culledObjects)
-							{
-								Object* object = (Object*)x;
-								if (all_layers || (layerMask & object->GetLayerMask()))
-								{
-									if (object->IsCastingShadow())
-									{
-										culledRenderer[object->mesh].push_front(object);
-
-										if (object->GetRenderTypes() & RENDERTYPE_TRANSPARENT || object->GetRenderTypes() & RENDERTYPE_WATER)
-										{
-											transparentShadowsRequested = true;
-										}
-									}
-								}
-							}
+							const CulledCollection& culledRenderer = shadow.culledRenderer[cascade];
 							if (!culledRenderer.empty())
 							{
 								CameraCB cb;
-								cb.mVP = l->shadowCam_spotLight[0].getVP();
+								cb.mVP = l->shadowCam_dirLight[cascade].getVP();
 								GetDevice()->UpdateBuffer(constantBuffers[CBTYPE_CAMERA], &cb, threadID);
 
-								GetDevice()->ClearDepthStencil(Light::shadowMapArray_2D, CLEAR_DEPTH, 0.0f, 0, threadID, l->shadowMap_index);
+								GetDevice()->ClearDepthStencil(Light::shadowMapArray_2D, CLEAR_DEPTH, 0.0f, 0, threadID, l->shadowMap_index + cascade);
 
 								// unfortunately we will always have to clear the associated transparent shadowmap to avoid discrepancy with shadowmap indexing changes across frames
-								GetDevice()->ClearRenderTarget(Light::shadowMapArray_Transparent, transparentShadowClearColor, threadID, l->shadowMap_index);
+								GetDevice()->ClearRenderTarget(Light::shadowMapArray_Transparent, transparentShadowClearColor, threadID, l->shadowMap_index + cascade);
 
 								// render opaque shadowmap:
-								GetDevice()->BindRenderTargets(0, nullptr, Light::shadowMapArray_2D, threadID, l->shadowMap_index);
-								RenderMeshes(l->translation, culledRenderer, SHADERTYPE_SHADOW, RENDERTYPE_OPAQUE, threadID);
+								GetDevice()->BindRenderTargets(0, nullptr, Light::shadowMapArray_2D, threadID, l->shadowMap_index + cascade);
+								RenderMeshes(l->shadowCam_dirLight[cascade].Eye, culledRenderer, SHADERTYPE_SHADOW, RENDERTYPE_OPAQUE, threadID, false, false, layerMask);
 
-								if (GetTransparentShadowsEnabled() && transparentShadowsRequested)
+								if (GetTransparentShadowsEnabled() && shadow.transparentShadowsRequested[cascade])
 								{
 									// render transparent shadowmap:
 									Texture2D* rts[] = {
 										Light::shadowMapArray_Transparent
 									};
-									GetDevice()->BindRenderTargets(ARRAYSIZE(rts), rts, Light::shadowMapArray_2D, threadID, l->shadowMap_index);
-									RenderMeshes(l->translation, culledRenderer, SHADERTYPE_SHADOW, RENDERTYPE_TRANSPARENT | RENDERTYPE_WATER, threadID);
+									GetDevice()->BindRenderTargets(ARRAYSIZE(rts), rts, Light::shadowMapArray_2D, threadID, l->shadowMap_index + cascade);
+									RenderMeshes(l->shadowCam_dirLight[cascade].Eye, culledRenderer, SHADERTYPE_SHADOW, RENDERTYPE_TRANSPARENT | RENDERTYPE_WATER, threadID, false, false, layerMask);
 								}
 							}
 						}
 					}
 					break;
-					case Light::POINT:
-					case Light::SPHERE:
-					case Light::DISC:
-					case Light::RECTANGLE:
-					case Light::TUBE:
+					case Light::SPOT:
 					{
-						if (shadowCounter_Cube >= SHADOWCOUNT_CUBE || l->shadowMap_index < 0 || l->shadowCam_pointLight.empty())
+						if (shadowCounter_2D >= SHADOWCOUNT_2D || l->shadowMap_index < 0 || l->shadowCam_spotLight.empty())
 							break;
-						shadowCounter_Cube++; // shadow indices are already complete so a shadow slot is consumed here even if no rendering actually happens!
+						shadowCounter_2D++; // shadow indices are already complete so a shadow slot is consumed here even if no rendering actually happens!
 
-						if (spTree != nullptr)
+						const CulledCollection& culledRenderer = shadow.culledRenderer[0];
+						if (!culledRenderer.empty())
 						{
-							CulledList culledObjects;
-							CulledCollection culledRenderer;
-							spTree->getVisible(l->bounds, culledObjects);
-							for (Cullable* x : culledObjects)
-							{
-								Object* object = (Object*)x;
-
-								if (all_layers || (layerMask & object->GetLayerMask()))
-								{
-									if (object->IsCastingShadow())
-									{
-										culledRenderer[object->mesh].push_front(object);
-									}
-								}
-							}
-							if (!culledRenderer.empty())
-							{
-								GetDevice()->BindRenderTargets(0, nullptr, Light::shadowMapArray_Cube, threadID, l->shadowMap_index);
-								GetDevice()->ClearDepthStencil(Light::shadowMapArray_Cube, CLEAR_DEPTH, 0.0f, 0, threadID, l->shadowMap_index);
+							CameraCB cb;
+							cb.mVP = l->shadowCam_spotLight[0].getVP();
+							GetDevice()->UpdateBuffer(constantBuffers[CBTYPE_CAMERA], &cb, threadID);
 
-								MiscCB miscCb;
-								miscCb.mColor = XMFLOAT4(l->translation.x, l->translation.y, l->translation.z, 1.0f / l->GetRange()); // reciprocal range, to avoid division in shader
-								GetDevice()->UpdateBuffer(constantBuffers[CBTYPE_MISC], &miscCb, threadID);
+							GetDevice()->ClearDepthStencil(Light::shadowMapArray_2D, CLEAR_DEPTH, 0.0f, 0, threadID, l->shadowMap_index);
 
-								CubeMapRenderCB cb;
-								for (unsigned int shcam = 0; shcam < l->shadowCam_pointLight.size(); ++shcam)
-									cb.mViewProjection[shcam] = l->shadowCam_pointLight[shcam].getVP();
+							// unfortunately we will always have to clear the associated transparent shadowmap to avoid discrepancy with shadowmap indexing changes across frames
+							GetDevice()->ClearRenderTarget(Light::shadowMapArray_Transparent, transparentShadowClearColor, threadID, l->shadowMap_index);
 
-								GetDevice()->UpdateBuffer(constantBuffers[CBTYPE_CUBEMAPRENDER], &cb, threadID);
+							// render opaque shadowmap:
+							GetDevice()->BindRenderTargets(0, nullptr, Light::shadowMapArray_2D, threadID, l->shadowMap_index);
+							RenderMeshes(l->translation, culledRenderer, SHADERTYPE_SHADOW, RENDERTYPE_OPAQUE, threadID, false, false, layerMask);
 
-								RenderMeshes(l->translation, culledRenderer, SHADERTYPE_SHADOWCUBE, RENDERTYPE_OPAQUE, threadID);
+							if (GetTransparentShadowsEnabled() && shadow.transparentShadowsRequested[0])
+							{
+								// render transparent shadowmap:
+								Texture2D* rts[] = {
+									Light::shadowMapArray_Transparent
+								};
+								GetDevice()->BindRenderTargets(ARRAYSIZE(rts), rts, Light::shadowMapArray_2D, threadID, l->shadowMap_index);
+								RenderMeshes(l->translation, culledRenderer, SHADERTYPE_SHADOW, RENDERTYPE_TRANSPARENT | RENDERTYPE_WATER, threadID, false, false, layerMask);
 							}
 						}
 					}
 					break;
+					default:
+						break;
 					} // terminate switch
 				}
-
 			}
 
 			GetDevice()->BindRenderTargets(0, nullptr, nullptr, threadID);
 		}
 
 
-		wiProfiler::GetInstance().EndRange(); // Shadow Rendering
+		wiProfiler::GetInstance().EndRange(threadID); // Shadow Rendering
 		GetDevice()->EventEnd(threadID);
 	}
 
 	GetDevice()->BindResource(PS, Light::shadowMapArray_2D, TEXSLOT_SHADOWARRAY_2D, threadID);
-	GetDevice()->BindResource(PS, Light::shadowMapArray_Cube, TEXSLOT_SHADOWARRAY_CUBE, threadID);
 	if (GetTransparentShadowsEnabled())
 	{
 		GetDevice()->BindResource(PS, Light::shadowMapArray_Transparent, TEXSLOT_SHADOWARRAY_TRANSPARENT, threadID);
 	}
 }
+void wiRenderer::DrawForShadowMapCube(GRAPHICSTHREAD threadID, uint32_t layerMask)
+{
+	if (wireRender)
+		return;
+
+	GetDevice()->EventBegin("Cube ShadowMap Render", threadID);
+	wiProfiler::GetInstance().BeginRange("Cube Shadow Rendering", wiProfiler::DOMAIN_GPU, threadID);
+
+	const FrameCulling& culling = frameCullings[getCamera()];
+	const CulledList& culledLights = culling.culledLights;
+
+	if (!culledLights.empty())
+	{
+		GetDevice()->UnbindResources(TEXSLOT_SHADOWARRAY_CUBE, 1, threadID);
+
+		ViewPort vp;
+		vp.TopLeftX = 0;
+		vp.TopLeftY = 0;
+		vp.Width = (float)SHADOWRES_CUBE;
+		vp.Height = (float)SHADOWRES_CUBE;
+		vp.MinDepth = 0.0f;
+		vp.MaxDepth = 1.0f;
+		GetDevice()->BindViewports(1, &vp, threadID);
+
+		GetDevice()->BindConstantBuffer(GS, constantBuffers[CBTYPE_CUBEMAPRENDER], CB_GETBINDSLOT(CubeMapRenderCB), threadID);
+
+		int shadowCounter_Cube = 0;
+		const Light::LightType types[] = { Light::POINT, Light::SPHERE, Light::DISC, Light::RECTANGLE, Light::TUBE };
+		for (Light::LightType type : types)
+		{
+			for (size_t lightIndex = 0; lightIndex < culledLights.size(); ++lightIndex)
+			{
+				Light* l = (Light*)culledLights[lightIndex];
+				if (l->GetType() != type || !l->shadow || !l->IsActive())
+				{
+					continue;
+				}
+
+				if (shadowCounter_Cube >= SHADOWCOUNT_CUBE || l->shadowMap_index < 0 || l->shadowCam_pointLight.empty())
+					continue;
+				shadowCounter_Cube++; // shadow indices are already complete so a shadow slot is consumed here even if no rendering actually happens!
+
+				const CulledCollection& culledRenderer = culling.culledShadows[lightIndex].culledRenderer[0];
+				if (!culledRenderer.empty())
+				{
+					GetDevice()->BindRenderTargets(0, nullptr, Light::shadowMapArray_Cube, threadID, l->shadowMap_index);
+					GetDevice()->ClearDepthStencil(Light::shadowMapArray_Cube, CLEAR_DEPTH, 0.0f, 0, threadID, l->shadowMap_index);
+
+					MiscCB miscCb;
+					miscCb.mColor = XMFLOAT4(l->translation.x, l->translation.y, l->translation.z, 1.0f / l->GetRange()); // reciprocal range, to avoid division in shader
+					GetDevice()->UpdateBuffer(constantBuffers[CBTYPE_MISC], &miscCb, threadID);
+
+					CubeMapRenderCB cb;
+					for (unsigned int shcam = 0; shcam < l->shadowCam_pointLight.size(); ++shcam)
+						cb.mViewProjection[shcam] = l->shadowCam_pointLight[shcam].getVP();
+
+					GetDevice()->UpdateBuffer(constantBuffers[CBTYPE_CUBEMAPRENDER], &cb, threadID);
+
+					RenderMeshes(l->translation, culledRenderer, SHADERTYPE_SHADOWCUBE, RENDERTYPE_OPAQUE, threadID, false, false, layerMask);
+				}
+			}
+		}
+
+		GetDevice()->BindRenderTargets(0, nullptr, nullptr, threadID);
+	}
+
+	wiProfiler::GetInstance().EndRange(threadID); // Cube Shadow Rendering
+	GetDevice()->EventEnd(threadID);
+
+	GetDevice()->BindResource(PS, Light::shadowMapArray_Cube, TEXSLOT_SHADOWARRAY_CUBE, threadID);
+}
+
+// Per-thread scratch memory of RenderMeshes, so the render queue doesn't need to allocate every time
+struct RenderQueueScratch
+{
+	struct VisibleInstance
+	{
+		const Object* object;
+		float dither;
+	};
+	// The visible instances of one mesh, drawn with one instanced draw call per subset
+	struct MeshDraw
+	{
+		Mesh* mesh;
+		uint32_t instanceOffset;	// first instance in the instances array
+		uint32_t instanceCount;
+		UINT instancesOffset;		// byte offset of the instance data in the dynamic vertex buffer
+		float nearestDistance;
+		float farthestDistance;
+		bool tessellatorRequested;
+		bool forceAlphaTestForDithering;
+	};
+	struct SubsetDraw
+	{
+		uint32_t drawIndex;
+		uint32_t subsetIndex;
+		uint32_t rangeOffset;		// first range in the drawRanges array
+		uint32_t rangeCount;		// 0: the whole subset is drawn, otherwise only the ranges of the visible meshlets
+	};
+
+	std::vector<VisibleInstance> instances;
+	std::vector<MeshDraw> meshDraws;
+	std::vector<SubsetDraw> subsetDraws;	// indexed by the render queue payload
+	std::vector<wiMeshlet::DrawRange> drawRanges;
+	std::vector<wiMeshlet::DrawRange> cullRanges;
+	wiRenderQueue queue;
+};
+// The visible meshlets of a subset are drawn with at most this many draw calls
+static const uint32_t MESHLET_MAX_DRAWRANGES = 64;
+static RenderQueueScratch renderQueueScratch[GRAPHICSTHREAD_COUNT];
 
 void wiRenderer::RenderMeshes(const XMFLOAT3& eye, const CulledCollection& culledRenderer, SHADERTYPE shaderType, UINT renderTypeFlags, GRAPHICSTHREAD threadID,
-	bool tessellation, bool occlusionCulling, uint32_t layerMask)
+	bool tessellation, bool occlusionCulling, uint32_t layerMask, const Camera* camera)
 {
 	// Intensive section, refactor and optimize!
 
@@ -4858,6 +5109,9 @@ void wiRenderer::RenderMeshes(const XMFLOAT3& eye, const CulledCollection& culle
 
 		const bool all_layers = layerMask == 0xFFFFFFFF; // this can avoid the recursive call per object : GetLayerMask()
 
+		// Blended passes are drawn back to front, the rest are sorted by state. Transparent shadows are multiplied together, so their order doesn't matter:
+		const bool backToFront = (renderTypeFlags & RENDERTYPE_TRANSPARENT) && shaderType != SHADERTYPE_SHADOW && shaderType != SHADERTYPE_SHADOWCUBE;
+
 		GraphicsPSO* impostorRequest = GetImpostorPSO(shaderType);
 
 		// Render impostors:
@@ -4865,20 +5119,20 @@ void wiRenderer::RenderMeshes(const XMFLOAT3& eye, const CulledCollection& culle
 		{
 			bool impostorGraphicsStateComplete = false;
 
-			for (CulledCollection::const_iterator iter = culledRenderer.begin(); iter != culledRenderer.end(); ++iter)
+			for (const CulledCollection::Batch& batch : culledRenderer.GetBatches())
 			{
-				Mesh* mesh = iter->first;
+				Mesh* mesh = batch.mesh;
 				if (!mesh->renderable || !mesh->hasImpostor() || !(mesh->GetRenderTypes() & renderTypeFlags))
 				{
 					continue;
 				}
 
-				const CulledObjectList& visibleInstances = iter->second;
+				const CulledCollection::Instances visibleInstances = culledRenderer.GetInstances(batch);
 
 				UINT instancesOffset;
 				size_t alloc_size = visibleInstances.size();
 				alloc_size *= advancedVBRequest ? sizeof(InstBuf) : sizeof(Instance);
-				void* instances = device->AllocateFromRingBuffer(dynamicVertexBufferPool, alloc_size, instancesOffset, threadID);
+				void* instances = device->AllocateFromRingBuffer(dynamicVertexBufferPools[threadID], alloc_size, instancesOffset, threadID);
 
 				int k = 0;
 				for (const Object* instance : visibleInstances)
@@ -4915,7 +5169,7 @@ void wiRenderer::RenderMeshes(const XMFLOAT3& eye, const CulledCollection& culle
 					}
 				}
 
-				device->InvalidateBufferAccess(dynamicVertexBufferPool, threadID);
+				device->InvalidateBufferAccess(dynamicVertexBufferPools[threadID], threadID);
 
 				if (k < 1)
 					continue;
@@ -4925,7 +5179,7 @@ void wiRenderer::RenderMeshes(const XMFLOAT3& eye, const CulledCollection& culle
 					GPUBuffer* vbs[] = {
 						&Mesh::impostorVB_POS,
 						&Mesh::impostorVB_TEX,
-						dynamicVertexBufferPool
+						dynamicVertexBufferPools[threadID]
 					};
 					UINT strides[] = {
 						sizeof(Mesh::Vertex_POS),
@@ -4945,7 +5199,7 @@ void wiRenderer::RenderMeshes(const XMFLOAT3& eye, const CulledCollection& culle
 						&Mesh::impostorVB_POS,
 						&Mesh::impostorVB_TEX,
 						&Mesh::impostorVB_POS,
-						dynamicVertexBufferPool
+						dynamicVertexBufferPools[threadID]
 					};
 					UINT strides[] = {
 						sizeof(Mesh::Vertex_POS),
@@ -4983,39 +5237,33 @@ void wiRenderer::RenderMeshes(const XMFLOAT3& eye, const CulledCollection& culle
 		}
 
 
-		PRIMITIVETOPOLOGY prevTOPOLOGY = TRIANGLELIST;
-
 		// Render meshes:
-		for (CulledCollection::const_iterator iter = culledRenderer.begin(); iter != culledRenderer.end(); ++iter) 
-		{
-			Mesh* mesh = iter->first;
+		//	First, the visible instances of every mesh are written into one instance buffer allocation (one instanced draw per mesh subset).
+		//	Then every renderable subset is added to the render queue, which is sorted to minimize state changes, and finally the draws are emitted in queue order.
+		RenderQueueScratch& scratch = renderQueueScratch[threadID];
+		scratch.meshDraws.clear();
+		scratch.subsetDraws.clear();
+		scratch.drawRanges.clear();
+		scratch.instances.clear();
+		scratch.queue.clear();
+
+		for (const CulledCollection::Batch& batch : culledRenderer.GetBatches())
+		{
+			Mesh* mesh = batch.mesh;
 			if (!mesh->renderable || !(mesh->GetRenderTypes() & renderTypeFlags))
 			{
 				continue;
 			}
 
-			const CulledObjectList& visibleInstances = iter->second;
-
-			const float tessF = mesh->getTessellationFactor();
-			const bool tessellatorRequested = tessF > 0 && tessellation;
-
-			if (tessellatorRequested)
-			{
-				TessellationCB tessCB;
-				tessCB.tessellationFactors = XMFLOAT4(tessF, tessF, tessF, tessF);
-				device->UpdateBuffer(constantBuffers[CBTYPE_TESSELLATION], &tessCB, threadID);
-				device->BindConstantBuffer(HS, constantBuffers[CBTYPE_TESSELLATION], CBSLOT_RENDERER_TESSELLATION, threadID);
-			}
-
-			bool forceAlphaTestForDithering = false;
+			RenderQueueScratch::MeshDraw draw;
+			draw.mesh = mesh;
+			draw.tessellatorRequested = mesh->getTessellationFactor() > 0 && tessellation;
+			draw.forceAlphaTestForDithering = false;
+			draw.instanceOffset = (uint32_t)scratch.instances.size();
+			draw.nearestDistance = FLT_MAX;
+			draw.farthestDistance = 0;
 
-			UINT instancesOffset;
-			size_t alloc_size = visibleInstances.size();
-			alloc_size *= advancedVBRequest ? sizeof(InstBuf) : sizeof(Instance);
-			void* instances = device->AllocateFromRingBuffer(dynamicVertexBufferPool, alloc_size, instancesOffset, threadID);
-
-			int k = 0;
-			for (const Object* instance : visibleInstances) 
+			for (const Object* instance : culledRenderer.GetInstances(batch))
 			{
 				if (occlusionCulling && instance->IsOccluded())
 					continue;
@@ -5023,68 +5271,128 @@ void wiRenderer::RenderMeshes(const XMFLOAT3& eye, const CulledCollection& culle
 				if (all_layers || (layerMask & instance->GetLayerMask()))
 				{
 					float dither = instance->transparency;
+					const float dist = wiMath::Distance(eye, instance->bounds.getCenter());
 					if (impostorRequest != nullptr)
 					{
 						// fade out to impostor...
 						const float impostorThreshold = instance->bounds.getRadius();
-						float dist = wiMath::Distance(eye, instance->bounds.getCenter());
 						if (mesh->hasImpostor())
 							dither = wiMath::SmoothStep(dither, 1.0f, wiMath::Clamp((dist - impostorThreshold - mesh->impostorDistance) / impostorThreshold, 0, 1));
 					}
 					if (dither > 1.0f - FLT_EPSILON)
 						continue;
 
-					forceAlphaTestForDithering = forceAlphaTestForDithering || (dither > 0);
+					draw.forceAlphaTestForDithering = draw.forceAlphaTestForDithering || (dither > 0);
+					draw.nearestDistance = min(draw.nearestDistance, dist);
+					draw.farthestDistance = max(draw.farthestDistance, dist);
 
-					if (mesh->softBody)
-						tempMat = __identityMat;
-					else
-						tempMat = instance->world;
+					RenderQueueScratch::VisibleInstance visibleInstance;
+					visibleInstance.object = instance;
+					visibleInstance.dither = dither;
+					scratch.instances.push_back(visibleInstance);
+				}
+			}
 
-					if (advancedVBRequest || tessellatorRequested)
-					{
-						((volatile InstBuf*)instances)[k].instance.Create(tempMat, dither, instance->color);
+			draw.instanceCount = (uint32_t)scratch.instances.size() - draw.instanceOffset;
+			if (draw.instanceCount > 0)
+			{
+				scratch.meshDraws.push_back(draw);
+			}
+		}
 
-						if (mesh->softBody)
-							tempMat = __identityMat;
-						else
-							tempMat = instance->worldPrev;
-						((volatile InstBuf*)instances)[k].instancePrev.Create(tempMat);
-					}
-					else
-					{
-						((volatile Instance*)instances)[k].Create(tempMat, dither, instance->color);
-					}
+		if (scratch.meshDraws.empty())
+		{
+			ResetAlphaRef(threadID);
+			device->EventEnd(threadID);
+			return;
+		}
+
+		// Allocate the instance data of every mesh at once, so the offsets stay valid until all draws are recorded:
+		size_t alloc_size = 0;
+		for (RenderQueueScratch::MeshDraw& draw : scratch.meshDraws)
+		{
+			draw.instancesOffset = (UINT)alloc_size;
+			alloc_size += draw.instanceCount * ((advancedVBRequest || draw.tessellatorRequested) ? sizeof(InstBuf) : sizeof(Instance));
+		}
+		UINT instancesOffset;
+		void* instances = device->AllocateFromRingBuffer(dynamicVertexBufferPools[threadID], alloc_size, instancesOffset, threadID);
+
+		for (RenderQueueScratch::MeshDraw& draw : scratch.meshDraws)
+		{
+			const Mesh* mesh = draw.mesh;
+			const bool instBuf = advancedVBRequest || draw.tessellatorRequested;
+			void* drawInstances = (void*)((size_t)instances + draw.instancesOffset);
+			draw.instancesOffset += instancesOffset;
+
+			for (uint32_t k = 0; k < draw.instanceCount; ++k)
+			{
+				const RenderQueueScratch::VisibleInstance& visibleInstance = scratch.instances[draw.instanceOffset + k];
+				const Object* instance = visibleInstance.object;
+
+				if (mesh->softBody)
+					tempMat = __identityMat;
+				else
+					tempMat = instance->world;
+
+				if (instBuf)
+				{
+					((volatile InstBuf*)drawInstances)[k].instance.Create(tempMat, visibleInstance.dither, instance->color);
 
-					++k;
+					if (mesh->softBody)
+						tempMat = __identityMat;
+					else
+						tempMat = instance->worldPrev;
+					((volatile InstBuf*)drawInstances)[k].instancePrev.Create(tempMat);
+				}
+				else
+				{
+					((volatile Instance*)drawInstances)[k].Create(tempMat, visibleInstance.dither, instance->color);
 				}
 			}
+		}
 
-			device->InvalidateBufferAccess(dynamicVertexBufferPool, threadID);
-
-			if (k < 1)
-				continue;
+		device->InvalidateBufferAccess(dynamicVertexBufferPools[threadID], threadID);
 
-			device->BindIndexBuffer(mesh->indexBuffer, mesh->GetIndexFormat(), 0, threadID);
+		// Fill the render queue with the renderable subsets:
+		for (uint32_t drawIndex = 0; drawIndex < (uint32_t)scratch.meshDraws.size(); ++drawIndex)
+		{
+			const RenderQueueScratch::MeshDraw& draw = scratch.meshDraws[drawIndex];
+			Mesh* mesh = draw.mesh;
 
-			enum class BOUNDVERTEXBUFFERTYPE
+			// The meshlets of a single instance are culled in object space. Deformed meshes are skipped, because the meshlet bounds are computed from the rest pose:
+			const bool meshletCulling = camera != nullptr && GetMeshletCullingEnabled() && draw.instanceCount == 1 && !mesh->meshlets.empty() &&
+				!draw.tessellatorRequested && !mesh->hasDynamicVB() && !mesh->hasArmature();
+			Frustum meshletFrustum;
+			XMFLOAT3 meshletEye;
+			bool coneCulling = false;
+			if (meshletCulling)
 			{
-				NOTHING,
-				POSITION,
-				POSITION_TEXCOORD,
-				EVERYTHING,
-			};
-			BOUNDVERTEXBUFFERTYPE boundVBType_Prev = BOUNDVERTEXBUFFERTYPE::NOTHING;
+				const XMMATRIX world = XMLoadFloat4x4(&scratch.instances[draw.instanceOffset].object->world);
+				const XMMATRIX localView = world * XMLoadFloat4x4(&camera->View);
+				XMFLOAT4X4 localView4x4;
+				XMStoreFloat4x4(&localView4x4, localView);
+				meshletFrustum.ConstructFrustum(camera->zFarP, camera->realProjection, localView4x4);
+				XMStoreFloat3(&meshletEye, XMMatrixInverse(nullptr, localView).r[3]);
+
+				// Normal cones are only valid for backface culled triangles, and the cone angles are not preserved by non-uniform scaling or mirroring:
+				XMVECTOR S, R, T;
+				XMMatrixDecompose(&S, &R, &T, world);
+				XMFLOAT3 scale;
+				XMStoreFloat3(&scale, S);
+				coneCulling = !mesh->doubleSided && XMVectorGetX(XMMatrixDeterminant(world)) > 0 &&
+					fabsf(scale.x - scale.y) <= scale.x * 0.001f && fabsf(scale.x - scale.z) <= scale.x * 0.001f;
+			}
 
-			for (MeshSubset& subset : mesh->subsets)
+			for (uint32_t subsetIndex = 0; subsetIndex < (uint32_t)mesh->subsets.size(); ++subsetIndex)
 			{
+				const MeshSubset& subset = mesh->subsets[subsetIndex];
 				if (subset.subsetIndices.empty() || subset.material->isSky)
 				{
 					continue;
 				}
 				Material* material = subset.material;
 
-				GraphicsPSO* pso = material->customShader == nullptr ? GetObjectPSO(shaderType, mesh->doubleSided, tessellatorRequested, material, forceAlphaTestForDithering) : material->customShader->passes[shaderType].pso;
+				GraphicsPSO* pso = material->customShader == nullptr ? GetObjectPSO(shaderType, mesh->doubleSided, draw.tessellatorRequested, material, draw.forceAlphaTestForDithering) : material->customShader->passes[shaderType].pso;
 				if (pso == nullptr)
 				{
 					continue;
@@ -5114,121 +5422,187 @@ void wiRenderer::RenderMeshes(const XMFLOAT3& eye, const CulledCollection& culle
 					continue;
 				}
 
-				BOUNDVERTEXBUFFERTYPE boundVBType;
-				if (advancedVBRequest || tessellatorRequested)
+				RenderQueueScratch::SubsetDraw subsetDraw;
+				subsetDraw.drawIndex = drawIndex;
+				subsetDraw.subsetIndex = subsetIndex;
+				subsetDraw.rangeOffset = 0;
+				subsetDraw.rangeCount = 0;
+				if (meshletCulling && subset.meshletCount > 0)
 				{
-					boundVBType = BOUNDVERTEXBUFFERTYPE::EVERYTHING;
+					const uint32_t rangeCount = wiMeshlet::Cull(&mesh->meshlets[subset.meshletOffset], subset.meshletCount, &meshletFrustum, meshletEye, coneCulling,
+						scratch.cullRanges, MESHLET_MAX_DRAWRANGES);
+					if (rangeCount == 0)
+					{
+						continue;
+					}
+					subsetDraw.rangeOffset = (uint32_t)scratch.drawRanges.size();
+					subsetDraw.rangeCount = rangeCount;
+					scratch.drawRanges.insert(scratch.drawRanges.end(), scratch.cullRanges.begin(), scratch.cullRanges.end());
 				}
-				else
+				scratch.queue.Add(pso, material, mesh, backToFront ? draw.farthestDistance : draw.nearestDistance, (uint32_t)scratch.subsetDraws.size());
+				scratch.subsetDraws.push_back(subsetDraw);
+			}
+		}
+
+		scratch.queue.Sort(backToFront ? wiRenderQueue::SORT_BACK_TO_FRONT : wiRenderQueue::SORT_STATE);
+
+		enum class BOUNDVERTEXBUFFERTYPE
+		{
+			NOTHING,
+			POSITION,
+			POSITION_TEXCOORD,
+			EVERYTHING,
+		};
+
+		// Only the state that differs from the previous draw is bound:
+		const GraphicsPSO* pso_Prev = nullptr;
+		const Material* material_Prev = nullptr;
+		UINT stencilRef_Prev = ~0u;
+		uint32_t drawIndex_Prev = ~0u;
+		BOUNDVERTEXBUFFERTYPE boundVBType_Prev = BOUNDVERTEXBUFFERTYPE::NOTHING;
+		float tessF_Prev = 0;
+
+		for (const wiRenderQueue::Entry& entry : scratch.queue.GetEntries())
+		{
+			const RenderQueueScratch::SubsetDraw& subsetDraw = scratch.subsetDraws[entry.payload];
+			const RenderQueueScratch::MeshDraw& draw = scratch.meshDraws[subsetDraw.drawIndex];
+			Mesh* mesh = draw.mesh;
+			const MeshSubset& subset = mesh->subsets[subsetDraw.subsetIndex];
+			Material* material = (Material*)entry.material;
+			GraphicsPSO* pso = (GraphicsPSO*)entry.pso;
+
+			if (subsetDraw.drawIndex != drawIndex_Prev)
+			{
+				device->BindIndexBuffer(mesh->indexBuffer, mesh->GetIndexFormat(), 0, threadID);
+
+				if (draw.tessellatorRequested)
 				{
-					// simple vertex buffers are used in some passes (note: tessellator requires more attributes)
-					if ((shaderType == SHADERTYPE_DEPTHONLY || shaderType == SHADERTYPE_SHADOW || shaderType == SHADERTYPE_SHADOWCUBE) && !material->IsAlphaTestEnabled() && !forceAlphaTestForDithering)
+					const float tessF = mesh->getTessellationFactor();
+					if (tessF != tessF_Prev)
 					{
-						if (shaderType == SHADERTYPE_SHADOW && material->IsTransparent())
-						{
-							boundVBType = BOUNDVERTEXBUFFERTYPE::POSITION_TEXCOORD;
-						}
-						else
-						{
-							// bypass texcoord stream for non alphatested shadows and zprepass
-							boundVBType = BOUNDVERTEXBUFFERTYPE::POSITION;
-						}
+						TessellationCB tessCB;
+						tessCB.tessellationFactors = XMFLOAT4(tessF, tessF, tessF, tessF);
+						device->UpdateBuffer(constantBuffers[CBTYPE_TESSELLATION], &tessCB, threadID);
+						device->BindConstantBuffer(HS, constantBuffers[CBTYPE_TESSELLATION], CBSLOT_RENDERER_TESSELLATION, threadID);
+						tessF_Prev = tessF;
 					}
-					else
+				}
+			}
+
+			BOUNDVERTEXBUFFERTYPE boundVBType;
+			if (advancedVBRequest || draw.tessellatorRequested)
+			{
+				boundVBType = BOUNDVERTEXBUFFERTYPE::EVERYTHING;
+			}
+			else
+			{
+				// simple vertex buffers are used in some passes (note: tessellator requires more attributes)
+				if ((shaderType == SHADERTYPE_DEPTHONLY || shaderType == SHADERTYPE_SHADOW || shaderType == SHADERTYPE_SHADOWCUBE) && !material->IsAlphaTestEnabled() && !draw.forceAlphaTestForDithering)
+				{
+					if (shaderType == SHADERTYPE_SHADOW && material->IsTransparent())
 					{
 						boundVBType = BOUNDVERTEXBUFFERTYPE::POSITION_TEXCOORD;
 					}
+					else
+					{
+						// bypass texcoord stream for non alphatested shadows and zprepass
+						boundVBType = BOUNDVERTEXBUFFERTYPE::POSITION;
+					}
 				}
-
-				if (material->IsWater())
+				else
 				{
 					boundVBType = BOUNDVERTEXBUFFERTYPE::POSITION_TEXCOORD;
 				}
-
-				if (IsWireRender())
+			}
+
+			if (material->IsWater())
+			{
+				boundVBType = BOUNDVERTEXBUFFERTYPE::POSITION_TEXCOORD;
+			}
+
+			if (IsWireRender())
+			{
+				boundVBType = BOUNDVERTEXBUFFERTYPE::POSITION_TEXCOORD;
+			}
+
+			// Only bind vertex buffers when the mesh or the layout changes
+			if (subsetDraw.drawIndex != drawIndex_Prev || boundVBType != boundVBType_Prev)
+			{
+				// Assemble the required vertex buffer:
+				switch (boundVBType)
+				{
+				case BOUNDVERTEXBUFFERTYPE::POSITION:
+				{
+					GPUBuffer* vbs[] = {
+						mesh->hasDynamicVB() ? dynamicVertexBufferPools[GRAPHICSTHREAD_IMMEDIATE] : (mesh->streamoutBuffer_POS != nullptr ? mesh->streamoutBuffer_POS : mesh->vertexBuffer_POS),
+						dynamicVertexBufferPools[threadID]
+					};
+					UINT strides[] = {
+						sizeof(Mesh::Vertex_POS),
+						sizeof(Instance)
+					};
+					UINT offsets[] = {
+						mesh->hasDynamicVB() ? mesh->bufferOffset_POS : 0,
+						draw.instancesOffset
+					};
+					device->BindVertexBuffers(vbs, 0, ARRAYSIZE(vbs), strides, offsets, threadID);
+				}
+				break;
+				case BOUNDVERTEXBUFFERTYPE::POSITION_TEXCOORD:
+				{
+					GPUBuffer* vbs[] = {
+						mesh->hasDynamicVB() ? dynamicVertexBufferPools[GRAPHICSTHREAD_IMMEDIATE] : (mesh->streamoutBuffer_POS != nullptr ? mesh->streamoutBuffer_POS : mesh->vertexBuffer_POS),
+						mesh->vertexBuffer_TEX,
+						dynamicVertexBufferPools[threadID]
+					};
+					UINT strides[] = {
+						sizeof(Mesh::Vertex_POS),
+						sizeof(Mesh::Vertex_TEX),
+						sizeof(Instance)
+					};
+					UINT offsets[] = {
+						mesh->hasDynamicVB() ? mesh->bufferOffset_POS : 0,
+						0,
+						draw.instancesOffset
+					};
+					device->BindVertexBuffers(vbs, 0, ARRAYSIZE(vbs), strides, offsets, threadID);
+				}
+				break;
+				case BOUNDVERTEXBUFFERTYPE::EVERYTHING:
 				{
-					boundVBType = BOUNDVERTEXBUFFERTYPE::POSITION_TEXCOORD;
+					GPUBuffer* vbs[] = {
+						mesh->hasDynamicVB() ? dynamicVertexBufferPools[GRAPHICSTHREAD_IMMEDIATE] : (mesh->streamoutBuffer_POS != nullptr ? mesh->streamoutBuffer_POS : mesh->vertexBuffer_POS),
+						mesh->vertexBuffer_TEX,
+						mesh->hasDynamicVB() ? dynamicVertexBufferPools[GRAPHICSTHREAD_IMMEDIATE] : (mesh->streamoutBuffer_PRE != nullptr ? mesh->streamoutBuffer_PRE : mesh->vertexBuffer_POS),
+						dynamicVertexBufferPools[threadID]
+					};
+					UINT strides[] = {
+						sizeof(Mesh::Vertex_POS),
+						sizeof(Mesh::Vertex_TEX),
+						sizeof(Mesh::Vertex_POS),
+						sizeof(InstBuf)
+					};
+					UINT offsets[] = {
+						mesh->hasDynamicVB() ? mesh->bufferOffset_POS : 0,
+						0,
+						mesh->hasDynamicVB() ? mesh->bufferOffset_PRE : 0,
+						draw.instancesOffset
+					};
+					device->BindVertexBuffers(vbs, 0, ARRAYSIZE(vbs), strides, offsets, threadID);
 				}
-
-				// Only bind vertex buffers when the layout changes
-				if (boundVBType != boundVBType_Prev)
-				{
-					// Assemble the required vertex buffer:
-					switch (boundVBType)
-					{
-					case BOUNDVERTEXBUFFERTYPE::POSITION:
-					{
-						GPUBuffer* vbs[] = {
-							mesh->hasDynamicVB() ? dynamicVertexBufferPool : (mesh->streamoutBuffer_POS != nullptr ? mesh->streamoutBuffer_POS : mesh->vertexBuffer_POS),
-							dynamicVertexBufferPool
-						};
-						UINT strides[] = {
-							sizeof(Mesh::Vertex_POS),
-							sizeof(Instance)
-						};
-						UINT offsets[] = {
-							mesh->hasDynamicVB() ? mesh->bufferOffset_POS : 0,
-							instancesOffset
-						};
-						device->BindVertexBuffers(vbs, 0, ARRAYSIZE(vbs), strides, offsets, threadID);
-					}
-					break;
-					case BOUNDVERTEXBUFFERTYPE::POSITION_TEXCOORD:
-					{
-						GPUBuffer* vbs[] = {
-							mesh->hasDynamicVB() ? dynamicVertexBufferPool : (mesh->streamoutBuffer_POS != nullptr ? mesh->streamoutBuffer_POS : mesh->vertexBuffer_POS),
-							mesh->vertexBuffer_TEX,
-							dynamicVertexBufferPool
-						};
-						UINT strides[] = {
-							sizeof(Mesh::Vertex_POS),
-							sizeof(Mesh::Vertex_TEX),
-							sizeof(Instance)
-						};
-						UINT offsets[] = {
-							mesh->hasDynamicVB() ? mesh->bufferOffset_POS : 0,
-							0,
-							instancesOffset
-						};
-						device->BindVertexBuffers(vbs, 0, ARRAYSIZE(vbs), strides, offsets, threadID);
-					}
-					break;
-					case BOUNDVERTEXBUFFERTYPE::EVERYTHING:
-					{
-						GPUBuffer* vbs[] = {
-							mesh->hasDynamicVB() ? dynamicVertexBufferPool : (mesh->streamoutBuffer_POS != nullptr ? mesh->streamoutBuffer_POS : mesh->vertexBuffer_POS),
-							mesh->vertexBuffer_TEX,
-							mesh->hasDynamicVB() ? dynamicVertexBufferPool : (mesh->streamoutBuffer_PRE != nullptr ? mesh->streamoutBuffer_PRE : mesh->vertexBuffer_POS),
-							dynamicVertexBufferPool
-						};
-						UINT strides[] = {
-							sizeof(Mesh::Vertex_POS),
-							sizeof(Mesh::Vertex_TEX),
-							sizeof(Mesh::Vertex_POS),
-							sizeof(InstBuf)
-						};
-						UINT offsets[] = {
-							mesh->hasDynamicVB() ? mesh->bufferOffset_POS : 0,
-							0,
-							mesh->hasDynamicVB() ? mesh->bufferOffset_PRE : 0,
-							instancesOffset
-						};
-						device->BindVertexBuffers(vbs, 0, ARRAYSIZE(vbs), strides, offsets, threadID);
-					}
+				break;
+				default:
+					assert(0);
 					break;
-					default:
-						assert(0);
-						break;
-					}
 				}
-				boundVBType_Prev = boundVBType;
+			}
+			drawIndex_Prev = subsetDraw.drawIndex;
+			boundVBType_Prev = boundVBType;
 
+			if (material != material_Prev)
+			{
 				device->BindConstantBuffer(PS, &material->constantBuffer, CB_GETBINDSLOT(MaterialCB), threadID);
 
-				device->BindStencilRef(material->GetStencilRef(), threadID);
-
-				device->BindGraphicsPSO(pso, threadID);
-
 				GPUResource* res[] = {
 					material->GetBaseColorMap(),
 					material->GetNormalMap(),
@@ -5239,9 +5613,34 @@ void wiRenderer::RenderMeshes(const XMFLOAT3& eye, const CulledCollection& culle
 
 				SetAlphaRef(material->alphaRef, threadID);
 
-				device->DrawIndexedInstanced((int)subset.subsetIndices.size(), k, subset.indexBufferOffset, 0, 0, threadID);
+				material_Prev = material;
+			}
+
+			// Some devices (DX11) only apply the stencil ref when the PSO is bound, so a stencil ref change also rebinds the PSO:
+			const UINT stencilRef = material->GetStencilRef();
+			if (stencilRef != stencilRef_Prev)
+			{
+				device->BindStencilRef(stencilRef, threadID);
+			}
+			if (pso != pso_Prev || stencilRef != stencilRef_Prev)
+			{
+				device->BindGraphicsPSO(pso, threadID);
+				pso_Prev = pso;
 			}
+			stencilRef_Prev = stencilRef;
 
+			if (subsetDraw.rangeCount == 0)
+			{
+				device->DrawIndexedInstanced((int)subset.subsetIndices.size(), draw.instanceCount, subset.indexBufferOffset, 0, 0, threadID);
+			}
+			else
+			{
+				for (uint32_t i = 0; i < subsetDraw.rangeCount; ++i)
+				{
+					const wiMeshlet::DrawRange& range = scratch.drawRanges[subsetDraw.rangeOffset + i];
+					device->DrawIndexedInstanced((int)range.indexCount, draw.instanceCount, subset.indexBufferOffset + range.indexOffset, 0, 0, threadID);
+				}
+			}
 		}
 
 		ResetAlphaRef(threadID);
@@ -5278,7 +5677,7 @@ void wiRenderer::DrawWorld(Camera* camera, bool tessellation, GRAPHICSTHREAD thr
 
 	if (!culledRenderer.empty() || (grass && culling.culledHairParticleSystems.empty()))
 	{
-		RenderMeshes(camera->translation, culledRenderer, shaderType, RENDERTYPE_OPAQUE, threadID, tessellation, GetOcclusionCullingEnabled() && occlusionCulling, layerMask);
+		RenderMeshes(camera->translation, culledRenderer, shaderType, RENDERTYPE_OPAQUE, threadID, tessellation, GetOcclusionCullingEnabled() && occlusionCulling, layerMask, camera);
 	}
 
 	GetDevice()->EventEnd(threadID);
@@ -5314,7 +5713,7 @@ void wiRenderer::DrawWorldTransparent(Camera* camera, SHADERTYPE shaderType, GRA
 
 	if (!culledRenderer.empty())
 	{
-		RenderMeshes(camera->translation, culledRenderer, shaderType, RENDERTYPE_TRANSPARENT | RENDERTYPE_WATER, threadID, false, GetOcclusionCullingEnabled() && occlusionCulling, layerMask);
+		RenderMeshes(camera->translation, culledRenderer, shaderType, RENDERTYPE_TRANSPARENT | RENDERTYPE_WATER, threadID, false, GetOcclusionCullingEnabled() && occlusionCulling, layerMask, camera);
 	}
 
 	GetDevice()->EventEnd(threadID);
@@ -5429,31 +5828,8 @@ void wiRenderer::RefreshEnvProbes(GRAPHICSTHREAD threadID)
 {
 	GetDevice()->EventBegin("EnvironmentProbe Refresh", threadID);
 
-	static const UINT envmapRes = 128;
-	static const UINT envmapCount = 16;
-	static const UINT envmapMIPs = 8;
-
-	if (textures[TEXTYPE_CUBEARRAY_ENVMAPARRAY] == nullptr)
-	{
-		TextureDesc desc;
-		desc.ArraySize = envmapCount * 6;
-		desc.BindFlags = BIND_SHADER_RESOURCE | BIND_RENDER_TARGET | BIND_UNORDERED_ACCESS;
-		desc.CPUAccessFlags = 0;
-		desc.Format = RTFormat_hdr;
-		desc.Height = envmapRes;
-		desc.Width = envmapRes;
-		desc.MipLevels = envmapMIPs;
-		desc.MiscFlags = RESOURCE_MISC_TEXTURECUBE /*| RESOURCE_MISC_GENERATE_MIPS*/;
-		desc.Usage = USAGE_DEFAULT;
-
-		textures[TEXTYPE_CUBEARRAY_ENVMAPARRAY] = new Texture2D;
-		textures[TEXTYPE_CUBEARRAY_ENVMAPARRAY]->RequestIndependentRenderTargetArraySlices(true);
-		textures[TEXTYPE_CUBEARRAY_ENVMAPARRAY]->RequestIndependentShaderResourceArraySlices(true);
-		textures[TEXTYPE_CUBEARRAY_ENVMAPARRAY]->RequestIndependentShaderResourcesForMIPs(true);
-		textures[TEXTYPE_CUBEARRAY_ENVMAPARRAY]->RequestIndependentUnorderedAccessResourcesForMIPs(true);
-		HRESULT hr = GetDevice()->CreateTexture2D(&desc, nullptr, (Texture2D**)&textures[TEXTYPE_CUBEARRAY_ENVMAPARRAY]);
-		assert(SUCCEEDED(hr));
-	}
+	static const UINT envmapRes = ENVPROBE_RESOLUTION;
+	static const UINT envmapCount = ENVPROBE_COUNT;
 
 	static Texture2D* envrenderingDepthBuffer = nullptr;
 	if (envrenderingDepthBuffer == nullptr)
@@ -5582,8 +5958,9 @@ void wiRenderer::RefreshEnvProbes(GRAPHICSTHREAD threadID)
 
 				for (Cullable* object : culledObjects)
 				{
-					culledRenderer[((Object*)object)->mesh].push_front((Object*)object);
+					culledRenderer.push_back((Object*)object);
 				}
+				culledRenderer.Sort();
 
 				RenderMeshes(center, culledRenderer, SHADERTYPE_ENVMAPCAPTURE, RENDERTYPE_OPAQUE, threadID);
 			}
@@ -5662,8 +6039,9 @@ void wiRenderer::RefreshEnvProbes(GRAPHICSTHREAD threadID)
 
 void wiRenderer::VoxelRadiance(GRAPHICSTHREAD threadID)
 {
-	if (!GetVoxelRadianceEnabled())
+	if (!GetVoxelRadianceEnabled() || textures[TEXTYPE_3D_VOXELRADIANCE] == nullptr || (voxelSceneData.secondaryBounceEnabled && textures[TEXTYPE_3D_VOXELRADIANCE_HELPER] == nullptr))
 	{
+		// The resources are created in UpdateRenderData(), they can only be missing if voxel GI was enabled after it in the same frame
 		return;
 	}
 
@@ -5673,50 +6051,6 @@ void wiRenderer::VoxelRadiance(GRAPHICSTHREAD threadID)
 	wiProfiler::GetInstance().BeginRange("Voxel Radiance", wiProfiler::DOMAIN_GPU, threadID);
 
 
-	if (textures[TEXTYPE_3D_VOXELRADIANCE] == nullptr)
-	{
-		TextureDesc desc;
-		ZeroMemory(&desc, sizeof(desc));
-		desc.Width = voxelSceneData.res;
-		desc.Height = voxelSceneData.res;
-		desc.Depth = voxelSceneData.res;
-		desc.MipLevels = 0;
-		desc.Format = RTFormat_voxelradiance;
-		desc.BindFlags = BIND_UNORDERED_ACCESS | BIND_SHADER_RESOURCE;
-		desc.Usage = USAGE_DEFAULT;
-		desc.CPUAccessFlags = 0;
-		desc.MiscFlags = 0;
-
-		textures[TEXTYPE_3D_VOXELRADIANCE] = new Texture3D;
-		textures[TEXTYPE_3D_VOXELRADIANCE]->RequestIndependentShaderResourcesForMIPs(true);
-		textures[TEXTYPE_3D_VOXELRADIANCE]->RequestIndependentUnorderedAccessResourcesForMIPs(true);
-		HRESULT hr = device->CreateTexture3D(&desc, nullptr, (Texture3D**)&textures[TEXTYPE_3D_VOXELRADIANCE]);
-		assert(SUCCEEDED(hr));
-	}
-	if (voxelSceneData.secondaryBounceEnabled && textures[TEXTYPE_3D_VOXELRADIANCE_HELPER] == nullptr)
-	{
-		TextureDesc desc = ((Texture3D*)textures[TEXTYPE_3D_VOXELRADIANCE])->GetDesc();
-		textures[TEXTYPE_3D_VOXELRADIANCE_HELPER] = new Texture3D;
-		textures[TEXTYPE_3D_VOXELRADIANCE_HELPER]->RequestIndependentShaderResourcesForMIPs(true);
-		textures[TEXTYPE_3D_VOXELRADIANCE_HELPER]->RequestIndependentUnorderedAccessResourcesForMIPs(true);
-		HRESULT hr = device->CreateTexture3D(&desc, nullptr, (Texture3D**)&textures[TEXTYPE_3D_VOXELRADIANCE_HELPER]);
-		assert(SUCCEEDED(hr));
-	}
-	if (resourceBuffers[RBTYPE_VOXELSCENE] == nullptr)
-	{
-		GPUBufferDesc desc;
-		desc.StructureByteStride = sizeof(UINT) * 2;
-		desc.ByteWidth = desc.StructureByteStride * voxelSceneData.res * voxelSceneData.res * voxelSceneData.res;
-		desc.BindFlags = BIND_UNORDERED_ACCESS | BIND_SHADER_RESOURCE;
-		desc.CPUAccessFlags = 0;
-		desc.MiscFlags = RESOURCE_MISC_BUFFER_STRUCTURED;
-		desc.Usage = USAGE_DEFAULT;
-
-		resourceBuffers[RBTYPE_VOXELSCENE] = new GPUBuffer;
-		HRESULT hr = device->CreateBuffer(&desc, nullptr, resourceBuffers[RBTYPE_VOXELSCENE]);
-		assert(SUCCEEDED(hr));
-	}
-
 	Texture3D* result = (Texture3D*)textures[TEXTYPE_3D_VOXELRADIANCE];
 
 	CulledList culledObjects;
@@ -5732,8 +6066,9 @@ void wiRenderer::VoxelRadiance(GRAPHICSTHREAD threadID)
 
 		for (Cullable* object : culledObjects)
 		{
-			culledRenderer[((Object*)object)->mesh].push_front((Object*)object);
+			culledRenderer.push_back((Object*)object);
 		}
+		culledRenderer.Sort();
 
 		ViewPort VP;
 		VP.TopLeftX = 0;
@@ -7244,7 +7579,6 @@ void wiRenderer::ManageDecalAtlas(GRAPHICSTHREAD threadID)
 	GraphicsDevice* device = GetDevice();
 
 
-	static Texture2D* atlasTexture = nullptr;
 	bool repackAtlas = false;
 	const int atlasClampBorder = 1;
 
@@ -7292,7 +7626,7 @@ void wiRenderer::ManageDecalAtlas(GRAPHICSTHREAD threadID)
 		{
 			assert(bins.size() == 1 && "The regions won't fit into the texture!");
 
-			SAFE_DELETE(atlasTexture);
+			SAFE_DELETE(decalAtlasTexture);
 
 			TextureDesc desc;
 			ZeroMemory(&desc, sizeof(desc));
@@ -7308,21 +7642,21 @@ void wiRenderer::ManageDecalAtlas(GRAPHICSTHREAD threadID)
 			desc.CPUAccessFlags = 0;
 			desc.MiscFlags = 0;
 
-			atlasTexture = new Texture2D;
-			atlasTexture->RequestIndependentUnorderedAccessResourcesForMIPs(true);
+			decalAtlasTexture = new Texture2D;
+			decalAtlasTexture->RequestIndependentUnorderedAccessResourcesForMIPs(true);
 
-			device->CreateTexture2D(&desc, nullptr, &atlasTexture);
+			device->CreateTexture2D(&desc, nullptr, &decalAtlasTexture);
 
-			for (UINT mip = 0; mip < atlasTexture->GetDesc().MipLevels; ++mip)
+			for (UINT mip = 0; mip < decalAtlasTexture->GetDesc().MipLevels; ++mip)
 			{
 				for (auto& it : storedTextures)
 				{
 					if (mip < it.first->GetDesc().MipLevels)
 					{
-						//device->CopyTexture2D_Region(atlasTexture, mip, it.second.x >> mip, it.second.y >> mip, it.first, mip, threadID);
+						//device->CopyTexture2D_Region(decalAtlasTexture, mip, it.second.x >> mip, it.second.y >> mip, it.first, mip, threadID);
 
 						// This is better because it implements format conversion so we can use multiple decal source texture formats in the atlas:
-						CopyTexture2D(atlasTexture, mip, (it.second.x >> mip) + atlasClampBorder, (it.second.y >> mip) + atlasClampBorder, it.first, mip, threadID, BORDEREXPAND_CLAMP);
+						CopyTexture2D(decalAtlasTexture, mip, (it.second.x >> mip) + atlasClampBorder, (it.second.y >> mip) + atlasClampBorder, it.first, mip, threadID, BORDEREXPAND_CLAMP);
 					}
 				}
 			}
@@ -7345,7 +7679,7 @@ void wiRenderer::ManageDecalAtlas(GRAPHICSTHREAD threadID)
 		{
 			if (decal->texture != nullptr)
 			{
-				const TextureDesc& desc = atlasTexture->GetDesc();
+				const TextureDesc& desc = decalAtlasTexture->GetDesc();
 
 				rect_xywhf rect = storedTextures[decal->texture];
 
@@ -7366,9 +7700,9 @@ void wiRenderer::ManageDecalAtlas(GRAPHICSTHREAD threadID)
 
 	}
 
-	if (atlasTexture != nullptr)
+	if (decalAtlasTexture != nullptr)
 	{
-		device->BindResource(PS, atlasTexture, TEXSLOT_DECALATLAS, threadID);
+		device->BindResource(PS, decalAtlasTexture, TEXSLOT_DECALATLAS, threadID);
 	}
 }
 
@@ -7507,10 +7841,11 @@ void wiRenderer::UpdateFrameCB(GRAPHICSTHREAD threadID)
 	cb.mFrustumPlanesWS[4] = camera->frustum.getNearPlane();
 	cb.mFrustumPlanesWS[5] = camera->frustum.getFarPlane();
 
-	if (spTree != nullptr && spTree->root != nullptr)
+	if (spTree != nullptr && !spTree->IsEmpty())
 	{
-		cb.mWorldBoundsMin = spTree->root->box.getMin();
-		cb.mWorldBoundsMax = spTree->root->box.getMax();
+		const AABB worldBounds = spTree->GetBounds();
+		cb.mWorldBoundsMin = worldBounds.getMin();
+		cb.mWorldBoundsMax = worldBounds.getMax();
 		cb.mWorldBoundsExtents.x = abs(cb.mWorldBoundsMax.x - cb.mWorldBoundsMin.x);
 		cb.mWorldBoundsExtents.y = abs(cb.mWorldBoundsMax.y - cb.mWorldBoundsMin.y);
 		cb.mWorldBoundsExtents.z = abs(cb.mWorldBoundsMax.z - cb.mWorldBoundsMin.z);
@@ -7678,116 +8013,212 @@ RAY wiRenderer::getPickRay(long cursorX, long cursorY) {
 	return RAY(lineStart, rayDirection);
 }
 
-wiRenderer::RayIntersectWorldResult wiRenderer::RayIntersectWorld(const RAY& ray, UINT renderTypeMask, uint32_t layerMask, bool dynamicObjects, bool onlyVisible)
-{
-	RayIntersectWorldResult result;
+// Scene queries are executed in groups of this size on the job system threads
+static const uint32_t SCENEQUERY_GROUPSIZE = 16;
 
-	if (spTree != nullptr)
+// Execute query(index) for every element of a batch, on the job system threads if the batch is large enough
+template<typename F>
+static void ExecuteSceneQueries(uint32_t count, const F& query)
+{
+	if (count > SCENEQUERY_GROUPSIZE)
 	{
-		CulledList culledObjects;
-		spTree->getVisible(ray, culledObjects);
-
-		if (culledObjects.empty())
+		wiJobSystem::context ctx;
+		wiJobSystem::Dispatch(ctx, count, SCENEQUERY_GROUPSIZE, [&](wiJobSystem::JobDispatchArgs args) {
+			query(args.jobIndex);
+		});
+		wiJobSystem::Wait(ctx);
+	}
+	else
+	{
+		for (uint32_t i = 0; i < count; ++i)
 		{
-			return result;
+			query(i);
 		}
+	}
+}
+// Whether the scene queries consider the object
+static bool IsSceneQueryable(Object* object, UINT renderTypeMask, uint32_t layerMask, bool dynamicObjects, bool onlyVisible)
+{
+	if (object->mesh == nullptr || !(object->GetLayerMask() & layerMask))
+	{
+		return false;
+	}
+	if (!(renderTypeMask & object->GetRenderTypes()))
+	{
+		return false;
+	}
+	if (!dynamicObjects && object->isDynamic())
+	{
+		return false;
+	}
+	if (onlyVisible && object->IsOccluded() && wiRenderer::GetOcclusionCullingEnabled())
+	{
+		return false;
+	}
+	return true;
+}
+// Trace a ray against the candidate objects, the mesh hierarchies must be up to date. It only reads the scene, so rays can be traced in parallel
+static void TraceRay(const RAY& ray, const CulledList& candidates, UINT renderTypeMask, uint32_t layerMask, bool dynamicObjects, bool onlyVisible,
+	wiRenderer::RayIntersectWorldResult& result)
+{
+	const XMVECTOR rayOrigin = XMLoadFloat3(&ray.origin);
+	const XMVECTOR rayDirection = XMVector3Normalize(XMLoadFloat3(&ray.direction));
+	const XMVECTOR rayDirection_inverse = XMVectorReciprocal(rayDirection);
 
-		const XMVECTOR rayOrigin = XMLoadFloat3(&ray.origin);
-		const XMVECTOR rayDirection = XMVector3Normalize(XMLoadFloat3(&ray.direction));
-
-		// pre allocate helper vector array:
-		static size_t _arraySize = 10000;
-		static XMVECTOR* _vertices = (XMVECTOR*)_mm_malloc(sizeof(XMVECTOR)*_arraySize, 16);
-
-		for (Cullable* culled : culledObjects)
+	// Order the objects front to back by where the ray enters their bounds, then the farther ones can be skipped after a hit:
+	vector<pair<float, Object*>> objects;
+	objects.reserve(candidates.size());
+	for (Cullable* culled : candidates)
+	{
+		Object* object = (Object*)culled;
+		if (!IsSceneQueryable(object, renderTypeMask, layerMask, dynamicObjects, onlyVisible))
 		{
-			Object* object = (Object*)culled;
-
-			const uint32_t objectLayerMask = object->GetLayerMask();
-			if (objectLayerMask & layerMask)
-			{
+			continue;
+		}
+		const XMFLOAT3 aabbMin = object->bounds.getMin();
+		const XMFLOAT3 aabbMax = object->bounds.getMax();
+		const XMVECTOR t1 = XMVectorMultiply(XMVectorSubtract(XMLoadFloat3(&aabbMin), rayOrigin), rayDirection_inverse);
+		const XMVECTOR t2 = XMVectorMultiply(XMVectorSubtract(XMLoadFloat3(&aabbMax), rayOrigin), rayDirection_inverse);
+		const XMVECTOR tmin = XMVectorMin(t1, t2);
+		float entry = max(max(XMVectorGetX(tmin), XMVectorGetY(tmin)), max(XMVectorGetZ(tmin), 0.0f));
+		if (!(entry >= 0))
+		{
+			entry = 0; // NaN from a ray starting on an axis aligned face, keep the object
+		}
+		objects.push_back(make_pair(entry, object));
+	}
+	sort(objects.begin(), objects.end(), [](const pair<float, Object*>& a, const pair<float, Object*>& b) {
+		return a.first < b.first;
+	});
 
-				if (!(renderTypeMask & object->GetRenderTypes()))
-				{
-					continue;
-				}
-				if (!dynamicObjects && object->isDynamic())
-				{
-					continue;
-				}
-				if (onlyVisible && object->IsOccluded() && GetOcclusionCullingEnabled())
-				{
-					continue;
-				}
+	for (auto& x : objects)
+	{
+		if (x.first >= result.distance)
+		{
+			break;
+		}
+		Object* object = x.second;
+		Mesh* mesh = object->mesh;
 
-				Mesh* mesh = object->mesh;
-				if (mesh->vertices_POS.size() >= _arraySize)
-				{
-					// grow preallocated vector helper array
-					_mm_free(_vertices);
-					_arraySize = (mesh->vertices_POS.size() + 1) * 2;
-					_vertices = (XMVECTOR*)_mm_malloc(sizeof(XMVECTOR)*_arraySize, 16);
-				}
+		const XMMATRIX objectMat = object->getMatrix();
+		const XMMATRIX objectMat_Inverse = XMMatrixInverse(nullptr, objectMat);
 
-				const XMMATRIX objectMat = object->getMatrix();
-				const XMMATRIX objectMat_Inverse = XMMatrixInverse(nullptr, objectMat);
+		// The local direction is not normalized, this way the hit distance in object space is the same as in world space:
+		XMFLOAT3 rayOrigin_local, rayDirection_local;
+		XMStoreFloat3(&rayOrigin_local, XMVector3Transform(rayOrigin, objectMat_Inverse));
+		XMStoreFloat3(&rayDirection_local, XMVector3TransformNormal(rayDirection, objectMat_Inverse));
 
-				const XMVECTOR rayOrigin_local = XMVector3Transform(rayOrigin, objectMat_Inverse);
-				const XMVECTOR rayDirection_local = XMVector3Normalize(XMVector3TransformNormal(rayDirection, objectMat_Inverse));
+		wiTriangleBVH::Hit hit;
+		hit.distance = result.distance;
+		if (mesh->bvh.Intersect(rayOrigin_local, rayDirection_local, hit))
+		{
+			XMVECTOR pos = XMVectorAdd(rayOrigin, XMVectorScale(rayDirection, hit.distance));
+			XMVECTOR nor = XMVector3Normalize(XMVector3TransformNormal(XMVector3Normalize(XMLoadFloat3(&hit.normal)), objectMat));
 
-				Mesh::Vertex_FULL _tmpvert;
+			result.object = object;
+			XMStoreFloat3(&result.position, pos);
+			XMStoreFloat3(&result.normal, nor);
+			result.distance = hit.distance;
+			result.subsetIndex = (int)mesh->vertices_POS[mesh->indices[hit.triangle * 3]].GetMaterialIndex();
+		}
+	}
+}
 
-				if (object->isArmatureDeformed() && !object->mesh->armature->boneCollection.empty())
-				{
-					for (size_t i = 0; i < mesh->vertices_POS.size(); ++i)
-					{
-						_tmpvert = mesh->TransformVertex((int)i);
-						_vertices[i] = XMLoadFloat4(&_tmpvert.pos);
-					}
-				}
-				else if (mesh->hasDynamicVB())
-				{
-					for (size_t i = 0; i < mesh->vertices_Transformed_POS.size(); ++i)
-					{
-						_vertices[i] = mesh->vertices_Transformed_POS[i].LoadPOS();
-					}
-				}
-				else
-				{
-					for (size_t i = 0; i < mesh->vertices_POS.size(); ++i)
-					{
-						_vertices[i] = mesh->vertices_POS[i].LoadPOS();
-					}
-				}
+wiRenderer::RayIntersectWorldResult wiRenderer::RayIntersectWorld(const RAY& ray, UINT renderTypeMask, uint32_t layerMask, bool dynamicObjects, bool onlyVisible)
+{
+	RayIntersectWorldResult result;
+	RayIntersectWorld(&ray, 1, &result, renderTypeMask, layerMask, dynamicObjects, onlyVisible);
+	return result;
+}
+void wiRenderer::RayIntersectWorld(const RAY* rays, uint32_t rayCount, RayIntersectWorldResult* results, UINT renderTypeMask, uint32_t layerMask, bool dynamicObjects, bool onlyVisible)
+{
+	for (uint32_t i = 0; i < rayCount; ++i)
+	{
+		results[i] = RayIntersectWorldResult();
+	}
+	if (spTree == nullptr || rayCount == 0)
+	{
+		return;
+	}
 
-				for (size_t i = 0; i < mesh->indices.size(); i += 3)
-				{
-					int i0 = mesh->indices[i], i1 = mesh->indices[i + 1], i2 = mesh->indices[i + 2];
-					float distance;
-					if (TriangleTests::Intersects(rayOrigin_local, rayDirection_local, _vertices[i0], _vertices[i1], _vertices[i2], distance))
-					{
-						XMVECTOR pos = XMVector3Transform(XMVectorAdd(rayOrigin_local, rayDirection_local*distance), objectMat);
-						distance = wiMath::Distance(pos, rayOrigin);
+	// Candidate objects of every ray from the scene tree, its queries are thread safe:
+	vector<CulledList> candidates(rayCount);
+	ExecuteSceneQueries(rayCount, [&](uint32_t i) {
+		spTree->getVisible(rays[i], candidates[i]);
+	});
 
-						if (distance < result.distance)
-						{
-							XMVECTOR nor = XMVector3Normalize(XMVector3TransformNormal(XMVector3Normalize(XMVector3Cross(XMVectorSubtract(_vertices[i2], _vertices[i1]), XMVectorSubtract(_vertices[i1], _vertices[i0]))), objectMat));
+	// Bring the triangle hierarchies of the candidate meshes up to date, once per mesh (meshes can be shared by objects):
+	unordered_map<Mesh*, bool> meshes;
+	for (const CulledList& list : candidates)
+	{
+		for (Cullable* culled : list)
+		{
+			Object* object = (Object*)culled;
+			if (IsSceneQueryable(object, renderTypeMask, layerMask, dynamicObjects, onlyVisible))
+			{
+				meshes[object->mesh] = object->isArmatureDeformed();
+			}
+		}
+	}
+	if (meshes.size() > 1)
+	{
+		vector<pair<Mesh*, bool>> meshArray(meshes.begin(), meshes.end());
+		wiJobSystem::context ctx;
+		wiJobSystem::Dispatch(ctx, (uint32_t)meshArray.size(), 1, [&](wiJobSystem::JobDispatchArgs args) {
+			meshArray[args.jobIndex].first->GetBVH(meshArray[args.jobIndex].second);
+		});
+		wiJobSystem::Wait(ctx);
+	}
+	else if (!meshes.empty())
+	{
+		meshes.begin()->first->GetBVH(meshes.begin()->second);
+	}
 
-							result.object = object;
-							XMStoreFloat3(&result.position, pos);
-							XMStoreFloat3(&result.normal, nor);
-							result.distance = distance;
-							result.subsetIndex = (int)mesh->vertices_POS[i0].GetMaterialIndex();
-						}
-					}
-				}
+	// Trace:
+	ExecuteSceneQueries(rayCount, [&](uint32_t i) {
+		TraceRay(rays[i], candidates[i], renderTypeMask, layerMask, dynamicObjects, onlyVisible, results[i]);
+	});
+}
+// Gather the queryable objects overlapping every shape into the flat result
+template<typename T>
+static void OverlapWorld(const T* shapes, uint32_t shapeCount, wiRenderer::OverlapWorldResult& result, UINT renderTypeMask, uint32_t layerMask, bool dynamicObjects, bool onlyVisible)
+{
+	result.objects.clear();
+	result.offsets.assign(shapeCount + 1, 0);
+	if (wiRenderer::spTree == nullptr || shapeCount == 0)
+	{
+		return;
+	}
 
-			}
+	vector<CulledList> culled(shapeCount);
+	ExecuteSceneQueries(shapeCount, [&](uint32_t i) {
+		CulledList& list = culled[i];
+		wiRenderer::spTree->getVisible(shapes[i], list);
+		list.erase(remove_if(list.begin(), list.end(), [&](Cullable* x) {
+			return !IsSceneQueryable((Object*)x, renderTypeMask, layerMask, dynamicObjects, onlyVisible);
+		}), list.end());
+	});
 
+	for (uint32_t i = 0; i < shapeCount; ++i)
+	{
+		result.offsets[i + 1] = result.offsets[i] + (uint32_t)culled[i].size();
+	}
+	result.objects.resize(result.offsets.back());
+	for (uint32_t i = 0; i < shapeCount; ++i)
+	{
+		for (size_t j = 0; j < culled[i].size(); ++j)
+		{
+			result.objects[result.offsets[i] + j] = (Object*)culled[i][j];
 		}
 	}
-
-	return result;
+}
+void wiRenderer::SphereIntersectWorld(const SPHERE* spheres, uint32_t sphereCount, OverlapWorldResult& result, UINT renderTypeMask, uint32_t layerMask, bool dynamicObjects, bool onlyVisible)
+{
+	OverlapWorld(spheres, sphereCount, result, renderTypeMask, layerMask, dynamicObjects, onlyVisible);
+}
+void wiRenderer::BoxIntersectWorld(const AABB* boxes, uint32_t boxCount, OverlapWorldResult& result, UINT renderTypeMask, uint32_t layerMask, bool dynamicObjects, bool onlyVisible)
+{
+	OverlapWorld(boxes, boxCount, result, renderTypeMask, layerMask, dynamicObjects, onlyVisible);
 }
 
 Model* wiRenderer::LoadModel(const std::string& fileName, const XMMATRIX& transform)
@@ -7905,13 +8336,11 @@ void wiRenderer::LoadDefaultLighting()
 	model->lights.insert(defaultLight);
 	GetScene().models.push_back(model);
 
-	if (spTree_lights) {
-		spTree_lights->AddObjects(spTree_lights->root, std::vector<Cullable*>(model->lights.begin(), model->lights.end()));
-	}
-	else
+	if (spTree_lights == nullptr)
 	{
-		spTree_lights = new Octree(std::vector<Cullable*>(model->lights.begin(), model->lights.end()));
+		spTree_lights = new wiSPTree;
 	}
+	spTree_lights->AddObjects(std::vector<Cullable*>(model->lights.begin(), model->lights.end()));
 }
 Scene& wiRenderer::GetScene()
 {
@@ -7926,9 +8355,13 @@ void wiRenderer::SynchronizeWithPhysicsEngine(float dt)
 {
 	if (physicsEngine && GetGameSpeed())
 	{
+		// The simulation steps on its own thread, the world is only modified between its steps:
+		physicsEngine->MarkForWrite();
+
 		physicsEngine->addWind(GetScene().worldInfo.windDirection);
 
 		// Update physics world data
+		vector<Object*> newObjects;
 		for (Model* model : GetScene().models)
 		{
 			for (Object* object : model->objects) 
@@ -7938,8 +8371,8 @@ void wiRenderer::SynchronizeWithPhysicsEngine(float dt)
 
 				if (pI < 0 && (object->rigidBody || mesh->softBody))
 				{
-					// Register the objects with physics attributes that doesn't exist in the simulation
-					physicsEngine->registerObject(object);
+					// The objects with physics attributes that doesn't exist in the simulation are registered together
+					newObjects.push_back(object);
 				}
 
 				if (pI >= 0) 
@@ -7949,15 +8382,30 @@ void wiRenderer::SynchronizeWithPhysicsEngine(float dt)
 						int gvg = mesh->goalVG;
 						if (gvg >= 0)
 						{
-							XMMATRIX worldMat = mesh->hasArmature() ? XMMatrixIdentity() : XMLoadFloat4x4(&object->world);
 							int j = 0;
-							for (std::map<int, float>::iterator it = mesh->vertexGroups[gvg].vertices.begin(); it != mesh->vertexGroups[gvg].vertices.end(); ++it)
+							if (mesh->hasArmature())
+							{
+								// The goal is in armature space, the skinned mesh is shared with picking:
+								const Mesh::SkinnedVertices& skinned = mesh->GetSkinnedVertices();
+								for (std::map<int, float>::iterator it = mesh->vertexGroups[gvg].vertices.begin(); it != mesh->vertexGroups[gvg].vertices.end(); ++it)
+								{
+									int vi = (*it).first;
+									mesh->goalPositions[j] = XMFLOAT3(skinned.posX[vi], skinned.posY[vi], skinned.posZ[vi]);
+									mesh->goalNormals[j] = XMFLOAT3(skinned.norX[vi], skinned.norY[vi], skinned.norZ[vi]);
+									++j;
+								}
+							}
+							else
 							{
-								int vi = (*it).first;
-								Mesh::Vertex_FULL tvert = mesh->TransformVertex(vi, worldMat);
-								mesh->goalPositions[j] = XMFLOAT3(tvert.pos.x, tvert.pos.y, tvert.pos.z);
-								mesh->goalNormals[j] = XMFLOAT3(tvert.nor.x, tvert.nor.y, tvert.nor.z);
-								++j;
+								XMMATRIX worldMat = XMLoadFloat4x4(&object->world);
+								for (std::map<int, float>::iterator it = mesh->vertexGroups[gvg].vertices.begin(); it != mesh->vertexGroups[gvg].vertices.end(); ++it)
+								{
+									int vi = (*it).first;
+									Mesh::Vertex_FULL tvert = mesh->TransformVertex(vi, worldMat);
+									mesh->goalPositions[j] = XMFLOAT3(tvert.pos.x, tvert.pos.y, tvert.pos.z);
+									mesh->goalNormals[j] = XMFLOAT3(tvert.nor.x, tvert.nor.y, tvert.nor.z);
+									++j;
+								}
 							}
 						}
 						physicsEngine->connectSoftBodyToVertices(
@@ -7972,10 +8420,18 @@ void wiRenderer::SynchronizeWithPhysicsEngine(float dt)
 			}
 		}
 
-		// Run physics simulation
+		if (!newObjects.empty())
+		{
+			physicsEngine->registerObjects(newObjects.data(), newObjects.size());
+		}
+
+		physicsEngine->UnMarkForWrite();
+
+		// Advance the physics simulation, it doesn't wait for the steps:
 		physicsEngine->Update(dt);
 
-		// Retrieve physics simulation data
+		// Retrieve physics simulation data, interpolated between the last two steps:
+		physicsEngine->MarkForRead();
 		for (Model* model : GetScene().models)
 		{
 			for (Object* object : model->objects) {
@@ -7994,7 +8450,7 @@ void wiRenderer::SynchronizeWithPhysicsEngine(float dt)
 				}
 			}
 		}
-
+		physicsEngine->UnMarkForRead();
 
 		physicsEngine->NextRunWorld();
 	}
@@ -8034,16 +8490,16 @@ void wiRenderer::CreateImpostor(Mesh* mesh, GRAPHICSTHREAD threadID)
 		InstancePrev instancePrev;
 	};
 	UINT instancesOffset; 
-	volatile InstBuf* buff = (volatile InstBuf*)GetDevice()->AllocateFromRingBuffer(dynamicVertexBufferPool, sizeof(InstBuf), instancesOffset, threadID);
+	volatile InstBuf* buff = (volatile InstBuf*)GetDevice()->AllocateFromRingBuffer(dynamicVertexBufferPools[threadID], sizeof(InstBuf), instancesOffset, threadID);
 	buff->instance.Create(__identity);
 	buff->instancePrev.Create(__identity);
-	GetDevice()->InvalidateBufferAccess(dynamicVertexBufferPool, threadID);
+	GetDevice()->InvalidateBufferAccess(dynamicVertexBufferPools[threadID], threadID);
 
 	GPUBuffer* vbs[] = {
-		mesh->hasDynamicVB() ? dynamicVertexBufferPool : (mesh->streamoutBuffer_POS != nullptr ? mesh->streamoutBuffer_POS : mesh->vertexBuffer_POS),
+		mesh->hasDynamicVB() ? dynamicVertexBufferPools[GRAPHICSTHREAD_IMMEDIATE] : (mesh->streamoutBuffer_POS != nullptr ? mesh->streamoutBuffer_POS : mesh->vertexBuffer_POS),
 		mesh->vertexBuffer_TEX,
-		mesh->hasDynamicVB() ? dynamicVertexBufferPool : (mesh->streamoutBuffer_PRE != nullptr ? mesh->streamoutBuffer_PRE : mesh->vertexBuffer_POS),
-		dynamicVertexBufferPool
+		mesh->hasDynamicVB() ? dynamicVertexBufferPools[GRAPHICSTHREAD_IMMEDIATE] : (mesh->streamoutBuffer_PRE != nullptr ? mesh->streamoutBuffer_PRE : mesh->vertexBuffer_POS),
+		dynamicVertexBufferPools[threadID]
 	};
 	UINT strides[] = {
 		sizeof(Mesh::Vertex_POS),
@@ -8189,27 +8645,21 @@ void wiRenderer::AddModel(Model* model)
 	// add object batch 
 	{
 		vector<Cullable*> collection(model->objects.begin(), model->objects.end());
-		if (spTree != nullptr)
-		{
-			spTree->AddObjects(spTree->root, collection);
-		}
-		else
+		if (spTree == nullptr)
 		{
-			spTree = new Octree(collection);
+			spTree = new wiSPTree;
 		}
+		spTree->AddObjects(collection);
 	}
 
 	// add light batch
 	{
 		vector<Cullable*> collection(model->lights.begin(), model->lights.end());
-		if (spTree_lights != nullptr)
-		{
-			spTree_lights->AddObjects(spTree_lights->root, collection);
-		}
-		else
+		if (spTree_lights == nullptr)
 		{
-			spTree_lights = new Octree(collection);
+			spTree_lights = new wiSPTree;
 		}
+		spTree_lights->AddObjects(collection);
 	}
 }
 
@@ -8228,17 +8678,15 @@ void wiRenderer::Add(Object* value)
 	{
 		value->attachTo(GetScene().GetWorldNode());
 	}
+	GetScene().InvalidateLookups();
 
 	vector<Cullable*> collection(0);
 	collection.push_back(value);
-	if (spTree != nullptr) 
-	{
-		spTree->AddObjects(spTree->root, collection);
-	}
-	else
+	if (spTree == nullptr)
 	{
-		spTree = new Octree(collection);
+		spTree = new wiSPTree;
 	}
+	spTree->AddObjects(collection);
 }
 void wiRenderer::Add(Light* value)
 {
@@ -8255,17 +8703,15 @@ void wiRenderer::Add(Light* value)
 	{
 		value->attachTo(GetScene().GetWorldNode());
 	}
+	GetScene().InvalidateLookups();
 
 	vector<Cullable*> collection(0);
 	collection.push_back(value);
-	if (spTree_lights != nullptr) 
-	{
-		spTree_lights->AddObjects(spTree_lights->root, collection);
-	}
-	else
+	if (spTree_lights == nullptr)
 	{
-		spTree_lights = new Octree(collection);
+		spTree_lights = new wiSPTree;
 	}
+	spTree_lights->AddObjects(collection);
 }
 void wiRenderer::Add(ForceField* value)
 {
@@ -8282,6 +8728,7 @@ void wiRenderer::Add(ForceField* value)
 	{
 		value->attachTo(GetScene().GetWorldNode());
 	}
+	GetScene().InvalidateLookups();
 }
 void wiRenderer::Add(Camera* value)
 {
@@ -8298,6 +8745,7 @@ void wiRenderer::Add(Camera* value)
 	{
 		value->attachTo(GetScene().GetWorldNode());
 	}
+	GetScene().InvalidateLookups();
 }
 
 void wiRenderer::Remove(Object* value)
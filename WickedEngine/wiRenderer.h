@@ -8,6 +8,8 @@
 #include "wiFrustum.h"
 
 #include <unordered_set>
+#include <unordered_map>
+#include <list>
 #include <deque>
 
 namespace wiSceneComponents
@@ -76,7 +78,8 @@ public:
 	static wiGraphicsTypes::Texture				*textures[TEXTYPE_LAST];
 	static wiGraphicsTypes::Sampler				*customsamplers[SSTYPE_LAST];
 
-	static wiGraphicsTypes::GPURingBuffer		*dynamicVertexBufferPool;
+	// Per-context ring buffers. Dynamic vertex buffers of meshes (soft bodies) are always in the immediate context's
+	static wiGraphicsTypes::GPURingBuffer		*dynamicVertexBufferPools[GRAPHICSTHREAD_COUNT];
 
 	static const wiGraphicsTypes::FORMAT RTFormat_ldr = wiGraphicsTypes::FORMAT_R8G8B8A8_UNORM;
 	static const wiGraphicsTypes::FORMAT RTFormat_hdr = wiGraphicsTypes::FORMAT_R16G16B16A16_FLOAT;
@@ -271,6 +274,8 @@ protected:
 
 	static bool debugLightCulling;
 	static bool occlusionCulling;
+	static bool softwareOcclusionCulling;
+	static bool meshletCulling;
 	static bool temporalAA, temporalAADEBUG;
 	static bool freezeCullingCamera;
 
@@ -302,6 +307,8 @@ protected:
 
 public:
 	static std::string SHADERPATH;
+	// Compiled pipeline states are saved to this file after the shaders are loaded, and reused by the driver on the next startup
+	static std::string PIPELINECACHEPATH;
 
 	static void SetUpStaticComponents();
 	static void CleanUpStatic();
@@ -355,6 +362,10 @@ public:
 	static bool GetAlphaCompositionEnabled() { return ALPHACOMPOSITIONENABLED; }
 	static void SetOcclusionCullingEnabled(bool enabled); // also inits query pool!
 	static bool GetOcclusionCullingEnabled() { return occlusionCulling; }
+	static void SetSoftwareOcclusionCullingEnabled(bool enabled) { softwareOcclusionCulling = enabled; } // culls the objects behind the occluder meshes on the CPU (see Mesh::occluder)
+	static bool GetSoftwareOcclusionCullingEnabled() { return softwareOcclusionCulling; }
+	static void SetMeshletCullingEnabled(bool enabled) { meshletCulling = enabled; }
+	static bool GetMeshletCullingEnabled() { return meshletCulling; }
 	static void SetLDSSkinningEnabled(bool enabled) { ldsSkinningEnabled = enabled; }
 	static bool GetLDSSkinningEnabled() { return ldsSkinningEnabled; }
 	static void SetTemporalAAEnabled(bool enabled) { temporalAA = enabled; }
@@ -399,6 +410,9 @@ public:
 
 	static void ReloadShaders(const std::string& path = "");
 	static void BindPersistentState(GRAPHICSTHREAD threadID);
+	// Bind the persistent state and the resources that are shared by every pass in a frame (entity arrays, shadow maps, environment probes, voxel radiance, decal atlas).
+	//	A deferred context starts without any state, so it must be called before recording passes on it.
+	static void BindCommonResources(GRAPHICSTHREAD threadID);
 
 	struct FrameCulling
 	{
@@ -411,6 +425,15 @@ public:
 		std::list<wiSceneComponents::Decal*> culledDecals;
 		std::list<wiSceneComponents::EnvironmentProbe*> culledEnvProbes;
 
+		// Shadow casters of a light for every shadow camera that it uses (directional light cascades)
+		struct ShadowCulling
+		{
+			CulledCollection culledRenderer[3];
+			bool transparentShadowsRequested[3];
+		};
+		// Indexed the same as culledLights. Only filled for the main camera
+		std::vector<ShadowCulling> culledShadows;
+
 		void Clear()
 		{
 			culledRenderer.clear();
@@ -444,12 +467,14 @@ public:
 	static void BindGBufferTextures(wiGraphicsTypes::Texture2D* slot0, wiGraphicsTypes::Texture2D* slot1, wiGraphicsTypes::Texture2D* slot2, wiGraphicsTypes::Texture2D* slot3, wiGraphicsTypes::Texture2D* slot4, GRAPHICSTHREAD threadID);
 	static void BindDepthTextures(wiGraphicsTypes::Texture2D* depth, wiGraphicsTypes::Texture2D* linearDepth, GRAPHICSTHREAD threadID);
 	
+	// camera: if it is provided, the meshlets of single instance meshes are culled against it and only the visible ones are drawn
 	static void RenderMeshes(const XMFLOAT3& eye, const CulledCollection& culledRenderer, SHADERTYPE shaderType, UINT renderTypeFlags, GRAPHICSTHREAD threadID, 
-		bool tessellation = false, bool occlusionCulling = false, uint32_t layerMask = 0xFFFFFFFF);
+		bool tessellation = false, bool occlusionCulling = false, uint32_t layerMask = 0xFFFFFFFF, const wiSceneComponents::Camera* camera = nullptr);
 	static void DrawSky(GRAPHICSTHREAD threadID);
 	static void DrawSun(GRAPHICSTHREAD threadID);
 	static void DrawWorld(wiSceneComponents::Camera* camera, bool tessellation, GRAPHICSTHREAD threadID, SHADERTYPE shaderType, bool grass, bool occlusionCulling, uint32_t layerMask = 0xFFFFFFFF);
-	static void DrawForShadowMap(GRAPHICSTHREAD threadID, uint32_t layerMask = 0xFFFFFFFF);
+	static void DrawForShadowMap2D(GRAPHICSTHREAD threadID, uint32_t layerMask = 0xFFFFFFFF);
+	static void DrawForShadowMapCube(GRAPHICSTHREAD threadID, uint32_t layerMask = 0xFFFFFFFF);
 	static void DrawWorldTransparent(wiSceneComponents::Camera* camera, SHADERTYPE shaderType, GRAPHICSTHREAD threadID, bool grass, bool occlusionCulling, uint32_t layerMask = 0xFFFFFFFF);
 	static void DrawDebugWorld(wiSceneComponents::Camera* camera, GRAPHICSTHREAD threadID);
 	static void DrawSoftParticles(wiSceneComponents::Camera* camera, bool distortion, GRAPHICSTHREAD threadID);
@@ -527,7 +552,24 @@ public:
 		float distance = FLT_MAX;
 		int subsetIndex = -1;
 	};
+	// Closest hit of a ray against the triangles of the scene. The objects are tested front to back by their bounds with the per-mesh triangle hierarchies (see Mesh::GetBVH())
 	static RayIntersectWorldResult RayIntersectWorld(const RAY& ray, UINT renderTypeMask = RENDERTYPE_OPAQUE, uint32_t layerMask = 0xFFFFFFFF, bool dynamicObjects = true, bool onlyVisible = false);
+	// Trace many rays at once, they are distributed among the job system threads. results must hold rayCount elements
+	static void RayIntersectWorld(const RAY* rays, uint32_t rayCount, RayIntersectWorldResult* results, UINT renderTypeMask = RENDERTYPE_OPAQUE, uint32_t layerMask = 0xFFFFFFFF, bool dynamicObjects = true, bool onlyVisible = false);
+
+	// Objects overlapped by a batch of shapes, in one flat array
+	struct OverlapWorldResult
+	{
+		std::vector<wiSceneComponents::Object*> objects;
+		std::vector<uint32_t> offsets; // the objects of shape i are [offsets[i], offsets[i + 1]), there is one more offset than shapes
+
+		uint32_t GetCount(uint32_t shape) const { return offsets[shape + 1] - offsets[shape]; }
+		wiSceneComponents::Object* const* GetObjects(uint32_t shape) const { return objects.data() + offsets[shape]; }
+	};
+	// Objects whose bounds overlap the spheres or boxes. The shapes are distributed among the job system threads.
+	//	The scene queries only read the scene (apart from the per-mesh caches which are locked), so they can be issued from any thread, but not while the scene is being updated.
+	static void SphereIntersectWorld(const SPHERE* spheres, uint32_t sphereCount, OverlapWorldResult& result, UINT renderTypeMask = RENDERTYPE_OPAQUE, uint32_t layerMask = 0xFFFFFFFF, bool dynamicObjects = true, bool onlyVisible = false);
+	static void BoxIntersectWorld(const AABB* boxes, uint32_t boxCount, OverlapWorldResult& result, UINT renderTypeMask = RENDERTYPE_OPAQUE, uint32_t layerMask = 0xFFFFFFFF, bool dynamicObjects = true, bool onlyVisible = false);
 
 
 	static PHYSICS* physicsEngine;
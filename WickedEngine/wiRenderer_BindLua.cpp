@@ -559,6 +559,32 @@ namespace wiRenderer_BindLua
 		}
 		return 0;
 	}
+	int SetSoftwareOcclusionCullingEnabled(lua_State* L)
+	{
+		int argc = wiLua::SGetArgCount(L);
+		if (argc > 0)
+		{
+			wiRenderer::SetSoftwareOcclusionCullingEnabled(wiLua::SGetBool(L, 1));
+		}
+		else
+		{
+			wiLua::SError(L, "SetSoftwareOcclusionCullingEnabled(bool enabled) not enough arguments!");
+		}
+		return 0;
+	}
+	int SetMeshletCullingEnabled(lua_State* L)
+	{
+		int argc = wiLua::SGetArgCount(L);
+		if (argc > 0)
+		{
+			wiRenderer::SetMeshletCullingEnabled(wiLua::SGetBool(L, 1));
+		}
+		else
+		{
+			wiLua::SError(L, "SetMeshletCullingEnabled(bool enabled) not enough arguments!");
+		}
+		return 0;
+	}
 
 	int Pick(lua_State* L)
 	{
@@ -751,6 +777,8 @@ namespace wiRenderer_BindLua
 			wiLua::GetGlobal()->RegisterFunc("SetResolution", SetResolution);
 			wiLua::GetGlobal()->RegisterFunc("SetDebugLightCulling", SetDebugLightCulling);
 			wiLua::GetGlobal()->RegisterFunc("SetOcclusionCullingEnabled", SetOcclusionCullingEnabled);
+			wiLua::GetGlobal()->RegisterFunc("SetSoftwareOcclusionCullingEnabled", SetSoftwareOcclusionCullingEnabled);
+			wiLua::GetGlobal()->RegisterFunc("SetMeshletCullingEnabled", SetMeshletCullingEnabled);
 
 			wiLua::GetGlobal()->RegisterFunc("Pick", Pick);
 			wiLua::GetGlobal()->RegisterFunc("DrawLine", DrawLine);
@@ -3,10 +3,20 @@
 #include "wiSound.h"
 #include "wiHelper.h"
 #include "wiTextureHelper.h"
+#include "wiCpuInfo.h"
+#include "wiTextureCompressor.h"
 
 #include "Utility/stb_image.h"
 #include "Utility/nv_dds.h"
 
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+#include <sys/stat.h>
+
 using namespace std;
 using namespace wiGraphicsTypes;
 
@@ -19,12 +29,114 @@ static const std::map<std::string, wiResourceManager::Data_Type> types = {
 };
 
 wiResourceManager* wiResourceManager::globalResources = nullptr;
+wiResourceManager::TEXTURE_COMPRESSION wiResourceManager::textureCompression = wiResourceManager::TEXTURE_COMPRESSION_FAST;
+bool wiResourceManager::textureCacheEnabled = true;
+
+// Increment it when the texture processing changes, to invalidate the cached textures:
+static const uint32_t TEXTURE_CACHE_VERSION = 2;
+
+struct wiResourceManager::FileData
+{
+	// dds:
+	nv_dds::CDDSImage dds;
+
+	// png, tga, jpg, etc. with the generated mip chain:
+	wiTextureCompressor::Image image;
+
+	// shaders:
+	BYTE* buffer = nullptr;
+	size_t bufferSize = 0;
+
+	~FileData()
+	{
+		SAFE_DELETE_ARRAY(buffer);
+	}
+};
+
+// Threads that execute the addAsync() requests. They are separate from the wiJobSystem,
+//	because a thread that waits for jobs in the middle of a frame could pick up a long file read.
+static mutex loaderMutex;
+static condition_variable loaderCondition;
+static deque<function<void()>> loaderQueue;
+static void SubmitLoaderJob(function<void()>&& job)
+{
+	static once_flag initialized;
+	call_once(initialized, [] {
+		const int threadCount = max(2, min(4, wiCpuInfo::GetCoreCount() / 2));
+		for (int i = 0; i < threadCount; ++i)
+		{
+			thread worker([] {
+				while (true)
+				{
+					function<void()> job;
+					{
+						unique_lock<mutex> lock(loaderMutex);
+						loaderCondition.wait(lock, [] { return !loaderQueue.empty(); });
+						job = std::move(loaderQueue.front());
+						loaderQueue.pop_front();
+					}
+					job();
+				}
+			});
+			worker.detach();
+		}
+	});
+
+	{
+		lock_guard<mutex> lock(loaderMutex);
+		loaderQueue.push_back(std::move(job));
+	}
+	loaderCondition.notify_one();
+}
+
+static bool GetResourceType(const string& nameStr, wiResourceManager::Data_Type newType, wiResourceManager::Data_Type& type)
+{
+	// dynamic type selection:
+	if (newType == wiResourceManager::Data_Type::DYNAMIC)
+	{
+		string ext = wiHelper::toUpper(nameStr.substr(nameStr.length() - 3, nameStr.length()));
+		auto& it = types.find(ext);
+		if (it == types.end())
+		{
+			return false;
+		}
+		type = it->second;
+	}
+	else
+	{
+		type = newType;
+	}
+	return true;
+}
+
+// Every manager that exists, so that UpdateAllAsyncLoads() can finish the background loads of all of them.
+//	It is created on first use, because managers are members of global components that are constructed before the statics of this file.
+//	The mutex is recursive because creating a resource can construct a new manager (for example the first GetShaderManager() call).
+struct ManagerList
+{
+	recursive_mutex locker;
+	vector<wiResourceManager*> items;
+};
+static ManagerList& GetManagerList()
+{
+	static ManagerList managers;
+	return managers;
+}
 
 wiResourceManager::wiResourceManager():wiThreadSafeManager()
 {
+	ManagerList& managers = GetManagerList();
+	managers.locker.lock();
+	managers.items.push_back(this);
+	managers.locker.unlock();
 }
 wiResourceManager::~wiResourceManager()
 {
+	ManagerList& managers = GetManagerList();
+	managers.locker.lock();
+	managers.items.erase(find(managers.items.begin(), managers.items.end(), this));
+	managers.locker.unlock();
+
 	CleanUp();
 }
 wiResourceManager* wiResourceManager::GetGlobal()
@@ -65,298 +177,378 @@ const wiResourceManager::Resource* wiResourceManager::get(const wiHashString& na
 
 void* wiResourceManager::add(const wiHashString& name, Data_Type newType)
 {
-	const Resource* res = get(name,true);
-	if(!res)
+	LOCK();
+	auto& it = resources.find(name);
+	if (it != resources.end())
 	{
-		string nameStr = name.GetString();
-		string ext = wiHelper::toUpper(nameStr.substr(nameStr.length() - 3, nameStr.length()));
-		Data_Type type;
-
-		// dynamic type selection:
-		if(newType==Data_Type::DYNAMIC){
-			auto& it = types.find(ext);
-			if(it!=types.end())
-				type = it->second;
-			else 
-				return nullptr;
-		}
-		else 
-			type = newType;
+		it->second->refCount++;
+		UNLOCK();
+		return it->second->data;
+	}
+	auto& pending = pendingLoads.find(name);
+	if (pending != pendingLoads.end())
+	{
+		// It is already loading in the background, finish it now:
+		AsyncHandle handle = pending->second;
+		handle->requestCount++;
+		UNLOCK();
+		FinishAsyncLoad(handle);
+		return handle->data;
+	}
 
-		void* success = nullptr;
+	string nameStr = name.GetString();
+	Data_Type type;
+	if (!GetResourceType(nameStr, newType, type))
+	{
+		UNLOCK();
+		return nullptr;
+	}
 
-		switch(type){
-		case Data_Type::IMAGE:
+	// It is registered as a pending load, so that other threads requesting the same resource meanwhile wait for this one instead of loading it again:
+	AsyncHandle handle = make_shared<AsyncResource>(name, type);
+	handle->claimed.store(true);
+	pendingLoads.insert(make_pair(name, handle));
+	UNLOCK();
+
+	void* success = nullptr;
+
+	FileData fileData;
+	if (LoadFileData(nameStr, type, fileData))
+	{
+		success = CreateResource(name, type, fileData);
+	}
+
+	LOCK();
+	if (success)
+	{
+		Resource* resource = new Resource(success, type);
+		resource->refCount = handle->requestCount;
+		resources.insert(pair<wiHashString, Resource*>(name, resource));
+	}
+	pendingLoads.erase(name);
+	UNLOCK();
+
+	handle->data = success;
+	handle->state.store(success != nullptr ? LOADED : FAILED);
+
+	return success;
+}
+
+// Load a png, tga, jpg, etc. with the full mip chain in the format selected by the texture compression setting.
+//	The cached dds file is used if it was created from the same source file with the same settings.
+bool wiResourceManager::ImportImage(const std::string& nameStr, Data_Type type, wiTextureCompressor::Image& image)
+{
+	struct stat info;
+	if (stat(nameStr.c_str(), &info) != 0)
+	{
+		return false;
+	}
+
+	// Only material textures are compressed:
+	const bool materialTexture = type == Data_Type::IMAGE_BASECOLOR || type == Data_Type::IMAGE_LINEAR || type == Data_Type::IMAGE_NORMALMAP;
+	const TEXTURE_COMPRESSION compression = materialTexture ? textureCompression : TEXTURE_COMPRESSION_NONE;
+
+	wiTextureCompressor::SourceStamp stamp;
+	stamp.fileSize = (uint64_t)info.st_size;
+	stamp.modifiedTime = (uint64_t)info.st_mtime;
+	stamp.settings = (TEXTURE_CACHE_VERSION << 16) | ((uint32_t)type << 8) | (uint32_t)compression;
+
+	const string cacheName = nameStr + ".dds";
+	if (textureCacheEnabled)
+	{
+		wiTextureCompressor::SourceStamp cachedStamp;
+		if (wiTextureCompressor::LoadDDS(cacheName, image, &cachedStamp) && cachedStamp == stamp)
 		{
-			Texture2D* image = nullptr;
+			return true;
+		}
+	}
 
-			if (!ext.compare(std::string("DDS")))
-			{
-				// Load dds
+	const int channelCount = 4;
+	int width, height, bpp;
+	unsigned char* rgb = stbi_load(nameStr.c_str(), &width, &height, &bpp, channelCount);
+	if (rgb == nullptr)
+	{
+		return false;
+	}
 
-				nv_dds::CDDSImage img;
-				img.load(nameStr, false);
+	wiTextureCompressor::MIP_FILTER filter = wiTextureCompressor::MIP_FILTER_LINEAR;
+	if (type == Data_Type::IMAGE_BASECOLOR)
+	{
+		filter = wiTextureCompressor::MIP_FILTER_COLOR;
+	}
+	else if (type == Data_Type::IMAGE_NORMALMAP)
+	{
+		filter = wiTextureCompressor::MIP_FILTER_NORMALMAP;
+	}
 
-				if (img.is_valid())
-				{
-					TextureDesc desc;
-					desc.ArraySize = 1;
-					desc.BindFlags = BIND_SHADER_RESOURCE;
-					desc.CPUAccessFlags = 0;
-					desc.Height = img.get_height();
-					desc.Width = img.get_width();
-					desc.MipLevels = 1;
-					desc.MiscFlags = 0;
-					desc.Usage = USAGE_IMMUTABLE;
-
-					switch (img.get_format())
-					{
-					case GL_RGB:
-					case GL_RGBA:
-						desc.Format = FORMAT_R8G8B8A8_UNORM;
-						break;
-					case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
-						desc.Format = FORMAT_BC1_UNORM;
-						break;
-					case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
-						desc.Format = FORMAT_BC1_UNORM;
-						break;
-					case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
-						desc.Format = FORMAT_BC2_UNORM;
-						break;
-					case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
-						desc.Format = FORMAT_BC3_UNORM;
-						break;
-					default:
-						desc.Format = FORMAT_B8G8R8A8_UNORM;
-						break;
-					}
+	FORMAT format = FORMAT_R8G8B8A8_UNORM;
+	switch (compression)
+	{
+	case TEXTURE_COMPRESSION_FAST:
+		// normal maps have the roughness in alpha
+		format = (type == Data_Type::IMAGE_NORMALMAP || wiTextureCompressor::HasTransparency(rgb, width, height)) ? FORMAT_BC3_UNORM : FORMAT_BC1_UNORM;
+		break;
+	case TEXTURE_COMPRESSION_QUALITY:
+		format = FORMAT_BC7_UNORM;
+		break;
+	default:
+		break;
+	}
 
-					std::vector<SubresourceData> InitData;
+	wiTextureCompressor::Image mips;
+	wiTextureCompressor::GenerateMipChain(rgb, (uint32_t)width, (uint32_t)height, filter, mips);
+	stbi_image_free(rgb);
 
-					if (img.is_volume())
-					{
-						assert(0); // TODO
-					}
+	// Block compression needs dimensions that are multiples of 4, those images are kept uncompressed:
+	if (format == FORMAT_R8G8B8A8_UNORM || !wiTextureCompressor::Compress(mips, format, image))
+	{
+		image = std::move(mips);
+	}
 
-					if (img.is_cubemap())
-					{
-						desc.ArraySize = 6;
-						desc.MiscFlags = RESOURCE_MISC_TEXTURECUBE;
+	if (textureCacheEnabled)
+	{
+		wiTextureCompressor::SaveDDS(cacheName, image, stamp);
+	}
 
-						desc.MipLevels = 1 + img.get_num_mipmaps();
-						InitData.resize(desc.MipLevels * 6);
+	return true;
+}
 
-						for (UINT dir = 0; dir < 6; ++dir)
-						{
-							const nv_dds::CTexture& face = img.get_cubemap_face(dir);
-
-							const UINT idx = dir * desc.MipLevels;
-							InitData[idx].pSysMem = face.operator uint8_t *();
-							InitData[idx].SysMemPitch = static_cast<UINT>(face.get_width() * 4);
-
-							if (face.get_num_mipmaps() > 0)
-							{
-								for (UINT i = 0; i < face.get_num_mipmaps(); ++i)
-								{
-									const nv_dds::CSurface& surf = face.get_mipmap(i);
-
-									InitData[idx + i + 1].pSysMem = surf.operator uint8_t *();
-									InitData[idx + i + 1].SysMemPitch = InitData[idx + i].SysMemPitch / 2;
-								}
-							}
-						}
-					}
-					else
-					{
-						desc.MipLevels = 1 + img.get_num_mipmaps();
-						InitData.resize(desc.MipLevels);
+bool wiResourceManager::LoadFileData(const std::string& nameStr, Data_Type type, FileData& fileData)
+{
+	switch (type)
+	{
+	case Data_Type::IMAGE:
+	case Data_Type::IMAGE_LINEAR:
+	case Data_Type::IMAGE_NORMALMAP:
+	case Data_Type::IMAGE_BASECOLOR:
+	{
+		string ext = wiHelper::toUpper(nameStr.substr(nameStr.length() - 3, nameStr.length()));
+		if (!ext.compare(std::string("DDS")))
+		{
+			// Load dds
+			try
+			{
+				fileData.dds.load(nameStr, false);
+			}
+			catch (const std::exception&)
+			{
+				return false;
+			}
+			return fileData.dds.is_valid();
+		}
 
-						InitData[0].pSysMem = img.operator uint8_t *();
-						InitData[0].SysMemPitch = static_cast<UINT>(img.get_size() / img.get_height() * 4 /* img.get_components()*/); // todo: review + vulkan api slightly different
+		return ImportImage(nameStr, type, fileData.image);
+	}
+	case Data_Type::VERTEXSHADER:
+	case Data_Type::PIXELSHADER:
+	case Data_Type::GEOMETRYSHADER:
+	case Data_Type::HULLSHADER:
+	case Data_Type::DOMAINSHADER:
+	case Data_Type::COMPUTESHADER:
+		return wiHelper::readByteData(nameStr, &fileData.buffer, fileData.bufferSize);
+	case Data_Type::SOUND:
+	case Data_Type::MUSIC:
+		// the sound device reads the file when the resource is created
+		return true;
+	default:
+		return false;
+	}
+}
 
-						if (img.get_num_mipmaps() > 0)
-						{
-							for (UINT i = 0; i < img.get_num_mipmaps(); ++i)
-							{
-								const nv_dds::CSurface& surf = img.get_mipmap(i);
-
-								InitData[i + 1].pSysMem = surf.operator uint8_t *();
-								//InitData[i + 1].SysMemPitch = static_cast<UINT>(surf.get_size() / surf.get_height() * img.get_components());
-								InitData[i + 1].SysMemPitch = InitData[i].SysMemPitch / 2;
-							}
-						}
-					}
+void* wiResourceManager::CreateResource(const wiHashString& name, Data_Type type, FileData& fileData)
+{
+	void* success = nullptr;
 
-					wiRenderer::GetDevice()->CreateTexture2D(&desc, InitData.data(), &image);
+	switch (type)
+	{
+	case Data_Type::IMAGE:
+	case Data_Type::IMAGE_LINEAR:
+	case Data_Type::IMAGE_NORMALMAP:
+	case Data_Type::IMAGE_BASECOLOR:
+	{
+		Texture2D* image = nullptr;
 
-				}
+		if (fileData.dds.is_valid())
+		{
+			TextureDesc desc;
+			desc.ArraySize = 1;
+			desc.BindFlags = BIND_SHADER_RESOURCE;
+			desc.CPUAccessFlags = 0;
+			desc.Height = fileData.dds.get_height();
+			desc.Width = fileData.dds.get_width();
+			desc.MipLevels = 1;
+			desc.MiscFlags = 0;
+			desc.Usage = USAGE_IMMUTABLE;
+
+			switch (fileData.dds.get_format())
+			{
+			case GL_RGB:
+			case GL_RGBA:
+				desc.Format = FORMAT_R8G8B8A8_UNORM;
+				break;
+			case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+				desc.Format = FORMAT_BC1_UNORM;
+				break;
+			case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+				desc.Format = FORMAT_BC1_UNORM;
+				break;
+			case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+				desc.Format = FORMAT_BC2_UNORM;
+				break;
+			case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+				desc.Format = FORMAT_BC3_UNORM;
+				break;
+			default:
+				desc.Format = FORMAT_B8G8R8A8_UNORM;
+				break;
+			}
+
+			std::vector<SubresourceData> InitData;
 
+			if (fileData.dds.is_volume())
+			{
+				assert(0); // TODO
 			}
-			else
+
+			if (fileData.dds.is_cubemap())
 			{
-				// png, tga, jpg, etc. loader:
+				desc.ArraySize = 6;
+				desc.MiscFlags = RESOURCE_MISC_TEXTURECUBE;
 
-				const int channelCount = 4;
-				int width, height, bpp;
-				unsigned char* rgb = stbi_load(nameStr.c_str(), &width, &height, &bpp, channelCount);
+				desc.MipLevels = 1 + fileData.dds.get_num_mipmaps();
+				InitData.resize(desc.MipLevels * 6);
 
-				if (rgb != nullptr)
+				for (UINT dir = 0; dir < 6; ++dir)
 				{
-					TextureDesc desc;
-					desc.ArraySize = 1;
-					desc.BindFlags = BIND_SHADER_RESOURCE | BIND_UNORDERED_ACCESS;
-					desc.CPUAccessFlags = 0;
-					desc.Format = FORMAT_R8G8B8A8_UNORM;
-					desc.Height = static_cast<uint32_t>(height);
-					desc.Width = static_cast<uint32_t>(width);
-					desc.MipLevels = (UINT)log2(max(width, height));
-					desc.MiscFlags = 0;
-					desc.Usage = USAGE_DEFAULT;
-
-					UINT mipwidth = width;
-					SubresourceData* InitData = new SubresourceData[desc.MipLevels];
-					for (UINT mip = 0; mip < desc.MipLevels; ++mip)
+					const nv_dds::CTexture& face = fileData.dds.get_cubemap_face(dir);
+
+					const UINT idx = dir * desc.MipLevels;
+					InitData[idx].pSysMem = face.operator uint8_t *();
+					InitData[idx].SysMemPitch = static_cast<UINT>(face.get_width() * 4);
+
+					if (face.get_num_mipmaps() > 0)
 					{
-						InitData[mip].pSysMem = rgb;
-						InitData[mip].SysMemPitch = static_cast<UINT>(mipwidth * channelCount);
-						mipwidth = max(1, mipwidth / 2);
+						for (UINT i = 0; i < face.get_num_mipmaps(); ++i)
+						{
+							const nv_dds::CSurface& surf = face.get_mipmap(i);
+
+							InitData[idx + i + 1].pSysMem = surf.operator uint8_t *();
+							InitData[idx + i + 1].SysMemPitch = InitData[idx + i].SysMemPitch / 2;
+						}
 					}
+				}
+			}
+			else
+			{
+				desc.MipLevels = 1 + fileData.dds.get_num_mipmaps();
+				InitData.resize(desc.MipLevels);
 
-					image = new Texture2D;
-					image->RequestIndependentShaderResourcesForMIPs(true);
-					image->RequestIndependentUnorderedAccessResourcesForMIPs(true);
-					HRESULT hr = wiRenderer::GetDevice()->CreateTexture2D(&desc, InitData, &image);
-					assert(SUCCEEDED(hr));
+				InitData[0].pSysMem = fileData.dds.operator uint8_t *();
+				InitData[0].SysMemPitch = static_cast<UINT>(fileData.dds.get_size() / fileData.dds.get_height() * 4 /* fileData.dds.get_components()*/); // todo: review + vulkan api slightly different
 
-					if (image != nullptr)
+				if (fileData.dds.get_num_mipmaps() > 0)
+				{
+					for (UINT i = 0; i < fileData.dds.get_num_mipmaps(); ++i)
 					{
-						wiRenderer::AddDeferredMIPGen(image);
+						const nv_dds::CSurface& surf = fileData.dds.get_mipmap(i);
+
+						InitData[i + 1].pSysMem = surf.operator uint8_t *();
+						//InitData[i + 1].SysMemPitch = static_cast<UINT>(surf.get_size() / surf.get_height() * fileData.dds.get_components());
+						InitData[i + 1].SysMemPitch = InitData[i].SysMemPitch / 2;
 					}
 				}
-
-				stbi_image_free(rgb);
 			}
 
-			success = image;
-		}
-		break;
-		case Data_Type::SOUND:
-		{
-			success = new wiSoundEffect(name.GetString());
-		}
-		break;
-		case Data_Type::MUSIC:
-		{
-			success = new wiMusic(name.GetString());
-		}
-		break;
-		case Data_Type::VERTEXSHADER:
-		{
-			BYTE* buffer;
-			size_t bufferSize;
-			if (wiHelper::readByteData(nameStr, &buffer, bufferSize)) {
-				VertexShader* shader = new VertexShader;
-				wiRenderer::GetDevice()->CreateVertexShader(buffer, bufferSize, shader);
-				delete[] buffer;
-				success = shader;
-			}
-			else{
-				success = nullptr;
-			}
-		}
-		break;
-		case Data_Type::PIXELSHADER:
-		{
-			BYTE* buffer;
-			size_t bufferSize;
-			if (wiHelper::readByteData(nameStr, &buffer, bufferSize)){
-				PixelShader* shader = new PixelShader;
-				wiRenderer::GetDevice()->CreatePixelShader(buffer, bufferSize, shader);
-				delete[] buffer;
-				success = shader;
-			}
-			else{
-				success = nullptr;
-			}
-		}
-		break;
-		case Data_Type::GEOMETRYSHADER:
-		{
-			BYTE* buffer;
-			size_t bufferSize;
-			if (wiHelper::readByteData(nameStr, &buffer, bufferSize)){
-				GeometryShader* shader = new GeometryShader;
-				wiRenderer::GetDevice()->CreateGeometryShader(buffer, bufferSize, shader);
-				delete[] buffer;
-				success = shader;
-			}
-			else{
-				success = nullptr;
-			}
+			wiRenderer::GetDevice()->CreateTexture2D(&desc, InitData.data(), &image);
 		}
-		break;
-		case Data_Type::HULLSHADER:
+		else if (!fileData.image.mips.empty())
 		{
-			BYTE* buffer;
-			size_t bufferSize;
-			if (wiHelper::readByteData(nameStr, &buffer, bufferSize)){
-				HullShader* shader = new HullShader;
-				wiRenderer::GetDevice()->CreateHullShader(buffer, bufferSize, shader);
-				delete[] buffer;
-				success = shader;
-			}
-			else{
-				success = nullptr;
-			}
-		}
-		break;
-		case Data_Type::DOMAINSHADER:
-		{
-			BYTE* buffer;
-			size_t bufferSize;
-			if (wiHelper::readByteData(nameStr, &buffer, bufferSize)){
-				DomainShader* shader = new DomainShader;
-				wiRenderer::GetDevice()->CreateDomainShader(buffer, bufferSize, shader);
-				delete[] buffer;
-				success = shader;
-			}
-			else{
-				success = nullptr;
-			}
-		}
-		break;
-		case Data_Type::COMPUTESHADER:
-		{
-			BYTE* buffer;
-			size_t bufferSize;
-			if (wiHelper::readByteData(nameStr, &buffer, bufferSize)) {
-				ComputeShader* shader = new ComputeShader;
-				wiRenderer::GetDevice()->CreateComputeShader(buffer, bufferSize, shader);
-				delete[] buffer;
-				success = shader;
-			}
-			else {
-				success = nullptr;
+			// png, tga, jpg, etc. with the mip chain that was generated on load:
+			const wiTextureCompressor::Image& source = fileData.image;
+
+			TextureDesc desc;
+			desc.ArraySize = 1;
+			desc.BindFlags = BIND_SHADER_RESOURCE;
+			desc.CPUAccessFlags = 0;
+			desc.Format = source.format;
+			desc.Height = source.height;
+			desc.Width = source.width;
+			desc.MipLevels = (UINT)source.mips.size();
+			desc.MiscFlags = 0;
+			desc.Usage = USAGE_IMMUTABLE;
+
+			std::vector<SubresourceData> InitData(desc.MipLevels);
+			for (UINT mip = 0; mip < desc.MipLevels; ++mip)
+			{
+				InitData[mip].pSysMem = source.mips[mip].data.data();
+				InitData[mip].SysMemPitch = source.mips[mip].rowPitch;
 			}
-		}
-		break;
-		default:
-			success=nullptr;
-			break;
-		};
 
-		if (success)
-		{
-			LOCK();
-			resources.insert(pair<wiHashString, Resource*>(name, new Resource(success, type)));
-			UNLOCK();
+			HRESULT hr = wiRenderer::GetDevice()->CreateTexture2D(&desc, InitData.data(), &image);
+			assert(SUCCEEDED(hr));
 		}
 
-		return success;
+		success = image;
+	}
+	break;
+	case Data_Type::SOUND:
+	{
+		success = new wiSoundEffect(name.GetString());
+	}
+	break;
+	case Data_Type::MUSIC:
+	{
+		success = new wiMusic(name.GetString());
+	}
+	break;
+	case Data_Type::VERTEXSHADER:
+	{
+		VertexShader* shader = new VertexShader;
+		wiRenderer::GetDevice()->CreateVertexShader(fileData.buffer, fileData.bufferSize, shader);
+		success = shader;
 	}
+	break;
+	case Data_Type::PIXELSHADER:
+	{
+		PixelShader* shader = new PixelShader;
+		wiRenderer::GetDevice()->CreatePixelShader(fileData.buffer, fileData.bufferSize, shader);
+		success = shader;
+	}
+	break;
+	case Data_Type::GEOMETRYSHADER:
+	{
+		GeometryShader* shader = new GeometryShader;
+		wiRenderer::GetDevice()->CreateGeometryShader(fileData.buffer, fileData.bufferSize, shader);
+		success = shader;
+	}
+	break;
+	case Data_Type::HULLSHADER:
+	{
+		HullShader* shader = new HullShader;
+		wiRenderer::GetDevice()->CreateHullShader(fileData.buffer, fileData.bufferSize, shader);
+		success = shader;
+	}
+	break;
+	case Data_Type::DOMAINSHADER:
+	{
+		DomainShader* shader = new DomainShader;
+		wiRenderer::GetDevice()->CreateDomainShader(fileData.buffer, fileData.bufferSize, shader);
+		success = shader;
+	}
+	break;
+	case Data_Type::COMPUTESHADER:
+	{
+		ComputeShader* shader = new ComputeShader;
+		wiRenderer::GetDevice()->CreateComputeShader(fileData.buffer, fileData.bufferSize, shader);
+		success = shader;
+	}
+	break;
+	default:
+		success = nullptr;
+		break;
+	};
 
-	return res->data;
+	return success;
 }
 
 bool wiResourceManager::del(const wiHashString& name, bool forceDelete)
@@ -381,6 +573,9 @@ bool wiResourceManager::del(const wiHashString& name, bool forceDelete)
 		if(res->data)
 			switch(res->type){
 			case Data_Type::IMAGE:
+			case Data_Type::IMAGE_LINEAR:
+			case Data_Type::IMAGE_NORMALMAP:
+			case Data_Type::IMAGE_BASECOLOR:
 				SAFE_DELETE(reinterpret_cast<Texture2D*&>(res->data));
 				break;
 			case Data_Type::VERTEXSHADER:
@@ -440,6 +635,29 @@ bool wiResourceManager::Register(const wiHashString& name, void* resource, Data_
 
 bool wiResourceManager::CleanUp()
 {
+	// Drop the requests that are still loading:
+	vector<AsyncHandle> pending;
+	LOCK();
+	for (auto& x : pendingLoads)
+	{
+		pending.push_back(x.second);
+	}
+	pendingLoads.clear();
+	failedLoads.clear();
+	UNLOCK();
+	for (auto& x : pending)
+	{
+		while (x->state.load() == LOADING)
+		{
+			this_thread::yield();
+		}
+		if (!x->claimed.exchange(true))
+		{
+			SAFE_DELETE(x->fileData);
+			x->state.store(FAILED);
+		}
+	}
+
 	wiRenderer::GetDevice()->WaitForGPU();
 
 	std::vector<wiHashString>resNames(0);
@@ -456,3 +674,158 @@ bool wiResourceManager::CleanUp()
 	UNLOCK();
 	return true;
 }
+
+wiResourceManager::AsyncHandle wiResourceManager::addAsync(const wiHashString& name, Data_Type newType)
+{
+	LOCK();
+	auto& it = resources.find(name);
+	if (it != resources.end())
+	{
+		it->second->refCount++;
+		AsyncHandle handle = make_shared<AsyncResource>(name, it->second->type);
+		handle->data = it->second->data;
+		handle->claimed.store(true);
+		handle->state.store(LOADED);
+		UNLOCK();
+		return handle;
+	}
+	auto& pending = pendingLoads.find(name);
+	if (pending != pendingLoads.end())
+	{
+		AsyncHandle handle = pending->second;
+		handle->requestCount++;
+		UNLOCK();
+		return handle;
+	}
+
+	Data_Type type;
+	if (!GetResourceType(name.GetString(), newType, type))
+	{
+		UNLOCK();
+		return nullptr;
+	}
+
+	AsyncHandle handle = make_shared<AsyncResource>(name, type);
+	pendingLoads.insert(make_pair(name, handle));
+	failedLoads.erase(name);
+	UNLOCK();
+
+	SubmitLoaderJob([handle] {
+		FileData* fileData = new FileData;
+		if (!LoadFileData(handle->name.GetString(), handle->type, *fileData))
+		{
+			SAFE_DELETE(fileData);
+		}
+		handle->fileData = fileData;
+		handle->state.store(DECODED);
+	});
+
+	return handle;
+}
+
+void wiResourceManager::FinishAsyncLoad(const AsyncHandle& handle)
+{
+	while (handle->state.load() == LOADING)
+	{
+		this_thread::yield();
+	}
+
+	if (handle->claimed.exchange(true))
+	{
+		// An other thread is creating it:
+		while (!handle->IsFinished())
+		{
+			this_thread::yield();
+		}
+		return;
+	}
+
+	void* data = nullptr;
+	if (handle->fileData != nullptr)
+	{
+		data = CreateResource(handle->name, handle->type, *handle->fileData);
+		SAFE_DELETE(handle->fileData);
+	}
+
+	LOCK();
+	if (data != nullptr)
+	{
+		Resource* resource = new Resource(data, handle->type);
+		resource->refCount = handle->requestCount;
+		resources.insert(pair<wiHashString, Resource*>(handle->name, resource));
+	}
+	else
+	{
+		failedLoads.insert(handle->name);
+	}
+	pendingLoads.erase(handle->name);
+	UNLOCK();
+
+	handle->data = data;
+	handle->state.store(data != nullptr ? LOADED : FAILED);
+}
+
+void* wiResourceManager::WaitForLoad(const AsyncHandle& handle)
+{
+	if (handle == nullptr)
+	{
+		return nullptr;
+	}
+	FinishAsyncLoad(handle);
+	return handle->data;
+}
+
+void wiResourceManager::UpdateAsyncLoads()
+{
+	vector<AsyncHandle> decoded;
+	LOCK();
+	for (auto& x : pendingLoads)
+	{
+		if (x.second->state.load() == DECODED)
+		{
+			decoded.push_back(x.second);
+		}
+	}
+	UNLOCK();
+
+	for (auto& x : decoded)
+	{
+		FinishAsyncLoad(x);
+	}
+}
+
+void wiResourceManager::UpdateAllAsyncLoads()
+{
+	// The list is locked for the whole update, so a manager can't be destroyed while its loads are being finished
+	ManagerList& managers = GetManagerList();
+	managers.locker.lock();
+	for (size_t i = 0; i < managers.items.size(); ++i)
+	{
+		managers.items[i]->UpdateAsyncLoads();
+	}
+	managers.locker.unlock();
+}
+
+wiResourceManager::Load_State wiResourceManager::GetLoadState(const wiHashString& name)
+{
+	Load_State state = NOT_FOUND;
+	LOCK();
+	if (resources.find(name) != resources.end())
+	{
+		state = LOADED;
+	}
+	else
+	{
+		auto& pending = pendingLoads.find(name);
+		if (pending != pendingLoads.end())
+		{
+			state = pending->second->state.load();
+		}
+		else if (failedLoads.find(name) != failedLoads.end())
+		{
+			state = FAILED;
+		}
+	}
+	UNLOCK();
+	return state;
+}
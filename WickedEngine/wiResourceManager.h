@@ -3,9 +3,13 @@
 #include "wiThreadSafeManager.h"
 #include "wiGraphicsAPI.h"
 #include "wiHashString.h"
+#include "wiTextureCompressor.h"
 
 #include <map>
 #include <unordered_map>
+#include <unordered_set>
+#include <memory>
+#include <atomic>
 
 class wiResourceManager : public wiThreadSafeManager
 {
@@ -20,6 +24,9 @@ public:
 		HULLSHADER,
 		DOMAINSHADER,
 		COMPUTESHADER,
+		IMAGE_LINEAR,		// material texture that doesn't hold colors, its mips are filtered without gamma correction
+		IMAGE_NORMALMAP,	// material normal map (rgb) with roughness (a)
+		IMAGE_BASECOLOR,	// material color texture, its mips are filtered in linear color space
 	};
 
 	struct Resource
@@ -35,9 +42,61 @@ public:
 	};
 	std::unordered_map<wiHashString, Resource*> resources;
 
+	enum Load_State {
+		LOADING,	// the file is being read and decoded on a loader thread
+		DECODED,	// waiting for the device resource to be created in UpdateAsyncLoads()
+		LOADED,		// the resource is registered, data is valid
+		FAILED,		// the file couldn't be loaded
+		NOT_FOUND,	// the resource was never requested, or it was deleted
+	};
+
+	// Decoded file contents, defined in the .cpp
+	struct FileData;
+
+	// Handle of an asynchronous load request, it can be kept and polled until the load finishes
+	struct AsyncResource
+	{
+		wiHashString name;
+		Data_Type type;
+		std::atomic<Load_State> state;
+		void* data = nullptr;			// valid when LOADED
+		long requestCount = 1;			// references to add to the resource when it is registered
+		std::atomic<bool> claimed;		// set by the thread that creates the device resource
+		FileData* fileData = nullptr;
+
+		AsyncResource(const wiHashString& name, Data_Type type) :name(name), type(type), state(LOADING), claimed(false) {}
+
+		bool IsFinished() const { return state.load() >= LOADED; }
+		bool IsLoaded() const { return state.load() == LOADED; }
+	};
+	typedef std::shared_ptr<AsyncResource> AsyncHandle;
+
+	// Image files (png, jpg, tga) are processed when they are loaded: the mip chain is generated on the CPU, and material textures (IMAGE_BASECOLOR, IMAGE_LINEAR, IMAGE_NORMALMAP) are block compressed.
+	//	Other images (IMAGE, DYNAMIC) are kept uncompressed with linearly filtered mips, because they can be lookup tables or environment maps that compression would ruin.
+	//	The result is cached as a dds file next to the source ("<source>.dds"), which is loaded instead while the source file and the settings don't change.
+	enum TEXTURE_COMPRESSION
+	{
+		TEXTURE_COMPRESSION_NONE,		// rgba8
+		TEXTURE_COMPRESSION_FAST,		// BC1 for opaque images, BC3 for transparent images and normal maps
+		TEXTURE_COMPRESSION_QUALITY,	// BC7
+	};
+
 protected:
 static wiResourceManager* globalResources;
 
+	// Requests that are not registered yet, so that multiple requests of the same resource are loaded once
+	std::unordered_map<wiHashString, AsyncHandle> pendingLoads;
+	// Names of the requests that failed, until they are requested again
+	std::unordered_set<wiHashString> failedLoads;
+
+	static TEXTURE_COMPRESSION textureCompression;
+	static bool textureCacheEnabled;
+
+	static bool ImportImage(const std::string& nameStr, Data_Type type, wiTextureCompressor::Image& image);
+	static bool LoadFileData(const std::string& nameStr, Data_Type type, FileData& fileData);
+	void* CreateResource(const wiHashString& name, Data_Type type, FileData& fileData);
+	void FinishAsyncLoad(const AsyncHandle& handle);
+
 
 public:
 	wiResourceManager();
@@ -51,5 +110,24 @@ public:
 	bool del(const wiHashString& name, bool forceDelete = false);
 	bool Register(const wiHashString& name, void* resource, Data_Type newType);
 	bool CleanUp();
+
+	// Start loading a resource in the background and return immediately. File reading and decoding happens on loader threads,
+	//	the device resource is created in UpdateAsyncLoads(). A request holds a reference to the resource, like add().
+	//	Requests of a resource that is already loading share the same handle. Returns nullptr if the type can't be determined.
+	AsyncHandle addAsync(const wiHashString& name, Data_Type newType = Data_Type::DYNAMIC);
+	// Wait until a request finishes and return the resource data, or nullptr if it failed. If the file is decoded already, the device resource is created on the calling thread.
+	//	Issuing several addAsync() requests first and waiting for them afterwards decodes the files in parallel.
+	void* WaitForLoad(const AsyncHandle& handle);
+	// Create and register the resources that finished decoding. Call it once per frame on the main thread.
+	void UpdateAsyncLoads();
+	// UpdateAsyncLoads() of every manager that exists, MainComponent calls it at the start of the frame
+	static void UpdateAllAsyncLoads();
+	// LOADED, LOADING or DECODED for a pending request, FAILED if the last request failed, NOT_FOUND if the resource was never requested
+	Load_State GetLoadState(const wiHashString& name);
+
+	static void SetTextureCompression(TEXTURE_COMPRESSION value) { textureCompression = value; }
+	static TEXTURE_COMPRESSION GetTextureCompression() { return textureCompression; }
+	static void SetTextureCacheEnabled(bool value) { textureCacheEnabled = value; }
+	static bool IsTextureCacheEnabled() { return textureCacheEnabled; }
 };
 
@@ -16,6 +16,8 @@ Luna<wiResourceManager_BindLua>::FunctionType wiResourceManager_BindLua::methods
 	lunamethod(wiResourceManager_BindLua, Add),
 	lunamethod(wiResourceManager_BindLua, Del),
 	lunamethod(wiResourceManager_BindLua, List),
+	lunamethod(wiResourceManager_BindLua, AddAsync),
+	lunamethod(wiResourceManager_BindLua, GetLoadState),
 	{ NULL, NULL }
 };
 Luna<wiResourceManager_BindLua>::PropertyType wiResourceManager_BindLua::properties[] = {
@@ -50,6 +52,9 @@ int wiResourceManager_BindLua::Get(lua_State *L)
 			switch (data->type)
 			{
 			case wiResourceManager::Data_Type::IMAGE:
+			case wiResourceManager::Data_Type::IMAGE_LINEAR:
+			case wiResourceManager::Data_Type::IMAGE_NORMALMAP:
+			case wiResourceManager::Data_Type::IMAGE_BASECOLOR:
 				Luna<Texture_BindLua>::push(L, new Texture_BindLua((Texture2D*)data->data));
 				return 1;
 				break;
@@ -140,6 +145,71 @@ int wiResourceManager_BindLua::List(lua_State *L)
 	wiLua::SSetString(L, ss.str());
 	return 1;
 }
+int wiResourceManager_BindLua::AddAsync(lua_State *L)
+{
+	if (resources == nullptr)
+	{
+		wiLua::SError(L, "AddAsync(string name) resources is empty!");
+		return 0;
+	}
+	int argc = wiLua::SGetArgCount(L);
+	if (argc > 0)
+	{
+		string name = wiLua::SGetString(L, 1);
+		wiResourceManager::Data_Type type = wiResourceManager::Data_Type::DYNAMIC;
+		if (argc > 1) //type info also provided in this case
+		{
+			string typeStr = wiHelper::toUpper(wiLua::SGetString(L, 2));
+			if (!typeStr.compare("SOUND"))
+				type = wiResourceManager::Data_Type::SOUND;
+			else if (!typeStr.compare("MUSIC"))
+				type = wiResourceManager::Data_Type::MUSIC;
+		}
+		wiResourceManager::AsyncHandle handle = resources->addAsync(name, type);
+		wiLua::SSetString(L, (handle != nullptr ? "ok" : "not supported"));
+		return 1;
+	}
+	else
+	{
+		wiLua::SError(L, "Resource:AddAsync(string name, (opt) string type) not enough arguments!");
+	}
+	return 0;
+}
+int wiResourceManager_BindLua::GetLoadState(lua_State *L)
+{
+	if (resources == nullptr)
+	{
+		wiLua::SError(L, "GetLoadState(string name) resources is empty!");
+		return 0;
+	}
+	int argc = wiLua::SGetArgCount(L);
+	if (argc > 0)
+	{
+		string name = wiLua::SGetString(L, 1);
+		switch (resources->GetLoadState(name))
+		{
+		case wiResourceManager::LOADING:
+		case wiResourceManager::DECODED:
+			wiLua::SSetString(L, "loading");
+			break;
+		case wiResourceManager::LOADED:
+			wiLua::SSetString(L, "loaded");
+			break;
+		case wiResourceManager::FAILED:
+			wiLua::SSetString(L, "failed");
+			break;
+		default:
+			wiLua::SSetString(L, "not found");
+			break;
+		}
+		return 1;
+	}
+	else
+	{
+		wiLua::SError(L, "GetLoadState(string name) not enough arguments!");
+	}
+	return 0;
+}
 
 void wiResourceManager_BindLua::Bind()
 {
@@ -22,6 +22,8 @@ public:
 	int Add(lua_State *L);
 	int Del(lua_State *L);
 	int List(lua_State *L);
+	int AddAsync(lua_State *L);
+	int GetLoadState(lua_State *L);
 
 	static void Bind();
 };
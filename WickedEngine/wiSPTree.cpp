@@ -3,374 +3,672 @@
 #include "wiSceneComponents.h"
 #include "wiFrustum.h"
 
-using namespace wiSceneComponents;
-
-#define SP_TREE_MAX_DEPTH 12
-#define SP_TREE_OBJECT_PER_NODE 6
-#define SP_TREE_BOX_CONTAIN
+#include <algorithm>
 
+using namespace std;
+using namespace wiSceneComponents;
 
-wiSPTree::wiSPTree()
+// Nodes with this many objects are never split
+#define SP_TREE_LEAF_SIZE 4
+// Nodes with more objects than this are always split, below this the surface area heuristic decides
+#define SP_TREE_MAX_LEAF_SIZE 16
+static_assert(SP_TREE_MAX_LEAF_SIZE <= 32, "Leaf frustum culling uses a single 32 bit visibility mask!");
+#define SP_TREE_BIN_COUNT 16
+// Below this depth, nodes are split in the middle, so the depth stays bounded even for degenerate input
+#define SP_TREE_MAX_DEPTH 48
+#define SP_TREE_STACK_SIZE 128
+// A background rebuild is started when the refitted tree cost exceeds the cost after the last build by this factor
+#define SP_TREE_REBUILD_THRESHOLD 1.5f
+#define SP_TREE_REFIT_GROUPSIZE 256
+
+
+namespace
 {
-	childCount = 0;
-	root=nullptr;
-}
+	inline float HalfArea(const XMFLOAT3& min, const XMFLOAT3& max)
+	{
+		const float x = max.x - min.x;
+		const float y = max.y - min.y;
+		const float z = max.z - min.z;
+		return x * y + y * z + z * x;
+	}
 
-wiSPTree::~wiSPTree()
-{
-	SAFE_DELETE(root);
-}
+	inline AABB::INTERSECTION_TYPE IntersectBox(const XMFLOAT3& aMin, const XMFLOAT3& aMax, const XMFLOAT3& bMin, const XMFLOAT3& bMax)
+	{
+		if (bMin.x >= aMin.x && bMax.x <= aMax.x &&
+			bMin.y >= aMin.y && bMax.y <= aMax.y &&
+			bMin.z >= aMin.z && bMax.z <= aMax.z)
+		{
+			return AABB::INSIDE;
+		}
+
+		if (aMax.x < bMin.x || aMin.x > bMax.x)
+			return AABB::OUTSIDE;
+		if (aMax.y < bMin.y || aMin.y > bMax.y)
+			return AABB::OUTSIDE;
+		if (aMax.z < bMin.z || aMin.z > bMax.z)
+			return AABB::OUTSIDE;
 
-void wiSPTree::initialize(const std::vector<Cullable*>& objects, const XMFLOAT3& newMin, const XMFLOAT3& newMax) {
-	XMFLOAT3 min = newMin;
-	XMFLOAT3 max = newMax;
+		return AABB::INTERSECTS;
+	}
 
-	for (Cullable* object : objects)
+	inline bool IntersectSphere(const SPHERE& sphere, const XMFLOAT3& bMin, const XMFLOAT3& bMax)
 	{
-		XMFLOAT3 gMin = object->bounds.getMin();
-		XMFLOAT3 gMax = object->bounds.getMax();
-		min = wiMath::Min(gMin, min);
-		max = wiMath::Max(gMax, max);
+		const XMFLOAT3 closestPointInAabb = wiMath::Min(wiMath::Max(sphere.center, bMin), bMax);
+		return wiMath::Distance(closestPointInAabb, sphere.center) < sphere.radius;
 	}
 
-	this->root = new wiSPTree::Node(nullptr, AABB(min, max));
-	AddObjects(this->root, objects);
-}
+	inline bool IntersectRay(const RAY& ray, const XMFLOAT3& bMin, const XMFLOAT3& bMax)
+	{
+		if (ray.origin.x >= bMin.x && ray.origin.x <= bMax.x &&
+			ray.origin.y >= bMin.y && ray.origin.y <= bMax.y &&
+			ray.origin.z >= bMin.z && ray.origin.z <= bMax.z)
+		{
+			return true;
+		}
 
-void wiSPTree::AddObjects(Node* node, const std::vector<Cullable*>& newObjects)
-{
-	for (Cullable* object : newObjects)
+		float tx1 = (bMin.x - ray.origin.x)*ray.direction_inverse.x;
+		float tx2 = (bMax.x - ray.origin.x)*ray.direction_inverse.x;
+
+		float tmin = min(tx1, tx2);
+		float tmax = max(tx1, tx2);
+
+		float ty1 = (bMin.y - ray.origin.y)*ray.direction_inverse.y;
+		float ty2 = (bMax.y - ray.origin.y)*ray.direction_inverse.y;
+
+		tmin = max(tmin, min(ty1, ty2));
+		tmax = min(tmax, max(ty1, ty2));
+
+		float tz1 = (bMin.z - ray.origin.z)*ray.direction_inverse.z;
+		float tz2 = (bMax.z - ray.origin.z)*ray.direction_inverse.z;
+
+		tmin = max(tmin, min(tz1, tz2));
+		tmax = min(tmax, max(tz1, tz2));
+
+		return tmax >= tmin;
+	}
+
+	inline float GetAxis(const XMFLOAT3& v, int axis)
 	{
-		node->objects.push_back(object);
+		return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
 	}
 
-	if (newObjects.size() > SP_TREE_OBJECT_PER_NODE && node->depth < SP_TREE_MAX_DEPTH) 
+	// Binned surface area heuristic build. It only reads the bounds array, so it can run on any thread.
+	//	nodes	: output node array, node bounds are not computed here
+	//	order	: output item order, the objects of every node are order[node.first ... node.first + node.count - 1]
+	void BuildHierarchy(const AABBArray& bounds, vector<wiSPTree::Node>& nodes, vector<uint32_t>& order)
 	{
-		node->count = childCount;
-		node->children.reserve(node->count);
-		XMFLOAT3 min = node->box.getMin();
-		XMFLOAT3 max = node->box.getMax();
-		AABB* boxes = new AABB[node->count];
-		if (node->count == 8) 
+		const uint32_t itemCount = (uint32_t)bounds.size();
+
+		nodes.clear();
+		order.resize(itemCount);
+		if (itemCount == 0)
 		{
-			boxes[0] = AABB(XMFLOAT3(min.x, (min.y + max.y)*0.5f, (min.z + max.z)*0.5f), XMFLOAT3((min.x + max.x)*0.5f, max.y, max.z));
-			boxes[1] = AABB(XMFLOAT3((min.x + max.x)*0.5f, (min.y + max.y)*0.5f, (min.z + max.z)*0.5f), max);
-			boxes[2] = AABB(XMFLOAT3(min.x, (min.y + max.y)*0.5f, min.z), XMFLOAT3((min.x + max.x)*0.5f, max.y, (min.z + max.z)*0.5f));
-			boxes[3] = AABB(XMFLOAT3((min.x + max.x)*0.5f, (min.y + max.y)*0.5f, min.z), XMFLOAT3(max.x, max.y, (min.z + max.z)*0.5f));
-
-			boxes[4] = AABB(XMFLOAT3(min.x, min.y, (min.z + max.z)*0.5f), XMFLOAT3((min.x + max.x)*0.5f, (min.y + max.y)*0.5f, max.z));
-			boxes[5] = AABB(XMFLOAT3((min.x + max.x)*0.5f, min.y, (min.z + max.z)*0.5f), XMFLOAT3(max.x, (min.y + max.y)*0.5f, max.z));
-			boxes[6] = AABB(min, XMFLOAT3((min.x + max.x)*0.5f, (min.y + max.y)*0.5f, (min.z + max.z)*0.5f));
-			boxes[7] = AABB(XMFLOAT3((min.x + max.x)*0.5f, min.y, min.z), XMFLOAT3(max.x, (min.y + max.y)*0.5f, (min.z + max.z)*0.5f));
+			return;
 		}
-		else 
+
+		vector<XMFLOAT3> centers(itemCount);
+		for (uint32_t i = 0; i < itemCount; ++i)
 		{
-			boxes[0] = AABB(XMFLOAT3(min.x, min.y, (min.z + max.z)*0.5f), XMFLOAT3((min.x + max.x)*0.5f, max.y, max.z));
-			boxes[1] = AABB(XMFLOAT3((min.x + max.x)*0.5f, min.y, (min.z + max.z)*0.5f), max);
-			boxes[2] = AABB(min, XMFLOAT3((min.x + max.x)*0.5f, max.y, (min.z + max.z)*0.5f));
-			boxes[3] = AABB(XMFLOAT3((min.x + max.x)*0.5f, min.y, min.z), XMFLOAT3(max.x, max.y, (min.z + max.z)*0.5f));
+			order[i] = i;
+			centers[i] = XMFLOAT3(bounds.center_x[i], bounds.center_y[i], bounds.center_z[i]);
 		}
-		for (int i = 0; i < node->count; ++i)
+
+		nodes.reserve(itemCount * 2);
+
+		wiSPTree::Node root;
+		root.left = 0;
+		root.first = 0;
+		root.count = itemCount;
+		nodes.push_back(root);
+
+		struct Task
 		{
-			std::vector<Cullable*> o(0);
-			o.reserve(newObjects.size());
-			for (Cullable* object : newObjects)
+			uint32_t node;
+			uint32_t depth;
+		};
+		vector<Task> tasks;
+		tasks.push_back({ 0, 0 });
+
+		while (!tasks.empty())
+		{
+			const Task task = tasks.back();
+			tasks.pop_back();
+
+			const uint32_t first = nodes[task.node].first;
+			const uint32_t count = nodes[task.node].count;
+
+			if (count <= SP_TREE_LEAF_SIZE)
+			{
+				continue;
+			}
+
+			// The split axis is the longest axis of the object centers:
+			XMFLOAT3 centerMin = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+			XMFLOAT3 centerMax = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+			for (uint32_t i = first; i < first + count; ++i)
 			{
-#ifdef SP_TREE_BOX_CONTAIN
-				if (boxes[i].intersects(object->bounds) == AABB::INSIDE)
-#else
-				if ((*boxes[i]).intersects(object->translation))
-#endif
+				centerMin = wiMath::Min(centerMin, centers[order[i]]);
+				centerMax = wiMath::Max(centerMax, centers[order[i]]);
+			}
+			const XMFLOAT3 centerExtent = XMFLOAT3(centerMax.x - centerMin.x, centerMax.y - centerMin.y, centerMax.z - centerMin.z);
+			int axis = 0;
+			if (centerExtent.y > GetAxis(centerExtent, axis))
+				axis = 1;
+			if (centerExtent.z > GetAxis(centerExtent, axis))
+				axis = 2;
+			const float axisMin = GetAxis(centerMin, axis);
+			const float axisExtent = GetAxis(centerExtent, axis);
+
+			uint32_t mid = first;
+
+			if (axisExtent > 0 && task.depth < SP_TREE_MAX_DEPTH)
+			{
+				const float binScale = (float)SP_TREE_BIN_COUNT / axisExtent;
+				auto getBin = [&](uint32_t item) {
+					const uint32_t bin = (uint32_t)((GetAxis(centers[item], axis) - axisMin) * binScale);
+					return min(bin, (uint32_t)SP_TREE_BIN_COUNT - 1);
+				};
+
+				struct Bin
+				{
+					XMFLOAT3 min = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+					XMFLOAT3 max = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+					uint32_t count = 0;
+				} bins[SP_TREE_BIN_COUNT];
+
+				for (uint32_t i = first; i < first + count; ++i)
+				{
+					const uint32_t item = order[i];
+					Bin& bin = bins[getBin(item)];
+					bin.min = wiMath::Min(bin.min, bounds.getMin(item));
+					bin.max = wiMath::Max(bin.max, bounds.getMax(item));
+					bin.count++;
+				}
+
+				// Sweep from the right to gather the right side of every split plane, then from the left to evaluate the cost:
+				float rightCost[SP_TREE_BIN_COUNT];
+				XMFLOAT3 _min = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+				XMFLOAT3 _max = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+				uint32_t rightCount = 0;
+				for (uint32_t i = SP_TREE_BIN_COUNT - 1; i > 0; --i)
+				{
+					_min = wiMath::Min(_min, bins[i].min);
+					_max = wiMath::Max(_max, bins[i].max);
+					rightCount += bins[i].count;
+					rightCost[i] = rightCount > 0 ? HalfArea(_min, _max) * rightCount : 0;
+				}
+
+				_min = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+				_max = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+				uint32_t leftCount = 0;
+				float bestCost = FLT_MAX;
+				uint32_t bestSplit = 0;
+				for (uint32_t i = 1; i < SP_TREE_BIN_COUNT; ++i)
+				{
+					_min = wiMath::Min(_min, bins[i - 1].min);
+					_max = wiMath::Max(_max, bins[i - 1].max);
+					leftCount += bins[i - 1].count;
+					if (leftCount == 0 || leftCount == count)
+					{
+						continue;
+					}
+					const float cost = HalfArea(_min, _max) * leftCount + rightCost[i];
+					if (cost < bestCost)
+					{
+						bestCost = cost;
+						bestSplit = i;
+					}
+				}
+
+				// The last sweep step also covered the whole node, compare the split against not splitting at all:
+				_min = wiMath::Min(_min, bins[SP_TREE_BIN_COUNT - 1].min);
+				_max = wiMath::Max(_max, bins[SP_TREE_BIN_COUNT - 1].max);
+				const float leafCost = HalfArea(_min, _max) * count;
+				if (count <= SP_TREE_MAX_LEAF_SIZE && bestCost >= leafCost)
+				{
+					continue;
+				}
+
+				if (bestSplit > 0)
 				{
-					o.push_back(object);
-					node->objects.remove(object);
+					mid = (uint32_t)(partition(order.begin() + first, order.begin() + first + count, [&](uint32_t item) {
+						return getBin(item) < bestSplit;
+					}) - order.begin());
 				}
 			}
-			if (!o.empty())
+
+			if (mid == first || mid == first + count)
 			{
-				node->children.push_back(new Node(node, boxes[i], node->depth + 1));
-				AddObjects(node->children.back(), o);
+				// No usable split plane was found, split by object count instead:
+				mid = first + count / 2;
+				nth_element(order.begin() + first, order.begin() + mid, order.begin() + first + count, [&](uint32_t a, uint32_t b) {
+					return GetAxis(centers[a], axis) < GetAxis(centers[b], axis);
+				});
 			}
+
+			const uint32_t left = (uint32_t)nodes.size();
+			nodes[task.node].left = left;
+
+			wiSPTree::Node child;
+			child.left = 0;
+			child.first = first;
+			child.count = mid - first;
+			nodes.push_back(child);
+			child.first = mid;
+			child.count = first + count - mid;
+			nodes.push_back(child);
+
+			tasks.push_back({ left, task.depth + 1 });
+			tasks.push_back({ left + 1, task.depth + 1 });
 		}
-		delete[] boxes;
 	}
+}
+
 
+wiSPTree::wiSPTree()
+{
+	buildCost = 0;
+	currentCost = 0;
+	rebuild.running = false;
+}
+wiSPTree::wiSPTree(const vector<Cullable*>& objects) :wiSPTree()
+{
+	AddObjects(objects);
 }
 
-void wiSPTree::Sort(const XMFLOAT3& origin, CulledList& objects, SortType sortType)
+wiSPTree::~wiSPTree()
 {
-	switch (sortType)
-	{
-	case wiSPTree::SP_TREE_SORT_NONE:
-		break;
-	case wiSPTree::SP_TREE_SORT_UNIQUE:
-		// Unique must only be called on a sorted forward_list!
-		// And we cannot rely on the by distance sort for this because culled objects could have been gathered by different cullers, so sort by pointers!
-		objects.sort([&](const void* a, const void* b) {
-			return a < b;
-		});
-		objects.unique();
-		break;
-	case wiSPTree::SP_TREE_SORT_BACK_TO_FRONT:
-		Sort(origin, objects, wiSPTree::SP_TREE_SORT_UNIQUE);
-		objects.sort([&](const Cullable* a, const Cullable* b) {
-			return wiMath::DistanceSquared(origin, a->bounds.getCenter()) > wiMath::DistanceSquared(origin, b->bounds.getCenter());
-		});
-		break;
-	case wiSPTree::SP_TREE_SORT_FRONT_TO_BACK:
-		Sort(origin, objects, wiSPTree::SP_TREE_SORT_UNIQUE);
-		objects.sort([&](const Cullable* a, const Cullable* b) {
-			return wiMath::DistanceSquared(origin, a->bounds.getCenter()) < wiMath::DistanceSquared(origin, b->bounds.getCenter());
-		});
-		break;
-	default:
-		break;
-	}
+	// The background rebuild writes into this object:
+	wiJobSystem::Wait(rebuildContext);
 }
 
-void wiSPTree::getVisible(const Frustum& frustum, CulledList& objects, SortType sortType, CullStrictness type, Node* node)
+void wiSPTree::Build()
 {
-	if (node == nullptr)
+	wiJobSystem::Wait(rebuildContext);
+	rebuild.running = false;
+
+	vector<Node> newNodes;
+	vector<uint32_t> order;
+	UpdateItemBounds();
+	BuildHierarchy(itemBounds, newNodes, order);
+	Apply(newNodes, order);
+	UpdateItemBounds();
+	RefitNodes();
+
+	buildCost = currentCost;
+}
+
+void wiSPTree::Apply(vector<Node>& newNodes, const vector<uint32_t>& order)
+{
+	vector<Cullable*> reordered(order.size());
+	for (size_t i = 0; i < order.size(); ++i)
 	{
-		node = root;
+		reordered[i] = items[order[i]];
 	}
+	items.swap(reordered);
 
-	int contain_type = frustum.CheckBox(node->box);
+	nodes.swap(newNodes);
+	nodeBounds.resize(nodes.size());
+}
 
-	if (!contain_type)
-	{
-		return;
-	}
-	else
+void wiSPTree::UpdateItemBounds()
+{
+	itemBounds.resize(items.size());
+
+	wiJobSystem::context ctx;
+	wiJobSystem::Dispatch(ctx, (uint32_t)items.size(), SP_TREE_REFIT_GROUPSIZE, [&](wiJobSystem::JobDispatchArgs args) {
+		const AABB& box = items[args.jobIndex]->bounds;
+		itemBounds.set(args.jobIndex, box.getMin(), box.getMax());
+	});
+	wiJobSystem::Wait(ctx);
+}
+
+void wiSPTree::RefitNodes()
+{
+	currentCost = 0;
+
+	// Children are always created after their parent, so a reverse iteration processes them first:
+	for (size_t i = nodes.size(); i > 0; --i)
 	{
-		for (Cullable* object : node->objects)
+		const size_t index = i - 1;
+		const Node& node = nodes[index];
+
+		XMFLOAT3 _min, _max;
+		if (node.IsLeaf())
 		{
-			if (
-				type == SP_TREE_LOOSE_CULL ||
-				(type == SP_TREE_STRICT_CULL &&
-					contain_type == BOX_FRUSTUM_INSIDE ||
-					(contain_type == BOX_FRUSTUM_INTERSECTS && frustum.CheckBox(object->bounds))
-					)
-				)
+			_min = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+			_max = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+			for (uint32_t j = node.first; j < node.first + node.count; ++j)
 			{
-				objects.push_front(object);
+				_min = wiMath::Min(_min, itemBounds.getMin(j));
+				_max = wiMath::Max(_max, itemBounds.getMax(j));
 			}
 		}
-		if(node->count)
+		else
 		{
-			for (unsigned int i = 0; i < node->children.size(); ++i)
-			{
-				getVisible(frustum, objects, sortType, type, node->children[i]);
-			}
+			_min = wiMath::Min(nodeBounds.getMin(node.left), nodeBounds.getMin(node.left + 1));
+			_max = wiMath::Max(nodeBounds.getMax(node.left), nodeBounds.getMax(node.left + 1));
 		}
-	}
 
-	if (node == root)
-	{
-		Sort(frustum.getCamPos(), objects, sortType);
+		nodeBounds.set(index, _min, _max);
+		currentCost += HalfArea(_min, _max);
 	}
 }
-void wiSPTree::getVisible(const AABB& frustum, CulledList& objects, SortType sortType, CullStrictness type, Node* node)
-{
-	if (node == nullptr)
-	{
-		node = root;
-	}
 
-	int contain_type = frustum.intersects(node->box);
-	if (!contain_type)
+void wiSPTree::AddObjects(const vector<Cullable*>& newObjects)
+{
+	if (newObjects.empty())
 	{
 		return;
 	}
-	else
-	{
-		for (Cullable* object : node->objects)
-		{
-			if (
-				type == SP_TREE_LOOSE_CULL ||
-				(type == SP_TREE_STRICT_CULL &&
-					contain_type == AABB::INSIDE ||
-					(contain_type == AABB::INTERSECTS && frustum.intersects(object->bounds))
-					)
-				) 
-			{
-				objects.push_front(object);
-			}
-		}
-		if(node->count)
-		{
-			for (unsigned int i = 0; i < node->children.size(); ++i)
-			{
-				getVisible(frustum, objects, sortType, type, node->children[i]);
-			}
-		}
-	}
+	items.insert(items.end(), newObjects.begin(), newObjects.end());
+	Build();
+}
 
-	if (node == root)
+void wiSPTree::Remove(Cullable* value)
+{
+	auto it = find(items.begin(), items.end(), value);
+	if (it != items.end())
 	{
-		Sort(frustum.getCenter(), objects, sortType);
+		items.erase(it);
+		Build();
 	}
 }
-void wiSPTree::getVisible(const SPHERE& frustum, CulledList& objects, SortType sortType, CullStrictness type, Node* node)
+
+void wiSPTree::Update()
 {
-	if (node == nullptr)
+	bool rebuilt = false;
+	if (rebuild.running && !wiJobSystem::IsBusy(rebuildContext))
 	{
-		node = root;
+		rebuild.running = false;
+		Apply(rebuild.nodes, rebuild.order);
+		rebuilt = true;
 	}
 
-	int contain_type = frustum.intersects(node->box);
+	UpdateItemBounds();
+	RefitNodes();
 
-	if (!contain_type)
+	if (rebuilt)
 	{
-		return;
+		buildCost = currentCost;
 	}
-	else 
+	else if (!rebuild.running && currentCost > buildCost * SP_TREE_REBUILD_THRESHOLD)
+	{
+		// The tree still works after refitting, just gets slower. So it is only replaced when the new one is finished:
+		rebuild.running = true;
+		rebuild.bounds = itemBounds;
+		wiJobSystem::Execute(rebuildContext, [this] {
+			BuildHierarchy(rebuild.bounds, rebuild.nodes, rebuild.order);
+		});
+	}
+}
+
+void wiSPTree::Sort(const XMFLOAT3& origin, CulledList& objects, SortType sortType)
+{
+	switch (sortType)
 	{
-		for (Cullable* object : node->objects)
+	case wiSPTree::SP_TREE_SORT_NONE:
+		break;
+	case wiSPTree::SP_TREE_SORT_UNIQUE:
+		// Culled objects could have been gathered by different cullers, so sort by pointers!
+		sort(objects.begin(), objects.end());
+		objects.erase(unique(objects.begin(), objects.end()), objects.end());
+		break;
+	case wiSPTree::SP_TREE_SORT_BACK_TO_FRONT:
+	case wiSPTree::SP_TREE_SORT_FRONT_TO_BACK:
 		{
-			if (frustum.intersects(object->bounds))
+			Sort(origin, objects, wiSPTree::SP_TREE_SORT_UNIQUE);
+
+			// Compute the distances only once instead of in every comparison:
+			vector<pair<float, Cullable*>> sorted(objects.size());
+			for (size_t i = 0; i < objects.size(); ++i)
 			{
-				objects.push_front(object);
+				sorted[i] = make_pair(wiMath::DistanceSquared(origin, objects[i]->bounds.getCenter()), objects[i]);
 			}
-		}
-		if(node->count)
-		{
-			for (unsigned int i = 0; i < node->children.size(); ++i)
+			if (sortType == wiSPTree::SP_TREE_SORT_BACK_TO_FRONT)
+			{
+				sort(sorted.begin(), sorted.end(), [](const pair<float, Cullable*>& a, const pair<float, Cullable*>& b) {
+					return a.first > b.first;
+				});
+			}
+			else
+			{
+				sort(sorted.begin(), sorted.end(), [](const pair<float, Cullable*>& a, const pair<float, Cullable*>& b) {
+					return a.first < b.first;
+				});
+			}
+			for (size_t i = 0; i < objects.size(); ++i)
 			{
-				getVisible(frustum, objects, sortType, type, node->children[i]);
+				objects[i] = sorted[i].second;
 			}
 		}
+		break;
+	default:
+		break;
 	}
+}
 
-	if (node == root)
+template<typename ItemTest>
+void wiSPTree::TestItems(uint32_t first, uint32_t count, CulledList& objects, const ItemTest& itemTest) const
+{
+	for (uint32_t i = first; i < first + count; ++i)
 	{
-		Sort(frustum.center, objects, sortType);
+		if (itemTest(itemBounds.getMin(i), itemBounds.getMax(i)))
+		{
+			objects.push_back(items[i]);
+		}
 	}
 }
-void wiSPTree::getVisible(const RAY& frustum, CulledList& objects, SortType sortType, CullStrictness type, Node* node)
+
+template<typename NodeTest, typename LeafTest>
+void wiSPTree::Query(CulledList& objects, const NodeTest& nodeTest, const LeafTest& leafTest) const
 {
-	if (node == nullptr)
+	if (nodes.empty())
 	{
-		node = root;
+		return;
 	}
 
-	int contain_type = frustum.intersects(node->box);
+	uint32_t stack[SP_TREE_STACK_SIZE];
+	uint32_t stackpos = 0;
+	stack[stackpos++] = 0;
 
-	if (!contain_type)
+	while (stackpos > 0)
 	{
-		return;
-	}
-	else 
-	{
-		for (Cullable* object : node->objects)
+		const uint32_t index = stack[--stackpos];
+		const Node& node = nodes[index];
+
+		const AABB::INTERSECTION_TYPE contain_type = nodeTest(nodeBounds.getMin(index), nodeBounds.getMax(index));
+
+		if (contain_type == AABB::OUTSIDE)
 		{
-			if (frustum.intersects(object->bounds))
-			{
-				objects.push_front(object);
-			}
+			continue;
+		}
+		if (contain_type == AABB::INSIDE)
+		{
+			// The whole subtree is visible, and its objects are contiguous:
+			objects.insert(objects.end(), items.begin() + node.first, items.begin() + node.first + node.count);
 		}
-		if(node->count)
+		else if (node.IsLeaf())
 		{
-			for (unsigned int i = 0; i < node->children.size(); ++i)
+			leafTest(node.first, node.count);
+		}
+		else
+		{
+			stack[stackpos++] = node.left;
+			stack[stackpos++] = node.left + 1;
+		}
+	}
+}
+
+void wiSPTree::getVisible(const Frustum& frustum, CulledList& objects, SortType sortType) const
+{
+	Query(objects,
+		[&](const XMFLOAT3& _min, const XMFLOAT3& _max) {
+			return (AABB::INTERSECTION_TYPE)frustum.CheckBox(_min, _max);
+		},
+		[&](uint32_t first, uint32_t count) {
+			// Leaves are small, a single mask element is enough:
+			uint32_t mask;
+			frustum.CheckBoxes(itemBounds, first, count, &mask);
+			for (uint32_t i = 0; i < count; ++i)
 			{
-				getVisible(frustum, objects, sortType, type, node->children[i]);
+				if (mask & (1u << i))
+				{
+					objects.push_back(items[first + i]);
+				}
 			}
 		}
-	}
+	);
 
-	if (node == root)
-	{
-		Sort(frustum.origin, objects, sortType);
-	}
+	Sort(frustum.getCamPos(), objects, sortType);
 }
-void wiSPTree::getAll(CulledList& objects, Node* node)
+void wiSPTree::getVisible(const AABB& frustum, CulledList& objects, SortType sortType) const
 {
-	if (node == nullptr)
-	{
-		node = root;
-	}
+	const XMFLOAT3 aMin = frustum.getMin();
+	const XMFLOAT3 aMax = frustum.getMax();
+
+	Query(objects,
+		[&](const XMFLOAT3& _min, const XMFLOAT3& _max) {
+			return IntersectBox(aMin, aMax, _min, _max);
+		},
+		[&](uint32_t first, uint32_t count) {
+			TestItems(first, count, objects, [&](const XMFLOAT3& _min, const XMFLOAT3& _max) {
+				return IntersectBox(aMin, aMax, _min, _max) != AABB::OUTSIDE;
+			});
+		}
+	);
 
-	objects.insert(objects.end(), node->objects.begin(),node->objects.end());
-	if(node->count)
-	{
-		for (unsigned int i = 0; i < node->children.size(); ++i)
-		{
-			getAll(objects, node->children[i]);
+	Sort(frustum.getCenter(), objects, sortType);
+}
+void wiSPTree::getVisible(const SPHERE& frustum, CulledList& objects, SortType sortType) const
+{
+	Query(objects,
+		[&](const XMFLOAT3& _min, const XMFLOAT3& _max) {
+			return IntersectSphere(frustum, _min, _max) ? AABB::INTERSECTS : AABB::OUTSIDE;
+		},
+		[&](uint32_t first, uint32_t count) {
+			TestItems(first, count, objects, [&](const XMFLOAT3& _min, const XMFLOAT3& _max) {
+				return IntersectSphere(frustum, _min, _max);
+			});
 		}
-	}
+	);
+
+	Sort(frustum.center, objects, sortType);
 }
-void wiSPTree::Remove(Cullable* value, Node* node)
+void wiSPTree::getVisible(const RAY& frustum, CulledList& objects, SortType sortType) const
 {
-	if (node == nullptr)
-	{
-		node = root;
-	}
-	node->objects.remove(value);
-	for (auto& child : node->children)
+	Query(objects,
+		[&](const XMFLOAT3& _min, const XMFLOAT3& _max) {
+			return IntersectRay(frustum, _min, _max) ? AABB::INTERSECTS : AABB::OUTSIDE;
+		},
+		[&](uint32_t first, uint32_t count) {
+			TestItems(first, count, objects, [&](const XMFLOAT3& _min, const XMFLOAT3& _max) {
+				return IntersectRay(frustum, _min, _max);
+			});
+		}
+	);
+
+	Sort(frustum.origin, objects, sortType);
+}
+void wiSPTree::getAll(CulledList& objects) const
+{
+	objects.insert(objects.end(), items.begin(), items.end());
+}
+
+AABB wiSPTree::GetBounds() const
+{
+	if (nodes.empty())
 	{
-		Remove(value, child);
+		return AABB();
 	}
+	return GetNodeBounds(0);
+}
+
+
+
+void CulledCollection::push_back(Object* object)
+{
+	Item item;
+	item.mesh = object->mesh;
+	item.object = object;
+	items.push_back(item);
 }
 
-wiSPTree* wiSPTree::updateTree(Node* node)
+void CulledCollection::Sort()
 {
-	if (node == nullptr)
+	batches.clear();
+
+	const size_t count = items.size();
+	if (count == 0)
 	{
-		node = root;
+		return;
 	}
 
-	if (node)
+	// Least significant digit radix sort on the mesh pointers, one byte per pass.
+	//	Passes where every key has the same digit are skipped, which are most of the high bytes of the addresses.
+	static const int passCount = sizeof(uintptr_t);
+	uint32_t histogram[passCount][256] = {};
+	for (const Item& item : items)
 	{
-
-		std::vector<Cullable*> bad(0);
-		for (Cullable* object : node->objects)
+		const uintptr_t key = (uintptr_t)item.mesh;
+		for (int pass = 0; pass < passCount; ++pass)
 		{
-#ifdef SP_TREE_BOX_CONTAIN
-			if (node->box.intersects(object->bounds) != AABB::INSIDE)
-#else
-			if (!node->box.intersects(object->translation))
-#endif
-				bad.push_back(object);
+			histogram[pass][(key >> (pass * 8)) & 0xFF]++;
 		}
+	}
 
-		if (!bad.empty()) {
+	sortTemp.resize(count);
+	Item* src = items.data();
+	Item* dst = sortTemp.data();
+	for (int pass = 0; pass < passCount; ++pass)
+	{
+		const int shift = pass * 8;
+		const uint32_t* digitCounts = histogram[pass];
+		if (digitCounts[((uintptr_t)src[0].mesh >> shift) & 0xFF] == count)
+		{
+			continue;
+		}
 
-			for (Cullable* object : bad)
-			{
-				node->objects.remove(object);
-			}
+		uint32_t offsets[256];
+		uint32_t offset = 0;
+		for (int digit = 0; digit < 256; ++digit)
+		{
+			offsets[digit] = offset;
+			offset += digitCounts[digit];
+		}
 
-			if (node->parent)
-			{
-				AddObjects(node->parent, bad);
-			}
-			else
-			{
-				CulledList culledItems;
-				getVisible(node->box, culledItems, SP_TREE_SORT_UNIQUE, SP_TREE_STRICT_CULL, node);
-				for (Cullable* item : culledItems)
-				{
-					bad.push_back(item);
-				}
+		for (size_t i = 0; i < count; ++i)
+		{
+			dst[offsets[((uintptr_t)src[i].mesh >> shift) & 0xFF]++] = src[i];
+		}
 
-				AABB nbb = node->box*1.5;
-				wiSPTree* tree;
-				if (childCount == 8)
-					tree = new Octree(bad, nbb.getMin(), nbb.getMax());
-				else
-					tree = new QuadTree(bad, nbb.getMin(), nbb.getMax());
+		std::swap(src, dst);
+	}
+	if (src != items.data())
+	{
+		items.swap(sortTemp);
+	}
 
-				return tree;
-			}
-		}
-		if (!node->children.empty())
+	Batch batch;
+	batch.mesh = items[0].mesh;
+	batch.offset = 0;
+	batch.count = 0;
+	for (const Item& item : items)
+	{
+		if (item.mesh != batch.mesh)
 		{
-			for (unsigned int i = 0; i < node->children.size(); ++i)
-			{
-				updateTree(node->children[i]);
-			}
+			batches.push_back(batch);
+			batch.mesh = item.mesh;
+			batch.offset += batch.count;
+			batch.count = 0;
 		}
-
+		batch.count++;
 	}
-	return nullptr;
+	batches.push_back(batch);
+}
+
+void CulledCollection::clear()
+{
+	items.clear();
+	batches.clear();
 }
@@ -1,9 +1,9 @@
 #pragma once
 #include "CommonInclude.h"
 #include "wiIntersectables.h"
+#include "wiJobSystem.h"
 
-#include <unordered_map>
-#include <list>
+#include <vector>
 
 namespace wiSceneComponents
 {
@@ -14,50 +14,89 @@ namespace wiSceneComponents
 
 class Frustum;
 
-typedef std::list<wiSceneComponents::Cullable*> CulledList;
+typedef std::vector<wiSceneComponents::Cullable*> CulledList;
 
-typedef std::list<wiSceneComponents::Object*> CulledObjectList;
-typedef std::unordered_map<wiSceneComponents::Mesh*,CulledObjectList> CulledCollection;
+// Visible objects grouped by their meshes
+//	Objects are collected into a flat array of (mesh, object) pairs, which is then radix sorted by mesh.
+//	After sorting, the objects of the same mesh are contiguous and can be iterated as batches.
+class CulledCollection
+{
+public:
+	struct Item
+	{
+		wiSceneComponents::Mesh* mesh;
+		wiSceneComponents::Object* object;
+	};
+	struct Batch
+	{
+		wiSceneComponents::Mesh* mesh;
+		uint32_t offset;
+		uint32_t count;
+	};
+	// Objects of one batch
+	struct Instances
+	{
+		struct iterator
+		{
+			const Item* item;
+
+			wiSceneComponents::Object* operator*() const { return item->object; }
+			iterator& operator++() { ++item; return *this; }
+			bool operator!=(const iterator& other) const { return item != other.item; }
+		};
+
+		const Item* first;
+		const Item* last;
 
+		iterator begin() const { return{ first }; }
+		iterator end() const { return{ last }; }
+		size_t size() const { return last - first; }
+	};
+
+	void push_back(wiSceneComponents::Object* object);
+	// Sort the items by mesh and build the batches. Must be called after adding items and before iterating the batches.
+	//	The sort is stable, so objects of the same mesh keep the order in which they were added.
+	void Sort();
+	void clear();
+	bool empty() const { return items.empty(); }
+	size_t size() const { return items.size(); }
+
+	const std::vector<Batch>& GetBatches() const { return batches; }
+	Instances GetInstances(const Batch& batch) const
+	{
+		const Item* first = items.data() + batch.offset;
+		return{ first, first + batch.count };
+	}
+
+private:
+	std::vector<Item> items;
+	std::vector<Item> sortTemp;
+	std::vector<Batch> batches;
+};
+
+// Space partitioning tree, implemented as a bounding volume hierarchy
+//	Nodes are stored in a contiguous array and reference each other by index. Node bounds are stored as structure of arrays.
+//	Every object is in exactly one leaf, the objects of a subtree are always contiguous in the item array.
+//	Moving objects are handled by refitting the bounds. If the tree quality degrades too much, it is rebuilt on a worker thread.
 class wiSPTree
 {
-protected:
-	int childCount;
-	wiSPTree();
 public:
+	wiSPTree();
+	wiSPTree(const std::vector<wiSceneComponents::Cullable*>& objects);
 	~wiSPTree();
-	void initialize(const std::vector<wiSceneComponents::Cullable*>& objects, const XMFLOAT3& newMin = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX), const XMFLOAT3& newMax = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX));
 
 	struct Node
 	{
-		int depth;
-		AABB box;
-		std::vector<Node*> children;
-		Node* parent;
-		int count;
-		CulledList objects;
-
-		Node(Node* newParent, const AABB& newBox = AABB(), int newDepth = 0) :parent(newParent), box(newBox), depth(newDepth)
-		{
-			count = 0;
-		}
-		~Node()
-		{
-			for (Node* x : children)
-			{
-				SAFE_DELETE(x);
-			}
-		}
-	};
-	Node* root;
-	enum CullStrictness
-	{
-		SP_TREE_STRICT_CULL,
-		SP_TREE_LOOSE_CULL
+		uint32_t left;		// index of the left child, the right child is always left + 1. Zero for leaf nodes (the root can not be a child)
+		uint32_t first;		// index of the first object of the subtree
+		uint32_t count;		// number of objects in the subtree
+
+		bool IsLeaf() const { return left == 0; }
 	};
+
 	enum SortType
 	{
-		// Completely bypass the sorting (can leave duplicated objects!)
+		// Completely bypass the sorting (can leave duplicated objects if multiple queries write into the same list!)
 		SP_TREE_SORT_NONE,
 		// Perform only a fast sort to eliminate duplicate elements
 		SP_TREE_SORT_UNIQUE,
@@ -70,32 +109,58 @@ public:
 	// Sort culled list by their distance to the origin point
 	static void Sort(const XMFLOAT3& origin, CulledList& objects, SortType sortType = SP_TREE_SORT_UNIQUE);
 
-	void AddObjects(Node* node, const std::vector<wiSceneComponents::Cullable*>& newObjects);
-	void getVisible(const Frustum& frustum, CulledList& objects, SortType sortType = SP_TREE_SORT_UNIQUE, CullStrictness type = SP_TREE_STRICT_CULL, Node* node = nullptr);
-	void getVisible(const AABB& frustum, CulledList& objects, SortType sortType = SP_TREE_SORT_UNIQUE, CullStrictness type = SP_TREE_STRICT_CULL, Node* node = nullptr);
-	void getVisible(const SPHERE& frustum, CulledList& objects, SortType sortType = SP_TREE_SORT_UNIQUE, CullStrictness type = SP_TREE_STRICT_CULL, Node* node = nullptr);
-	void getVisible(const RAY& frustum, CulledList& objects, SortType sortType = SP_TREE_SORT_UNIQUE, CullStrictness type = SP_TREE_STRICT_CULL, Node* node = nullptr);
-	void getAll(CulledList& objects, Node* node = nullptr);
-	// Updates the tree. Returns null if successful, returns a new tree if the tree is resized. The old tree can be thrown away then.
-	wiSPTree* updateTree(Node* node = nullptr);
-	void Remove(wiSceneComponents::Cullable* value, Node* node = nullptr);
-};
+	// Add objects to the tree. The tree is rebuilt immediately, so prefer adding objects in batches
+	void AddObjects(const std::vector<wiSceneComponents::Cullable*>& newObjects);
+	// Remove an object from the tree. The tree is rebuilt immediately
+	void Remove(wiSceneComponents::Cullable* value);
+	// Refit the bounds to the current object bounds, and start a background rebuild if the tree quality degraded. Call once per frame.
+	void Update();
 
-class Octree : public wiSPTree
-{
-public:
-	Octree(const std::vector<wiSceneComponents::Cullable*>& objects, const XMFLOAT3& newMin = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX), const XMFLOAT3& newMax = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX))
+	// The queries append the results to the objects array. They are safe to call from multiple threads at the same time, but not while the tree is modified
+	void getVisible(const Frustum& frustum, CulledList& objects, SortType sortType = SP_TREE_SORT_UNIQUE) const;
+	void getVisible(const AABB& frustum, CulledList& objects, SortType sortType = SP_TREE_SORT_UNIQUE) const;
+	void getVisible(const SPHERE& frustum, CulledList& objects, SortType sortType = SP_TREE_SORT_UNIQUE) const;
+	void getVisible(const RAY& frustum, CulledList& objects, SortType sortType = SP_TREE_SORT_UNIQUE) const;
+	void getAll(CulledList& objects) const;
+
+	bool IsEmpty() const { return nodes.empty(); }
+	// Bounds of the whole tree
+	AABB GetBounds() const;
+	size_t GetNodeCount() const { return nodes.size(); }
+	const Node& GetNode(size_t index) const { return nodes[index]; }
+	AABB GetNodeBounds(size_t index) const { return AABB(nodeBounds.getMin(index), nodeBounds.getMax(index)); }
+
+private:
+	std::vector<Node> nodes;
+	AABBArray nodeBounds;
+	std::vector<wiSceneComponents::Cullable*> items;
+	AABBArray itemBounds;
+
+	// Surface area heuristic cost of the tree after the last build, used to detect quality degradation
+	float buildCost;
+	float currentCost;
+
+	struct RebuildState
 	{
-		childCount=8;
-		initialize(objects, newMin, newMax);
-	}
+		AABBArray bounds;
+		std::vector<Node> nodes;
+		std::vector<uint32_t> order;
+		bool running;
+	} rebuild;
+	wiJobSystem::context rebuildContext;
+
+	// Rebuild the tree on the calling thread. A background rebuild in progress is discarded.
+	void Build();
+	// Reorder the items to match the order of a newly built tree and take its nodes
+	void Apply(std::vector<Node>& newNodes, const std::vector<uint32_t>& order);
+	// Read the current bounds of every item
+	void UpdateItemBounds();
+	// Recompute the node bounds bottom-up from the item bounds
+	void RefitNodes();
+
+	// Traverse the tree. nodeTest classifies node bounds, leafTest appends the visible objects of a partially visible leaf
+	template<typename NodeTest, typename LeafTest>
+	void Query(CulledList& objects, const NodeTest& nodeTest, const LeafTest& leafTest) const;
+	template<typename ItemTest>
+	void TestItems(uint32_t first, uint32_t count, CulledList& objects, const ItemTest& itemTest) const;
 };
-class QuadTree : public wiSPTree
-{
-public:
-	QuadTree(const std::vector<wiSceneComponents::Cullable*>& objects, const XMFLOAT3& newMin = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX), const XMFLOAT3& newMax = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX))
-	{
-		childCount = 4;
-		initialize(objects, newMin, newMax);
-	}
-};
\ No newline at end of file
@@ -11,8 +11,12 @@
 #include "wiPHYSICS.h"
 #include "wiArchive.h"
 #include "wiBackLog.h"
+#include "wiJobSystem.h"
+#include "wiSpinLock.h"
 
 #include <sstream>
+#include <unordered_map>
+#include <algorithm>
 
 using namespace std;
 using namespace wiGraphicsTypes;
@@ -60,13 +64,155 @@ void Scene::AddModel(Model* model)
 }
 void Scene::Update()
 {
-	models[0]->UpdateTransform();
+	if (transformHierarchyVersion != Transform::GetHierarchyVersion())
+	{
+		transformHierarchyVersion = Transform::GetHierarchyVersion();
+
+		// Flatten the hierarchy. The subtrees of the world node are independent, they are grouped to have enough work for a job:
+		static const uint32_t groupSize = 256;
+		transformOrder.clear();
+		transformGroups.clear();
+		transformOrder.push_back(models[0]);
+		for (Transform* root : models[0]->children)
+		{
+			if (transformGroups.empty() || (uint32_t)transformOrder.size() - transformGroups.back() >= groupSize)
+			{
+				transformGroups.push_back((uint32_t)transformOrder.size());
+			}
+			root->GatherHierarchy(transformOrder);
+		}
+	}
+
+	// The transforms are updated only if their inputs changed, every group is updated on a different thread:
+	models[0]->UpdateTransformNode();
+	wiJobSystem::context ctx;
+	for (size_t i = 0; i < transformGroups.size(); ++i)
+	{
+		const uint32_t first = transformGroups[i];
+		const uint32_t last = (i + 1 < transformGroups.size() ? transformGroups[i + 1] : (uint32_t)transformOrder.size());
+		wiJobSystem::Execute(ctx, [this, first, last] {
+			for (uint32_t j = first; j < last; ++j)
+			{
+				transformOrder[j]->UpdateTransformNode();
+			}
+		});
+	}
+	wiJobSystem::Wait(ctx);
 
 	for (Model* x : models)
 	{
 		x->UpdateModel();
 	}
 }
+void Scene::UpdateLookups()
+{
+	if (lookupVersion == Transform::GetHierarchyVersion())
+	{
+		return;
+	}
+	lookupVersion = Transform::GetHierarchyVersion();
+
+	transformLookup.clear();
+	transformIDLookup.clear();
+	objectLookup.clear();
+	armatureLookup.clear();
+	materialLookup.clear();
+	cameraLookup.clear();
+	lightLookup.clear();
+
+	// Transforms in the same order as Transform::find() would visit them. The first one is kept with a name:
+	vector<Transform*> stack;
+	stack.push_back(models[0]);
+	while (!stack.empty())
+	{
+		Transform* x = stack.back();
+		stack.pop_back();
+		transformLookup.insert(make_pair(wiHashString(x->name), x));
+		transformIDLookup.insert(make_pair(x->GetID(), x));
+		for (auto it = x->children.rbegin(); it != x->children.rend(); ++it)
+		{
+			if (*it != nullptr)
+			{
+				stack.push_back(*it);
+			}
+		}
+	}
+
+	for (Model* model : models)
+	{
+		for (Object* x : model->objects)
+		{
+			objectLookup.insert(make_pair(wiHashString(x->name), x));
+		}
+		for (Armature* x : model->armatures)
+		{
+			armatureLookup.insert(make_pair(wiHashString(x->name), x));
+		}
+		for (auto& x : model->materials)
+		{
+			materialLookup.insert(make_pair(wiHashString(x.first), x.second));
+		}
+		for (Camera* x : model->cameras)
+		{
+			cameraLookup.insert(make_pair(wiHashString(x->name), x));
+		}
+		for (Light* x : model->lights)
+		{
+			lightLookup.insert(make_pair(wiHashString(x->name), x));
+		}
+	}
+}
+template<typename T>
+static T* FindInLookup(const unordered_map<wiHashString, T*>& lookup, const string& name)
+{
+	auto it = lookup.find(wiHashString(name));
+	// wiHashString only compares hashes:
+	if (it != lookup.end() && !it->first.GetString().compare(name))
+	{
+		return it->second;
+	}
+	return nullptr;
+}
+Transform* Scene::FindTransform(const std::string& name)
+{
+	UpdateLookups();
+	return FindInLookup(transformLookup, name);
+}
+Transform* Scene::FindTransform(uint64_t id)
+{
+	UpdateLookups();
+	auto it = transformIDLookup.find(id);
+	if (it != transformIDLookup.end())
+	{
+		return it->second;
+	}
+	return nullptr;
+}
+Object* Scene::FindObject(const std::string& name)
+{
+	UpdateLookups();
+	return FindInLookup(objectLookup, name);
+}
+Armature* Scene::FindArmature(const std::string& name)
+{
+	UpdateLookups();
+	return FindInLookup(armatureLookup, name);
+}
+Material* Scene::FindMaterial(const std::string& name)
+{
+	UpdateLookups();
+	return FindInLookup(materialLookup, name);
+}
+Camera* Scene::FindCamera(const std::string& name)
+{
+	UpdateLookups();
+	return FindInLookup(cameraLookup, name);
+}
+Light* Scene::FindLight(const std::string& name)
+{
+	UpdateLookups();
+	return FindInLookup(lightLookup, name);
+}
 #pragma endregion
 
 #pragma region CULLABLE
@@ -263,27 +409,27 @@ void Material::Serialize(wiArchive& archive)
 		if (!surfaceMapName.empty())
 		{
 			surfaceMapName = texturesDir + surfaceMapName;
-			surfaceMap = (Texture2D*)wiResourceManager::GetGlobal()->add(surfaceMapName);
+			surfaceMap = (Texture2D*)wiResourceManager::GetGlobal()->add(surfaceMapName, wiResourceManager::IMAGE_LINEAR);
 		}
 		if (!textureName.empty())
 		{
 			textureName = texturesDir + textureName;
-			texture = (Texture2D*)wiResourceManager::GetGlobal()->add(textureName);
+			texture = (Texture2D*)wiResourceManager::GetGlobal()->add(textureName, wiResourceManager::IMAGE_BASECOLOR);
 		}
 		if (!normalMapName.empty())
 		{
 			normalMapName = texturesDir + normalMapName;
-			normalMap = (Texture2D*)wiResourceManager::GetGlobal()->add(normalMapName);
+			normalMap = (Texture2D*)wiResourceManager::GetGlobal()->add(normalMapName, wiResourceManager::IMAGE_NORMALMAP);
 		}
 		if (!displacementMapName.empty())
 		{
 			displacementMapName = texturesDir + displacementMapName;
-			displacementMap = (Texture2D*)wiResourceManager::GetGlobal()->add(displacementMapName);
+			displacementMap = (Texture2D*)wiResourceManager::GetGlobal()->add(displacementMapName, wiResourceManager::IMAGE_LINEAR);
 		}
 		if (!specularMapName.empty())
 		{
 			specularMapName = texturesDir + specularMapName;
-			specularMap = (Texture2D*)wiResourceManager::GetGlobal()->add(specularMapName);
+			specularMap = (Texture2D*)wiResourceManager::GetGlobal()->add(specularMapName, wiResourceManager::IMAGE_LINEAR);
 		}
 	}
 	else
@@ -374,6 +520,8 @@ MeshSubset::MeshSubset()
 {
 	material = nullptr;
 	indexBufferOffset = 0;
+	meshletOffset = 0;
+	meshletCount = 0;
 }
 MeshSubset::~MeshSubset()
 {
@@ -435,6 +583,7 @@ void Mesh::init()
 	indices.resize(0);
 	renderable = false;
 	doubleSided = false;
+	occluder = false;
 	aabb = AABB();
 	trailInfo = RibbonTrail();
 	armature = nullptr;
@@ -448,7 +597,11 @@ void Mesh::init()
 	softVG = -1;
 	goalPositions.clear();
 	goalNormals.clear();
+	meshlets.clear();
+	collisionBVH.clear();
 	renderDataComplete = false;
+	renderDataPrepared = false;
+	optimized = false;
 	calculatedAO = false;
 	armatureName = "";
 	impostorDistance = 100.0f;
@@ -456,6 +609,13 @@ void Mesh::init()
 	bufferOffset_POS = 0;
 	bufferOffset_PRE = 0;
 	indexFormat = wiGraphicsTypes::INDEXFORMAT_16BIT;
+	skinnedArmature = nullptr;
+	skinnedVersion = ~0ull;
+	softBodyVersion = 0;
+	bvh.Clear();
+	bvhPositions.clear();
+	bvhSource = -1;
+	bvhVersion = 0;
 
 	SAFE_INIT(indexBuffer);
 	SAFE_INIT(vertexBuffer_POS);
@@ -464,113 +624,332 @@ void Mesh::init()
 	SAFE_INIT(streamoutBuffer_POS);
 	SAFE_INIT(streamoutBuffer_PRE);
 }
-void Mesh::CreateRenderData() 
+void Mesh::PrepareRenderData()
 {
-	if (!renderDataComplete) 
+	// First, assemble vertex, index arrays:
+
+	// Reorder the triangles and vertices before anything is derived from them:
+	if (!optimized)
 	{
-		// First, assemble vertex, index arrays:
-
-		// In case of recreate, delete data first:
-		vertices_POS.clear();
-		vertices_TEX.clear();
-		vertices_BON.clear();
-
-		// De-interleave vertex arrays:
-		vertices_POS.resize(vertices_FULL.size());
-		vertices_TEX.resize(vertices_FULL.size());
-		// do not resize vertices_BON just yet, not every mesh will need bone vertex data!
-		for (size_t i = 0; i < vertices_FULL.size(); ++i)
-		{
-			// Normalize normals:
-			float alpha = vertices_FULL[i].nor.w;
-			XMVECTOR nor = XMLoadFloat4(&vertices_FULL[i].nor);
-			nor = XMVector3Normalize(nor);
-			XMStoreFloat4(&vertices_FULL[i].nor, nor);
-			vertices_FULL[i].nor.w = alpha;
-
-			// Normalize bone weights:
-			XMFLOAT4& wei = vertices_FULL[i].wei;
-			float len = wei.x + wei.y + wei.z + wei.w;
-			if (len > 0)
-			{
-				wei.x /= len;
-				wei.y /= len;
-				wei.z /= len;
-				wei.w /= len;
-
-				if (vertices_BON.empty())
-				{
-					// Allocate full bone vertex data when we find a correct bone weight.
-					vertices_BON.resize(vertices_FULL.size());
-				}
-				vertices_BON[i] = Vertex_BON(vertices_FULL[i]);
-			}
+		Optimize();
+	}
+
+	// In case of recreate, delete data first:
+	skinnedVersion = ~0ull;
+	bvh.Clear();
+	vertices_POS.clear();
+	vertices_TEX.clear();
+	vertices_BON.clear();
+
+	// De-interleave vertex arrays:
+	vertices_POS.resize(vertices_FULL.size());
+	vertices_TEX.resize(vertices_FULL.size());
+	// do not resize vertices_BON just yet, not every mesh will need bone vertex data!
+	for (size_t i = 0; i < vertices_FULL.size(); ++i)
+	{
+		// Normalize normals:
+		float alpha = vertices_FULL[i].nor.w;
+		XMVECTOR nor = XMLoadFloat4(&vertices_FULL[i].nor);
+		nor = XMVector3Normalize(nor);
+		XMStoreFloat4(&vertices_FULL[i].nor, nor);
+		vertices_FULL[i].nor.w = alpha;
+
+		// Normalize bone weights:
+		XMFLOAT4& wei = vertices_FULL[i].wei;
+		float len = wei.x + wei.y + wei.z + wei.w;
+		if (len > 0)
+		{
+			wei.x /= len;
+			wei.y /= len;
+			wei.z /= len;
+			wei.w /= len;
 
-			// Split and type conversion:
-			vertices_POS[i] = Vertex_POS(vertices_FULL[i]);
-			vertices_TEX[i] = Vertex_TEX(vertices_FULL[i]);
+			if (vertices_BON.empty())
+			{
+				// Allocate full bone vertex data when we find a correct bone weight.
+				vertices_BON.resize(vertices_FULL.size());
+			}
+			vertices_BON[i] = Vertex_BON(vertices_FULL[i]);
 		}
 
-		// Save original vertices. This will be input for CPU skinning / soft bodies
-		vertices_Transformed_POS = vertices_POS;
-		vertices_Transformed_PRE = vertices_POS; // pre <- pos!! (previous positions will have the current positions initially)
+		// Split and type conversion:
+		vertices_POS[i] = Vertex_POS(vertices_FULL[i]);
+		vertices_TEX[i] = Vertex_TEX(vertices_FULL[i]);
+	}
+
+	// Save original vertices. This will be input for CPU skinning / soft bodies
+	vertices_Transformed_POS = vertices_POS;
+	vertices_Transformed_PRE = vertices_POS; // pre <- pos!! (previous positions will have the current positions initially)
+
+	// Map subset indices:
+	for (auto& subset : subsets)
+	{
+		subset.subsetIndices.clear();
+		subset.meshletOffset = 0;
+		subset.meshletCount = 0;
+	}
+	for (size_t i = 0; i < indices.size(); ++i)
+	{
+		uint32_t index = indices[i];
+		const XMFLOAT4& tex = vertices_FULL[index].tex;
+		unsigned int materialIndex = (unsigned int)floor(tex.z);
+
+		assert((materialIndex < (unsigned int)subsets.size()) && "Bad subset index!");
+
+		MeshSubset& subset = subsets[materialIndex];
+		subset.subsetIndices.push_back(index);
+
+		if (index >= 65536)
+		{
+			indexFormat = INDEXFORMAT_32BIT;
+		}
+	}
 
-		// Map subset indices:
-		for (auto& subset : subsets)
+	// Map subset meshlets, they are sorted by subset. If the triangles were modified after the meshlets were built, they are discarded:
+	for (uint32_t i = 0; i < (uint32_t)meshlets.size(); ++i)
+	{
+		const wiMeshlet::Meshlet& meshlet = meshlets[i];
+		if (meshlet.subset >= subsets.size() || (meshlet.triangleOffset + meshlet.triangleCount) * 3 > subsets[meshlet.subset].subsetIndices.size())
 		{
-			subset.subsetIndices.clear();
+			meshlets.clear();
+			for (auto& subset : subsets)
+			{
+				subset.meshletOffset = 0;
+				subset.meshletCount = 0;
+			}
+			break;
 		}
-		for (size_t i = 0; i < indices.size(); ++i)
+		MeshSubset& subset = subsets[meshlet.subset];
+		if (subset.meshletCount == 0)
 		{
-			uint32_t index = indices[i];
-			const XMFLOAT4& tex = vertices_FULL[index].tex;
-			unsigned int materialIndex = (unsigned int)floor(tex.z);
+			subset.meshletOffset = i;
+		}
+		subset.meshletCount++;
+	}
 
-			assert((materialIndex < (unsigned int)subsets.size()) && "Bad subset index!");
+	// Goal positions, normals are controlling blending between animation and physics states for soft body rendering:
+	goalPositions.clear();
+	goalNormals.clear();
+	if (goalVG >= 0)
+	{
+		goalPositions.resize(vertexGroups[goalVG].vertices.size());
+		goalNormals.resize(vertexGroups[goalVG].vertices.size());
+	}
 
-			MeshSubset& subset = subsets[materialIndex];
-			subset.subsetIndices.push_back(index);
 
-			if (index >= 65536)
+	// Mapping render vertices to physics vertex representation:
+	//	the physics vertices contain unique position, not duplicated by texcoord or normals
+	//	this way we can map several renderable vertices to one physics vertex
+	//	but the mapping function will actually be indexed by renderable vertex index for efficient retrieval.
+	if (!physicsverts.empty() && physicalmapGP.empty())
+	{
+		for (size_t i = 0; i < vertices_POS.size(); ++i)
+		{
+			for (size_t j = 0; j < physicsverts.size(); ++j)
 			{
-				indexFormat = INDEXFORMAT_32BIT;
+				if (fabs(vertices_POS[i].pos.x - physicsverts[j].x) < FLT_EPSILON
+					&&	fabs(vertices_POS[i].pos.y - physicsverts[j].y) < FLT_EPSILON
+					&&	fabs(vertices_POS[i].pos.z - physicsverts[j].z) < FLT_EPSILON
+					)
+				{
+					physicalmapGP.push_back(static_cast<int>(j));
+					break;
+				}
 			}
 		}
+	}
+
+	renderDataPrepared = true;
+}
+void Mesh::BuildMeshlets()
+{
+	meshlets.clear();
+	if (vertices_FULL.empty() || subsets.empty())
+	{
+		return;
+	}
+	for (const Vertex_FULL& vertex : vertices_FULL)
+	{
+		if (vertex.pos.w != 0)
+		{
+			// wind moves the vertices in the vertex shader, the meshlet bounds wouldn't hold
+			return;
+		}
+	}
+
+	// Group the triangles by subset:
+	vector<vector<uint32_t>> subsetTriangles(subsets.size());
+	const size_t triangleIndexCount = indices.size() - indices.size() % 3;
+	for (size_t i = 0; i < triangleIndexCount; i += 3)
+	{
+		unsigned int materialIndex = (unsigned int)floor(vertices_FULL[indices[i]].tex.z);
+		if (materialIndex >= (unsigned int)subsets.size())
+		{
+			return;
+		}
+		subsetTriangles[materialIndex].push_back(indices[i + 0]);
+		subsetTriangles[materialIndex].push_back(indices[i + 1]);
+		subsetTriangles[materialIndex].push_back(indices[i + 2]);
+	}
+
+	// Reorder the triangles of every subset into meshlets. The subset index lists keep this order, so every meshlet is a range of the index buffer:
+	vector<uint32_t> remainder(indices.begin() + triangleIndexCount, indices.end());
+	indices.clear();
+	for (uint32_t subsetIndex = 0; subsetIndex < (uint32_t)subsetTriangles.size(); ++subsetIndex)
+	{
+		vector<uint32_t>& triangles = subsetTriangles[subsetIndex];
+		if (triangles.empty())
+		{
+			continue;
+		}
+		const size_t first = meshlets.size();
+		wiMeshlet::Build(triangles.data(), (uint32_t)triangles.size(), &vertices_FULL[0].pos.x, (uint32_t)vertices_FULL.size(), sizeof(Vertex_FULL), meshlets);
+		for (size_t i = first; i < meshlets.size(); ++i)
+		{
+			meshlets[i].subset = subsetIndex;
+		}
+		indices.insert(indices.end(), triangles.begin(), triangles.end());
+	}
+	indices.insert(indices.end(), remainder.begin(), remainder.end());
+}
+void Mesh::Optimize(wiMeshOptimizer::CacheStats* statsBefore, wiMeshOptimizer::CacheStats* statsAfter)
+{
+	optimized = true;
+	collisionBVH.clear(); // it refers to the triangles by their order
 
+	const uint32_t vertexCount = (uint32_t)vertices_FULL.size();
+	if (statsBefore != nullptr)
+	{
+		*statsBefore = wiMeshOptimizer::AnalyzeVertexCache(indices.data(), (uint32_t)indices.size(), vertexCount);
+	}
 
-		// Goal positions, normals are controlling blending between animation and physics states for soft body rendering:
-		goalPositions.clear();
-		goalNormals.clear();
-		if (goalVG >= 0)
+	// Large static meshes are split into meshlets for culling first, unless they were loaded with the mesh.
+	//	Skinned and soft body meshes are deformed, their meshlet bounds wouldn't hold:
+	bool skinned = false;
+	for (const Vertex_FULL& vertex : vertices_FULL)
+	{
+		if (vertex.wei.x + vertex.wei.y + vertex.wei.z + vertex.wei.w > 0)
 		{
-			goalPositions.resize(vertexGroups[goalVG].vertices.size());
-			goalNormals.resize(vertexGroups[goalVG].vertices.size());
+			skinned = true;
+			break;
 		}
+	}
+	if (meshlets.empty() && !skinned && !softBody && indices.size() / 3 >= wiMeshlet::MIN_MESH_TRIANGLES)
+	{
+		BuildMeshlets();
+	}
 
+	// Group the triangles by subset, the same way as the subset index lists are assembled:
+	vector<vector<uint32_t>> subsetTriangles(subsets.size());
+	const size_t triangleIndexCount = indices.size() - indices.size() % 3;
+	bool valid = vertexCount > 0 && !subsets.empty();
+	for (size_t i = 0; i < triangleIndexCount && valid; i += 3)
+	{
+		unsigned int materialIndex = (unsigned int)floor(vertices_FULL[indices[i]].tex.z);
+		if (materialIndex >= (unsigned int)subsets.size())
+		{
+			valid = false;
+			break;
+		}
+		subsetTriangles[materialIndex].push_back(indices[i + 0]);
+		subsetTriangles[materialIndex].push_back(indices[i + 1]);
+		subsetTriangles[materialIndex].push_back(indices[i + 2]);
+	}
 
-		// Mapping render vertices to physics vertex representation:
-		//	the physics vertices contain unique position, not duplicated by texcoord or normals
-		//	this way we can map several renderable vertices to one physics vertex
-		//	but the mapping function will actually be indexed by renderable vertex index for efficient retrieval.
-		if (!physicsverts.empty() && physicalmapGP.empty())
+	if (valid)
+	{
+		// The triangles are only reordered inside the meshlets, so their bounds and ranges stay valid.
+		//	The meshlet order is kept, neighbouring meshlets are merged into fewer draws when culling:
+		vector<bool> subsetMeshlets(subsets.size(), false);
+		vector<uint32_t> localIndex(vertexCount, ~0u);
+		vector<uint32_t> meshletVertices;
+		vector<uint32_t> meshletIndices;
+		for (const wiMeshlet::Meshlet& meshlet : meshlets)
 		{
-			for (size_t i = 0; i < vertices_POS.size(); ++i)
+			if (meshlet.subset >= subsets.size() || (meshlet.triangleOffset + meshlet.triangleCount) * 3 > subsetTriangles[meshlet.subset].size())
+			{
+				continue; // discarded in PrepareRenderData()
+			}
+			subsetMeshlets[meshlet.subset] = true;
+
+			// The meshlet vertices are numbered locally, so the work is proportional to the meshlet size:
+			uint32_t* triangles = &subsetTriangles[meshlet.subset][meshlet.triangleOffset * 3];
+			meshletVertices.clear();
+			meshletIndices.resize(meshlet.triangleCount * 3);
+			for (uint32_t i = 0; i < meshlet.triangleCount * 3; ++i)
 			{
-				for (size_t j = 0; j < physicsverts.size(); ++j)
+				uint32_t& local = localIndex[triangles[i]];
+				if (local == ~0u)
 				{
-					if (fabs(vertices_POS[i].pos.x - physicsverts[j].x) < FLT_EPSILON
-						&&	fabs(vertices_POS[i].pos.y - physicsverts[j].y) < FLT_EPSILON
-						&&	fabs(vertices_POS[i].pos.z - physicsverts[j].z) < FLT_EPSILON
-						)
-					{
-						physicalmapGP.push_back(static_cast<int>(j));
-						break;
-					}
+					local = (uint32_t)meshletVertices.size();
+					meshletVertices.push_back(triangles[i]);
 				}
+				meshletIndices[i] = local;
+			}
+			wiMeshOptimizer::OptimizeVertexCache(meshletIndices.data(), (uint32_t)meshletIndices.size(), (uint32_t)meshletVertices.size());
+			for (uint32_t i = 0; i < meshlet.triangleCount * 3; ++i)
+			{
+				triangles[i] = meshletVertices[meshletIndices[i]];
+			}
+			for (uint32_t vertex : meshletVertices)
+			{
+				localIndex[vertex] = ~0u;
 			}
 		}
 
+		vector<uint32_t> remainder(indices.begin() + triangleIndexCount, indices.end());
+		vector<uint32_t> clusters;
+		indices.clear();
+		for (size_t subsetIndex = 0; subsetIndex < subsetTriangles.size(); ++subsetIndex)
+		{
+			vector<uint32_t>& triangles = subsetTriangles[subsetIndex];
+			if (!subsetMeshlets[subsetIndex] && !triangles.empty())
+			{
+				wiMeshOptimizer::OptimizeVertexCache(triangles.data(), (uint32_t)triangles.size(), vertexCount, wiMeshOptimizer::CACHE_SIZE, &clusters);
+				wiMeshOptimizer::OptimizeOverdraw(triangles.data(), (uint32_t)triangles.size(), &vertices_FULL[0].pos.x, vertexCount, sizeof(Vertex_FULL), clusters);
+			}
+			indices.insert(indices.end(), triangles.begin(), triangles.end());
+		}
+		indices.insert(indices.end(), remainder.begin(), remainder.end());
+
+		// Number the vertices in the order that the triangles use them.
+		//	Vertex groups and the soft body physics refer to the vertices by index, those meshes keep their vertex order:
+		if (vertexGroups.empty() && !softBody && physicsverts.empty() && physicalmapGP.empty())
+		{
+			vector<uint32_t> remap;
+			wiMeshOptimizer::OptimizeVertexFetch(indices.data(), (uint32_t)indices.size(), vertexCount, remap);
+
+			vector<Vertex_FULL> remapped(vertexCount);
+			for (uint32_t i = 0; i < vertexCount; ++i)
+			{
+				remapped[remap[i]] = vertices_FULL[i];
+			}
+			vertices_FULL.swap(remapped);
+
+			if (trailInfo.base >= 0 && trailInfo.base < (int)vertexCount)
+			{
+				trailInfo.base = (int)remap[trailInfo.base];
+			}
+			if (trailInfo.tip >= 0 && trailInfo.tip < (int)vertexCount)
+			{
+				trailInfo.tip = (int)remap[trailInfo.tip];
+			}
+		}
+	}
 
+	if (statsAfter != nullptr)
+	{
+		*statsAfter = wiMeshOptimizer::AnalyzeVertexCache(indices.data(), (uint32_t)indices.size(), vertexCount);
+	}
+}
+void Mesh::CreateRenderData() 
+{
+	if (!renderDataComplete) 
+	{
+		if (!renderDataPrepared)
+		{
+			PrepareRenderData();
+		}
 
 		// Create actual GPU data:
 
@@ -699,6 +1078,7 @@ void Mesh::CreateRenderData()
 
 
 		renderDataComplete = true;
+		renderDataPrepared = false; // a recreate prepares the data again
 	}
 
 }
@@ -885,106 +1265,157 @@ void Mesh::CreateImpostorVB()
 		wiRenderer::GetDevice()->CreateBuffer(&bd, &InitData, &impostorVB_TEX);
 	}
 }
-void Mesh::ComputeNormals(bool smooth)
+namespace
 {
-	// Start recalculating normals:
-
-	if (smooth)
+	// Hash map keys for welding vertices. Positions are compared exactly, only negative zero is treated the same as zero
+	inline uint32_t FloatBits(float value)
 	{
-		// Compute smooth surface normals:
+		value += 0.0f;
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+	inline size_t HashCombine(size_t seed, uint32_t value)
+	{
+		return seed ^ (value + 0x9e3779b9 + (seed << 6) + (seed >> 2));
+	}
+	struct PositionKey
+	{
+		uint32_t x, y, z;
 
-		// 1.) Zero normals, they will be averaged later
-		for (size_t i = 0; i < vertices_FULL.size() - 1; i++)
-		{
-			vertices_FULL[i].nor = XMFLOAT4(0, 0, 0, 0);
-		}
+		PositionKey(const XMFLOAT4& pos) :x(FloatBits(pos.x)), y(FloatBits(pos.y)), z(FloatBits(pos.z)) {}
+		bool operator==(const PositionKey& other) const { return x == other.x && y == other.y && z == other.z; }
 
-		// 2.) Find identical vertices by POSITION, accumulate face normals
-		for (size_t i = 0; i < vertices_FULL.size() - 1; i++)
+		struct Hash
 		{
-			Vertex_FULL& v_search = vertices_FULL[i];
-
-			for (size_t ind = 0; ind < indices.size() / 3; ++ind)
-			{
-				uint32_t i0 = indices[ind * 3 + 0];
-				uint32_t i1 = indices[ind * 3 + 1];
-				uint32_t i2 = indices[ind * 3 + 2];
+			size_t operator()(const PositionKey& key) const { return HashCombine(HashCombine(key.x, key.y), key.z); }
+		};
+	};
+	struct VertexKey
+	{
+		PositionKey position;
+		uint32_t u, v;
+		int material;
 
-				Vertex_FULL& v0 = vertices_FULL[i0];
-				Vertex_FULL& v1 = vertices_FULL[i1];
-				Vertex_FULL& v2 = vertices_FULL[i2];
+		VertexKey(const XMFLOAT4& pos, const XMFLOAT4& tex) :position(pos), u(FloatBits(tex.x)), v(FloatBits(tex.y)), material((int)tex.z) {}
+		bool operator==(const VertexKey& other) const { return position == other.position && u == other.u && v == other.v && material == other.material; }
 
-				bool match_pos0 =
-					fabs(v_search.pos.x - v0.pos.x) < FLT_EPSILON &&
-					fabs(v_search.pos.y - v0.pos.y) < FLT_EPSILON &&
-					fabs(v_search.pos.z - v0.pos.z) < FLT_EPSILON;
+		struct Hash
+		{
+			size_t operator()(const VertexKey& key) const { return HashCombine(HashCombine(HashCombine(PositionKey::Hash()(key.position), key.u), key.v), (uint32_t)key.material); }
+		};
+	};
+}
+void Mesh::ComputeNormals(bool smooth, NORMAL_WEIGHTING weighting)
+{
+	// Start recalculating normals:
 
-				bool match_pos1 =
-					fabs(v_search.pos.x - v1.pos.x) < FLT_EPSILON &&
-					fabs(v_search.pos.y - v1.pos.y) < FLT_EPSILON &&
-					fabs(v_search.pos.z - v1.pos.z) < FLT_EPSILON;
+	if (smooth)
+	{
+		// Compute smooth surface normals:
 
-				bool match_pos2 =
-					fabs(v_search.pos.x - v2.pos.x) < FLT_EPSILON &&
-					fabs(v_search.pos.y - v2.pos.y) < FLT_EPSILON &&
-					fabs(v_search.pos.z - v2.pos.z) < FLT_EPSILON;
+		const uint32_t vertexCount = (uint32_t)vertices_FULL.size();
+		const uint32_t faceCount = (uint32_t)(indices.size() / 3);
 
-				if (match_pos0 || match_pos1 || match_pos2)
+		// 1.) Weld vertices by POSITION with a hash map, every vertex gets the index of its position group
+		vector<uint32_t> positionGroups(vertexCount);
+		uint32_t groupCount = 0;
+		{
+			unordered_map<PositionKey, uint32_t, PositionKey::Hash> groups;
+			groups.reserve(vertexCount);
+			for (uint32_t i = 0; i < vertexCount; ++i)
+			{
+				auto it = groups.insert(make_pair(PositionKey(vertices_FULL[i].pos), groupCount));
+				if (it.second)
 				{
-					XMVECTOR U = XMLoadFloat4(&v2.pos) - XMLoadFloat4(&v0.pos);
-					XMVECTOR V = XMLoadFloat4(&v1.pos) - XMLoadFloat4(&v0.pos);
-
-					XMVECTOR N = XMVector3Cross(U, V);
-					N = XMVector3Normalize(N);
-
-					XMFLOAT3 normal;
-					XMStoreFloat3(&normal, N);
-
-					v_search.nor.x += normal.x;
-					v_search.nor.y += normal.y;
-					v_search.nor.z += normal.z;
+					groupCount++;
 				}
-
+				positionGroups[i] = it.first->second;
 			}
 		}
 
-		// 3.) Find unique vertices by POSITION and TEXCOORD and MATERIAL and remove duplicates
-		for (size_t i = 0; i < vertices_FULL.size() - 1; i++)
-		{
-			const Vertex_FULL& v0 = vertices_FULL[i];
+		// 2.) Compute the weighted face normal contribution of every face corner in parallel
+		vector<XMFLOAT3> cornerNormals(faceCount * 3);
+		wiJobSystem::context ctx;
+		wiJobSystem::Dispatch(ctx, faceCount, 1024, [&](wiJobSystem::JobDispatchArgs args) {
+			const uint32_t face = args.jobIndex;
+			const XMVECTOR P0 = XMLoadFloat4(&vertices_FULL[indices[face * 3 + 0]].pos);
+			const XMVECTOR P1 = XMLoadFloat4(&vertices_FULL[indices[face * 3 + 1]].pos);
+			const XMVECTOR P2 = XMLoadFloat4(&vertices_FULL[indices[face * 3 + 2]].pos);
 
-			for (size_t j = i + 1; j < vertices_FULL.size(); j++)
+			XMVECTOR U = P2 - P0;
+			XMVECTOR V = P1 - P0;
+
+			// The length of the cross product is twice the triangle area:
+			XMVECTOR N = XMVector3Cross(U, V);
+			if (weighting != NORMAL_WEIGHTING_AREA)
 			{
-				const Vertex_FULL& v1 = vertices_FULL[j];
+				N = XMVector3Normalize(N);
+			}
 
-				bool unique_pos =
-					fabs(v0.pos.x - v1.pos.x) < FLT_EPSILON &&
-					fabs(v0.pos.y - v1.pos.y) < FLT_EPSILON &&
-					fabs(v0.pos.z - v1.pos.z) < FLT_EPSILON;
+			if (weighting == NORMAL_WEIGHTING_ANGLE)
+			{
+				const XMVECTOR E01 = XMVector3Normalize(P1 - P0);
+				const XMVECTOR E02 = XMVector3Normalize(P2 - P0);
+				const XMVECTOR E12 = XMVector3Normalize(P2 - P1);
+				const float angle0 = XMVectorGetX(XMVector3AngleBetweenNormals(E01, E02));
+				const float angle1 = XMVectorGetX(XMVector3AngleBetweenNormals(-E01, E12));
+				const float angle2 = XM_PI - angle0 - angle1;
+				XMStoreFloat3(&cornerNormals[face * 3 + 0], N * angle0);
+				XMStoreFloat3(&cornerNormals[face * 3 + 1], N * angle1);
+				XMStoreFloat3(&cornerNormals[face * 3 + 2], N * angle2);
+			}
+			else
+			{
+				XMStoreFloat3(&cornerNormals[face * 3 + 0], N);
+				cornerNormals[face * 3 + 1] = cornerNormals[face * 3 + 0];
+				cornerNormals[face * 3 + 2] = cornerNormals[face * 3 + 0];
+			}
+		});
+		wiJobSystem::Wait(ctx);
 
-				bool unique_tex =
-					fabs(v0.tex.x - v1.tex.x) < FLT_EPSILON &&
-					fabs(v0.tex.y - v1.tex.y) < FLT_EPSILON &&
-					(int)v0.tex.z == (int)v1.tex.z;
+		// 3.) Accumulate the face normals into the position groups with one linear pass over the face corners
+		vector<XMFLOAT3> groupNormals(groupCount, XMFLOAT3(0, 0, 0));
+		for (size_t corner = 0; corner < cornerNormals.size(); ++corner)
+		{
+			XMFLOAT3& normal = groupNormals[positionGroups[indices[corner]]];
+			normal.x += cornerNormals[corner].x;
+			normal.y += cornerNormals[corner].y;
+			normal.z += cornerNormals[corner].z;
+		}
 
-				if (unique_pos && unique_tex)
+		// 4.) Every vertex gets the normalized normal of its position group
+		wiJobSystem::Dispatch(ctx, vertexCount, 1024, [&](wiJobSystem::JobDispatchArgs args) {
+			Vertex_FULL& vertex = vertices_FULL[args.jobIndex];
+			XMFLOAT3 normal;
+			XMStoreFloat3(&normal, XMVector3Normalize(XMLoadFloat3(&groupNormals[positionGroups[args.jobIndex]])));
+			vertex.nor.x = normal.x;
+			vertex.nor.y = normal.y;
+			vertex.nor.z = normal.z;
+		});
+		wiJobSystem::Wait(ctx);
+
+		// 5.) Find unique vertices by POSITION and TEXCOORD and MATERIAL and remove duplicates
+		{
+			vector<Vertex_FULL> uniqueVertices;
+			uniqueVertices.reserve(vertexCount);
+			vector<uint32_t> remap(vertexCount);
+			unordered_map<VertexKey, uint32_t, VertexKey::Hash> uniques;
+			uniques.reserve(vertexCount);
+			for (uint32_t i = 0; i < vertexCount; ++i)
+			{
+				auto it = uniques.insert(make_pair(VertexKey(vertices_FULL[i].pos, vertices_FULL[i].tex), (uint32_t)uniqueVertices.size()));
+				if (it.second)
 				{
-					for (size_t ind = 0; ind < indices.size(); ++ind)
-					{
-						if (indices[ind] == j)
-						{
-							indices[ind] = static_cast<uint32_t>(i);
-						}
-						else if (indices[ind] > j && indices[ind] > 0)
-						{
-							indices[ind]--;
-						}
-					}
-
-					vertices_FULL.erase(vertices_FULL.begin() + j);
+					uniqueVertices.push_back(vertices_FULL[i]);
 				}
-
+				remap[i] = it.first->second;
+			}
+			for (auto& index : indices)
+			{
+				index = remap[index];
 			}
+			vertices_FULL.swap(uniqueVertices);
 		}
 	}
 	else
@@ -1039,9 +1470,16 @@ void Mesh::ComputeNormals(bool smooth)
 		indices = newIndexBuffer;
 	}
 
-	// force recreate:
-	renderDataComplete = false;
-	CreateRenderData();
+	// force recreate (a mesh that is still loading creates its render data later), the meshlets and the collider are built again from the new triangles:
+	meshlets.clear();
+	collisionBVH.clear();
+	optimized = false;
+	renderDataPrepared = false;
+	if (renderDataComplete)
+	{
+		renderDataComplete = false;
+		CreateRenderData();
+	}
 }
 void Mesh::FlipCulling()
 {
@@ -1056,8 +1494,16 @@ void Mesh::FlipCulling()
 		indices[face * 3 + 2] = i1;
 	}
 
-	renderDataComplete = false;
-	CreateRenderData();
+	// force recreate:
+	meshlets.clear();
+	collisionBVH.clear();
+	optimized = false;
+	renderDataPrepared = false;
+	if (renderDataComplete)
+	{
+		renderDataComplete = false;
+		CreateRenderData();
+	}
 }
 void Mesh::FlipNormals()
 {
@@ -1070,8 +1516,13 @@ void Mesh::FlipNormals()
 		v0.nor.z *= -1;
 	}
 
-	renderDataComplete = false;
-	CreateRenderData();
+	// force recreate:
+	renderDataPrepared = false;
+	if (renderDataComplete)
+	{
+		renderDataComplete = false;
+		CreateRenderData();
+	}
 }
 Mesh::Vertex_FULL Mesh::TransformVertex(int vertexI, const XMMATRIX& mat)
 {
@@ -1128,6 +1579,198 @@ Mesh::Vertex_FULL Mesh::TransformVertex(int vertexI, const XMMATRIX& mat)
 	return retV;
 }
 
+void Mesh::SkinnedVertices::resize(size_t count)
+{
+	posX.resize(count);
+	posY.resize(count);
+	posZ.resize(count);
+	norX.resize(count);
+	norY.resize(count);
+	norZ.resize(count);
+}
+// Linear blend skinning of the vertices [first, last). The bone matrices are already multiplied by the output transform,
+//	because blending is linear: sum(w * bone) * mat == sum(w * (bone * mat)). So every vertex only needs a single matrix blend.
+static void SkinVertexRange(const Mesh& mesh, const XMFLOAT4X4* bones, uint32_t boneCount, const XMMATRIX& mat, uint32_t first, uint32_t last, Mesh::SkinnedVertices& out)
+{
+	for (uint32_t i = first; i < last; ++i)
+	{
+		XMVECTOR pos = mesh.vertices_POS[i].LoadPOS();
+		XMVECTOR nor = mesh.vertices_POS[i].LoadNOR();
+
+		XMMATRIX skin = mat;
+		if (boneCount > 0)
+		{
+			const Mesh::Vertex_BON& bon = mesh.vertices_BON[i];
+
+			XMMATRIX sum(XMVectorZero(), XMVectorZero(), XMVectorZero(), XMVectorZero());
+			bool weighted = false;
+			for (int influence = 0; influence < 4; ++influence)
+			{
+				const uint32_t weight = (uint32_t)(bon.wei >> (influence * 16)) & 0xFFFF;
+				const uint32_t index = (uint32_t)(bon.ind >> (influence * 16)) & 0xFFFF;
+				if (weight == 0 || index >= boneCount)
+				{
+					continue;
+				}
+				const XMVECTOR w = XMVectorReplicate((float)weight / 65535.0f);
+				const XMFLOAT4X4& bone = bones[index];
+				sum.r[0] = XMVectorMultiplyAdd(XMLoadFloat4((const XMFLOAT4*)&bone._11), w, sum.r[0]);
+				sum.r[1] = XMVectorMultiplyAdd(XMLoadFloat4((const XMFLOAT4*)&bone._21), w, sum.r[1]);
+				sum.r[2] = XMVectorMultiplyAdd(XMLoadFloat4((const XMFLOAT4*)&bone._31), w, sum.r[2]);
+				sum.r[3] = XMVectorMultiplyAdd(XMLoadFloat4((const XMFLOAT4*)&bone._41), w, sum.r[3]);
+				weighted = true;
+			}
+			if (weighted)
+			{
+				skin = sum;
+			}
+		}
+
+		XMFLOAT3 transformedP, transformedN;
+		XMStoreFloat3(&transformedP, XMVector3Transform(pos, skin));
+		XMStoreFloat3(&transformedN, XMVector3Normalize(XMVector3TransformNormal(nor, skin)));
+
+		out.posX[i] = transformedP.x;
+		out.posY[i] = transformedP.y;
+		out.posZ[i] = transformedP.z;
+		out.norX[i] = transformedN.x;
+		out.norY[i] = transformedN.y;
+		out.norZ[i] = transformedN.z;
+	}
+}
+// Gather the bones into a flat array, instead of following the bone pointers for every vertex. It stays empty if the mesh is not skinned.
+static void GatherSkinningBones(const Mesh& mesh, const XMMATRIX& mat, vector<XMFLOAT4X4>& bones)
+{
+	bones.clear();
+	if (mesh.hasArmature() && !mesh.armature->boneCollection.empty() && mesh.vertices_BON.size() == mesh.vertices_POS.size())
+	{
+		bones.resize(mesh.armature->boneCollection.size());
+		for (size_t i = 0; i < bones.size(); ++i)
+		{
+			XMStoreFloat4x4(&bones[i], XMMatrixMultiply(XMLoadFloat4x4(&mesh.armature->boneCollection[i]->boneRelativity), mat));
+		}
+	}
+}
+void Mesh::SkinVertices(uint32_t first, uint32_t count, SkinnedVertices& out, const XMMATRIX& mat) const
+{
+	assert(first + count <= vertices_POS.size());
+	if (count == 0)
+	{
+		return;
+	}
+
+	if (out.size() < first + count)
+	{
+		out.resize(first + count);
+	}
+
+	vector<XMFLOAT4X4> bones;
+	GatherSkinningBones(*this, mat, bones);
+	const XMFLOAT4X4* boneArray = bones.data();
+	const uint32_t boneCount = (uint32_t)bones.size();
+
+	static const uint32_t blockSize = 1024;
+	const uint32_t blockCount = (count + blockSize - 1) / blockSize;
+	if (blockCount == 1)
+	{
+		SkinVertexRange(*this, boneArray, boneCount, mat, first, first + count, out);
+		return;
+	}
+
+	wiJobSystem::context ctx;
+	wiJobSystem::Dispatch(ctx, blockCount, 1, [&](wiJobSystem::JobDispatchArgs args) {
+		const uint32_t blockFirst = first + args.jobIndex * blockSize;
+		const uint32_t blockLast = min(blockFirst + blockSize, first + count);
+		SkinVertexRange(*this, boneArray, boneCount, mat, blockFirst, blockLast, out);
+	});
+	wiJobSystem::Wait(ctx);
+}
+const Mesh::SkinnedVertices& Mesh::GetSkinnedVertices()
+{
+	lock_guard<mutex> lock(cacheLock);
+	return UpdateSkinnedVertices();
+}
+const Mesh::SkinnedVertices& Mesh::UpdateSkinnedVertices()
+{
+	const uint64_t version = armature != nullptr ? armature->skinningVersion : 0;
+	if (skinnedArmature != armature || skinnedVersion != version || skinnedVertices.size() != vertices_POS.size())
+	{
+		// It is skinned on this thread, not with SkinVertices(): waiting for jobs while cacheLock is held could execute an other query of this mesh on the same thread, which would lock it again
+		vector<XMFLOAT4X4> bones;
+		GatherSkinningBones(*this, XMMatrixIdentity(), bones);
+		skinnedVertices.resize(vertices_POS.size());
+		SkinVertexRange(*this, bones.data(), (uint32_t)bones.size(), XMMatrixIdentity(), 0, (uint32_t)vertices_POS.size(), skinnedVertices);
+		skinnedArmature = armature;
+		skinnedVersion = version;
+	}
+	return skinnedVertices;
+}
+
+const wiTriangleBVH& Mesh::GetBVH(bool armatureDeformed)
+{
+	enum BVH_SOURCE
+	{
+		BVH_SOURCE_VERTICES,
+		BVH_SOURCE_SKINNED,
+		BVH_SOURCE_SOFTBODY,
+	};
+
+	lock_guard<mutex> lock(cacheLock);
+
+	if (vertices_POS.empty() || indices.size() < 3)
+	{
+		return bvh;
+	}
+
+	const float* positions;
+	uint32_t stride;
+	int source;
+	uint64_t version;
+	if (armatureDeformed && armature != nullptr && !armature->boneCollection.empty())
+	{
+		const SkinnedVertices& skinned = UpdateSkinnedVertices();
+		source = BVH_SOURCE_SKINNED;
+		version = skinnedVersion;
+		if (bvhSource != source || bvhVersion != version || bvh.IsEmpty())
+		{
+			bvhPositions.resize(skinned.size());
+			for (size_t i = 0; i < skinned.size(); ++i)
+			{
+				bvhPositions[i] = XMFLOAT3(skinned.posX[i], skinned.posY[i], skinned.posZ[i]);
+			}
+		}
+		positions = &bvhPositions[0].x;
+		stride = sizeof(XMFLOAT3);
+	}
+	else if (hasDynamicVB() && vertices_Transformed_POS.size() == vertices_POS.size())
+	{
+		source = BVH_SOURCE_SOFTBODY;
+		version = softBodyVersion;
+		positions = &vertices_Transformed_POS[0].pos.x;
+		stride = sizeof(Vertex_POS);
+	}
+	else
+	{
+		source = BVH_SOURCE_VERTICES;
+		version = 0;
+		positions = &vertices_POS[0].pos.x;
+		stride = sizeof(Vertex_POS);
+	}
+
+	if (bvh.IsEmpty())
+	{
+		bvh.Build(positions, stride, (uint32_t)vertices_POS.size(), indices.data(), (uint32_t)indices.size());
+	}
+	else if (bvhSource != source || bvhVersion != version)
+	{
+		bvh.Refit(positions, stride, indices.data());
+	}
+	bvhSource = source;
+	bvhVersion = version;
+
+	return bvh;
+}
+
 int Mesh::GetRenderTypes() const
 {
 	int retVal = RENDERTYPE::RENDERTYPE_VOID;
@@ -1147,67 +1790,78 @@ void Mesh::Serialize(wiArchive& archive)
 		archive >> name;
 		archive >> parent;
 
-		// vertices
+		if (archive.GetVersion() >= 22)
+		{
+			archive.ReadArray(vertices_FULL);
+			archive.ReadArray(indices);
+			archive.ReadArray(physicsverts);
+			archive.ReadArray(physicsindices);
+			archive.ReadArray(physicalmapGP);
+		}
+		else
 		{
-			size_t vertexCount;
-			archive >> vertexCount;
-			vertices_FULL.resize(vertexCount);
-			for (size_t i = 0; i < vertexCount; ++i)
+			// vertices
 			{
-				archive >> vertices_FULL[i].pos;
-				archive >> vertices_FULL[i].nor;
-				archive >> vertices_FULL[i].tex;
-				archive >> vertices_FULL[i].ind;
-				archive >> vertices_FULL[i].wei;
-
-				if (archive.GetVersion() < 8)
+				size_t vertexCount;
+				archive >> vertexCount;
+				vertices_FULL.resize(vertexCount);
+				for (size_t i = 0; i < vertexCount; ++i)
 				{
-					vertices_FULL[i].pos.w = vertices_FULL[i].tex.w;
+					archive >> vertices_FULL[i].pos;
+					archive >> vertices_FULL[i].nor;
+					archive >> vertices_FULL[i].tex;
+					archive >> vertices_FULL[i].ind;
+					archive >> vertices_FULL[i].wei;
+
+					if (archive.GetVersion() < 8)
+					{
+						vertices_FULL[i].pos.w = vertices_FULL[i].tex.w;
+					}
 				}
 			}
-		}
-		// indices
-		{
-			size_t indexCount;
-			archive >> indexCount;
-			unsigned int tempInd;
-			for (size_t i = 0; i < indexCount; ++i)
+			// indices
 			{
-				archive >> tempInd;
-				indices.push_back(tempInd);
+				size_t indexCount;
+				archive >> indexCount;
+				unsigned int tempInd;
+				for (size_t i = 0; i < indexCount; ++i)
+				{
+					archive >> tempInd;
+					indices.push_back(tempInd);
+				}
 			}
-		}
-		// physicsVerts
-		{
-			size_t physicsVertCount;
-			archive >> physicsVertCount;
-			XMFLOAT3 tempPhysicsVert;
-			for (size_t i = 0; i < physicsVertCount; ++i)
+			// physicsVerts
 			{
-				archive >> tempPhysicsVert;
-				physicsverts.push_back(tempPhysicsVert);
+				size_t physicsVertCount;
+				archive >> physicsVertCount;
+				XMFLOAT3 tempPhysicsVert;
+				for (size_t i = 0; i < physicsVertCount; ++i)
+				{
+					archive >> tempPhysicsVert;
+					physicsverts.push_back(tempPhysicsVert);
+				}
 			}
-		}
-		// physicsindices
-		{
-			size_t physicsIndexCount;
-			archive >> physicsIndexCount;
-			unsigned int tempInd;
-			for (size_t i = 0; i < physicsIndexCount; ++i)
+			// physicsindices
 			{
-				archive >> tempInd;
-				physicsindices.push_back(tempInd);
+				size_t physicsIndexCount;
+				archive >> physicsIndexCount;
+				unsigned int tempInd;
+				for (size_t i = 0; i < physicsIndexCount; ++i)
+				{
+					archive >> tempInd;
+					physicsindices.push_back(tempInd);
+				}
 			}
-		}
-		// physicalmapGP
-		{
-			size_t physicalmapGPCount;
-			archive >> physicalmapGPCount;
-			int tempInd;
-			for (size_t i = 0; i < physicalmapGPCount; ++i)
+			// physicalmapGP
 			{
-				archive >> tempInd;
-				physicalmapGP.push_back(tempInd);
+				size_t physicalmapGPCount;
+				archive >> physicalmapGPCount;
+				int tempInd;
+				for (size_t i = 0; i < physicalmapGPCount; ++i)
+				{
+					archive >> tempInd;
+					physicalmapGP.push_back(tempInd);
+				}
 			}
 		}
 		// subsets
@@ -1264,8 +1918,27 @@ void Mesh::Serialize(wiArchive& archive)
 		{
 			archive >> impostorDistance;
 			archive >> tessellationFactor;
-			bool tmp;
-			archive >> tmp/*optimized*/;
+			archive >> optimized;
+			if (archive.GetVersion() < 24)
+			{
+				// the flag was always set before, but the meshes were never optimized:
+				optimized = false;
+			}
+		}
+
+		if (archive.GetVersion() >= 23)
+		{
+			archive.ReadArray(meshlets);
+		}
+
+		if (archive.GetVersion() >= 25)
+		{
+			archive.ReadArray(collisionBVH);
+		}
+
+		if (archive.GetVersion() >= 26)
+		{
+			archive >> occluder;
 		}
 	}
 	else
@@ -1273,48 +1946,59 @@ void Mesh::Serialize(wiArchive& archive)
 		archive << name;
 		archive << parent;
 
-		// vertices
+		if (archive.GetVersion() >= 22)
 		{
-			archive << vertices_FULL.size();
-			for (size_t i = 0; i < vertices_FULL.size(); ++i)
-			{
-				archive << vertices_FULL[i].pos;
-				archive << vertices_FULL[i].nor;
-				archive << vertices_FULL[i].tex;
-				archive << vertices_FULL[i].ind;
-				archive << vertices_FULL[i].wei;
-			}
+			archive.WriteArray(vertices_FULL);
+			archive.WriteArray(indices);
+			archive.WriteArray(physicsverts);
+			archive.WriteArray(physicsindices);
+			archive.WriteArray(physicalmapGP);
 		}
-		// indices
+		else
 		{
-			archive << indices.size();
-			for (auto& x : indices)
+			// vertices
 			{
-				archive << x;
+				archive << vertices_FULL.size();
+				for (size_t i = 0; i < vertices_FULL.size(); ++i)
+				{
+					archive << vertices_FULL[i].pos;
+					archive << vertices_FULL[i].nor;
+					archive << vertices_FULL[i].tex;
+					archive << vertices_FULL[i].ind;
+					archive << vertices_FULL[i].wei;
+				}
 			}
-		}
-		// physicsverts
-		{
-			archive << physicsverts.size();
-			for (auto& x : physicsverts)
+			// indices
 			{
-				archive << x;
+				archive << indices.size();
+				for (auto& x : indices)
+				{
+					archive << x;
+				}
 			}
-		}
-		// physicsindices
-		{
-			archive << physicsindices.size();
-			for (auto& x : physicsindices)
+			// physicsverts
 			{
-				archive << x;
+				archive << physicsverts.size();
+				for (auto& x : physicsverts)
+				{
+					archive << x;
+				}
 			}
-		}
-		// physicalmapGP
-		{
-			archive << physicalmapGP.size();
-			for (auto& x : physicalmapGP)
+			// physicsindices
 			{
-				archive << x;
+				archive << physicsindices.size();
+				for (auto& x : physicsindices)
+				{
+					archive << x;
+				}
+			}
+			// physicalmapGP
+			{
+				archive << physicalmapGP.size();
+				for (auto& x : physicalmapGP)
+				{
+					archive << x;
+				}
 			}
 		}
 		// subsets
@@ -1358,8 +2042,22 @@ void Mesh::Serialize(wiArchive& archive)
 		{
 			archive << impostorDistance;
 			archive << tessellationFactor;
-			bool tmp = true;
-			archive << tmp/*optimized*/;
+			archive << optimized;
+		}
+
+		if (archive.GetVersion() >= 23)
+		{
+			archive.WriteArray(meshlets);
+		}
+
+		if (archive.GetVersion() >= 25)
+		{
+			archive.WriteArray(collisionBVH);
+		}
+
+		if (archive.GetVersion() >= 26)
+		{
+			archive << occluder;
 		}
 	}
 }
@@ -1505,6 +2203,22 @@ void Model::FinishLoading()
 
 
 	// Set up Render data
+	//	The CPU side of every mesh is prepared in parallel, then the GPU buffers are created in one batch on this thread:
+	std::unordered_set<Mesh*> meshSet;
+	for (Object* x : objects)
+	{
+		if (x->mesh != nullptr && !x->mesh->renderDataComplete && !x->mesh->renderDataPrepared)
+		{
+			meshSet.insert(x->mesh);
+		}
+	}
+	std::vector<Mesh*> meshArray(meshSet.begin(), meshSet.end());
+	wiJobSystem::context ctx;
+	wiJobSystem::Dispatch(ctx, (uint32_t)meshArray.size(), 1, [&](wiJobSystem::JobDispatchArgs args) {
+		meshArray[args.jobIndex]->PrepareRenderData();
+	});
+	wiJobSystem::Wait(ctx);
+
 	for (Object* x : objects)
 	{
 		if (x->mesh != nullptr)
@@ -1532,18 +2246,27 @@ void Model::UpdateModel()
 	{
 		x.second->Update();
 	}
-	for (Armature* x : armatures)
-	{
-		x->UpdateArmature();
-	}
-	for (Object* x : objects)
-	{
-		x->UpdateObject();
-	}
-	for (Light*x : lights)
-	{
-		x->UpdateLight();
-	}
+
+	// Armatures, objects and lights are independent of each other inside the model, so they are updated in parallel:
+	wiJobSystem::context ctx;
+
+	std::vector<Armature*> armatureArray(armatures.begin(), armatures.end());
+	wiJobSystem::Dispatch(ctx, (uint32_t)armatureArray.size(), 1, [&](wiJobSystem::JobDispatchArgs args) {
+		armatureArray[args.jobIndex]->UpdateArmature();
+	});
+
+	std::vector<Object*> objectArray(objects.begin(), objects.end());
+	wiJobSystem::Dispatch(ctx, (uint32_t)objectArray.size(), 64, [&](wiJobSystem::JobDispatchArgs args) {
+		objectArray[args.jobIndex]->UpdateObject();
+	});
+
+	std::vector<Light*> lightArray(lights.begin(), lights.end());
+	wiJobSystem::Dispatch(ctx, (uint32_t)lightArray.size(), 16, [&](wiJobSystem::JobDispatchArgs args) {
+		lightArray[args.jobIndex]->UpdateLight();
+	});
+
+	wiJobSystem::Wait(ctx);
+
 	for (EnvironmentProbe* probe : environmentProbes)
 	{
 		probe->UpdateEnvProbe();
@@ -1665,7 +2388,16 @@ void Model::Serialize(wiArchive& archive)
 		for (size_t i = 0; i < meshCount; ++i)
 		{
 			Mesh* x = new Mesh;
-			x->Serialize(archive);
+			if (archive.GetVersion() >= 22)
+			{
+				archive.BeginSection();
+				x->Serialize(archive);
+				archive.EndSection();
+			}
+			else
+			{
+				x->Serialize(archive);
+			}
 			meshes.insert(pair<string, Mesh*>(x->name, x));
 		}
 
@@ -1810,7 +2542,18 @@ void Model::Serialize(wiArchive& archive)
 		archive << meshes.size();
 		for (auto& x : meshes)
 		{
-			x.second->Serialize(archive);
+			if (archive.GetVersion() >= 22)
+			{
+				// every mesh is a section that LoadMesh() can find by name
+				//	it is not compressed, because decompressing is slower than reading the mapped data
+				archive.BeginSection(GetMeshSectionName(x.second->name));
+				x.second->Serialize(archive);
+				archive.EndSection();
+			}
+			else
+			{
+				x.second->Serialize(archive);
+			}
 		}
 
 		archive << materials.size();
@@ -1865,19 +2608,30 @@ void Model::Serialize(wiArchive& archive)
 		}
 	}
 }
+std::string Model::GetMeshSectionName(const std::string& meshName)
+{
+	return "mesh/" + meshName;
+}
+Mesh* Model::LoadMesh(wiArchive& archive, const std::string& meshName)
+{
+	if (!archive.IsOpen() || !archive.IsReadMode() || !archive.SeekSection(GetMeshSectionName(meshName)))
+	{
+		return nullptr;
+	}
+	Mesh* x = new Mesh;
+	archive.BeginSection();
+	x->Serialize(archive);
+	archive.EndSection();
+	return x;
+}
 #pragma endregion
 
 #pragma region BONE
-void Bone::UpdateTransform()
+void Bone::UpdateTransformNode()
 {
-	//Transform::UpdateTransform();
+	//Transform::UpdateTransformNode();
 
-	// Needs to be updated differently than regular Transforms
-
-	for (Transform* child : children)
-	{
-		child->UpdateTransform();
-	}
+	// Needs to be updated differently than regular Transforms, the Armature updates its bones
 }
 void Bone::Serialize(wiArchive& archive)
 {
@@ -1907,6 +2661,14 @@ void Bone::Serialize(wiArchive& archive)
 		for (size_t i = 0; i < actionFramesCount; ++i)
 		{
 			ActionFrames aframes = ActionFrames();
+			if (archive.GetVersion() >= 22)
+			{
+				archive.ReadArray(aframes.keyframesRot);
+				archive.ReadArray(aframes.keyframesPos);
+				archive.ReadArray(aframes.keyframesSca);
+				actionFrames.push_back(aframes);
+				continue;
+			}
 			KeyFrame tempKeyFrame;
 			size_t tempCount;
 			archive >> tempCount;
@@ -1961,6 +2723,13 @@ void Bone::Serialize(wiArchive& archive)
 		int i = 0;
 		for (auto& x : actionFrames)
 		{
+			if (archive.GetVersion() >= 22)
+			{
+				archive.WriteArray(x.keyframesRot);
+				archive.WriteArray(x.keyframesPos);
+				archive.WriteArray(x.keyframesSca);
+				continue;
+			}
 			archive << x.keyframesRot.size();
 			for (auto& y : x.keyframesRot)
 			{
@@ -2103,18 +2872,41 @@ Armature::~Armature()
 	}
 	animationLayers.clear();
 }
-void Armature::UpdateTransform()
+void Armature::UpdateTransformNode()
 {
-	Transform::UpdateTransform();
+	Transform::UpdateTransformNode();
+
+	if (channelActionCount != actions.size() || channelBoneCount != boneCollection.size())
+	{
+		CreateAnimationChannels();
+	}
+	const size_t cursorCount = boneCollection.size() * KEYFRAMETYPE_COUNT * 2;
+	for (auto& x : animationLayers)
+	{
+		if (x->keyframeCursors.size() != cursorCount)
+		{
+			x->keyframeCursors.assign(cursorCount, 0);
+		}
+	}
 
+	// Update tree for skinning:
+	//	Note that skinning is not using the armature transform, it will be calculated in armature local space
+	//	This is needed because we want to skin meshes, then reuse the meshes for multiple objects without additional deform
+	//	The bones are ordered so that the parent matrix is always updated before its children:
 	XMMATRIX remapMat = XMLoadFloat4x4(&skinningRemap);
-	for (Bone* root : rootbones)
+	for (size_t i = 0; i < boneOrder.size(); ++i)
 	{
-		// Update tree for skinning:
-		//	Note that skinning is not using the armature transform, it will be calculated in armature local space
-		//	This is needed because we want to skin meshes, then reuse the meshes for multiple objects without additional deform
-		RecursiveBoneTransform(this, root, remapMat);
+		const int parent = boneOrderParents[i];
+		if (parent < 0)
+		{
+			UpdateBoneTransform(boneOrder[i], remapMat);
+		}
+		else
+		{
+			UpdateBoneTransform(boneOrder[i], XMLoadFloat4x4(&boneCollection[boneOrder[parent]]->world));
+		}
 	}
+	skinningVersion++;
 
 	XMMATRIX worldMatrix = getMatrix();
 	for (Bone* bone : boneCollection)
@@ -2138,9 +2930,16 @@ void Armature::UpdateTransform()
 		XMStoreFloat4(&bone->rotation, v[1]);
 		XMStoreFloat3(&bone->translation, v[2]);
 		XMStoreFloat4x4(&bone->world, boneMatrix);
+	}
+}
+void Armature::GatherHierarchy(std::vector<Transform*>& result)
+{
+	Transform::GatherHierarchy(result);
 
-		// Any attachments should be updated too:
-		bone->UpdateTransform();
+	// The bones are not attached to the armature, but they are updated by it, so any bone attachments are updated after it:
+	for (Bone* root : rootbones)
+	{
+		root->GatherHierarchy(result);
 	}
 }
 void Armature::UpdateArmature()
@@ -2200,26 +2999,27 @@ void Armature::UpdateArmature()
 			anim.blendFact = 1;
 	}
 }
-void Armature::RecursiveBoneTransform(Armature* armature, Bone* bone, const XMMATRIX& parentBoneMat)
+void Armature::UpdateBoneTransform(uint32_t boneIndex, const XMMATRIX& parentBoneMat)
 {
+	Bone* bone = boneCollection[boneIndex];
+
 	// TRANSITION BLENDING + ADDITIVE BLENDING
 	XMVECTOR finalTrans = XMVectorSet(0, 0, 0, 0);
 	XMVECTOR finalRotat = XMQuaternionIdentity();
 	XMVECTOR finalScala = XMVectorSet(1, 1, 1, 0);
 
-	for (auto& x : armature->animationLayers)
+	for (auto& x : animationLayers)
 	{
 		AnimationLayer& anim = *x;
+		uint32_t* cursors = &anim.keyframeCursors[boneIndex * KEYFRAMETYPE_COUNT * 2];
 
-		int frameCountPrev = armature->actions[anim.prevAction].frameCount;
-		XMVECTOR prevTrans = InterpolateKeyFrames(anim.currentFramePrevAction, frameCountPrev, bone->actionFrames[anim.prevAction].keyframesPos, POSITIONKEYFRAMETYPE);
-		XMVECTOR prevRotat = InterpolateKeyFrames(anim.currentFramePrevAction, frameCountPrev, bone->actionFrames[anim.prevAction].keyframesRot, ROTATIONKEYFRAMETYPE);
-		XMVECTOR prevScala = InterpolateKeyFrames(anim.currentFramePrevAction, frameCountPrev, bone->actionFrames[anim.prevAction].keyframesSca, SCALARKEYFRAMETYPE);
+		XMVECTOR prevTrans = SampleChannel(channels[GetChannelIndex(anim.prevAction, boneIndex, POSITIONKEYFRAMETYPE)], anim.currentFramePrevAction, POSITIONKEYFRAMETYPE, cursors[0]);
+		XMVECTOR prevRotat = SampleChannel(channels[GetChannelIndex(anim.prevAction, boneIndex, ROTATIONKEYFRAMETYPE)], anim.currentFramePrevAction, ROTATIONKEYFRAMETYPE, cursors[1]);
+		XMVECTOR prevScala = SampleChannel(channels[GetChannelIndex(anim.prevAction, boneIndex, SCALARKEYFRAMETYPE)], anim.currentFramePrevAction, SCALARKEYFRAMETYPE, cursors[2]);
 
-		int frameCount = armature->actions[anim.activeAction].frameCount;
-		XMVECTOR currTrans = InterpolateKeyFrames(anim.currentFrame, frameCount, bone->actionFrames[anim.activeAction].keyframesPos, POSITIONKEYFRAMETYPE);
-		XMVECTOR currRotat = InterpolateKeyFrames(anim.currentFrame, frameCount, bone->actionFrames[anim.activeAction].keyframesRot, ROTATIONKEYFRAMETYPE);
-		XMVECTOR currScala = InterpolateKeyFrames(anim.currentFrame, frameCount, bone->actionFrames[anim.activeAction].keyframesSca, SCALARKEYFRAMETYPE);
+		XMVECTOR currTrans = SampleChannel(channels[GetChannelIndex(anim.activeAction, boneIndex, POSITIONKEYFRAMETYPE)], anim.currentFrame, POSITIONKEYFRAMETYPE, cursors[3]);
+		XMVECTOR currRotat = SampleChannel(channels[GetChannelIndex(anim.activeAction, boneIndex, ROTATIONKEYFRAMETYPE)], anim.currentFrame, ROTATIONKEYFRAMETYPE, cursors[4]);
+		XMVECTOR currScala = SampleChannel(channels[GetChannelIndex(anim.activeAction, boneIndex, SCALARKEYFRAMETYPE)], anim.currentFrame, SCALARKEYFRAMETYPE, cursors[5]);
 
 		currTrans = XMVectorLerp(prevTrans, currTrans, anim.blendFact);
 		currRotat = XMQuaternionSlerp(prevRotat, currRotat, anim.blendFact);
@@ -2263,101 +3063,76 @@ void Armature::RecursiveBoneTransform(Armature* armature, Bone* bone, const XMMA
 
 	XMStoreFloat4x4(&bone->world, boneMat); // usable in scene graph
 	XMStoreFloat4x4(&bone->boneRelativity, skinningMat); // usable in skinning
-
-	for (unsigned int i = 0; i<bone->childrenI.size(); ++i) {
-		RecursiveBoneTransform(armature, bone->childrenI[i], boneMat);
-	}
 }
-XMVECTOR Armature::InterpolateKeyFrames(float cf, const int maxCf, const std::vector<KeyFrame>& keyframeList, KeyFrameType type)
+XMVECTOR Armature::SampleChannel(const AnimationChannel& channel, float cf, KeyFrameType type, uint32_t& cursor)
 {
-	XMVECTOR result = XMVectorSet(0, 0, 0, 0);
-
-	switch (type)
+	const size_t count = channel.frames.size();
+	if (count == 0)
 	{
-	case Armature::ROTATIONKEYFRAMETYPE:
-		result = XMVectorSet(0, 0, 0, 1);
-		break;
-	case Armature::POSITIONKEYFRAMETYPE:
-		result = XMVectorSet(0, 0, 0, 1);
-		break;
-	case Armature::SCALARKEYFRAMETYPE:
-		result = XMVectorSet(1, 1, 1, 1);
-		break;
-	default:
-		assert(0);
-		break;
+		switch (type)
+		{
+		case Armature::ROTATIONKEYFRAMETYPE:
+		case Armature::POSITIONKEYFRAMETYPE:
+			return XMVectorSet(0, 0, 0, 1);
+		case Armature::SCALARKEYFRAMETYPE:
+			return XMVectorSet(1, 1, 1, 1);
+		default:
+			assert(0);
+			return XMVectorSet(0, 0, 0, 0);
+		}
+	}
+	if (count == 1)
+	{
+		return XMLoadFloat4(&channel.values[0]);
 	}
 
-	//SEARCH 2 INTERPOLATABLE FRAMES
-	int nearest[2] = { 0,0 };
-	int first = 0, last = 0;
-	if (keyframeList.size()>1) {
-		first = keyframeList[0].frameI;
-		last = keyframeList.back().frameI;
-
-		if (cf <= first) { //BROKEN INTERVAL
-			nearest[0] = 0;
-			nearest[1] = 0;
+	// Before the first or after the last keyframe, the end value is held:
+	size_t k;
+	float interframe = 0;
+	if (cf <= channel.frames.front())
+	{
+		k = 0;
+	}
+	else if (cf >= channel.frames.back())
+	{
+		k = count - 1;
+	}
+	else
+	{
+		// Find the keyframe k so that frames[k] <= cf < frames[k+1]
+		//	The animation usually advances less than a keyframe between updates, so the interval of the previous update or the next one is tried first:
+		k = cursor;
+		if (k + 1 < count && channel.frames[k] <= cf && cf < channel.frames[k + 1])
+		{
+			// same interval
 		}
-		else if (cf >= last) {
-			nearest[0] = (int)(keyframeList.size() - 1);
-			nearest[1] = (int)(keyframeList.size() - 1);
+		else if (k + 2 < count && channel.frames[k + 1] <= cf && cf < channel.frames[k + 2])
+		{
+			k = k + 1;
 		}
-		else { //IN BETWEEN TWO KEYFRAMES, DECIDE WHICH
-			for (int k = (int)keyframeList.size() - 1; k>0; k--)
-				if (keyframeList[k].frameI <= cf) {
-					nearest[0] = k;
-					break;
-				}
-			for (int k = 0; k<(int)keyframeList.size(); k++)
-				if (keyframeList[k].frameI >= cf) {
-					nearest[1] = k;
-					break;
-				}
+		else
+		{
+			auto it = upper_bound(channel.frames.begin(), channel.frames.end(), cf, [](float a, int b) { return a < (float)b; });
+			k = (size_t)(it - channel.frames.begin()) - 1;
 		}
+		cursor = (uint32_t)k;
 
-		//INTERPOLATE BETWEEN THE TWO FRAMES
-		int keyframes[2] = {
-			keyframeList[nearest[0]].frameI,
-			keyframeList[nearest[1]].frameI
-		};
-		float interframe = 0;
-		if (cf <= first || cf >= last) { //BROKEN INTERVAL
-			float intervalBegin = (float)(maxCf - keyframes[0]);
-			float intervalEnd = keyframes[1] + intervalBegin;
-			float intervalLen = abs(intervalEnd - intervalBegin);
-			float offsetCf = cf + intervalBegin;
-			if (intervalLen) interframe = offsetCf / intervalLen;
-		}
-		else {
-			float intervalBegin = (float)keyframes[0];
-			float intervalEnd = (float)keyframes[1];
-			float intervalLen = abs(intervalEnd - intervalBegin);
-			float offsetCf = cf - intervalBegin;
-			if (intervalLen) interframe = offsetCf / intervalLen;
-		}
+		float intervalBegin = (float)channel.frames[k];
+		float intervalEnd = (float)channel.frames[k + 1];
+		interframe = (cf - intervalBegin) / (intervalEnd - intervalBegin);
+	}
 
-		if (type == ROTATIONKEYFRAMETYPE) {
-			XMVECTOR quat[2] = {
-				XMLoadFloat4(&keyframeList[nearest[0]].data),
-				XMLoadFloat4(&keyframeList[nearest[1]].data)
-			};
-			result = XMQuaternionNormalize(XMQuaternionSlerp(quat[0], quat[1], interframe));
-		}
-		else {
-			XMVECTOR tran[2] = {
-				XMLoadFloat4(&keyframeList[nearest[0]].data),
-				XMLoadFloat4(&keyframeList[nearest[1]].data)
-			};
-			result = XMVectorLerp(tran[0], tran[1], interframe);
-		}
+	XMVECTOR a = XMLoadFloat4(&channel.values[k]);
+	if (interframe <= 0)
+	{
+		return type == ROTATIONKEYFRAMETYPE ? XMQuaternionNormalize(a) : a;
 	}
-	else {
-		if (!keyframeList.empty())
-			result = XMLoadFloat4(&keyframeList.back().data);
+	XMVECTOR b = XMLoadFloat4(&channel.values[k + 1]);
+	if (type == ROTATIONKEYFRAMETYPE)
+	{
+		return XMQuaternionNormalize(XMQuaternionSlerp(a, b, interframe));
 	}
-
-	return result;
+	return XMVectorLerp(a, b, interframe);
 }
 
 
@@ -2455,12 +3230,77 @@ void Armature::CreateFamily()
 			rootbones.push_back(i);
 		}
 	}
+	InvalidateHierarchy();
 
 	XMMATRIX remapMat = XMLoadFloat4x4(&skinningRemap);
 	for (Bone* root : rootbones)
 	{
 		RecursiveRest(root, remapMat);
 	}
+
+	CreateAnimationChannels();
+}
+void Armature::CreateAnimationChannels()
+{
+	channelActionCount = actions.size();
+	channelBoneCount = boneCollection.size();
+
+	unordered_map<const Bone*, uint32_t> boneIndices;
+	for (size_t i = 0; i < boneCollection.size(); ++i)
+	{
+		boneIndices[boneCollection[i]] = (uint32_t)i;
+	}
+
+	// Flatten the hierarchy breadth first, so every parent is placed before its children:
+	boneOrder.clear();
+	boneOrderParents.clear();
+	for (Bone* root : rootbones)
+	{
+		boneOrder.push_back(boneIndices[root]);
+		boneOrderParents.push_back(-1);
+	}
+	for (size_t i = 0; i < boneOrder.size(); ++i)
+	{
+		for (Bone* child : boneCollection[boneOrder[i]]->childrenI)
+		{
+			boneOrder.push_back(boneIndices[child]);
+			boneOrderParents.push_back((int)i);
+		}
+	}
+
+	channels.clear();
+	channels.resize(channelActionCount * channelBoneCount * KEYFRAMETYPE_COUNT);
+	for (size_t action = 0; action < channelActionCount; ++action)
+	{
+		for (uint32_t boneIndex = 0; boneIndex < (uint32_t)channelBoneCount; ++boneIndex)
+		{
+			const Bone* bone = boneCollection[boneIndex];
+			if (action >= bone->actionFrames.size())
+			{
+				continue;
+			}
+			const ActionFrames& frames = bone->actionFrames[action];
+			const vector<KeyFrame>* keyframeLists[KEYFRAMETYPE_COUNT];
+			keyframeLists[ROTATIONKEYFRAMETYPE] = &frames.keyframesRot;
+			keyframeLists[POSITIONKEYFRAMETYPE] = &frames.keyframesPos;
+			keyframeLists[SCALARKEYFRAMETYPE] = &frames.keyframesSca;
+
+			for (int type = 0; type < KEYFRAMETYPE_COUNT; ++type)
+			{
+				vector<KeyFrame> keyframes = *keyframeLists[type];
+				stable_sort(keyframes.begin(), keyframes.end(), [](const KeyFrame& a, const KeyFrame& b) { return a.frameI < b.frameI; });
+
+				AnimationChannel& channel = channels[GetChannelIndex((int)action, boneIndex, (KeyFrameType)type)];
+				channel.frames.reserve(keyframes.size());
+				channel.values.reserve(keyframes.size());
+				for (const KeyFrame& keyframe : keyframes)
+				{
+					channel.frames.push_back(keyframe.frameI);
+					channel.values.push_back(keyframe.data);
+				}
+			}
+		}
+	}
 }
 void Armature::CreateBuffers()
 {
@@ -2595,9 +3435,9 @@ void Decal::addNormal(const std::string& nor){
 		normal = (Texture2D*)wiResourceManager::GetGlobal()->add(nor);
 	}
 }
-void Decal::UpdateTransform()
+void Decal::UpdateTransformNode()
 {
-	Transform::UpdateTransform();
+	Transform::UpdateTransformNode();
 
 	XMMATRIX rotMat = XMMatrixRotationQuaternion(XMLoadFloat4(&rotation));
 	XMVECTOR eye = XMLoadFloat3(&translation);
@@ -2663,9 +3503,9 @@ void Decal::Serialize(wiArchive& archive)
 #pragma endregion
 
 #pragma region CAMERA
-void Camera::UpdateTransform()
+void Camera::UpdateTransformNode()
 {
-	Transform::UpdateTransform();
+	Transform::UpdateTransformNode();
 
 	UpdateProps();
 }
@@ -2837,9 +3677,9 @@ void Object::FadeTrail() {
 		trail.pop_front();
 	}
 }
-void Object::UpdateTransform()
+void Object::UpdateTransformNode()
 {
-	Transform::UpdateTransform();
+	Transform::UpdateTransformNode();
 
 }
 void Object::UpdateObject()
@@ -2874,13 +3714,23 @@ void Object::UpdateObject()
 
 	if (!trail.empty())
 	{
-		wiRenderer::objectsWithTrails.insert(this);
 		FadeTrail();
 	}
 
-	for (wiEmittedParticle* x : eParticleSystems)
+	// Objects are updated from multiple threads, so registering into the renderer's global lists must be serialized:
+	if (!trail.empty() || !eParticleSystems.empty())
 	{
-		wiRenderer::emitterSystems.insert(x);
+		static wiSpinLock locker;
+		locker.lock();
+		if (!trail.empty())
+		{
+			wiRenderer::objectsWithTrails.insert(this);
+		}
+		for (wiEmittedParticle* x : eParticleSystems)
+		{
+			wiRenderer::emitterSystems.insert(x);
+		}
+		locker.unlock();
 	}
 }
 bool Object::IsCastingShadow() const
@@ -3088,9 +3938,9 @@ float Light::GetRange() const
 	}
 	return 0;
 }
-void Light::UpdateTransform()
+void Light::UpdateTransformNode()
 {
-	Transform::UpdateTransform();
+	Transform::UpdateTransformNode();
 }
 
 void Light::UpdateLight()
@@ -8,11 +8,17 @@
 #include "wiFrustum.h"
 #include "wiTransform.h"
 #include "wiIntersectables.h"
+#include "wiHashString.h"
+#include "wiMeshlet.h"
+#include "wiMeshOptimizer.h"
+#include "wiTriangleBVH.h"
 #include "ShaderInterop.h"
 
 #include <vector>
 #include <map>
 #include <unordered_set>
+#include <unordered_map>
+#include <mutex>
 #include <list>
 #include <deque>
 #include <sstream>
@@ -303,6 +309,10 @@ struct MeshSubset
 
 	std::vector<uint32_t> subsetIndices;
 
+	// Range of the mesh meshlets that belong to the subset
+	uint32_t meshletOffset;
+	uint32_t meshletCount;
+
 	MeshSubset();
 	~MeshSubset();
 };
@@ -455,6 +465,18 @@ public:
 		}
 	};
 
+	// Vertices skinned on the CPU, in structure of arrays layout
+	struct SkinnedVertices
+	{
+		std::vector<float> posX, posY, posZ;
+		std::vector<float> norX, norY, norZ;
+
+		void resize(size_t count);
+		size_t size() const { return posX.size(); }
+		inline XMVECTOR LoadPOS(size_t i) const { return XMVectorSet(posX[i], posY[i], posZ[i], 1); }
+		inline XMVECTOR LoadNOR(size_t i) const { return XMVectorSet(norX[i], norY[i], norZ[i], 0); }
+	};
+
 	std::string name;
 	std::string parent;
 	std::vector<Vertex_FULL>	vertices_FULL;
@@ -469,6 +491,8 @@ public:
 	std::vector<int>			physicalmapGP;
 	std::vector<MeshSubset>		subsets;
 	std::vector<std::string>	materialNames;
+	std::vector<wiMeshlet::Meshlet> meshlets; // sorted by subset, the triangles of a meshlet are a range of its subset indices
+	std::vector<uint8_t>		collisionBVH; // the physics engine's hierarchy of the triangle mesh collider, it is saved with the mesh so that loading doesn't rebuild it
 
 	wiGraphicsTypes::GPUBuffer*	indexBuffer;
 	wiGraphicsTypes::GPUBuffer*	vertexBuffer_POS;
@@ -484,6 +508,7 @@ public:
 	wiGraphicsTypes::INDEXBUFFER_FORMAT indexFormat;
 
 	bool renderable,doubleSided;
+	bool occluder; // rasterized into the software occlusion buffer to cull the objects behind it (see wiSoftwareOcclusion)
 
 	bool calculatedAO;
 
@@ -512,15 +537,57 @@ public:
 	float tessellationFactor;
 
 	bool renderDataComplete;
+	bool renderDataPrepared;
+	bool optimized; // triangles and vertices are reordered for the GPU (see Optimize())
+
+	// Cache of GetSkinnedVertices(), valid while the armature pose version matches:
+	SkinnedVertices skinnedVertices;
+	const Armature* skinnedArmature;
+	uint64_t skinnedVersion;
+
+	// Incremented whenever the physics writes the soft body vertices (vertices_Transformed_POS)
+	uint64_t softBodyVersion;
+
+	// Triangle hierarchy for ray queries, see GetBVH(). It is refitted when the vertex positions that it was built from change:
+	wiTriangleBVH bvh;
+	std::vector<XMFLOAT3> bvhPositions; // skinned positions gathered for the hierarchy
+	int bvhSource;
+	uint64_t bvhVersion;
+
+	// Guards the lazily updated caches above, so that the scene can be queried from multiple threads:
+	std::mutex cacheLock;
 
 	Mesh(const std::string& newName = "");
 	~Mesh();
+	// CPU side of CreateRenderData(): vertex streams, subset indices and the physics mapping. It doesn't use the graphics device,
+	//	so it can run on any thread, meshes can be prepared in parallel. CreateRenderData() only creates the GPU buffers of a prepared mesh.
+	void PrepareRenderData();
 	void CreateRenderData();
+	// Split the triangles of every subset into meshlets and reorder the indices to match. It is done on load for large static meshes (see Optimize())
+	void BuildMeshlets();
+	// Reorder the triangles of every subset for the post-transform vertex cache and less overdraw (within the meshlets if there are any, building them first for large static meshes),
+	//	then reorder the vertices for fetch locality. It is done once in PrepareRenderData(), the optional stats receive the vertex cache efficiency before and after.
+	void Optimize(wiMeshOptimizer::CacheStats* statsBefore = nullptr, wiMeshOptimizer::CacheStats* statsAfter = nullptr);
 	static void CreateImpostorVB();
-	void ComputeNormals(bool smooth = false);
+	enum NORMAL_WEIGHTING
+	{
+		NORMAL_WEIGHTING_UNIFORM,	// every face contributes equally to the smooth normal
+		NORMAL_WEIGHTING_AREA,		// faces contribute by their surface area
+		NORMAL_WEIGHTING_ANGLE,		// faces contribute by their corner angle at the vertex
+	};
+	void ComputeNormals(bool smooth = false, NORMAL_WEIGHTING weighting = NORMAL_WEIGHTING_UNIFORM);
 	void FlipCulling();
 	void FlipNormals();
 	Vertex_FULL TransformVertex(int vertexI, const XMMATRIX& mat = XMMatrixIdentity());
+	// Skin the vertices [first, first + count) like the skinning shader does (linear blend), then transform them by mat.
+	//	The results are written to the same indices of out, which is grown if needed. Large ranges are split among the job system threads.
+	void SkinVertices(uint32_t first, uint32_t count, SkinnedVertices& out, const XMMATRIX& mat = XMMatrixIdentity()) const;
+	// All vertices skinned in armature space (or the rest pose without armature). The result is cached until the armature pose changes,
+	//	so it is computed at most once per frame however many times it is queried. Thread safe, while the scene is not being updated.
+	const SkinnedVertices& GetSkinnedVertices();
+	// Triangle hierarchy of the rendered vertex positions: skinned in armature space if armatureDeformed, the soft body simulation, or the mesh vertices.
+	//	It is built on the first query, deformed meshes are refitted when their vertices change. Thread safe, while the scene is not being updated.
+	const wiTriangleBVH& GetBVH(bool armatureDeformed);
 	void init();
 	
 	bool hasArmature() const { return armature != nullptr; }
@@ -530,6 +597,10 @@ public:
 	int GetRenderTypes() const;
 	wiGraphicsTypes::INDEXBUFFER_FORMAT GetIndexFormat() const { return indexFormat; }
 	void Serialize(wiArchive& archive);
+
+private:
+	// GetSkinnedVertices() without locking, cacheLock must be held. It doesn't use the job system, because waiting for jobs under the lock can deadlock
+	const SkinnedVertices& UpdateSkinnedVertices();
 };
 struct Cullable
 {
@@ -594,7 +665,7 @@ struct Object : public Cullable, public Transform, public ModelChild
 	bool IsReflector() const;
 	int GetRenderTypes() const;
 	bool IsOccluded() const;
-	virtual void UpdateTransform();
+	virtual void UpdateTransformNode() override;
 	void UpdateObject();
 	XMMATRIX GetOBB() const;
 	void Serialize(wiArchive& archive);
@@ -661,7 +732,7 @@ struct Bone : public Transform
 		connected = false;
 	}
 
-	virtual void UpdateTransform() override;
+	virtual void UpdateTransformNode() override;
 	void Serialize(wiArchive& archive);
 };
 struct AnimationLayer
@@ -692,6 +763,9 @@ struct AnimationLayer
 
 	bool looped;
 
+	// Keyframe search hints for the current and the previous action, for every channel of every bone. Not serialized.
+	std::vector<uint32_t> keyframeCursors;
+
 	AnimationLayer();
 
 	void ChangeAction(int actionIndex, float blendFrames = 0.0f, float weight = 1.0f);
@@ -730,6 +804,9 @@ public:
 	std::vector<ShaderBoneType> boneData;
 	wiGraphicsTypes::GPUBuffer boneBuffer;
 
+	// Incremented every time the skinning matrices (Bone::boneRelativity) are recomputed, CPU skinning results are cached by this
+	uint64_t skinningVersion = 0;
+
 	// This will be used to eg. mirror the whole skin, without modifying the armature transform itself
 	//	It will affect the skin only, so the mesh vertices should be mirrored as well to work correctly!
 	XMFLOAT4X4 skinningRemap;
@@ -766,23 +843,45 @@ public:
 	AnimationLayer* GetAnimLayer(const std::string& name);
 	void AddAnimLayer(const std::string& name);
 	void DeleteAnimLayer(const std::string& name);
-	virtual void UpdateTransform() override;
+	virtual void UpdateTransformNode() override;
+	virtual void GatherHierarchy(std::vector<Transform*>& result) override;
 	void UpdateArmature();
 	void CreateFamily();
+	// Rebuild the sampled animation from the bone keyframes and the bone hierarchy. This happens automatically when bones or actions are added,
+	//	but it must be called after modifying existing keyframes.
+	void CreateAnimationChannels();
 	void CreateBuffers();
 	Bone* GetBone(const std::string& name);
 	void Serialize(wiArchive& archive);
 
 private:
-	static void RecursiveRest(Bone* bone, XMMATRIX recursiveRest);
-	static void RecursiveBoneTransform(Armature* armature, Bone* bone, const XMMATRIX& parentBoneMat);
-
 	enum KeyFrameType {
 		ROTATIONKEYFRAMETYPE,
 		POSITIONKEYFRAMETYPE,
 		SCALARKEYFRAMETYPE,
+		KEYFRAMETYPE_COUNT,
 	};
-	static XMVECTOR InterpolateKeyFrames(float currentFrame, const int frameCount, const std::vector<KeyFrame>& keyframes, KeyFrameType type);
+
+	// Keyframes of one bone, action and type, sorted by frame.
+	//	The frame numbers are stored apart from the values, so the keyframe search only touches the frames.
+	struct AnimationChannel
+	{
+		std::vector<int> frames;
+		std::vector<XMFLOAT4> values;
+	};
+	std::vector<AnimationChannel> channels;	// for every action, bone and keyframe type
+	size_t channelActionCount = 0;
+	size_t channelBoneCount = 0;
+
+	// The bone hierarchy flattened, so that it can be evaluated in a single loop:
+	std::vector<uint32_t> boneOrder;		// boneCollection indices, parents come before their children
+	std::vector<int> boneOrderParents;		// position of the parent in boneOrder, -1 for root bones
+
+	size_t GetChannelIndex(int action, uint32_t bone, KeyFrameType type) const { return ((size_t)action * channelBoneCount + bone) * KEYFRAMETYPE_COUNT + type; }
+	void UpdateBoneTransform(uint32_t boneIndex, const XMMATRIX& parentBoneMat);
+
+	static void RecursiveRest(Bone* bone, XMMATRIX recursiveRest);
+	static XMVECTOR SampleChannel(const AnimationChannel& channel, float currentFrame, KeyFrameType type, uint32_t& cursor);
 };
 struct SHCAM{	
 	XMFLOAT4X4 View,Projection;
@@ -909,7 +1008,7 @@ struct Light : public Cullable , public Transform, public ModelChild
 
 	Light();
 	virtual ~Light();
-	virtual void UpdateTransform();
+	virtual void UpdateTransformNode() override;
 	void UpdateLight();
 	void SetType(LightType type);
 	LightType GetType() const { return type; }
@@ -935,7 +1034,7 @@ struct Decal : public Cullable, public Transform, public ModelChild
 	
 	void addTexture(const std::string& tex);
 	void addNormal(const std::string& nor);
-	virtual void UpdateTransform();
+	virtual void UpdateTransformNode() override;
 	void UpdateDecal();
 	float GetOpacity() const;
 	void Serialize(wiArchive& archive);
@@ -1155,7 +1254,7 @@ struct Camera : public Transform, public ModelChild
 	{
 		return XMLoadFloat4x4(&realProjection);
 	}
-	virtual void UpdateTransform();
+	virtual void UpdateTransformNode() override;
 
 	void Serialize(wiArchive& archive);
 };
@@ -1214,6 +1313,12 @@ struct Model : public Transform
 	// merge
 	void Add(Model* value);
 	void Serialize(wiArchive& archive);
+
+	// Name of the archive section that contains a serialized mesh of the model
+	static std::string GetMeshSectionName(const std::string& meshName);
+	// Load a single mesh from a model archive through the table of contents, without loading the rest of the model. Returns nullptr if it is not found
+	//	The materials and the armature are not resolved, they are only referenced by materialNames and armatureName
+	static Mesh* LoadMesh(wiArchive& archive, const std::string& meshName);
 };
 
 struct Scene
@@ -1229,6 +1334,35 @@ struct Scene
 	Model* GetWorldNode();
 	void AddModel(Model* model);
 	void Update();
+
+	// Find scene contents by name or ID. If there are more with the same name, the first one is returned, like with a linear search.
+	//	The lookup tables are rebuilt when the transform hierarchy changed, or after InvalidateLookups()
+	Transform* FindTransform(const std::string& name);
+	Transform* FindTransform(uint64_t id);
+	Object* FindObject(const std::string& name);
+	Armature* FindArmature(const std::string& name);
+	Material* FindMaterial(const std::string& name);
+	Camera* FindCamera(const std::string& name);
+	Light* FindLight(const std::string& name);
+	// Call after renaming something in the scene, or adding to a model without attaching it
+	void InvalidateLookups() { lookupVersion = ~0ull; }
+
+private:
+	std::unordered_map<wiHashString, Transform*> transformLookup;
+	std::unordered_map<uint64_t, Transform*> transformIDLookup;
+	std::unordered_map<wiHashString, Object*> objectLookup;
+	std::unordered_map<wiHashString, Armature*> armatureLookup;
+	std::unordered_map<wiHashString, Material*> materialLookup;
+	std::unordered_map<wiHashString, Camera*> cameraLookup;
+	std::unordered_map<wiHashString, Light*> lightLookup;
+	uint64_t lookupVersion = ~0ull;
+	void UpdateLookups();
+
+	// The transform hierarchy under the world node, parents before their children. Rebuilt when the hierarchy changes:
+	std::vector<Transform*> transformOrder;
+	// Start of each group of root subtrees in transformOrder, the groups can be updated in parallel:
+	std::vector<uint32_t> transformGroups;
+	uint64_t transformHierarchyVersion = ~0ull;
 };
 
 }
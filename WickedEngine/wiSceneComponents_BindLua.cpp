@@ -3,6 +3,7 @@
 #include "Matrix_BindLua.h"
 #include "wiEmittedParticle.h"
 #include "Texture_BindLua.h"
+#include "wiRenderer.h"
 
 using namespace std;
 
@@ -71,6 +72,7 @@ int Node_BindLua::SetName(lua_State* L)
 	if (argc > 0)
 	{
 		node->name = wiLua::SGetString(L, 1);
+		wiRenderer::GetScene().InvalidateLookups();
 	}
 	else
 	{
@@ -1703,6 +1705,7 @@ int Material_BindLua::SetName(lua_State* L)
 	if (argc > 0)
 	{
 		material->name = wiLua::SGetString(L, 1);
+		wiRenderer::GetScene().InvalidateLookups();
 	}
 	else
 		wiLua::SError(L, "SetName(string name) not enough arguments!");
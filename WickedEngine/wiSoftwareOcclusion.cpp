@@ -0,0 +1,289 @@
+#include "wiSoftwareOcclusion.h"
+
+#include <algorithm>
+
+using namespace std;
+
+// Triangles with a smaller screen area (in pixels) are skipped
+#define SOFTWARE_OCCLUSION_MIN_AREA 1e-6f
+// Upper bound of pending texels in IsVisible(): every level adds at most 3 to the stack and the first level adds 4
+#define SOFTWARE_OCCLUSION_STACK_SIZE 64
+
+
+namespace
+{
+	inline XMFLOAT3 ToScreen(const XMFLOAT4& clip)
+	{
+		const float invW = 1.0f / clip.w;
+		return XMFLOAT3(
+			(clip.x * invW * 0.5f + 0.5f) * wiSoftwareOcclusion::WIDTH,
+			(0.5f - clip.y * invW * 0.5f) * wiSoftwareOcclusion::HEIGHT,
+			invW
+		);
+	}
+	inline XMFLOAT4 LerpClip(const XMFLOAT4& a, const XMFLOAT4& b, float t)
+	{
+		return XMFLOAT4(a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t, a.w + (b.w - a.w) * t);
+	}
+}
+
+
+void wiSoftwareOcclusion::Clear(const XMMATRIX& viewProjection, float zNear)
+{
+	XMStoreFloat4x4(&this->viewProjection, viewProjection);
+	this->zNear = zNear;
+
+	depth.assign(WIDTH * HEIGHT, 0.0f);
+	levels.clear();
+	hierarchy.clear();
+}
+
+void wiSoftwareOcclusion::RasterizeTriangles(const float* positions, uint32_t stride, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, const XMMATRIX& world)
+{
+	const XMMATRIX M = world * XMLoadFloat4x4(&viewProjection);
+
+	clipPositions.resize(vertexCount);
+	for (uint32_t i = 0; i < vertexCount; ++i)
+	{
+		const float* p = (const float*)((const uint8_t*)positions + (size_t)i * stride);
+		XMStoreFloat4(&clipPositions[i], XMVector3Transform(XMVectorSet(p[0], p[1], p[2], 1), M));
+	}
+
+	for (uint32_t i = 0; i + 2 < indexCount; i += 3)
+	{
+		const XMFLOAT4* v[] = { &clipPositions[indices[i]], &clipPositions[indices[i + 1]], &clipPositions[indices[i + 2]] };
+
+		if (v[0]->w >= zNear && v[1]->w >= zNear && v[2]->w >= zNear)
+		{
+			DrawTriangle(ToScreen(*v[0]), ToScreen(*v[1]), ToScreen(*v[2]));
+			continue;
+		}
+
+		// Clip against the near plane, one triangle becomes a polygon with up to 4 vertices:
+		XMFLOAT4 polygon[4];
+		int count = 0;
+		for (int j = 0; j < 3; ++j)
+		{
+			const XMFLOAT4& a = *v[j];
+			const XMFLOAT4& b = *v[(j + 1) % 3];
+			if (a.w >= zNear)
+			{
+				polygon[count++] = a;
+			}
+			if ((a.w >= zNear) != (b.w >= zNear))
+			{
+				polygon[count++] = LerpClip(a, b, (zNear - a.w) / (b.w - a.w));
+			}
+		}
+		for (int j = 2; j < count; ++j)
+		{
+			DrawTriangle(ToScreen(polygon[0]), ToScreen(polygon[j - 1]), ToScreen(polygon[j]));
+		}
+	}
+}
+
+void wiSoftwareOcclusion::DrawTriangle(XMFLOAT3 a, XMFLOAT3 b, XMFLOAT3 c)
+{
+	float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+	if (!(fabsf(area) > SOFTWARE_OCCLUSION_MIN_AREA))
+	{
+		return; // degenerate (or NaN)
+	}
+	if (area < 0)
+	{
+		// draw both windings the same way:
+		swap(b, c);
+		area = -area;
+	}
+
+	// Pixel bounds, clamped before the integer conversion because clipped vertices can be far outside of the screen:
+	const float minXf = max(0.0f, min(min(a.x, b.x), c.x));
+	const float minYf = max(0.0f, min(min(a.y, b.y), c.y));
+	const float maxXf = min((float)(WIDTH - 1), max(max(a.x, b.x), c.x));
+	const float maxYf = min((float)(HEIGHT - 1), max(max(a.y, b.y), c.y));
+	if (minXf > maxXf || minYf > maxYf)
+	{
+		return;
+	}
+	const int minX = (int)minXf & ~3; // rows are processed in aligned groups of 4 pixels
+	const int minY = (int)minYf;
+	const int maxX = (int)maxXf;
+	const int maxY = (int)maxYf;
+
+	// Edge functions E(x, y) = A * x + B * y + C, all of them are positive inside the triangle.
+	//	Each of them is proportional to the barycentric weight of the vertex opposite of the edge, which gives the depth plane.
+	const float A0 = b.y - c.y, B0 = c.x - b.x, C0 = b.x * c.y - b.y * c.x; // b -> c, weight of a
+	const float A1 = c.y - a.y, B1 = a.x - c.x, C1 = c.x * a.y - c.y * a.x; // c -> a, weight of b
+	const float A2 = a.y - b.y, B2 = b.x - a.x, C2 = a.x * b.y - a.y * b.x; // a -> b, weight of c
+
+	const float invArea = 1.0f / area;
+	const float zA = (A0 * a.z + A1 * b.z + A2 * c.z) * invArea;
+	const float zB = (B0 * a.z + B1 * b.z + B2 * c.z) * invArea;
+	const float zC = (C0 * a.z + C1 * b.z + C2 * c.z) * invArea;
+	// The interpolated depth is clamped to the nearest vertex, so that rounding can't make the occluder any closer:
+	const XMVECTOR zNearest = XMVectorReplicate(max(max(a.z, b.z), c.z));
+
+	const XMVECTOR laneX = XMVectorAdd(XMVectorReplicate((float)minX), XMVectorSet(0.5f, 1.5f, 2.5f, 3.5f)); // pixel centers
+	const XMVECTOR stepE0 = XMVectorReplicate(A0 * 4);
+	const XMVECTOR stepE1 = XMVectorReplicate(A1 * 4);
+	const XMVECTOR stepE2 = XMVectorReplicate(A2 * 4);
+	const XMVECTOR stepZ = XMVectorReplicate(zA * 4);
+	const XMVECTOR zero = XMVectorZero();
+
+	for (int y = minY; y <= maxY; ++y)
+	{
+		const float py = (float)y + 0.5f;
+		XMVECTOR e0 = XMVectorMultiplyAdd(XMVectorReplicate(A0), laneX, XMVectorReplicate(B0 * py + C0));
+		XMVECTOR e1 = XMVectorMultiplyAdd(XMVectorReplicate(A1), laneX, XMVectorReplicate(B1 * py + C1));
+		XMVECTOR e2 = XMVectorMultiplyAdd(XMVectorReplicate(A2), laneX, XMVectorReplicate(B2 * py + C2));
+		XMVECTOR z = XMVectorMultiplyAdd(XMVectorReplicate(zA), laneX, XMVectorReplicate(zB * py + zC));
+
+		float* row = &depth[y * WIDTH];
+		for (int x = minX; x <= maxX; x += 4)
+		{
+			const XMVECTOR inside = XMVectorAndInt(XMVectorAndInt(XMVectorGreaterOrEqual(e0, zero), XMVectorGreaterOrEqual(e1, zero)), XMVectorGreaterOrEqual(e2, zero));
+			const XMVECTOR current = XMLoadFloat4((const XMFLOAT4*)(row + x));
+			const XMVECTOR nearest = XMVectorMax(current, XMVectorMin(z, zNearest));
+			XMStoreFloat4((XMFLOAT4*)(row + x), XMVectorSelect(current, nearest, inside));
+
+			e0 = XMVectorAdd(e0, stepE0);
+			e1 = XMVectorAdd(e1, stepE1);
+			e2 = XMVectorAdd(e2, stepE2);
+			z = XMVectorAdd(z, stepZ);
+		}
+	}
+}
+
+void wiSoftwareOcclusion::BuildHierarchy()
+{
+	levels.clear();
+	hierarchy.clear();
+
+	Level level;
+	level.offset = 0;
+	level.width = WIDTH;
+	level.height = HEIGHT;
+	levels.push_back(level);
+
+	hierarchy.resize(WIDTH * HEIGHT);
+	for (uint32_t i = 0; i < WIDTH * HEIGHT; ++i)
+	{
+		hierarchy[i].farthest = depth[i];
+		hierarchy[i].nearest = depth[i];
+	}
+
+	while (level.width > 1 || level.height > 1)
+	{
+		const Level child = level;
+		level.offset = (uint32_t)hierarchy.size();
+		level.width = (child.width + 1) / 2;
+		level.height = (child.height + 1) / 2;
+		levels.push_back(level);
+		hierarchy.resize(hierarchy.size() + level.width * level.height);
+
+		for (uint32_t y = 0; y < level.height; ++y)
+		{
+			for (uint32_t x = 0; x < level.width; ++x)
+			{
+				Texel texel = { FLT_MAX, 0 };
+				for (uint32_t cy = y * 2; cy < min(y * 2 + 2, child.height); ++cy)
+				{
+					for (uint32_t cx = x * 2; cx < min(x * 2 + 2, child.width); ++cx)
+					{
+						const Texel& c = hierarchy[child.offset + cy * child.width + cx];
+						texel.farthest = min(texel.farthest, c.farthest);
+						texel.nearest = max(texel.nearest, c.nearest);
+					}
+				}
+				hierarchy[level.offset + y * level.width + x] = texel;
+			}
+		}
+	}
+}
+
+bool wiSoftwareOcclusion::IsVisible(const AABB& aabb) const
+{
+	if (levels.empty())
+	{
+		return true;
+	}
+
+	// Screen rectangle and nearest depth of the box:
+	const XMMATRIX M = XMLoadFloat4x4(&viewProjection);
+	float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+	float nearest = 0;
+	for (int i = 0; i < 8; ++i)
+	{
+		XMFLOAT4 clip;
+		XMStoreFloat4(&clip, XMVector3Transform(XMLoadFloat3(&aabb.corners[i]), M));
+		if (!(clip.w >= zNear))
+		{
+			return true;
+		}
+		const XMFLOAT3 p = ToScreen(clip);
+		minX = min(minX, p.x);
+		minY = min(minY, p.y);
+		maxX = max(maxX, p.x);
+		maxY = max(maxY, p.y);
+		nearest = max(nearest, p.z);
+	}
+	if (maxX < 0 || maxY < 0 || minX >= WIDTH || minY >= HEIGHT)
+	{
+		return true; // outside of the buffer, that is up to frustum culling
+	}
+	const uint32_t x0 = (uint32_t)max(0.0f, minX);
+	const uint32_t y0 = (uint32_t)max(0.0f, minY);
+	const uint32_t x1 = (uint32_t)min((float)(WIDTH - 1), maxX);
+	const uint32_t y1 = (uint32_t)min((float)(HEIGHT - 1), maxY);
+
+	// Start from the level where the rectangle covers at most 2x2 texels, then refine only where it is undecided.
+	//	A region is occluded if its farthest depth is in front of the box, and the box is visible if the nearest depth of a region is behind it.
+	uint32_t start = 0;
+	while (start + 1 < levels.size() && ((x1 >> start) - (x0 >> start) > 1 || (y1 >> start) - (y0 >> start) > 1))
+	{
+		start++;
+	}
+
+	struct Entry
+	{
+		uint32_t level, x, y;
+	};
+	Entry stack[SOFTWARE_OCCLUSION_STACK_SIZE];
+	int stackSize = 0;
+	for (uint32_t y = y0 >> start; y <= (y1 >> start); ++y)
+	{
+		for (uint32_t x = x0 >> start; x <= (x1 >> start); ++x)
+		{
+			stack[stackSize++] = { start, x, y };
+		}
+	}
+
+	while (stackSize > 0)
+	{
+		const Entry entry = stack[--stackSize];
+		const Texel& texel = GetTexel(entry.level, entry.x, entry.y);
+		if (texel.farthest > nearest)
+		{
+			continue;
+		}
+		if (texel.nearest <= nearest || entry.level == 0)
+		{
+			return true;
+		}
+
+		const uint32_t level = entry.level - 1;
+		const uint32_t cx0 = max(entry.x * 2, x0 >> level);
+		const uint32_t cy0 = max(entry.y * 2, y0 >> level);
+		const uint32_t cx1 = min(entry.x * 2 + 1, x1 >> level);
+		const uint32_t cy1 = min(entry.y * 2 + 1, y1 >> level);
+		for (uint32_t y = cy0; y <= cy1; ++y)
+		{
+			for (uint32_t x = cx0; x <= cx1; ++x)
+			{
+				stack[stackSize++] = { level, x, y };
+			}
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "CommonInclude.h"
+#include "wiIntersectables.h"
+
+#include <vector>
+
+// Occlusion culling on the CPU: occluder triangles are rasterized into a small depth buffer, then bounding boxes are tested against a min/max hierarchy of it
+//	The depth is stored as 1 / w (the inverse view distance, 0 is infinitely far). It interpolates linearly in screen space and doesn't depend on the depth range of the projection.
+//	The results are available right after the occluders are drawn, so culled objects never reach the GPU and there is no latency like with occlusion queries.
+class wiSoftwareOcclusion
+{
+public:
+	// Resolution of the depth buffer, the width must be a multiple of 4 because 4 pixels are rasterized at once with SIMD
+	static const uint32_t WIDTH = 256;
+	static const uint32_t HEIGHT = 128;
+
+	// Depth range of a region of the depth buffer, the farthest is the minimum and the nearest is the maximum of 1 / w
+	struct Texel
+	{
+		float farthest;
+		float nearest;
+	};
+
+	// Start a new frame, everything is cleared to infinitely far
+	//	zNear				: geometry closer to the camera is clipped, boxes that reach closer are always visible
+	void Clear(const XMMATRIX& viewProjection, float zNear);
+	// Draw an occluder mesh into the depth buffer, both windings are drawn
+	//	positions			: first vertex position, the vertices are stride bytes apart
+	void RasterizeTriangles(const float* positions, uint32_t stride, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, const XMMATRIX& world);
+	// Build the hierarchy from the depth buffer, after all the occluders are drawn
+	void BuildHierarchy();
+
+	// Returns false if the box is completely behind the occluders. Boxes that are outside of the screen or reach behind the near plane are visible.
+	//	It is safe to call from multiple threads at the same time, after BuildHierarchy().
+	bool IsVisible(const AABB& aabb) const;
+
+	float GetDepth(uint32_t x, uint32_t y) const { return depth[y * WIDTH + x]; }
+	uint32_t GetLevelCount() const { return (uint32_t)levels.size(); }
+	uint32_t GetLevelWidth(uint32_t level) const { return levels[level].width; }
+	uint32_t GetLevelHeight(uint32_t level) const { return levels[level].height; }
+	const Texel& GetTexel(uint32_t level, uint32_t x, uint32_t y) const { return hierarchy[levels[level].offset + y * levels[level].width + x]; }
+
+private:
+	XMFLOAT4X4 viewProjection;
+	float zNear = 0;
+
+	std::vector<float> depth;				// full resolution depth buffer that the occluders are drawn into
+	std::vector<XMFLOAT4> clipPositions;	// vertices of the current occluder in clip space
+
+	struct Level
+	{
+		uint32_t offset;	// first texel in the hierarchy array
+		uint32_t width;
+		uint32_t height;
+	};
+	std::vector<Level> levels;		// the first level is the full resolution, every next one is half of the previous (rounded up)
+	std::vector<Texel> hierarchy;
+
+	// Draw a triangle that is already in screen space: x, y in pixels, z is the depth
+	void DrawTriangle(XMFLOAT3 a, XMFLOAT3 b, XMFLOAT3 c);
+};
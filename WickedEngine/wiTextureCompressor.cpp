@@ -0,0 +1,1044 @@
+#include "wiTextureCompressor.h"
+#include "wiJobSystem.h"
+
+#include <fstream>
+#include <cfloat>
+
+using namespace std;
+using namespace wiGraphicsTypes;
+
+namespace wiTextureCompressor
+{
+	// sRGB <-> linear conversion tables
+	struct GammaTables
+	{
+		static const uint32_t LINEAR_RESOLUTION = 16384;
+
+		float toLinear[256];
+		uint8_t toSRGB[LINEAR_RESOLUTION];
+
+		GammaTables()
+		{
+			for (uint32_t i = 0; i < 256; ++i)
+			{
+				const float srgb = i / 255.0f;
+				toLinear[i] = srgb <= 0.04045f ? srgb / 12.92f : powf((srgb + 0.055f) / 1.055f, 2.4f);
+			}
+			for (uint32_t i = 0; i < LINEAR_RESOLUTION; ++i)
+			{
+				const float linear = i / float(LINEAR_RESOLUTION - 1);
+				const float srgb = linear <= 0.0031308f ? linear * 12.92f : 1.055f * powf(linear, 1.0f / 2.4f) - 0.055f;
+				toSRGB[i] = (uint8_t)(srgb * 255.0f + 0.5f);
+			}
+		}
+	};
+	static const GammaTables& GetGammaTables()
+	{
+		static GammaTables tables;
+		return tables;
+	}
+
+	static inline float saturate(float x)
+	{
+		return x < 0.0f ? 0.0f : (x > 1.0f ? 1.0f : x);
+	}
+	static inline uint8_t UnormToByte(float x)
+	{
+		return (uint8_t)(saturate(x) * 255.0f + 0.5f);
+	}
+
+
+	bool IsFormatSupported(FORMAT format)
+	{
+		switch (format)
+		{
+		case FORMAT_R8G8B8A8_UNORM:
+		case FORMAT_BC1_UNORM:
+		case FORMAT_BC3_UNORM:
+		case FORMAT_BC5_UNORM:
+		case FORMAT_BC7_UNORM:
+			return true;
+		default:
+			return false;
+		}
+	}
+	bool IsBlockCompressed(FORMAT format)
+	{
+		return format == FORMAT_BC1_UNORM || format == FORMAT_BC3_UNORM || format == FORMAT_BC5_UNORM || format == FORMAT_BC7_UNORM;
+	}
+	uint32_t GetFormatStride(FORMAT format)
+	{
+		switch (format)
+		{
+		case FORMAT_BC1_UNORM:
+			return 8;
+		case FORMAT_BC3_UNORM:
+		case FORMAT_BC5_UNORM:
+		case FORMAT_BC7_UNORM:
+			return 16;
+		default:
+			return 4;
+		}
+	}
+
+	bool HasTransparency(const uint8_t* rgba, uint32_t width, uint32_t height)
+	{
+		const size_t count = (size_t)width * height;
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (rgba[i * 4 + 3] != 255)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+
+	void GenerateMipChain(const uint8_t* rgba, uint32_t width, uint32_t height, MIP_FILTER filter, Image& image)
+	{
+		const GammaTables& gamma = GetGammaTables();
+
+		image.format = FORMAT_R8G8B8A8_UNORM;
+		image.width = width;
+		image.height = height;
+		image.mips.clear();
+
+		MipLevel base;
+		base.width = width;
+		base.height = height;
+		base.rowPitch = width * 4;
+		base.data.assign(rgba, rgba + (size_t)width * height * 4);
+		image.mips.push_back(std::move(base));
+
+		// The filtering is done on the decoded values, so that the rounding errors don't add up through the chain:
+		vector<XMFLOAT4> current((size_t)width * height);
+		for (size_t i = 0; i < current.size(); ++i)
+		{
+			const uint8_t* src = rgba + i * 4;
+			switch (filter)
+			{
+			case MIP_FILTER_COLOR:
+				current[i] = XMFLOAT4(gamma.toLinear[src[0]], gamma.toLinear[src[1]], gamma.toLinear[src[2]], src[3] / 255.0f);
+				break;
+			case MIP_FILTER_NORMALMAP:
+				current[i] = XMFLOAT4(src[0] / 255.0f * 2 - 1, src[1] / 255.0f * 2 - 1, src[2] / 255.0f * 2 - 1, src[3] / 255.0f);
+				break;
+			default:
+				current[i] = XMFLOAT4(src[0] / 255.0f, src[1] / 255.0f, src[2] / 255.0f, src[3] / 255.0f);
+				break;
+			}
+		}
+
+		vector<XMFLOAT4> next;
+		while (width > 1 || height > 1)
+		{
+			const uint32_t mipWidth = max(1u, width / 2);
+			const uint32_t mipHeight = max(1u, height / 2);
+			next.resize((size_t)mipWidth * mipHeight);
+
+			// Box filter. With odd dimensions some of the footprints are 3 pixels wide, so that every source pixel contributes:
+			for (uint32_t y = 0; y < mipHeight; ++y)
+			{
+				const uint32_t y0 = y * height / mipHeight;
+				const uint32_t y1 = max(y0 + 1, (y + 1) * height / mipHeight);
+				for (uint32_t x = 0; x < mipWidth; ++x)
+				{
+					const uint32_t x0 = x * width / mipWidth;
+					const uint32_t x1 = max(x0 + 1, (x + 1) * width / mipWidth);
+
+					XMFLOAT4 sum = XMFLOAT4(0, 0, 0, 0);
+					for (uint32_t sy = y0; sy < y1; ++sy)
+					{
+						for (uint32_t sx = x0; sx < x1; ++sx)
+						{
+							const XMFLOAT4& src = current[(size_t)sy * width + sx];
+							sum.x += src.x;
+							sum.y += src.y;
+							sum.z += src.z;
+							sum.w += src.w;
+						}
+					}
+					const float weight = 1.0f / ((y1 - y0) * (x1 - x0));
+					sum.x *= weight;
+					sum.y *= weight;
+					sum.z *= weight;
+					sum.w *= weight;
+
+					if (filter == MIP_FILTER_NORMALMAP)
+					{
+						const float length = sqrtf(sum.x * sum.x + sum.y * sum.y + sum.z * sum.z);
+						if (length > 0)
+						{
+							sum.x /= length;
+							sum.y /= length;
+							sum.z /= length;
+						}
+					}
+
+					next[(size_t)y * mipWidth + x] = sum;
+				}
+			}
+
+			MipLevel mip;
+			mip.width = mipWidth;
+			mip.height = mipHeight;
+			mip.rowPitch = mipWidth * 4;
+			mip.data.resize((size_t)mipWidth * mipHeight * 4);
+			for (size_t i = 0; i < next.size(); ++i)
+			{
+				const XMFLOAT4& src = next[i];
+				uint8_t* dst = &mip.data[i * 4];
+				switch (filter)
+				{
+				case MIP_FILTER_COLOR:
+					dst[0] = gamma.toSRGB[(uint32_t)(saturate(src.x) * (GammaTables::LINEAR_RESOLUTION - 1) + 0.5f)];
+					dst[1] = gamma.toSRGB[(uint32_t)(saturate(src.y) * (GammaTables::LINEAR_RESOLUTION - 1) + 0.5f)];
+					dst[2] = gamma.toSRGB[(uint32_t)(saturate(src.z) * (GammaTables::LINEAR_RESOLUTION - 1) + 0.5f)];
+					break;
+				case MIP_FILTER_NORMALMAP:
+					dst[0] = UnormToByte(src.x * 0.5f + 0.5f);
+					dst[1] = UnormToByte(src.y * 0.5f + 0.5f);
+					dst[2] = UnormToByte(src.z * 0.5f + 0.5f);
+					break;
+				default:
+					dst[0] = UnormToByte(src.x);
+					dst[1] = UnormToByte(src.y);
+					dst[2] = UnormToByte(src.z);
+					break;
+				}
+				dst[3] = UnormToByte(src.w);
+			}
+			image.mips.push_back(std::move(mip));
+
+			current.swap(next);
+			width = mipWidth;
+			height = mipHeight;
+		}
+	}
+
+
+	// 4x4 pixels, one array for each channel
+	struct BlockPixels
+	{
+		float channels[4][16];
+	};
+
+	// Read a block of pixels, the coordinates outside the image are clamped to the edge
+	static void LoadBlock(const MipLevel& mip, uint32_t blockX, uint32_t blockY, BlockPixels& block)
+	{
+		for (uint32_t y = 0; y < 4; ++y)
+		{
+			const uint32_t py = min(blockY * 4 + y, mip.height - 1);
+			for (uint32_t x = 0; x < 4; ++x)
+			{
+				const uint32_t px = min(blockX * 4 + x, mip.width - 1);
+				const uint8_t* src = &mip.data[(size_t)py * mip.rowPitch + px * 4];
+				for (uint32_t c = 0; c < 4; ++c)
+				{
+					block.channels[c][y * 4 + x] = src[c];
+				}
+			}
+		}
+	}
+
+	// Project the pixels onto the line from e0 to e1, and quantize their position to [0, levels - 1]
+	static void FitIndices(const BlockPixels& block, uint32_t firstChannel, uint32_t channelCount, const float* e0, const float* e1, uint32_t levels, uint8_t indices[16])
+	{
+		float dir[4];
+		float lengthSq = 0;
+		for (uint32_t c = 0; c < channelCount; ++c)
+		{
+			dir[c] = e1[c] - e0[c];
+			lengthSq += dir[c] * dir[c];
+		}
+		if (lengthSq < 1e-6f)
+		{
+			memset(indices, 0, 16);
+			return;
+		}
+		const float scale = (levels - 1) / lengthSq;
+
+#ifdef _XM_SSE_INTRINSICS_
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 maxLevel = _mm_set1_ps(float(levels - 1));
+		const __m128 half = _mm_set1_ps(0.5f);
+		for (uint32_t i = 0; i < 16; i += 4)
+		{
+			__m128 t = zero;
+			for (uint32_t c = 0; c < channelCount; ++c)
+			{
+				const __m128 p = _mm_sub_ps(_mm_loadu_ps(&block.channels[firstChannel + c][i]), _mm_set1_ps(e0[c]));
+				t = _mm_add_ps(t, _mm_mul_ps(p, _mm_set1_ps(dir[c] * scale)));
+			}
+			// Rounded by truncation, clamping to maxLevel + 0.5 can't round above maxLevel:
+			t = _mm_min_ps(_mm_max_ps(_mm_add_ps(t, half), zero), _mm_add_ps(maxLevel, half));
+			const __m128i level = _mm_cvttps_epi32(t);
+			indices[i + 0] = (uint8_t)_mm_cvtsi128_si32(level);
+			indices[i + 1] = (uint8_t)_mm_cvtsi128_si32(_mm_srli_si128(level, 4));
+			indices[i + 2] = (uint8_t)_mm_cvtsi128_si32(_mm_srli_si128(level, 8));
+			indices[i + 3] = (uint8_t)_mm_cvtsi128_si32(_mm_srli_si128(level, 12));
+		}
+#else
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			float t = 0;
+			for (uint32_t c = 0; c < channelCount; ++c)
+			{
+				t += (block.channels[firstChannel + c][i] - e0[c]) * (dir[c] * scale);
+			}
+			indices[i] = (uint8_t)min(levels - 1, (uint32_t)max(0.0f, t + 0.5f));
+		}
+#endif // _XM_SSE_INTRINSICS_
+	}
+
+	// Least squares fit of the endpoints to the pixels, with the interpolation weights of the given indices. Returns false if the system is singular.
+	static bool RefineEndpoints(const BlockPixels& block, uint32_t firstChannel, uint32_t channelCount, const uint8_t indices[16], uint32_t levels, float* e0, float* e1)
+	{
+		float aa = 0, ab = 0, bb = 0;
+		float ax[4] = {}, bx[4] = {};
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			const float b = indices[i] / float(levels - 1);
+			const float a = 1 - b;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for (uint32_t c = 0; c < channelCount; ++c)
+			{
+				ax[c] += a * block.channels[firstChannel + c][i];
+				bx[c] += b * block.channels[firstChannel + c][i];
+			}
+		}
+		const float det = aa * bb - ab * ab;
+		if (abs(det) < 1e-6f)
+		{
+			return false;
+		}
+		const float invDet = 1.0f / det;
+		for (uint32_t c = 0; c < channelCount; ++c)
+		{
+			e0[c] = min(255.0f, max(0.0f, (ax[c] * bb - bx[c] * ab) * invDet));
+			e1[c] = min(255.0f, max(0.0f, (bx[c] * aa - ax[c] * ab) * invDet));
+		}
+		return true;
+	}
+
+	// Principal axis of the pixel colors and the range of their projections on it
+	static void FindEndpoints(const BlockPixels& block, uint32_t channelCount, float* e0, float* e1)
+	{
+		float mean[4] = {};
+		float minimum[4] = { 255, 255, 255, 255 };
+		float maximum[4] = {};
+		for (uint32_t c = 0; c < channelCount; ++c)
+		{
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				mean[c] += block.channels[c][i];
+				minimum[c] = min(minimum[c], block.channels[c][i]);
+				maximum[c] = max(maximum[c], block.channels[c][i]);
+			}
+			mean[c] /= 16;
+		}
+
+		float covariance[4][4] = {};
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			for (uint32_t c0 = 0; c0 < channelCount; ++c0)
+			{
+				for (uint32_t c1 = c0; c1 < channelCount; ++c1)
+				{
+					covariance[c0][c1] += (block.channels[c0][i] - mean[c0]) * (block.channels[c1][i] - mean[c1]);
+				}
+			}
+		}
+		for (uint32_t c0 = 0; c0 < channelCount; ++c0)
+		{
+			for (uint32_t c1 = 0; c1 < c0; ++c1)
+			{
+				covariance[c0][c1] = covariance[c1][c0];
+			}
+		}
+
+		// Power iteration, starting from the bounding box diagonal:
+		float axis[4];
+		for (uint32_t c = 0; c < channelCount; ++c)
+		{
+			axis[c] = maximum[c] - minimum[c];
+		}
+		for (int iteration = 0; iteration < 8; ++iteration)
+		{
+			float next[4] = {};
+			float length = 0;
+			for (uint32_t c0 = 0; c0 < channelCount; ++c0)
+			{
+				for (uint32_t c1 = 0; c1 < channelCount; ++c1)
+				{
+					next[c0] += covariance[c0][c1] * axis[c1];
+				}
+				length = max(length, abs(next[c0]));
+			}
+			if (length < 1e-6f)
+			{
+				break;
+			}
+			for (uint32_t c = 0; c < channelCount; ++c)
+			{
+				axis[c] = next[c] / length;
+			}
+		}
+
+		float lengthSq = 0;
+		for (uint32_t c = 0; c < channelCount; ++c)
+		{
+			lengthSq += axis[c] * axis[c];
+		}
+		if (lengthSq < 1e-6f)
+		{
+			// Every pixel is the same
+			for (uint32_t c = 0; c < channelCount; ++c)
+			{
+				e0[c] = mean[c];
+				e1[c] = mean[c];
+			}
+			return;
+		}
+
+		float tmin = FLT_MAX, tmax = -FLT_MAX;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			float t = 0;
+			for (uint32_t c = 0; c < channelCount; ++c)
+			{
+				t += (block.channels[c][i] - mean[c]) * axis[c];
+			}
+			tmin = min(tmin, t);
+			tmax = max(tmax, t);
+		}
+		tmin /= lengthSq;
+		tmax /= lengthSq;
+		for (uint32_t c = 0; c < channelCount; ++c)
+		{
+			e0[c] = min(255.0f, max(0.0f, mean[c] + axis[c] * tmin));
+			e1[c] = min(255.0f, max(0.0f, mean[c] + axis[c] * tmax));
+		}
+	}
+
+
+	// BC1 color block, always in 4 color mode so that it is also valid as the color part of BC3
+	static inline uint16_t PackRGB565(const float* color)
+	{
+		const uint32_t r = (uint32_t)(saturate(color[0] / 255.0f) * 31 + 0.5f);
+		const uint32_t g = (uint32_t)(saturate(color[1] / 255.0f) * 63 + 0.5f);
+		const uint32_t b = (uint32_t)(saturate(color[2] / 255.0f) * 31 + 0.5f);
+		return (uint16_t)((r << 11) | (g << 5) | b);
+	}
+	static inline void UnpackRGB565(uint16_t packed, float* color)
+	{
+		const uint32_t r = (packed >> 11) & 31;
+		const uint32_t g = (packed >> 5) & 63;
+		const uint32_t b = packed & 31;
+		color[0] = float((r << 3) | (r >> 2));
+		color[1] = float((g << 2) | (g >> 4));
+		color[2] = float((b << 3) | (b >> 2));
+	}
+	struct BC1Candidate
+	{
+		uint16_t color0;
+		uint16_t color1;
+		uint8_t levels[16];
+		float error;
+	};
+	static void EvaluateBC1(const BlockPixels& block, const float* e0, const float* e1, BC1Candidate& candidate)
+	{
+		candidate.color0 = PackRGB565(e0);
+		candidate.color1 = PackRGB565(e1);
+
+		float palette[4][3];
+		UnpackRGB565(candidate.color0, palette[0]);
+		UnpackRGB565(candidate.color1, palette[3]);
+		for (uint32_t c = 0; c < 3; ++c)
+		{
+			palette[1][c] = (2 * palette[0][c] + palette[3][c]) / 3;
+			palette[2][c] = (palette[0][c] + 2 * palette[3][c]) / 3;
+		}
+
+		FitIndices(block, 0, 3, palette[0], palette[3], 4, candidate.levels);
+
+		candidate.error = 0;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			for (uint32_t c = 0; c < 3; ++c)
+			{
+				const float diff = block.channels[c][i] - palette[candidate.levels[i]][c];
+				candidate.error += diff * diff;
+			}
+		}
+	}
+	static void EncodeBC1(const BlockPixels& block, uint8_t* dest)
+	{
+		float e0[4], e1[4];
+		FindEndpoints(block, 3, e0, e1);
+
+		// Inset the bounding line a bit, the extreme pixels are rare:
+		for (uint32_t c = 0; c < 3; ++c)
+		{
+			const float inset = (e1[c] - e0[c]) / 16;
+			e0[c] += inset;
+			e1[c] -= inset;
+		}
+
+		BC1Candidate best;
+		EvaluateBC1(block, e0, e1, best);
+
+		BC1Candidate refined;
+		if (RefineEndpoints(block, 0, 3, best.levels, 4, e0, e1))
+		{
+			EvaluateBC1(block, e0, e1, refined);
+			if (refined.error < best.error)
+			{
+				best = refined;
+			}
+		}
+
+		// Palette index of the levels along the line from color0 to color1:
+		static const uint8_t levelToIndex[4] = { 0, 2, 3, 1 };
+		uint16_t color0 = best.color0;
+		uint16_t color1 = best.color1;
+		uint32_t bits = 0;
+		if (color0 == color1)
+		{
+			// Only a single color, every index selects color0
+		}
+		else
+		{
+			bool flip = false;
+			if (color0 < color1)
+			{
+				// 4 color mode requires color0 > color1
+				swap(color0, color1);
+				flip = true;
+			}
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				const uint32_t level = flip ? 3 - best.levels[i] : best.levels[i];
+				bits |= (uint32_t)levelToIndex[level] << (i * 2);
+			}
+		}
+
+		dest[0] = (uint8_t)(color0 & 0xFF);
+		dest[1] = (uint8_t)(color0 >> 8);
+		dest[2] = (uint8_t)(color1 & 0xFF);
+		dest[3] = (uint8_t)(color1 >> 8);
+		dest[4] = (uint8_t)(bits & 0xFF);
+		dest[5] = (uint8_t)((bits >> 8) & 0xFF);
+		dest[6] = (uint8_t)((bits >> 16) & 0xFF);
+		dest[7] = (uint8_t)(bits >> 24);
+	}
+
+	// BC4 single channel block, the alpha of BC3 and both channels of BC5 use it
+	static void EncodeBC4(const BlockPixels& block, uint32_t channel, uint8_t* dest)
+	{
+		float minimum = 255, maximum = 0;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			minimum = min(minimum, block.channels[channel][i]);
+			maximum = max(maximum, block.channels[channel][i]);
+		}
+		const uint8_t value0 = (uint8_t)maximum;
+		const uint8_t value1 = (uint8_t)minimum;
+
+		// 8 value mode (value0 > value1): index 0 is value0, 1 is value1, 2-7 are interpolated from value0 towards value1
+		uint64_t bits = 0;
+		if (value0 != value1)
+		{
+			const float e0 = value1;
+			const float e1 = value0;
+			uint8_t levels[16];
+			FitIndices(block, channel, 1, &e0, &e1, 8, levels);
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				const uint32_t level = levels[i];
+				const uint64_t index = level == 0 ? 1 : (level == 7 ? 0 : 8 - level);
+				bits |= index << (i * 3);
+			}
+		}
+
+		dest[0] = value0;
+		dest[1] = value1;
+		for (uint32_t i = 0; i < 6; ++i)
+		{
+			dest[2 + i] = (uint8_t)((bits >> (i * 8)) & 0xFF);
+		}
+	}
+
+	// BC7 mode 6: a single subset with RGBA endpoints of 7 bits + a p-bit each, and 4 bit indices
+	static const uint32_t BC7_WEIGHTS4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+	struct BC7Candidate
+	{
+		uint8_t endpoints[2][4];	// 7 bit values
+		uint8_t pbits[2];
+		uint8_t indices[16];
+		float error;
+	};
+	static void EvaluateBC7(const BlockPixels& block, const float* e0, const float* e1, uint32_t pbit0, uint32_t pbit1, BC7Candidate& candidate)
+	{
+		float palette[16][4];
+		float endpoints[2][4];
+		const float* source[2] = { e0, e1 };
+		const uint32_t pbits[2] = { pbit0, pbit1 };
+		for (uint32_t e = 0; e < 2; ++e)
+		{
+			candidate.pbits[e] = (uint8_t)pbits[e];
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				const int quantized = min(127, max(0, (int)((source[e][c] - pbits[e]) / 2 + 0.5f)));
+				candidate.endpoints[e][c] = (uint8_t)quantized;
+				endpoints[e][c] = float((quantized << 1) | pbits[e]);
+			}
+		}
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				const uint32_t a = (uint32_t)endpoints[0][c];
+				const uint32_t b = (uint32_t)endpoints[1][c];
+				palette[i][c] = float(((64 - BC7_WEIGHTS4[i]) * a + BC7_WEIGHTS4[i] * b + 32) >> 6);
+			}
+		}
+
+		FitIndices(block, 0, 4, endpoints[0], endpoints[1], 16, candidate.indices);
+
+		candidate.error = 0;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			// The weights are not exactly uniform, check the neighbours of the projected index too:
+			const uint32_t projected = candidate.indices[i];
+			float bestError = FLT_MAX;
+			for (uint32_t index = (projected > 0 ? projected - 1 : 0); index <= min(15u, projected + 1); ++index)
+			{
+				float error = 0;
+				for (uint32_t c = 0; c < 4; ++c)
+				{
+					const float diff = block.channels[c][i] - palette[index][c];
+					error += diff * diff;
+				}
+				if (error < bestError)
+				{
+					bestError = error;
+					candidate.indices[i] = (uint8_t)index;
+				}
+			}
+			candidate.error += bestError;
+		}
+	}
+	static void EvaluateBC7PBits(const BlockPixels& block, const float* e0, const float* e1, BC7Candidate& best)
+	{
+		BC7Candidate candidate;
+		for (uint32_t p = 0; p < 4; ++p)
+		{
+			EvaluateBC7(block, e0, e1, p & 1, p >> 1, candidate);
+			if (candidate.error < best.error)
+			{
+				best = candidate;
+			}
+		}
+	}
+	struct BitWriter
+	{
+		uint8_t* dest;
+		uint32_t position = 0;
+
+		BitWriter(uint8_t* dest) :dest(dest)
+		{
+			memset(dest, 0, 16);
+		}
+		void write(uint32_t value, uint32_t bitCount)
+		{
+			for (uint32_t i = 0; i < bitCount; ++i, ++position)
+			{
+				dest[position / 8] |= ((value >> i) & 1) << (position % 8);
+			}
+		}
+	};
+	static void EncodeBC7(const BlockPixels& block, uint8_t* dest)
+	{
+		float e0[4], e1[4];
+		FindEndpoints(block, 4, e0, e1);
+
+		BC7Candidate best;
+		best.error = FLT_MAX;
+		EvaluateBC7PBits(block, e0, e1, best);
+
+		if (best.error > 0)
+		{
+			float r0[4], r1[4];
+			if (RefineEndpoints(block, 0, 4, best.indices, 16, r0, r1))
+			{
+				EvaluateBC7PBits(block, r0, r1, best);
+			}
+		}
+
+		// The highest bit of the first index is implicitly 0, so the endpoints are swapped if it would be 1:
+		if (best.indices[0] & 8)
+		{
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				swap(best.endpoints[0][c], best.endpoints[1][c]);
+			}
+			swap(best.pbits[0], best.pbits[1]);
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				best.indices[i] = 15 - best.indices[i];
+			}
+		}
+
+		BitWriter writer(dest);
+		writer.write(1 << 6, 7);
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			writer.write(best.endpoints[0][c], 7);
+			writer.write(best.endpoints[1][c], 7);
+		}
+		writer.write(best.pbits[0], 1);
+		writer.write(best.pbits[1], 1);
+		writer.write(best.indices[0], 3);
+		for (uint32_t i = 1; i < 16; ++i)
+		{
+			writer.write(best.indices[i], 4);
+		}
+	}
+
+	bool Compress(const Image& src, FORMAT format, Image& dst)
+	{
+		assert(src.format == FORMAT_R8G8B8A8_UNORM);
+		if (src.format != FORMAT_R8G8B8A8_UNORM || !IsFormatSupported(format))
+		{
+			return false;
+		}
+		if (!IsBlockCompressed(format))
+		{
+			dst = src;
+			return true;
+		}
+		if (src.width % 4 != 0 || src.height % 4 != 0)
+		{
+			return false;
+		}
+
+		const uint32_t stride = GetFormatStride(format);
+
+		dst.format = format;
+		dst.width = src.width;
+		dst.height = src.height;
+		dst.mips.resize(src.mips.size());
+
+		// Every row of blocks in every mip is a separate job:
+		struct BlockRow
+		{
+			uint32_t mip;
+			uint32_t y;
+		};
+		vector<BlockRow> rows;
+		for (uint32_t mip = 0; mip < (uint32_t)src.mips.size(); ++mip)
+		{
+			const MipLevel& source = src.mips[mip];
+			MipLevel& level = dst.mips[mip];
+			const uint32_t blocksX = max(1u, (source.width + 3) / 4);
+			const uint32_t blocksY = max(1u, (source.height + 3) / 4);
+			level.width = source.width;
+			level.height = source.height;
+			level.rowPitch = blocksX * stride;
+			level.data.resize((size_t)level.rowPitch * blocksY);
+
+			for (uint32_t y = 0; y < blocksY; ++y)
+			{
+				rows.push_back({ mip, y });
+			}
+		}
+
+		wiJobSystem::context ctx;
+		wiJobSystem::Dispatch(ctx, (uint32_t)rows.size(), 1, [&](wiJobSystem::JobDispatchArgs args) {
+
+			const BlockRow& row = rows[args.jobIndex];
+			const MipLevel& source = src.mips[row.mip];
+			MipLevel& level = dst.mips[row.mip];
+			const uint32_t blocksX = level.rowPitch / stride;
+
+			BlockPixels block;
+			for (uint32_t x = 0; x < blocksX; ++x)
+			{
+				LoadBlock(source, x, row.y, block);
+				uint8_t* dest = &level.data[(size_t)row.y * level.rowPitch + x * stride];
+
+				switch (format)
+				{
+				case FORMAT_BC1_UNORM:
+					EncodeBC1(block, dest);
+					break;
+				case FORMAT_BC3_UNORM:
+					EncodeBC4(block, 3, dest);
+					EncodeBC1(block, dest + 8);
+					break;
+				case FORMAT_BC5_UNORM:
+					EncodeBC4(block, 0, dest);
+					EncodeBC4(block, 1, dest + 8);
+					break;
+				case FORMAT_BC7_UNORM:
+					EncodeBC7(block, dest);
+					break;
+				default:
+					break;
+				}
+			}
+
+		});
+		wiJobSystem::Wait(ctx);
+
+		return true;
+	}
+
+
+	// DDS file layout:
+	static const uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+	static const uint32_t DDS_FOURCC_DX10 = 0x30315844; // "DX10"
+	static const uint32_t DDS_STAMP_TAG = 0x4B434957; // "WICK"
+	static const uint32_t DDSD_CAPS = 0x1;
+	static const uint32_t DDSD_HEIGHT = 0x2;
+	static const uint32_t DDSD_WIDTH = 0x4;
+	static const uint32_t DDSD_PITCH = 0x8;
+	static const uint32_t DDSD_PIXELFORMAT = 0x1000;
+	static const uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+	static const uint32_t DDSD_LINEARSIZE = 0x80000;
+	static const uint32_t DDPF_FOURCC = 0x4;
+	static const uint32_t DDSCAPS_COMPLEX = 0x8;
+	static const uint32_t DDSCAPS_TEXTURE = 0x1000;
+	static const uint32_t DDSCAPS_MIPMAP = 0x400000;
+	static const uint32_t DDS_DIMENSION_TEXTURE2D = 3;
+	static const uint32_t DDS_MAX_DIMENSION = 16384;
+
+	struct DDS_PIXELFORMAT
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t fourCC;
+		uint32_t RGBBitCount;
+		uint32_t RBitMask;
+		uint32_t GBitMask;
+		uint32_t BBitMask;
+		uint32_t ABitMask;
+	};
+	struct DDS_HEADER
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t height;
+		uint32_t width;
+		uint32_t pitchOrLinearSize;
+		uint32_t depth;
+		uint32_t mipMapCount;
+		uint32_t reserved1[11];
+		DDS_PIXELFORMAT ddspf;
+		uint32_t caps;
+		uint32_t caps2;
+		uint32_t caps3;
+		uint32_t caps4;
+		uint32_t reserved2;
+	};
+	struct DDS_HEADER_DXT10
+	{
+		uint32_t dxgiFormat;
+		uint32_t resourceDimension;
+		uint32_t miscFlag;
+		uint32_t arraySize;
+		uint32_t miscFlags2;
+	};
+	static_assert(sizeof(DDS_HEADER) == 124, "Invalid DDS header size!");
+
+	// DXGI_FORMAT values
+	static uint32_t GetDXGIFormat(FORMAT format)
+	{
+		switch (format)
+		{
+		case FORMAT_R8G8B8A8_UNORM:
+			return 28;
+		case FORMAT_BC1_UNORM:
+			return 71;
+		case FORMAT_BC3_UNORM:
+			return 77;
+		case FORMAT_BC5_UNORM:
+			return 83;
+		case FORMAT_BC7_UNORM:
+			return 98;
+		default:
+			return 0;
+		}
+	}
+	static FORMAT GetFormatFromDXGI(uint32_t dxgiFormat)
+	{
+		switch (dxgiFormat)
+		{
+		case 28:
+			return FORMAT_R8G8B8A8_UNORM;
+		case 71:
+			return FORMAT_BC1_UNORM;
+		case 77:
+			return FORMAT_BC3_UNORM;
+		case 83:
+			return FORMAT_BC5_UNORM;
+		case 98:
+			return FORMAT_BC7_UNORM;
+		default:
+			return FORMAT_UNKNOWN;
+		}
+	}
+
+	bool SaveDDS(const string& fileName, const Image& image, const SourceStamp& stamp)
+	{
+		if (!IsFormatSupported(image.format) || image.mips.empty())
+		{
+			return false;
+		}
+
+		DDS_HEADER header = {};
+		header.size = sizeof(DDS_HEADER);
+		header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT;
+		header.flags |= IsBlockCompressed(image.format) ? DDSD_LINEARSIZE : DDSD_PITCH;
+		header.height = image.height;
+		header.width = image.width;
+		header.pitchOrLinearSize = IsBlockCompressed(image.format) ? (uint32_t)image.mips[0].data.size() : image.mips[0].rowPitch;
+		header.mipMapCount = (uint32_t)image.mips.size();
+		header.reserved1[0] = DDS_STAMP_TAG;
+		header.reserved1[1] = (uint32_t)(stamp.fileSize & 0xFFFFFFFF);
+		header.reserved1[2] = (uint32_t)(stamp.fileSize >> 32);
+		header.reserved1[3] = (uint32_t)(stamp.modifiedTime & 0xFFFFFFFF);
+		header.reserved1[4] = (uint32_t)(stamp.modifiedTime >> 32);
+		header.reserved1[5] = stamp.settings;
+		header.ddspf.size = sizeof(DDS_PIXELFORMAT);
+		header.ddspf.flags = DDPF_FOURCC;
+		header.ddspf.fourCC = DDS_FOURCC_DX10;
+		header.caps = DDSCAPS_TEXTURE | DDSCAPS_COMPLEX | DDSCAPS_MIPMAP;
+
+		DDS_HEADER_DXT10 header10 = {};
+		header10.dxgiFormat = GetDXGIFormat(image.format);
+		header10.resourceDimension = DDS_DIMENSION_TEXTURE2D;
+		header10.arraySize = 1;
+
+		ofstream file(fileName, ios::binary | ios::trunc);
+		if (!file.is_open())
+		{
+			return false;
+		}
+		file.write((const char*)&DDS_MAGIC, sizeof(DDS_MAGIC));
+		file.write((const char*)&header, sizeof(header));
+		file.write((const char*)&header10, sizeof(header10));
+		for (const MipLevel& mip : image.mips)
+		{
+			file.write((const char*)mip.data.data(), mip.data.size());
+		}
+		return file.good();
+	}
+
+	bool LoadDDS(const string& fileName, Image& image, SourceStamp* stamp)
+	{
+		ifstream file(fileName, ios::binary);
+		if (!file.is_open())
+		{
+			return false;
+		}
+
+		uint32_t magic = 0;
+		DDS_HEADER header = {};
+		DDS_HEADER_DXT10 header10 = {};
+		file.read((char*)&magic, sizeof(magic));
+		file.read((char*)&header, sizeof(header));
+		if (!file.good() || magic != DDS_MAGIC || header.size != sizeof(DDS_HEADER) || header.ddspf.fourCC != DDS_FOURCC_DX10)
+		{
+			return false;
+		}
+		file.read((char*)&header10, sizeof(header10));
+
+		const FORMAT format = GetFormatFromDXGI(header10.dxgiFormat);
+		if (!file.good() || format == FORMAT_UNKNOWN || header10.resourceDimension != DDS_DIMENSION_TEXTURE2D || header10.arraySize != 1 || header.width == 0 || header.height == 0)
+		{
+			return false;
+		}
+
+		if (stamp != nullptr)
+		{
+			*stamp = SourceStamp();
+			if (header.reserved1[0] == DDS_STAMP_TAG)
+			{
+				stamp->fileSize = (uint64_t)header.reserved1[1] | ((uint64_t)header.reserved1[2] << 32);
+				stamp->modifiedTime = (uint64_t)header.reserved1[3] | ((uint64_t)header.reserved1[4] << 32);
+				stamp->settings = header.reserved1[5];
+			}
+		}
+
+		const bool blockCompressed = IsBlockCompressed(format);
+		const uint32_t stride = GetFormatStride(format);
+		const uint32_t mipCount = (header.flags & DDSD_MIPMAPCOUNT) ? max(1u, header.mipMapCount) : 1;
+
+		// The header is not trusted before it is checked against the dimensions and the size of the file, a corrupt cache file must not allocate or read garbage:
+		if (header.width > DDS_MAX_DIMENSION || header.height > DDS_MAX_DIMENSION)
+		{
+			return false;
+		}
+		uint32_t fullMipCount = 1;
+		while ((max(header.width, header.height) >> fullMipCount) > 0)
+		{
+			fullMipCount++;
+		}
+		if (mipCount > fullMipCount)
+		{
+			return false;
+		}
+		const uint32_t topRowPitch = blockCompressed ? ((header.width + 3) / 4) * stride : header.width * stride;
+		const uint32_t topSize = blockCompressed ? topRowPitch * ((header.height + 3) / 4) : topRowPitch;
+		if (header.pitchOrLinearSize != topSize)
+		{
+			return false;
+		}
+		uint64_t dataSize = 0;
+		for (uint32_t i = 0; i < mipCount; ++i)
+		{
+			const uint32_t width = max(1u, header.width >> i);
+			const uint32_t height = max(1u, header.height >> i);
+			dataSize += blockCompressed ? (uint64_t)((width + 3) / 4) * ((height + 3) / 4) * stride : (uint64_t)width * height * stride;
+		}
+		const streamoff dataStart = file.tellg();
+		file.seekg(0, ios::end);
+		const streamoff dataEnd = file.tellg();
+		file.seekg(dataStart);
+		if (!file.good() || dataEnd - dataStart != (streamoff)dataSize)
+		{
+			return false;
+		}
+
+		image.format = format;
+		image.width = header.width;
+		image.height = header.height;
+		image.mips.resize(mipCount);
+		uint32_t width = header.width;
+		uint32_t height = header.height;
+		for (MipLevel& mip : image.mips)
+		{
+			mip.width = width;
+			mip.height = height;
+			const uint32_t rows = blockCompressed ? (height + 3) / 4 : height;
+			mip.rowPitch = blockCompressed ? ((width + 3) / 4) * stride : width * stride;
+			mip.data.resize((size_t)mip.rowPitch * rows);
+			file.read((char*)mip.data.data(), mip.data.size());
+			if (!file.good())
+			{
+				image.mips.clear();
+				return false;
+			}
+
+			width = max(1u, width / 2);
+			height = max(1u, height / 2);
+		}
+
+		return true;
+	}
+}
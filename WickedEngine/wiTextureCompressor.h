@@ -0,0 +1,64 @@
+#pragma once
+#include "CommonInclude.h"
+#include "wiGraphicsAPI.h"
+
+#include <vector>
+#include <string>
+
+// CPU texture processing: mip chain generation, block compression and dds files
+//	Block compression is executed in parallel on the wiJobSystem, one job per row of blocks.
+namespace wiTextureCompressor
+{
+	struct MipLevel
+	{
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t rowPitch = 0;			// bytes in a row of pixels, or in a row of 4x4 blocks for block compressed formats
+		std::vector<uint8_t> data;
+	};
+
+	struct Image
+	{
+		wiGraphicsTypes::FORMAT format = wiGraphicsTypes::FORMAT_R8G8B8A8_UNORM;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		std::vector<MipLevel> mips;
+	};
+
+	enum MIP_FILTER
+	{
+		MIP_FILTER_COLOR,		// rgb is sRGB encoded, it is filtered in linear space. Alpha is filtered linearly
+		MIP_FILTER_LINEAR,		// every channel is filtered as it is stored
+		MIP_FILTER_NORMALMAP,	// rgb is a unit vector, it is renormalized after filtering. Alpha is filtered linearly
+	};
+
+	// Supported formats: FORMAT_R8G8B8A8_UNORM, FORMAT_BC1_UNORM, FORMAT_BC3_UNORM, FORMAT_BC5_UNORM, FORMAT_BC7_UNORM
+	bool IsFormatSupported(wiGraphicsTypes::FORMAT format);
+	bool IsBlockCompressed(wiGraphicsTypes::FORMAT format);
+	// Bytes in a 4x4 block of a block compressed format, or in a pixel of an uncompressed format
+	uint32_t GetFormatStride(wiGraphicsTypes::FORMAT format);
+	// Whether the rgba8 image has any alpha value that is not 255
+	bool HasTransparency(const uint8_t* rgba, uint32_t width, uint32_t height);
+
+	// Create an FORMAT_R8G8B8A8_UNORM image from rgba8 pixels with the full mip chain down to 1x1. Every mip is filtered from the previous one in floating point.
+	void GenerateMipChain(const uint8_t* rgba, uint32_t width, uint32_t height, MIP_FILTER filter, Image& image);
+	// Compress every mip of an FORMAT_R8G8B8A8_UNORM image
+	//	BC1: rgb, BC3: rgb + alpha, BC5: red and green channels, BC7: rgba with higher quality (mode 6)
+	//	Block compressed textures require that the top level dimensions are multiples of 4, otherwise it returns false
+	bool Compress(const Image& src, wiGraphicsTypes::FORMAT format, Image& dst);
+
+	// Identifies the source file of a cached texture, it is stored in the reserved fields of the dds header
+	struct SourceStamp
+	{
+		uint64_t fileSize = 0;
+		uint64_t modifiedTime = 0;
+		uint32_t settings = 0;		// anything else that changes the cached result
+
+		bool operator==(const SourceStamp& other) const { return fileSize == other.fileSize && modifiedTime == other.modifiedTime && settings == other.settings; }
+	};
+
+	// Write the image with a DX10 dds header
+	bool SaveDDS(const std::string& fileName, const Image& image, const SourceStamp& stamp = SourceStamp());
+	// Read a dds file written by SaveDDS. Returns false for other kinds of dds files
+	bool LoadDDS(const std::string& fileName, Image& image, SourceStamp* stamp = nullptr);
+}
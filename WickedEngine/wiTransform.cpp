@@ -3,11 +3,19 @@
 #include "wiMath.h"
 
 #include <vector>
+#include <cstring>
 
 namespace wiSceneComponents
 {
 
 std::atomic<uint64_t> Node::__Unique_ID_Counter = 0;
+std::atomic<uint64_t> Transform::__Hierarchy_Version = 0;
+
+template<typename T>
+static bool BitwiseEqual(const T& a, const T& b)
+{
+	return memcmp(&a, &b, sizeof(T)) == 0;
+}
 
 Node::Node() {
 	name = "";
@@ -38,6 +46,7 @@ Transform::~Transform()
 {
 	detach();
 	detachChild();
+	InvalidateHierarchy();
 }
 
 
@@ -58,6 +67,7 @@ void Transform::attachTo(Transform* newParent, int copyTranslation, int copyRota
 		copyParentS = copyScale;
 		XMStoreFloat4x4(&parent_inv_rest, XMMatrixInverse(nullptr, parent->getMatrix(copyParentT, copyParentR, copyParentS)));
 		parent->children.insert(this);
+		InvalidateHierarchy();
 	}
 }
 Transform* Transform::find(const std::string& findname)
@@ -126,6 +136,7 @@ void Transform::detach() {
 			parent->children.erase(this);
 		}
 		applyTransform(copyParentT, copyParentR, copyParentS);
+		InvalidateHierarchy();
 	}
 	parent = nullptr;
 }
@@ -166,12 +177,38 @@ void Transform::transform(const XMMATRIX& m)
 	}
 }
 void Transform::UpdateTransform()
+{
+	std::vector<Transform*> hierarchy;
+	GatherHierarchy(hierarchy);
+	for (Transform* x : hierarchy)
+	{
+		x->UpdateTransformNode();
+	}
+}
+void Transform::UpdateTransformNode()
 {
 	worldPrev = world;
 	translationPrev = translation;
 	scalePrev = scale;
 	rotationPrev = rotation;
 
+	if (parent != nullptr)
+	{
+		hasChanged = hasChanged || parent->hasChanged;
+	}
+
+	// Nothing to do if the world matrix was computed from the same inputs and it was not overwritten since:
+	if (updateCache.valid &&
+		updateCache.parent == parent &&
+		BitwiseEqual(updateCache.translation_rest, translation_rest) &&
+		BitwiseEqual(updateCache.rotation_rest, rotation_rest) &&
+		BitwiseEqual(updateCache.scale_rest, scale_rest) &&
+		BitwiseEqual(updateCache.world, world) &&
+		(parent == nullptr || (BitwiseEqual(updateCache.parent_world, parent->world) && BitwiseEqual(updateCache.parent_inv_rest, parent_inv_rest))))
+	{
+		return;
+	}
+
 	XMVECTOR s = XMLoadFloat3(&scale_rest);
 	XMVECTOR r = XMLoadFloat4(&rotation_rest);
 	XMVECTOR t = XMLoadFloat3(&translation_rest);
@@ -182,29 +219,57 @@ void Transform::UpdateTransform()
 		;
 	XMStoreFloat4x4(&world_rest, w);
 
+	bool relativeToParent = false;
 	if (parent != nullptr)
 	{
-		w = w * XMLoadFloat4x4(&parent_inv_rest) * parent->getMatrix();
-		XMVECTOR v[3];
-		XMMatrixDecompose(&v[0], &v[1], &v[2], w);
-		XMStoreFloat3(&scale, v[0]);
-		XMStoreFloat4(&rotation, v[1]);
-		XMStoreFloat3(&translation, v[2]);
-		XMStoreFloat4x4(&world, w);
-
-		hasChanged = hasChanged || parent->hasChanged;
+		// The parent transform relative to its state when this was attached. Usually the parent didn't move since then, and this is identity:
+		XMMATRIX parentRelative = XMLoadFloat4x4(&parent_inv_rest) * parent->getMatrix();
+		const XMVECTOR epsilon = XMVectorReplicate(0.00001f);
+		relativeToParent = !(
+			XMVector4NearEqual(parentRelative.r[0], g_XMIdentityR0, epsilon) &&
+			XMVector4NearEqual(parentRelative.r[1], g_XMIdentityR1, epsilon) &&
+			XMVector4NearEqual(parentRelative.r[2], g_XMIdentityR2, epsilon) &&
+			XMVector4NearEqual(parentRelative.r[3], g_XMIdentityR3, epsilon)
+			);
+
+		if (relativeToParent)
+		{
+			w = w * parentRelative;
+			XMVECTOR v[3];
+			XMMatrixDecompose(&v[0], &v[1], &v[2], w);
+			XMStoreFloat3(&scale, v[0]);
+			XMStoreFloat4(&rotation, v[1]);
+			XMStoreFloat3(&translation, v[2]);
+			XMStoreFloat4x4(&world, w);
+		}
 	}
-	else
+	if (!relativeToParent)
 	{
+		// The rest pose is the world pose, no need to decompose:
 		world = world_rest;
 		translation = translation_rest;
 		rotation = rotation_rest;
 		scale = scale_rest;
 	}
 
+	updateCache.valid = true;
+	updateCache.parent = parent;
+	updateCache.translation_rest = translation_rest;
+	updateCache.rotation_rest = rotation_rest;
+	updateCache.scale_rest = scale_rest;
+	updateCache.parent_inv_rest = parent_inv_rest;
+	if (parent != nullptr)
+	{
+		updateCache.parent_world = parent->world;
+	}
+	updateCache.world = world;
+}
+void Transform::GatherHierarchy(std::vector<Transform*>& result)
+{
+	result.push_back(this);
 	for (Transform* child : children)
 	{
-		child->UpdateTransform();
+		child->GatherHierarchy(result);
 	}
 }
 void Transform::Translate(const XMFLOAT3& value)
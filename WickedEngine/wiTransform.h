@@ -4,6 +4,7 @@
 
 #include <atomic>
 #include <set>
+#include <vector>
 
 class wiArchive;
 
@@ -81,11 +82,32 @@ struct Transform : public Node
 	void CatmullRom(const Transform* a, const Transform* b, const Transform* c, const Transform* d, float t);
 	// Update this transform and children recursively
 	virtual void UpdateTransform();
+	// Update only this transform, the parent must be already up to date
+	virtual void UpdateTransformNode();
+	// Append this transform and every transform that is updated from it, parents before their children
+	virtual void GatherHierarchy(std::vector<Transform*>& result);
 	// Get the root of the tree
 	Transform* GetRoot();
 	// Layer mask with parent hierarchy masking
 	virtual uint32_t GetLayerMask() const override;
 	void Serialize(wiArchive& archive);
+
+	// Changes every time a transform is attached, detached or destroyed anywhere, so flattened hierarchies can be cached
+	static uint64_t GetHierarchyVersion() { return __Hierarchy_Version.load(); }
+	static void InvalidateHierarchy() { __Hierarchy_Version.fetch_add(1); }
+
+private:
+	static std::atomic<uint64_t> __Hierarchy_Version;
+
+	// The inputs and the result of the last world matrix computation. If none of them changed, the update can be skipped:
+	struct UpdateCache
+	{
+		bool valid = false;
+		const Transform* parent = nullptr;
+		XMFLOAT3 translation_rest, scale_rest;
+		XMFLOAT4 rotation_rest;
+		XMFLOAT4X4 parent_inv_rest, parent_world, world;
+	} updateCache;
 };
 
 }
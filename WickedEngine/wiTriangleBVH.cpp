@@ -0,0 +1,446 @@
+#include "wiTriangleBVH.h"
+
+#include <algorithm>
+#include <cassert>
+
+using namespace std;
+
+#define TRIANGLE_BVH_BIN_COUNT 16
+// Below this depth, nodes are split in the middle, so the depth stays bounded even for degenerate input
+#define TRIANGLE_BVH_MAX_DEPTH 48
+#define TRIANGLE_BVH_STACK_SIZE 128
+// Determinant limit of the ray - triangle test, same as DirectX::TriangleTests::Intersects()
+#define TRIANGLE_BVH_RAY_EPSILON 1e-20f
+
+
+namespace
+{
+	inline float HalfArea(const XMFLOAT3& aabbMin, const XMFLOAT3& aabbMax)
+	{
+		const float x = aabbMax.x - aabbMin.x;
+		const float y = aabbMax.y - aabbMin.y;
+		const float z = aabbMax.z - aabbMin.z;
+		return x * y + y * z + z * x;
+	}
+	inline float GetComponent(const XMFLOAT3& v, int axis)
+	{
+		return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+	}
+	inline void Merge(XMFLOAT3& aabbMin, XMFLOAT3& aabbMax, const XMFLOAT3& otherMin, const XMFLOAT3& otherMax)
+	{
+		aabbMin = XMFLOAT3(min(aabbMin.x, otherMin.x), min(aabbMin.y, otherMin.y), min(aabbMin.z, otherMin.z));
+		aabbMax = XMFLOAT3(max(aabbMax.x, otherMax.x), max(aabbMax.y, otherMax.y), max(aabbMax.z, otherMax.z));
+	}
+	inline XMFLOAT3 GetPosition(const float* positions, uint32_t stride, uint32_t index)
+	{
+		const float* p = (const float*)((const uint8_t*)positions + (size_t)index * stride);
+		return XMFLOAT3(p[0], p[1], p[2]);
+	}
+
+	// Ray - box slab test, returns the entry distance or FLT_MAX if the box is missed or farther than maxDistance
+	inline float IntersectBox(const XMFLOAT3& origin, const XMFLOAT3& directionInverse, const XMFLOAT3& aabbMin, const XMFLOAT3& aabbMax, float maxDistance)
+	{
+		const float tx1 = (aabbMin.x - origin.x) * directionInverse.x;
+		const float tx2 = (aabbMax.x - origin.x) * directionInverse.x;
+		const float ty1 = (aabbMin.y - origin.y) * directionInverse.y;
+		const float ty2 = (aabbMax.y - origin.y) * directionInverse.y;
+		const float tz1 = (aabbMin.z - origin.z) * directionInverse.z;
+		const float tz2 = (aabbMax.z - origin.z) * directionInverse.z;
+
+		const float tmin = max(max(min(tx1, tx2), min(ty1, ty2)), max(min(tz1, tz2), 0.0f));
+		const float tmax = min(min(max(tx1, tx2), max(ty1, ty2)), min(max(tz1, tz2), maxDistance));
+
+		return tmin <= tmax ? tmin : FLT_MAX;
+	}
+}
+
+
+void wiTriangleBVH::Build(const float* positions, uint32_t stride, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount)
+{
+	Clear();
+
+	const uint32_t count = indexCount / 3;
+	if (count == 0)
+	{
+		return;
+	}
+	triangleCount = count;
+
+	// Triangle bounds and centroids:
+	vector<XMFLOAT3> boxMin(count), boxMax(count), centroids(count);
+	vector<uint32_t> order(count);
+	for (uint32_t t = 0; t < count; ++t)
+	{
+		assert(indices[t * 3 + 0] < vertexCount && indices[t * 3 + 1] < vertexCount && indices[t * 3 + 2] < vertexCount);
+		const XMFLOAT3 p0 = GetPosition(positions, stride, indices[t * 3 + 0]);
+		const XMFLOAT3 p1 = GetPosition(positions, stride, indices[t * 3 + 1]);
+		const XMFLOAT3 p2 = GetPosition(positions, stride, indices[t * 3 + 2]);
+		boxMin[t] = boxMax[t] = p0;
+		Merge(boxMin[t], boxMax[t], p1, p1);
+		Merge(boxMin[t], boxMax[t], p2, p2);
+		centroids[t] = XMFLOAT3((boxMin[t].x + boxMax[t].x) * 0.5f, (boxMin[t].y + boxMax[t].y) * 0.5f, (boxMin[t].z + boxMax[t].z) * 0.5f);
+		order[t] = t;
+	}
+
+	struct Range
+	{
+		uint32_t node;
+		uint32_t first;
+		uint32_t count;
+		uint32_t depth;
+	};
+	vector<Range> stack;
+	stack.push_back({ 0, 0, count, 0 });
+	nodes.reserve((count / PACKET_SIZE + 1) * 2);
+	packets.reserve(count / PACKET_SIZE + 1);
+	nodes.emplace_back();
+
+	struct Bin
+	{
+		XMFLOAT3 aabbMin;
+		XMFLOAT3 aabbMax;
+		uint32_t count;
+	};
+	Bin bins[TRIANGLE_BVH_BIN_COUNT];
+	float rightCosts[TRIANGLE_BVH_BIN_COUNT];
+
+	while (!stack.empty())
+	{
+		const Range range = stack.back();
+		stack.pop_back();
+
+		if (range.count <= PACKET_SIZE)
+		{
+			Node& node = nodes[range.node];
+			node.left = 0;
+			node.packet = (uint32_t)packets.size();
+			packets.emplace_back();
+			TrianglePacket& packet = packets.back();
+			for (uint32_t i = 0; i < PACKET_SIZE; ++i)
+			{
+				packet.triangle[i] = i < range.count ? order[range.first + i] : ~0u;
+			}
+			continue;
+		}
+
+		// Split along the longest axis of the centroid bounds:
+		XMFLOAT3 centroidMin = centroids[order[range.first]];
+		XMFLOAT3 centroidMax = centroidMin;
+		for (uint32_t i = range.first + 1; i < range.first + range.count; ++i)
+		{
+			Merge(centroidMin, centroidMax, centroids[order[i]], centroids[order[i]]);
+		}
+		const XMFLOAT3 extent = XMFLOAT3(centroidMax.x - centroidMin.x, centroidMax.y - centroidMin.y, centroidMax.z - centroidMin.z);
+		const int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+		const float axisMin = GetComponent(centroidMin, axis);
+		const float axisExtent = GetComponent(extent, axis);
+
+		uint32_t* first = &order[range.first];
+		uint32_t* last = first + range.count;
+		uint32_t* split = nullptr;
+
+		if (axisExtent > 0 && range.depth < TRIANGLE_BVH_MAX_DEPTH)
+		{
+			// Binned surface area heuristic:
+			const float scale = (float)TRIANGLE_BVH_BIN_COUNT / axisExtent;
+			for (Bin& bin : bins)
+			{
+				bin.aabbMin = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+				bin.aabbMax = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+				bin.count = 0;
+			}
+			for (uint32_t* it = first; it != last; ++it)
+			{
+				const int b = min(TRIANGLE_BVH_BIN_COUNT - 1, (int)((GetComponent(centroids[*it], axis) - axisMin) * scale));
+				Merge(bins[b].aabbMin, bins[b].aabbMax, boxMin[*it], boxMax[*it]);
+				bins[b].count++;
+			}
+
+			XMFLOAT3 rightMin = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+			XMFLOAT3 rightMax = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+			uint32_t rightCount = 0;
+			for (int b = TRIANGLE_BVH_BIN_COUNT - 1; b > 0; --b)
+			{
+				Merge(rightMin, rightMax, bins[b].aabbMin, bins[b].aabbMax);
+				rightCount += bins[b].count;
+				rightCosts[b] = rightCount > 0 ? HalfArea(rightMin, rightMax) * rightCount : 0;
+			}
+
+			XMFLOAT3 leftMin = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+			XMFLOAT3 leftMax = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+			uint32_t leftCount = 0;
+			float bestCost = FLT_MAX;
+			int bestSplit = -1;
+			for (int b = 0; b < TRIANGLE_BVH_BIN_COUNT - 1; ++b)
+			{
+				Merge(leftMin, leftMax, bins[b].aabbMin, bins[b].aabbMax);
+				leftCount += bins[b].count;
+				if (leftCount == 0 || leftCount == range.count)
+				{
+					continue;
+				}
+				const float cost = HalfArea(leftMin, leftMax) * leftCount + rightCosts[b + 1];
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestSplit = b;
+				}
+			}
+
+			if (bestSplit >= 0)
+			{
+				split = std::partition(first, last, [&](uint32_t t) {
+					return min(TRIANGLE_BVH_BIN_COUNT - 1, (int)((GetComponent(centroids[t], axis) - axisMin) * scale)) <= bestSplit;
+				});
+			}
+		}
+		if (split == nullptr || split == first || split == last)
+		{
+			// Split in the middle:
+			split = first + range.count / 2;
+			std::nth_element(first, split, last, [&](uint32_t a, uint32_t b) {
+				return GetComponent(centroids[a], axis) < GetComponent(centroids[b], axis);
+			});
+		}
+
+		const uint32_t left = (uint32_t)nodes.size();
+		nodes[range.node].left = left;
+		nodes.emplace_back();
+		nodes.emplace_back();
+
+		const uint32_t leftCount = (uint32_t)(split - first);
+		stack.push_back({ left + 1, range.first + leftCount, range.count - leftCount, range.depth + 1 });
+		stack.push_back({ left, range.first, leftCount, range.depth + 1 });
+	}
+
+	Refit(positions, stride, indices);
+}
+
+void wiTriangleBVH::Refit(const float* positions, uint32_t stride, const uint32_t* indices)
+{
+	for (TrianglePacket& packet : packets)
+	{
+		FillPacket(packet, positions, stride, indices);
+	}
+	UpdateBounds();
+}
+
+void wiTriangleBVH::Clear()
+{
+	nodes.clear();
+	packets.clear();
+	triangleCount = 0;
+}
+
+void wiTriangleBVH::FillPacket(TrianglePacket& packet, const float* positions, uint32_t stride, const uint32_t* indices) const
+{
+	float* v0 = &packet.v0[0].x;
+	float* e1 = &packet.e1[0].x;
+	float* e2 = &packet.e2[0].x;
+	for (uint32_t i = 0; i < PACKET_SIZE; ++i)
+	{
+		XMFLOAT3 p0 = XMFLOAT3(0, 0, 0);
+		XMFLOAT3 p1 = XMFLOAT3(0, 0, 0);
+		XMFLOAT3 p2 = XMFLOAT3(0, 0, 0);
+		if (packet.triangle[i] != ~0u)
+		{
+			p0 = GetPosition(positions, stride, indices[packet.triangle[i] * 3 + 0]);
+			p1 = GetPosition(positions, stride, indices[packet.triangle[i] * 3 + 1]);
+			p2 = GetPosition(positions, stride, indices[packet.triangle[i] * 3 + 2]);
+		}
+		// The XMFLOAT4 arrays are x, y, z rows of PACKET_SIZE lanes:
+		v0[0 * PACKET_SIZE + i] = p0.x;
+		v0[1 * PACKET_SIZE + i] = p0.y;
+		v0[2 * PACKET_SIZE + i] = p0.z;
+		e1[0 * PACKET_SIZE + i] = p1.x - p0.x;
+		e1[1 * PACKET_SIZE + i] = p1.y - p0.y;
+		e1[2 * PACKET_SIZE + i] = p1.z - p0.z;
+		e2[0 * PACKET_SIZE + i] = p2.x - p0.x;
+		e2[1 * PACKET_SIZE + i] = p2.y - p0.y;
+		e2[2 * PACKET_SIZE + i] = p2.z - p0.z;
+	}
+}
+
+void wiTriangleBVH::UpdateBounds()
+{
+	// The children are always after their parent:
+	for (size_t i = nodes.size(); i-- > 0;)
+	{
+		Node& node = nodes[i];
+		node.aabbMin = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+		node.aabbMax = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+		if (node.IsLeaf())
+		{
+			const TrianglePacket& packet = packets[node.packet];
+			const float* v0 = &packet.v0[0].x;
+			const float* e1 = &packet.e1[0].x;
+			const float* e2 = &packet.e2[0].x;
+			for (uint32_t j = 0; j < PACKET_SIZE; ++j)
+			{
+				if (packet.triangle[j] == ~0u)
+				{
+					continue;
+				}
+				const XMFLOAT3 p0 = XMFLOAT3(v0[j], v0[PACKET_SIZE + j], v0[2 * PACKET_SIZE + j]);
+				const XMFLOAT3 p1 = XMFLOAT3(p0.x + e1[j], p0.y + e1[PACKET_SIZE + j], p0.z + e1[2 * PACKET_SIZE + j]);
+				const XMFLOAT3 p2 = XMFLOAT3(p0.x + e2[j], p0.y + e2[PACKET_SIZE + j], p0.z + e2[2 * PACKET_SIZE + j]);
+				Merge(node.aabbMin, node.aabbMax, p0, p0);
+				Merge(node.aabbMin, node.aabbMax, p1, p1);
+				Merge(node.aabbMin, node.aabbMax, p2, p2);
+			}
+		}
+		else
+		{
+			Merge(node.aabbMin, node.aabbMax, nodes[node.left].aabbMin, nodes[node.left].aabbMax);
+			Merge(node.aabbMin, node.aabbMax, nodes[node.left + 1].aabbMin, nodes[node.left + 1].aabbMax);
+		}
+	}
+}
+
+bool wiTriangleBVH::Intersect(const XMFLOAT3& origin, const XMFLOAT3& direction, Hit& hit) const
+{
+	if (nodes.empty())
+	{
+		return false;
+	}
+
+	const XMFLOAT3 directionInverse = XMFLOAT3(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+
+	// The ray is replicated into every lane, it is tested against a whole triangle packet at once (Moller-Trumbore):
+	const XMVECTOR ox = XMVectorReplicate(origin.x);
+	const XMVECTOR oy = XMVectorReplicate(origin.y);
+	const XMVECTOR oz = XMVectorReplicate(origin.z);
+	const XMVECTOR dx = XMVectorReplicate(direction.x);
+	const XMVECTOR dy = XMVectorReplicate(direction.y);
+	const XMVECTOR dz = XMVectorReplicate(direction.z);
+	const XMVECTOR zero = XMVectorZero();
+	const XMVECTOR one = XMVectorSplatOne();
+	const XMVECTOR epsilon = XMVectorReplicate(TRIANGLE_BVH_RAY_EPSILON);
+
+	bool result = false;
+
+	// Closer nodes are visited first, so that farther ones can be skipped when they are behind the closest hit so far:
+	struct StackEntry
+	{
+		uint32_t node;
+		float distance;
+	};
+	StackEntry stack[TRIANGLE_BVH_STACK_SIZE];
+	uint32_t stackSize = 0;
+
+	float rootDistance = IntersectBox(origin, directionInverse, nodes[0].aabbMin, nodes[0].aabbMax, hit.distance);
+	if (rootDistance != FLT_MAX)
+	{
+		stack[stackSize++] = { 0, rootDistance };
+	}
+
+	while (stackSize > 0)
+	{
+		const StackEntry entry = stack[--stackSize];
+		if (entry.distance >= hit.distance)
+		{
+			continue;
+		}
+		const Node& node = nodes[entry.node];
+
+		if (node.IsLeaf())
+		{
+			const TrianglePacket& packet = packets[node.packet];
+			const XMVECTOR v0x = XMLoadFloat4(&packet.v0[0]);
+			const XMVECTOR v0y = XMLoadFloat4(&packet.v0[1]);
+			const XMVECTOR v0z = XMLoadFloat4(&packet.v0[2]);
+			const XMVECTOR e1x = XMLoadFloat4(&packet.e1[0]);
+			const XMVECTOR e1y = XMLoadFloat4(&packet.e1[1]);
+			const XMVECTOR e1z = XMLoadFloat4(&packet.e1[2]);
+			const XMVECTOR e2x = XMLoadFloat4(&packet.e2[0]);
+			const XMVECTOR e2y = XMLoadFloat4(&packet.e2[1]);
+			const XMVECTOR e2z = XMLoadFloat4(&packet.e2[2]);
+
+			// p = cross(direction, e2)
+			const XMVECTOR px = XMVectorSubtract(XMVectorMultiply(dy, e2z), XMVectorMultiply(dz, e2y));
+			const XMVECTOR py = XMVectorSubtract(XMVectorMultiply(dz, e2x), XMVectorMultiply(dx, e2z));
+			const XMVECTOR pz = XMVectorSubtract(XMVectorMultiply(dx, e2y), XMVectorMultiply(dy, e2x));
+			const XMVECTOR det = XMVectorAdd(XMVectorAdd(XMVectorMultiply(e1x, px), XMVectorMultiply(e1y, py)), XMVectorMultiply(e1z, pz));
+			const XMVECTOR detInverse = XMVectorReciprocal(det);
+
+			// s = origin - v0
+			const XMVECTOR sx = XMVectorSubtract(ox, v0x);
+			const XMVECTOR sy = XMVectorSubtract(oy, v0y);
+			const XMVECTOR sz = XMVectorSubtract(oz, v0z);
+			const XMVECTOR u = XMVectorMultiply(XMVectorAdd(XMVectorAdd(XMVectorMultiply(sx, px), XMVectorMultiply(sy, py)), XMVectorMultiply(sz, pz)), detInverse);
+
+			// q = cross(s, e1)
+			const XMVECTOR qx = XMVectorSubtract(XMVectorMultiply(sy, e1z), XMVectorMultiply(sz, e1y));
+			const XMVECTOR qy = XMVectorSubtract(XMVectorMultiply(sz, e1x), XMVectorMultiply(sx, e1z));
+			const XMVECTOR qz = XMVectorSubtract(XMVectorMultiply(sx, e1y), XMVectorMultiply(sy, e1x));
+			const XMVECTOR v = XMVectorMultiply(XMVectorAdd(XMVectorAdd(XMVectorMultiply(dx, qx), XMVectorMultiply(dy, qy)), XMVectorMultiply(dz, qz)), detInverse);
+			const XMVECTOR t = XMVectorMultiply(XMVectorAdd(XMVectorAdd(XMVectorMultiply(e2x, qx), XMVectorMultiply(e2y, qy)), XMVectorMultiply(e2z, qz)), detInverse);
+
+			XMVECTOR mask = XMVectorGreater(XMVectorAbs(det), epsilon);
+			mask = XMVectorAndInt(mask, XMVectorGreaterOrEqual(u, zero));
+			mask = XMVectorAndInt(mask, XMVectorGreaterOrEqual(v, zero));
+			mask = XMVectorAndInt(mask, XMVectorLessOrEqual(XMVectorAdd(u, v), one));
+			mask = XMVectorAndInt(mask, XMVectorGreaterOrEqual(t, zero));
+			mask = XMVectorAndInt(mask, XMVectorLess(t, XMVectorReplicate(hit.distance)));
+
+			XMUINT4 laneMask;
+			XMStoreUInt4(&laneMask, mask);
+			if ((laneMask.x | laneMask.y | laneMask.z | laneMask.w) != 0)
+			{
+				XMFLOAT4 laneT, laneU, laneV;
+				XMStoreFloat4(&laneT, t);
+				XMStoreFloat4(&laneU, u);
+				XMStoreFloat4(&laneV, v);
+				const uint32_t* lanes = &laneMask.x;
+				uint32_t closest = PACKET_SIZE;
+				for (uint32_t i = 0; i < PACKET_SIZE; ++i)
+				{
+					if (lanes[i] != 0 && (&laneT.x)[i] < hit.distance)
+					{
+						hit.distance = (&laneT.x)[i];
+						closest = i;
+					}
+				}
+				if (closest < PACKET_SIZE)
+				{
+					hit.triangle = packet.triangle[closest];
+					hit.u = (&laneU.x)[closest];
+					hit.v = (&laneV.x)[closest];
+					// cross(e2, e1):
+					const float* e1 = &packet.e1[0].x;
+					const float* e2 = &packet.e2[0].x;
+					const XMFLOAT3 a = XMFLOAT3(e2[closest], e2[PACKET_SIZE + closest], e2[2 * PACKET_SIZE + closest]);
+					const XMFLOAT3 b = XMFLOAT3(e1[closest], e1[PACKET_SIZE + closest], e1[2 * PACKET_SIZE + closest]);
+					hit.normal = XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+					result = true;
+				}
+			}
+		}
+		else
+		{
+			const Node& left = nodes[node.left];
+			const Node& right = nodes[node.left + 1];
+			float leftDistance = IntersectBox(origin, directionInverse, left.aabbMin, left.aabbMax, hit.distance);
+			float rightDistance = IntersectBox(origin, directionInverse, right.aabbMin, right.aabbMax, hit.distance);
+			uint32_t nearNode = node.left;
+			uint32_t farNode = node.left + 1;
+			if (rightDistance < leftDistance)
+			{
+				std::swap(leftDistance, rightDistance);
+				std::swap(nearNode, farNode);
+			}
+			assert(stackSize + 2 <= TRIANGLE_BVH_STACK_SIZE);
+			if (rightDistance != FLT_MAX)
+			{
+				stack[stackSize++] = { farNode, rightDistance };
+			}
+			if (leftDistance != FLT_MAX)
+			{
+				stack[stackSize++] = { nearNode, leftDistance };
+			}
+		}
+	}
+
+	return result;
+}
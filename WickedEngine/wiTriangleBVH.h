@@ -0,0 +1,69 @@
+#pragma once
+#include "CommonInclude.h"
+
+#include <vector>
+
+// Bounding volume hierarchy over the triangles of a mesh, for ray queries on the CPU
+//	Built with the binned surface area heuristic. Nodes are stored in a contiguous array like in wiSPTree, the children of a node are always next to each other.
+//	Every leaf holds up to 4 triangles in one packet (structure of arrays layout), a ray is tested against all of them at once with SIMD instructions.
+//	Deformed meshes are refitted to the new vertex positions, the hierarchy is kept.
+class wiTriangleBVH
+{
+public:
+	static const uint32_t PACKET_SIZE = 4;
+
+	struct Node
+	{
+		XMFLOAT3 aabbMin;
+		uint32_t left;		// index of the left child, the right child is always left + 1. Zero for leaf nodes (the root can not be a child)
+		XMFLOAT3 aabbMax;
+		uint32_t packet;	// index of the triangle packet of a leaf
+
+		bool IsLeaf() const { return left == 0; }
+	};
+
+	// Up to PACKET_SIZE triangles, the components are stored in the lanes of the vectors
+	struct TrianglePacket
+	{
+		XMFLOAT4 v0[3];		// first vertex x, y, z
+		XMFLOAT4 e1[3];		// second vertex - first vertex
+		XMFLOAT4 e2[3];		// third vertex - first vertex
+		uint32_t triangle[PACKET_SIZE];	// triangle index in the index list, ~0 for unused lanes
+	};
+
+	struct Hit
+	{
+		float distance = FLT_MAX;	// in units of the ray direction. Set it before the query to limit the ray length
+		uint32_t triangle = ~0u;	// triangle index in the index list
+		float u = 0, v = 0;			// barycentric coordinates of the hit: position = v0 * (1 - u - v) + v1 * u + v2 * v
+		XMFLOAT3 normal = XMFLOAT3(0, 0, 0);	// face normal (not normalized), it points to the front side like in Mesh::ComputeNormals()
+	};
+
+	// Build the hierarchy for a triangle list
+	//	positions			: first vertex position, the vertices are stride bytes apart
+	void Build(const float* positions, uint32_t stride, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount);
+	// Update the bounds and triangles to new vertex positions of the same triangle list that it was built with
+	void Refit(const float* positions, uint32_t stride, const uint32_t* indices);
+	void Clear();
+
+	// Find the closest triangle that the ray hits, in either winding order
+	//	direction			: doesn't need to be normalized, the hit distance is measured in units of it
+	//	hit					: the distance limits the search, it is only written if a closer triangle is hit
+	//	Returns whether a triangle was hit. It is safe to call from multiple threads at the same time, but not while the hierarchy is modified.
+	bool Intersect(const XMFLOAT3& origin, const XMFLOAT3& direction, Hit& hit) const;
+
+	bool IsEmpty() const { return nodes.empty(); }
+	size_t GetNodeCount() const { return nodes.size(); }
+	size_t GetTriangleCount() const { return triangleCount; }
+	const Node& GetNode(size_t index) const { return nodes[index]; }
+
+private:
+	std::vector<Node> nodes;
+	std::vector<TrianglePacket> packets;
+	size_t triangleCount = 0;
+
+	// Fill the triangles of a packet from the vertex positions, unused lanes are degenerate and never hit
+	void FillPacket(TrianglePacket& packet, const float* positions, uint32_t stride, const uint32_t* indices) const;
+	// Recompute the node bounds bottom-up from the triangle packets
+	void UpdateBounds();
+};